@@ -175,6 +175,40 @@ static int set_mpc_style_offsets( char *buff, const double *xyz)
    return( 0);
 }
 
+/* Horizons vector tables give,  for each time,  a line with the JD and
+'A.D.' date,  then a line with the position and one with the velocity.
+With VEC_LABELS='N',  those are just three numbers;  with labels,  they
+look like ' X = 1.23E+03 Y =-4.56E+03 Z = ...'.  We handle either. */
+
+static int get_three_values( const char *buff, double *vals)
+{
+   int i;
+
+   if( !strchr( buff, '='))
+      return( 3 == sscanf( buff, "%lf %lf %lf", vals, vals + 1, vals + 2) ? 0 : -1);
+   for( i = 0; i < 3; i++)
+      {
+      buff = strchr( buff, '=');
+      if( !buff)
+         return( -1);
+      buff++;
+      vals[i] = atof( buff);
+      }
+   return( 0);
+}
+
+static int get_horizons_state( FILE *ifile, char *buff, const size_t buffsize,
+                               double *state)
+{
+   int i;
+
+   for( i = 0; i < 6; i += 3)
+      if( !fgets( buff, (int)buffsize, ifile)
+                     || get_three_values( buff, state + i))
+         return( -1);
+   return( 0);
+}
+
 const char *cmd_start =
 #ifndef _WIN32
     "curl -s -o /tmp/add_off.txt %s\""
@@ -290,16 +324,8 @@ static int set_offsets( offset_t *offsets, const int n_offsets)
                printf( "Found locations\n%s", buff);
             assert( jd > hst_launch_jd);
             assert( jd < jd_for_year_2100);
-            for( j = 0; j < 6; j += 3)
-               {
-               int n_found;
-
-               if( !fgets( buff, sizeof( buff), ifile))
-                  assert( 0);
-               n_found = sscanf( buff, "%lf %lf %lf", state + j,
-                                 state + j + 1, state + j + 2);
-               assert( 3 == n_found);
-               }
+            j = get_horizons_state( ifile, buff, sizeof( buff), state);
+            assert( !j);
             for( j = 0; j < i; j++)
                if( !strcmp( offsets[j].mpc_code, offsets[0].mpc_code)
                         && fabs( offsets[j].jd - jd) < tolerance
@@ -340,6 +366,216 @@ static int set_offsets( offset_t *offsets, const int n_offsets)
    return( 0);
 }
 
+/* For large files (WISE/NEOWISE data can run to hundreds of thousands
+of observations),  asking Horizons for 520 offsets at a time is slow,
+and you may not want to depend on network access at all.  Instead,  you
+can download a Horizons vector table (J2000 equatorial,  geocentric,
+positions and velocities in km and km/s) covering the time span of
+the observations,  and give its name with the '-e' option.  (You can
+give several such files,  one per spacecraft.)  The spacecraft is
+identified from the 'Target body name' line in the Horizons header.
+
+   Each table is loaded once into a time-sorted array.  The observations
+for that spacecraft are sorted by time,  and offsets are filled in one
+sweep through both arrays,  using cubic Hermite interpolation from the
+positions and velocities at the bracketing times.  The error in that
+scales as the fourth power of the step size;  for a spacecraft in low
+earth orbit,  a one-minute step keeps it well under a metre.  With '-e',
+no requests are made to Horizons;  observations outside the time span
+of the table,  or for spacecraft with no table,  are counted as failed. */
+
+typedef struct
+{
+   double jd, state[6];
+} ephem_node_t;
+
+typedef struct
+{
+   char mpc_code[4];
+   int n_nodes;
+   ephem_node_t *nodes;
+} vector_ephem_t;
+
+static vector_ephem_t *ephems = NULL;
+static int n_ephems = 0;
+
+static int compare_nodes( const void *a, const void *b)
+{
+   const double jd1 = ((const ephem_node_t *)a)->jd;
+   const double jd2 = ((const ephem_node_t *)b)->jd;
+
+   return( (jd1 > jd2) - (jd1 < jd2));
+}
+
+/* Horizons headers contain a line such as
+
+Target body name: WISE (spacecraft) (-163)        {source: WISE_merged}
+
+   from which we get the JPL index and,  from that,  the MPC code. */
+
+static const char *mpc_code_from_target_line( const char *buff)
+{
+   const char *tptr = strstr( buff, " (-");
+   size_t i;
+   const size_t n_xrefs = sizeof( jpl_xrefs) / sizeof( jpl_xrefs[0]);
+
+   while( tptr && strstr( tptr + 1, " (-"))
+      tptr = strstr( tptr + 1, " (-");
+   if( tptr)
+      for( i = 0; i < n_xrefs; i++)
+         if( atoi( tptr + 2) == jpl_xrefs[i].jpl_desig)
+            return( jpl_xrefs[i].mpc_code);
+   return( NULL);
+}
+
+static int load_vector_ephem( const char *filename)
+{
+   FILE *ifile = fopen( filename, "rb");
+   char buff[300];
+   vector_ephem_t *ephem;
+   int n_alloced = 0;
+
+   if( !ifile)
+      {
+      fprintf( stderr, "Ephemeris file '%s' not opened : ", filename);
+      perror( NULL);
+      return( -1);
+      }
+   ephems = (vector_ephem_t *)realloc( ephems,
+                           (n_ephems + 1) * sizeof( vector_ephem_t));
+   assert( ephems);
+   ephem = ephems + n_ephems;
+   memset( ephem, 0, sizeof( vector_ephem_t));
+   while( fgets( buff, sizeof( buff), ifile))
+      if( strstr( buff, " = A.D. ") && strstr( buff, " TDB"))
+         {
+         ephem_node_t *node;
+
+         if( ephem->n_nodes == n_alloced)
+            {
+            n_alloced = n_alloced * 2 + 1000;
+            ephem->nodes = (ephem_node_t *)realloc( ephem->nodes,
+                                    n_alloced * sizeof( ephem_node_t));
+            assert( ephem->nodes);
+            }
+         node = ephem->nodes + ephem->n_nodes;
+         node->jd = atof( buff);
+         if( !get_horizons_state( ifile, buff, sizeof( buff), node->state))
+            ephem->n_nodes++;
+         }
+      else if( !*ephem->mpc_code && strstr( buff, "Target body name:"))
+         {
+         const char *code = mpc_code_from_target_line( buff);
+
+         if( code)
+            memcpy( ephem->mpc_code, code, 3);
+         }
+   fclose( ifile);
+   if( !*ephem->mpc_code || ephem->n_nodes < 2)
+      {
+      fprintf( stderr, "'%s' isn't a Horizons vector table for a known spacecraft\n",
+                        filename);
+      free( ephem->nodes);
+      return( -2);
+      }
+   qsort( ephem->nodes, ephem->n_nodes, sizeof( ephem_node_t), compare_nodes);
+   if( verbose)
+      printf( "%d vectors for (%s) loaded from '%s'\n", ephem->n_nodes,
+                        ephem->mpc_code, filename);
+   n_ephems++;
+   return( 0);
+}
+
+/* Cubic Hermite interpolation between nodes n0 and n1.  Velocities are
+in km/s;  'dt' (the node spacing) is in days,  so it's converted to
+seconds to match. */
+
+static void hermite_interpolate( const ephem_node_t *n0,
+                  const ephem_node_t *n1, const double jd, double *state)
+{
+   const double dt = (n1->jd - n0->jd) * seconds_per_day;
+   const double t = (jd - n0->jd) / (n1->jd - n0->jd);
+   const double t2 = t * t, t3 = t2 * t;
+   const double h00 = 2. * t3 - 3. * t2 + 1., h10 = t3 - 2. * t2 + t;
+   const double h01 = 3. * t2 - 2. * t3, h11 = t3 - t2;
+   const double d00 = (6. * t2 - 6. * t) / dt, d10 = 3. * t2 - 4. * t + 1.;
+   const double d11 = 3. * t2 - 2. * t;
+   int i;
+
+   for( i = 0; i < 3; i++)
+      {
+      const double p0 = n0->state[i], p1 = n1->state[i];
+      const double v0 = n0->state[i + 3], v1 = n1->state[i + 3];
+
+      state[i] = h00 * p0 + h10 * dt * v0 + h01 * p1 + h11 * dt * v1;
+      state[i + 3] = d00 * (p0 - p1) + d10 * v0 + d11 * v1;
+      }
+}
+
+typedef struct
+{
+   double jd;
+   int idx;
+} jd_idx_t;
+
+static int compare_jd_idx( const void *a, const void *b)
+{
+   const double jd1 = ((const jd_idx_t *)a)->jd;
+   const double jd2 = ((const jd_idx_t *)b)->jd;
+
+   return( (jd1 > jd2) - (jd1 < jd2));
+}
+
+static void set_offsets_from_ephems( offset_t *offsets, const int n_offsets)
+{
+   jd_idx_t *sorted = (jd_idx_t *)malloc( (n_offsets + 1) * sizeof( jd_idx_t));
+   int i, j, n_sorted;
+
+   assert( sorted);
+   for( j = 0; j < n_ephems; j++)
+      {
+      const vector_ephem_t *ephem = ephems + j;
+      int node = 0;
+
+      n_sorted = 0;
+      for( i = 0; i < n_offsets; i++)
+         if( !memcmp( offsets[i].mpc_code, ephem->mpc_code, 3))
+            {
+            sorted[n_sorted].jd = offsets[i].jd;
+            sorted[n_sorted++].idx = i;
+            }
+      qsort( sorted, n_sorted, sizeof( jd_idx_t), compare_jd_idx);
+      for( i = 0; i < n_sorted; i++)
+         {
+         offset_t *off = offsets + sorted[i].idx;
+
+         while( node < ephem->n_nodes - 2 && ephem->nodes[node + 1].jd <= off->jd)
+            node++;
+         if( off->jd >= ephem->nodes[0].jd
+                     && off->jd <= ephem->nodes[ephem->n_nodes - 1].jd)
+            {
+            double state[6];
+
+            hermite_interpolate( ephem->nodes + node, ephem->nodes + node + 1,
+                                 off->jd, state);
+            memcpy( off->xyz, state, 3 * sizeof( double));
+            memcpy( off->vel, state + 3, 3 * sizeof( double));
+            n_positions_set++;
+            }
+         }
+      }
+   free( sorted);
+   for( i = 0; i < n_offsets; i++)     /* anything not set now won't be */
+      if( !offsets[i].xyz[0] && offsets[i].mpc_code[0])
+         {
+         if( verbose)
+            printf( "No vectors for JD %.5f (%s)\n", offsets[i].jd,
+                                 offsets[i].mpc_code);
+         n_positions_failed++;
+         offsets[i].mpc_code[0] = '\0';
+         }
+}
+
       /* ADES spacecraft positions/velocities are limited to 13 bytes. */
 static char *ades_posvel( char *buff, const double value)
 {
@@ -422,7 +658,7 @@ int process_file( const char *filename, FILE *ofile)
    double jd;
    time_t t0 = time( NULL);
    offset_t *offsets = NULL;
-   int i, n_offsets = 0;
+   int i, n_offsets = 0, n_alloced = 0, next_idx = 0;
    bool ades_found = false;
 
    assert( ifile);
@@ -434,8 +670,13 @@ int process_file( const char *filename, FILE *ofile)
             if( verbose)
                printf( "Sat obs: %.5f\n%s", jd, buff);
             n_offsets++;
-            offsets = (offset_t *)realloc( offsets,
-                                 n_offsets * sizeof( offset_t));
+            if( n_offsets > n_alloced)
+               {
+               n_alloced = n_alloced * 2 + 100;
+               offsets = (offset_t *)realloc( offsets,
+                                 n_alloced * sizeof( offset_t));
+               assert( offsets);
+               }
             memset( offsets + n_offsets - 1, 0, sizeof( offset_t));
             offsets[n_offsets - 1].jd = jd;
             if( *mpc_code_from_ades)
@@ -456,7 +697,9 @@ int process_file( const char *filename, FILE *ofile)
          }
       else if( strstr( buff, "<ades version="))
          ades_found = true;
-   for( i = 0; i < n_offsets; i++)
+   if( n_ephems)           /* offline mode;  see above */
+      set_offsets_from_ephems( offsets, n_offsets);
+   else for( i = 0; i < n_offsets; i++)
       {
       if( verbose)
          printf( "%d: JD %.5f; code '%s'\n", i, offsets[i].jd, offsets[i].mpc_code);
@@ -477,12 +720,25 @@ int process_file( const char *filename, FILE *ofile)
       else if( buff[14] != 's' || *mpc_code_from_ades)
          {
          int idx = -1;
+         bool search = true;
          char *mpc_code = (*mpc_code_from_ades ? mpc_code_from_ades : buff + 77);
 
-         for( i = 0; idx < 0 && i < n_offsets; i++)
+               /* Observations come in the order in which they were found */
+               /* on the first pass,  so we usually needn't search.  (An   */
+               /* empty MPC code means we failed to get that offset.)      */
+         if( next_idx < n_offsets && fabs( jd - offsets[next_idx].jd) < tolerance
+                  && (!offsets[next_idx].mpc_code[0]
+                         || !memcmp( mpc_code, offsets[next_idx].mpc_code, 3)))
+            {
+            search = false;
+            if( offsets[next_idx].mpc_code[0])
+               idx = next_idx;
+            }
+         for( i = 0; search && idx < 0 && i < n_offsets; i++)
             if( !memcmp( mpc_code, offsets[i].mpc_code, 3)
                        && fabs( jd - offsets[i].jd) < tolerance)
                idx = i;
+         next_idx = (idx >= 0 ? idx + 1 : next_idx + 1);
          if( idx >= 0)
             {
             if( *mpc_code_from_ades)
@@ -529,6 +785,9 @@ int process_file( const char *filename, FILE *ofile)
          }
    fclose( ifile);
    free( offsets);
+   for( i = 0; i < n_ephems; i++)
+      free( ephems[i].nodes);
+   free( ephems);
    snprintf( buff, sizeof( buff),
          "COM %d positions set by add_off; %d failed in %.2f seconds\n",
          n_positions_set, n_positions_failed,
@@ -554,7 +813,9 @@ int main( const int argc, const char **argv)
       fprintf( stderr,
             "'add_off' takes the name of an input file of astrometry as a command-line\n"
             "argument.  Optionally,  the name of the output file can be specified as\n"
-            "a second command-line argument (output goes to stdout by default).\n");
+            "a second command-line argument (output goes to stdout by default).\n"
+            "'-e(filename)' loads a Horizons vector table for a spacecraft,  and\n"
+            "interpolates offsets from it instead of querying Horizons.\n");
       return( -1);
       }
    if( argc > 2 && argv[2][0] != '-')
@@ -584,6 +845,10 @@ int main( const int argc, const char **argv)
             case 'o':
                timing_offset = atof( argv[i] + 2);
                break;
+            case 'e':
+               if( load_vector_ephem( argv[i] + 2))
+                  return( -1);
+               break;
             default:
                printf( "Option '%s' unrecognized\n", argv[i]);
                break;
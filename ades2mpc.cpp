@@ -306,7 +306,7 @@ static int find_tag( const char *buff, size_t len)
        "vel2", "vel3",
    NULL };
 
-   int i, rval = -1;
+   int lo = 0, hi = (int)( sizeof( tags) / sizeof( tags[0])) - 1;
 
    if( *buff == '/')       /* closing tag */
       {
@@ -314,11 +314,23 @@ static int find_tag( const char *buff, size_t len)
       len--;
       }
    if( !memcmp( buff, "ades", 4))
-      rval = 0;
-   for( i = 0; tags[i] && rval == -1; i++)
-      if( !memcmp( tags[i], buff, len) && !tags[i][len])
-         rval = i + 1;
-   return( rval);
+      return( 0);
+   while( lo < hi)         /* tags[hi] is the NULL terminator */
+      {
+      const int mid = (lo + hi) / 2;
+      const size_t tag_len = strlen( tags[mid]);
+      int compare = memcmp( tags[mid], buff, (len < tag_len ? len : tag_len));
+
+      if( !compare)
+         compare = (tag_len > len) - (tag_len < len);
+      if( !compare)
+         return( mid + 1);
+      if( compare < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+      }
+   return( -1);
 }
 
 /* Packs references such as 'MPEC 2021-D85' into the five-byte form
@@ -1477,3 +1489,458 @@ void ades_artsat_desigs( void *ades_context, const bool ignore_artsat_desigs)
 
    cptr->ignore_artsat_desigs = ignore_artsat_desigs;
 }
+
+/* The following functions read ADES observations directly into
+'ades_obs_t' structures,  without the detour through 80-column text (and
+subsequent re-parsing of that text).  Only the commonly used fields are
+extracted:  time,  RA/dec,  their uncertainties,  magnitude,  station,
+and designation.  If you need anything else (satellite offsets,  radar
+data, etc.),  use the above xlate_ades2mpc( ) code.
+
+   Input can either be a buffer holding the entire file (which may have
+been memory-mapped) or an open FILE.  In the latter case,  the file is
+read through a window that starts at ADES_READER_WINDOW_SIZE bytes and
+is only enlarged if a line won't fit in it;  memory use is set by the
+longest line,  not by the size of the file.  Either way,  a mix of XML and
+PSV data is handled,  and anything that isn't an optical observation is
+skipped.  In PSV,  radar observations are in their own blocks,  told
+apart by radar-only fields (delay,  doppler,  frq,  trx,  rcv) in the
+header;  the rows of such blocks are read past,  not returned.  */
+
+#define ADES_READER_WINDOW_SIZE    65536
+
+typedef struct
+{
+   const char *ptr, *end;        /* unread part of input */
+   const char *line, *line_end;  /* current line being parsed */
+   FILE *ifile;
+   char *window;
+   size_t window_size;
+   int *psv_tags, n_psv_fields, psv_is_radar;
+   int curr_tag, in_optical, id_set;
+   ades_obs_t obs;
+} ades_reader_t;
+
+void *init_ades_reader( const char *buff, const size_t buff_len)
+{
+   ades_reader_t *rval = (ades_reader_t *)calloc( 1, sizeof( ades_reader_t));
+
+   if( rval)
+      {
+      rval->ptr = buff;
+      rval->end = buff + buff_len;
+      rval->curr_tag = -1;
+      }
+   return( rval);
+}
+
+void *init_ades_file_reader( FILE *ifile)
+{
+   ades_reader_t *rval = (ades_reader_t *)calloc( 1, sizeof( ades_reader_t));
+
+   if( rval)
+      {
+      rval->window = (char *)malloc( ADES_READER_WINDOW_SIZE);
+      if( !rval->window)
+         {
+         free( rval);
+         return( NULL);
+         }
+      rval->ifile = ifile;
+      rval->window_size = ADES_READER_WINDOW_SIZE;
+      rval->ptr = rval->end = rval->window;
+      rval->curr_tag = -1;
+      }
+   return( rval);
+}
+
+void free_ades_reader( void *reader)
+{
+   ades_reader_t *rptr = (ades_reader_t *)reader;
+
+   if( rptr->psv_tags)
+      free( rptr->psv_tags);
+   if( rptr->window)
+      free( rptr->window);
+   free( rptr);
+}
+
+/* Sets reader->line and reader->line_end to the next line,  minus any
+CR/LF.  For file input,  this may mean shifting the unread part of the
+window down and filling the rest from the file.  If a line is too long
+to fit in the window (an entire XML file on one line is legal),  the
+window is doubled until it does fit.  Only if that allocation fails is
+the line broken into window-sized pieces.  */
+
+static bool get_next_reader_line( ades_reader_t *reader)
+{
+   const char *tptr;
+
+   while( reader->ptr < reader->end && (*reader->ptr == 10 || *reader->ptr == 13))
+      reader->ptr++;
+   tptr = (const char *)memchr( reader->ptr, 10, reader->end - reader->ptr);
+   while( !tptr && reader->ifile && !feof( reader->ifile))
+      {
+      const size_t n_left = reader->end - reader->ptr;
+      size_t n_read;
+
+      if( n_left == reader->window_size)
+         {           /* window is full,  with no line end;  enlarge it */
+         char *new_window = (char *)realloc( reader->window,
+                                             reader->window_size * 2);
+
+         if( !new_window)
+            break;
+         reader->window = new_window;
+         reader->window_size *= 2;
+         }
+      else
+         memmove( reader->window, reader->ptr, n_left);
+      reader->ptr = reader->window;
+      n_read = fread( reader->window + n_left, 1,
+                     reader->window_size - n_left, reader->ifile);
+      reader->end = reader->window + n_left + n_read;
+      while( reader->ptr < reader->end && (*reader->ptr == 10 || *reader->ptr == 13))
+         reader->ptr++;
+      tptr = (const char *)memchr( reader->ptr, 10, reader->end - reader->ptr);
+      if( !n_read)
+         break;
+      }
+   if( reader->ptr == reader->end)
+      return( false);
+   if( !tptr)
+      tptr = reader->end;
+   reader->line = reader->ptr;
+   reader->ptr = tptr;
+   while( tptr > reader->line && tptr[-1] == 13)
+      tptr--;
+   reader->line_end = tptr;
+   return( true);
+}
+
+static inline unsigned get_digits( const char *tptr, const int n_digits)
+{
+   unsigned rval = 0;
+
+   for( int i = 0; i < n_digits; i++)
+      rval = rval * 10 + (unsigned)( tptr[i] - '0');
+   return( rval);
+}
+
+/* ADES times are (almost always) ISO-formatted,  'YYYY-MM-DDTHH:MM:SS.sss',
+possibly followed by a 'Z' and possibly with more or fewer decimals.  That's
+simple enough to parse quickly.  Anything else goes to the much more
+flexible (and much slower) get_time_from_stringl( ).  */
+
+static long double ades_time_to_t2k( const char *tptr, const size_t len)
+{
+   if( len >= 19 && len < 40 && tptr[4] == '-' && tptr[7] == '-'
+            && tptr[10] == 'T' && tptr[13] == ':' && tptr[16] == ':')
+      {
+      const long jd = dmy_to_day( (int)get_digits( tptr + 8, 2),
+                                  (int)get_digits( tptr + 5, 2),
+                                  (long)get_digits( tptr, 4), CALENDAR_GREGORIAN);
+      long double seconds = (long double)get_digits( tptr + 17, 2);
+      long double scale = 0.1;
+      size_t i = 19;
+
+      if( i < len && tptr[i] == '.')
+         for( i++; i < len && isdigit( tptr[i]); i++, scale *= 0.1)
+            seconds += scale * (long double)( tptr[i] - '0');
+      if( i == len || (i == len - 1 && tptr[i] == 'Z'))
+         return( (long double)( jd - 2451545L) - 0.5
+               + (long double)get_digits( tptr + 11, 2) / hours_per_day
+               + (long double)get_digits( tptr + 14, 2) / minutes_per_day
+               + seconds / seconds_per_day);
+      }
+   char tbuff[40];
+   const size_t n_copy = (len < sizeof( tbuff) ? len : sizeof( tbuff) - 1);
+
+   memcpy( tbuff, tptr, n_copy);
+   tbuff[n_copy] = '\0';
+   if( n_copy && tbuff[n_copy - 1] == 'Z')
+      tbuff[n_copy - 1] = '\0';
+   return( get_time_from_stringl( 0., tbuff, 0, NULL));
+}
+
+static void copy_field( char *obuff, const size_t obuff_size,
+                        const char *ibuff, size_t len)
+{
+   if( len >= obuff_size)
+      len = obuff_size - 1;
+   memcpy( obuff, ibuff, len);
+   obuff[len] = '\0';
+}
+
+/* Stores the value for one ADES field,  given its tag.  As with the
+80-column translation,  a permID takes priority over a provID,  which
+takes priority over a trkSub or artSat designation.   */
+
+static void set_ades_obs_field( ades_reader_t *reader, const int itag,
+                              const char *tptr, const size_t len)
+{
+   ades_obs_t *obs = &reader->obs;
+   char tbuff[40];
+
+   copy_field( tbuff, sizeof( tbuff), tptr, len);
+   switch( itag)
+      {
+      case ADES_permID:
+      case ADES_provID:
+      case ADES_trkSub:
+      case ADES_artSat:
+         {
+         const int priority = (itag == ADES_permID ? 3 :
+                                  (itag == ADES_provID ? 2 : 1));
+
+         if( priority > reader->id_set)
+            {
+            reader->id_set = priority;
+            copy_field( obs->desig, sizeof( obs->desig), tptr, len);
+            }
+         }
+         break;
+      case ADES_obsTime:
+         obs->t2k = ades_time_to_t2k( tptr, len);
+         break;
+      case ADES_ra:
+      case ADES_raStar:
+         obs->ra = atof( tbuff);
+         break;
+      case ADES_dec:
+      case ADES_decStar:
+         obs->dec = atof( tbuff);
+         break;
+      case ADES_rmsRA:
+         obs->sigma_ra = atof( tbuff);
+         break;
+      case ADES_rmsDec:
+         obs->sigma_dec = atof( tbuff);
+         break;
+      case ADES_rmsCorr:
+         obs->sigma_corr = atof( tbuff);
+         break;
+      case ADES_rmsTime:
+         obs->sigma_time = atof( tbuff);
+         break;
+      case ADES_mag:
+         obs->mag = atof( tbuff);
+         break;
+      case ADES_rmsMag:
+         obs->sigma_mag = atof( tbuff);
+         break;
+      case ADES_band:
+         copy_field( obs->band, sizeof( obs->band), tptr, len);
+         break;
+      case ADES_stn:
+         copy_field( obs->stn, sizeof( obs->stn), tptr, len);
+         break;
+      case ADES_mode:
+         copy_field( obs->mode, sizeof( obs->mode), tptr, len);
+         break;
+      default:
+         break;
+      }
+}
+
+static void reset_ades_obs( ades_reader_t *reader)
+{
+   memset( &reader->obs, 0, sizeof( ades_obs_t));
+   reader->id_set = 0;
+}
+
+/* Parses a PSV data line.  Returns true if the line had the expected
+number of fields,  false if it didn't (meaning the PSV section is over). */
+
+static bool parse_ades_psv_line( ades_reader_t *reader)
+{
+   const char *tptr = reader->line, *end = reader->line_end;
+   int i;
+
+   reset_ades_obs( reader);
+   for( i = 0; i < reader->n_psv_fields && tptr <= end; i++)
+      {
+      const char *field_end = (const char *)memchr( tptr, '|', end - tptr);
+
+      if( !field_end)
+         field_end = end;
+      if( (field_end == end) != (i == reader->n_psv_fields - 1))
+         return( false);         /* too few or too many fields */
+      while( tptr < field_end && *tptr == ' ')
+         tptr++;
+      size_t len = field_end - tptr;
+
+      while( len && tptr[len - 1] == ' ')
+         len--;
+      if( len)
+         set_ades_obs_field( reader, reader->psv_tags[i], tptr, len);
+      tptr = field_end + 1;
+      }
+   return( i == reader->n_psv_fields);
+}
+
+/* Checks for a PSV header line such as 'permID |provID|trkSub|mode|stn...'.
+The line must contain at least MIN_PSV_TAGS fields,  and each must be a
+recognized ADES tag.  Returns 1 if it's such a header line,  0 if it isn't,
+-1 if we run out of memory.  */
+
+static int parse_ades_psv_header( ades_reader_t *reader)
+{
+   const char *tptr = reader->line, *end = reader->line_end;
+   int n_fields = 1, i, is_radar = 0;
+
+   if( tptr == end || *skip_whitespace( tptr) < 'a'
+                   || *skip_whitespace( tptr) > 'z')
+      return( 0);
+   for( const char *cptr = tptr; cptr < end; cptr++)
+      if( *cptr == '|')
+         n_fields++;
+   if( n_fields < MIN_PSV_TAGS)
+      return( 0);
+   int *tags = (int *)malloc( n_fields * sizeof( int));
+
+   if( !tags)
+      return( -1);
+   for( i = 0; i < n_fields; i++)
+      {
+      const char *field_end = (const char *)memchr( tptr, '|', end - tptr);
+      size_t len;
+
+      if( !field_end)
+         field_end = end;
+      while( tptr < field_end && *tptr == ' ')
+         tptr++;
+      len = field_end - tptr;
+      while( len && tptr[len - 1] == ' ')
+         len--;
+      tags[i] = (len ? find_tag( tptr, len) : -1);
+      if( tags[i] <= 0)
+         {
+         free( tags);
+         return( 0);
+         }
+      if( tags[i] == ADES_delay || tags[i] == ADES_doppler
+                  || tags[i] == ADES_frq || tags[i] == ADES_trx
+                  || tags[i] == ADES_rcv)
+         is_radar = 1;
+      tptr = field_end + 1;
+      }
+   if( reader->psv_tags)
+      free( reader->psv_tags);
+   reader->psv_tags = tags;
+   reader->n_psv_fields = n_fields;
+   reader->psv_is_radar = is_radar;
+   return( 1);
+}
+
+/* Parses XML from the current position in the line,  up to the end of
+the line or until an </optical> closing tag is found.  Returns true in
+the latter case,  with reader->line set to point just past that tag so
+that parsing can resume from there.  */
+
+static bool parse_ades_xml( ades_reader_t *reader)
+{
+   const char *tptr = reader->line, *end = reader->line_end;
+
+   while( tptr < end)
+      {
+      while( tptr < end && (unsigned char)*tptr <= ' ')
+         tptr++;
+      if( tptr == end)
+         break;
+      if( *tptr == '<')
+         {
+         const char *tag_end = (const char *)memchr( tptr, '>', end - tptr);
+         int tag_idx;
+
+         if( !tag_end)     /* tag split across lines;  e.g.,  an XML */
+            break;         /* declaration.  Nothing we care about.   */
+         tag_idx = find_tag( tptr + 1, tag_end - tptr - 1);
+         if( tptr[1] == '/')
+            {
+            reader->curr_tag = -1;
+            if( tag_idx == ADES_optical && reader->in_optical)
+               {
+               reader->in_optical = 0;
+               reader->line = tag_end + 1;
+               return( true);
+               }
+            }
+         else if( tag_end[-1] == '/')
+            reader->curr_tag = -1;     /* empty <tag/> */
+         else
+            {
+            reader->curr_tag = tag_idx;
+            if( tag_idx == ADES_optical)
+               {
+               reset_ades_obs( reader);
+               reader->in_optical = 1;
+               }
+            }
+         tptr = tag_end + 1;
+         }
+      else
+         {
+         const char *text_end = (const char *)memchr( tptr, '<', end - tptr);
+         const char *tptr2;
+
+         if( !text_end)
+            text_end = end;
+         tptr2 = text_end;
+         while( tptr2 > tptr && (unsigned char)tptr2[-1] <= ' ')
+            tptr2--;
+         if( reader->in_optical && reader->curr_tag > 0)
+            set_ades_obs_field( reader, reader->curr_tag, tptr, tptr2 - tptr);
+         tptr = text_end;
+         }
+      }
+   reader->line = reader->line_end;
+   return( false);
+}
+
+/* Returns 1 if an observation was read into *obs,  0 at end of input,
+-1 if we ran out of memory.   */
+
+int get_next_ades_observation( void *reader_context, ades_obs_t *obs)
+{
+   ades_reader_t *reader = (ades_reader_t *)reader_context;
+
+   for( ;;)
+      {
+      if( reader->line < reader->line_end)
+         {           /* finish XML left over from previous call */
+         if( parse_ades_xml( reader))
+            {
+            *obs = reader->obs;
+            return( 1);
+            }
+         }
+      if( !get_next_reader_line( reader))
+         return( 0);
+      if( reader->psv_tags)
+         {
+         if( parse_ades_psv_line( reader))
+            {
+            reader->line = reader->line_end;
+            if( reader->psv_is_radar)
+               continue;
+            *obs = reader->obs;
+            return( 1);
+            }
+         free( reader->psv_tags);      /* end of PSV data */
+         reader->psv_tags = NULL;
+         reader->n_psv_fields = 0;
+         }
+      if( *reader->line == '#' || *reader->line == '!')
+         reader->line = reader->line_end;    /* PSV header data */
+      else if( !reader->in_optical)
+         {
+         const int rval = parse_ades_psv_header( reader);
+
+         if( rval < 0)
+            return( rval);
+         if( rval)
+            reader->line = reader->line_end;
+         }
+      }
+}
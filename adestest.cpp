@@ -27,12 +27,37 @@ static void error_exit( )
       "tools,  but probably not with anyone else's.\n"
       "\n"
       "    Add a '-m' command line switch to get 'real' 80-column data,  with\n"
-      "times in decimal days and RA/decs in base-60 form.\n");
+      "times in decimal days and RA/decs in base-60 form.\n"
+      "\n"
+      "    Add a '-r' switch to instead read the file directly into observation\n"
+      "records (see 'get_next_ades_observation()') and show those.\n");
    exit( -1);
 }
 
 void ades_artsat_desigs( void *ades_context, const bool ignore_artsat_desigs);
 
+static int show_ades_records( FILE *ifile)
+{
+   void *reader = init_ades_file_reader( ifile);
+   ades_obs_t obs;
+   int n_obs = 0;
+
+   assert( reader);
+   while( get_next_ades_observation( reader, &obs) > 0)
+      {
+      char tbuff[80];
+
+      full_ctimel( tbuff, obs.t2k, FULL_CTIME_YMD | FULL_CTIME_MILLISECS
+                  | FULL_CTIME_MONTHS_AS_DIGITS | FULL_CTIME_LEADING_ZEROES);
+      printf( "%-12s %s %s %12.8f %+12.8f %6.3f %6.3f %5.2f %s\n",
+               obs.desig, obs.stn, tbuff, obs.ra, obs.dec,
+               obs.sigma_ra, obs.sigma_dec, obs.mag, obs.band);
+      n_obs++;
+      }
+   free_ades_reader( reader);
+   return( n_obs);
+}
+
 int main( const int argc, const char **argv)
 {
    FILE *ifile;
@@ -70,6 +95,11 @@ int main( const int argc, const char **argv)
             case 'a':
                ades_artsat_desigs( ades_context, true);
                break;
+            case 'r':
+               printf( "%d observations read\n", show_ades_records( ifile));
+               fclose( ifile);
+               free_ades2mpc_context( ades_context);
+               return( 0);
             default:
                fprintf( stderr, "'%s' not recognized\n", argv[i]);
                error_exit( );
@@ -18,6 +18,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #ifndef AFUNCS_H_INCLUDED
 #define AFUNCS_H_INCLUDED
 
+#include <stddef.h>              /* required for size_t */
 #include <stdint.h>              /* required for int64_t #define */
 
 #ifndef DPT
@@ -66,6 +67,10 @@ extern "C" {
 int DLL_FUNC constell_from_ra_dec( const double ra_degrees_1875,
                                    const double dec_degrees_1875,
                                    char DLLPTR *constell_name);
+int DLL_FUNC constells_from_j2000( const size_t n_points,
+                     const double DLLPTR *ra_degrees,
+                     const double DLLPTR *dec_degrees,
+                     char DLLPTR *constell_idx);      /* conbound.c */
 void DLL_FUNC make_var_desig( char DLLPTR *buff, int var_no);
 int DLL_FUNC decipher_var_desig( const char DLLPTR *desig);
 int DLL_FUNC setup_precession( double DLLPTR *matrix, const double year_from,
@@ -150,6 +155,17 @@ double DLL_FUNC reverse_integrated_refraction( const double latitude,
                   const double refracted_alt, const double wavelength_microns,
                   const double height_in_meters, const double rel_humid_pct,
                   const double temp_kelvins, const double pressure_mb);
+void * DLL_FUNC init_refraction_profile( const double latitude,
+                  const double wavelength_microns,
+                  const double height_in_meters, const double rel_humid_pct,
+                  const double temp_kelvins, const double pressure_mb,
+                  const double max_error);                /* refract4.c */
+double DLL_FUNC profile_refraction( const void *profile,
+                  const double observed_alt);
+double DLL_FUNC reverse_profile_refraction( const void *profile,
+                  const double refracted_alt, int *used_integrator);
+double DLL_FUNC refraction_profile_error( const void *profile);
+void DLL_FUNC free_refraction_profile( void *profile);
 
 int DLL_FUNC calc_dist_and_posn_ang( const double *p1, const double *p2,
                                        double *dist, double *posn_ang);
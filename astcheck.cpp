@@ -117,6 +117,7 @@ static int n_asteroids, record_length;
 int verbose = 0;
 const char *data_path = NULL;
 char sof_header[MAX_SOF_SIZE];
+static void *sof_plan;  /* compiled form of the above;  see sof.cpp */
 int32_t sof_checksum;
 
 static FILE *get_file_from_path( const char *filename, const char *permits)
@@ -138,6 +139,69 @@ static FILE *get_file_from_path( const char *filename, const char *permits)
    return( fp);
 }
 
+/* As above,  but just puts the path in 'buff' (with the 'data_path'
+version preferred if the file exists there).     */
+
+static const char *get_path( char *buff, const size_t buffsize,
+                             const char *filename)
+{
+   if( data_path && *data_path)
+      {
+      FILE *fp;
+
+      strlcpy_err( buff, data_path, buffsize);
+      if( buff[strlen( buff) - 1] != '/')
+         strlcat_err( buff, "/", buffsize);
+      strlcat_err( buff, filename, buffsize);
+      fp = fopen( buff, "rb");
+      if( fp)
+         {
+         fclose( fp);
+         return( buff);
+         }
+      }
+   strlcpy_err( buff, filename, buffsize);
+   return( buff);
+}
+
+/* Station data come from ObsCodes.html (or ObsCodes.htm,  if stored with
+a truncated extension),  with rovers.txt for any codes not found there.
+They're parsed once into a hash table.  With '-b',  that's cached in
+binary form in 'obscodes.bin' (in the data path,  if one is given;  see
+load_mpc_code_table( ) in mpc_code.cpp),  and re-read from there until
+ObsCodes.html or rovers.txt changes.  */
+
+static void *load_station_data( const bool use_cache)
+{
+   char paths[2][450], cache_path[450];
+   const char *filenames[2];
+   FILE *ifile;
+
+   filenames[0] = get_path( paths[0], sizeof( paths[0]), "ObsCodes.html");
+   if( (ifile = fopen( filenames[0], "rb")) == NULL)
+      filenames[0] = get_path( paths[0], sizeof( paths[0]), "ObsCodes.htm");
+   else
+      fclose( ifile);
+   if( (ifile = fopen( filenames[0], "rb")) == NULL)
+      return( NULL);
+   fclose( ifile);
+   filenames[1] = get_path( paths[1], sizeof( paths[1]), "rovers.txt");
+   if( !use_cache)
+      return( load_mpc_code_table( filenames, 2, NULL));
+   if( data_path && *data_path)
+      {
+      strlcpy_error( cache_path, data_path);
+      if( cache_path[strlen( cache_path) - 1] != '/')
+         strlcat_error( cache_path, "/");
+      }
+   else
+      *cache_path = '\0';
+   strlcat_error( cache_path, "obscodes.bin");
+   if( verbose)
+      printf( "Station data cached in '%s'\n", cache_path);
+   return( load_mpc_code_table( filenames, 2, cache_path));
+}
+
 static FILE *get_sof_file( const char *filename)
 {
    FILE *ifile = get_file_from_path( filename, "rb");
@@ -145,7 +209,6 @@ static FILE *get_sof_file( const char *filename)
    if( ifile)
       {
       int filelen;
-      size_t i, j;
       char buff[450];
 
       if( !fgets( buff, sizeof( buff), ifile))
@@ -156,6 +219,12 @@ static FILE *get_sof_file( const char *filename)
       record_length = (int)strlen( buff);
       assert( record_length < MAX_SOF_SIZE);
       strlcpy_error( sof_header, buff);
+      sof_plan = compile_sof_header( sof_header);
+      if( !sof_plan)
+         {
+         fprintf( stderr, "'%s' has an unusable header\n", filename);
+         exit( -4);
+         }
       fseek( ifile, 0L, SEEK_END);
       filelen = ftell( ifile);
       if( filelen % record_length)
@@ -164,16 +233,7 @@ static FILE *get_sof_file( const char *filename)
          exit( -5);
          }
       n_asteroids = filelen / record_length - 1;      /* there's a header line */
-      for( i = 0; i < 4; i++)
-         {
-         const int32_t big_prime = 1234567891;
-
-         fseek( ifile, (long)( i * (filelen - sizeof( buff))) / 3L, SEEK_SET);
-         if( fread( buff, sizeof( buff), 1, ifile))
-            for( j = 0; j < sizeof( buff); j++)
-               sof_checksum = sof_checksum * big_prime + (int32_t)buff[i];
-         }
-      fseek( ifile, 0L, SEEK_SET);
+      sof_checksum = get_sof_file_checksum( ifile);
       if( verbose)
          printf( "'%s': %d objects; record size %d\n",
                       filename, n_asteroids, record_length);
@@ -208,6 +268,26 @@ static double compute_asteroid_loc( const double *earth_loc,
    return( r1);
 }
 
+/* Computes the day data (approximate RA/dec) for one SOF record.   */
+
+static void compute_record_day_data( AST_DATA *rval, const double *earth_loc,
+                                     const double jd, const char *tbuff)
+{
+   ELEMENTS class_elem;
+   double ra, dec;
+
+   if( extract_sof_data_compiled( &class_elem, tbuff, sof_plan, NULL))
+      {
+      printf( "'mpcorb.sof' data doesn't parse correctly:\n%s\n", tbuff);
+      exit( -1);
+      }
+
+   compute_asteroid_loc( earth_loc, &class_elem, jd, &ra, &dec);
+
+   rval->ra = integerize_angle( ra);
+   rval->dec = integerize_angle( dec);
+}
+
 AST_DATA *compute_day_data( const long ijd)
 {
    char tbuff[300];
@@ -230,19 +310,7 @@ AST_DATA *compute_day_data( const long ijd)
    tbuff[record_length] = '\0';
    for( i = 0; i < n_asteroids && fgets( tbuff, sizeof( tbuff), orbits_file); i++)
       {
-      ELEMENTS class_elem;
-      double ra, dec;
-
-      if( extract_sof_data( &class_elem, tbuff, sof_header))
-         {
-         printf( "'mpcorb.sof' data doesn't parse correctly:\n%s\n", tbuff);
-         exit( -1);
-         }
-
-      compute_asteroid_loc( earth_loc, &class_elem, jd, &ra, &dec);
-
-      rval[i].ra = integerize_angle( ra);
-      rval[i].dec = integerize_angle( dec);
+      compute_record_day_data( rval + i, earth_loc, jd, tbuff);
       if( verbose && counter <= i * 80 / n_asteroids)
          {
          printf( "%d", counter % 10);
@@ -255,6 +323,109 @@ AST_DATA *compute_day_data( const long ijd)
    return( rval);
 }
 
+/* 'mpc2sof -d' writes a diff between the previous and current versions
+of 'mpcorb.sof' (see comments in mpc2sof.cpp for the format).  If we have
+day data computed from the previous version,  most of it can be copied;
+only the changed and added records need to be recomputed.  Returns NULL
+if there's no diff file,  or it doesn't lead from the file from which
+'old_data' was computed to the one we're now using.  */
+
+static char sof_diff_filename[256];     /* set in main( ) */
+
+/* The sampled 'sof_checksum' can miss a few changed orbits,  so a .chk
+or .dif file is only trusted if it also matches a hash of all of
+'mpcorb.sof'.  That means reading the whole file,  so it's only done
+when a .chk or .dif file actually needs checking,  and only once.  */
+
+static uint32_t get_sof_full_checksum( void)
+{
+   static uint32_t full_checksum;
+   static int full_checksum_found = 0;
+
+   if( !full_checksum_found)
+      {
+      full_checksum = get_sof_file_full_checksum( orbits_file);
+      full_checksum_found = 1;
+      }
+   return( full_checksum);
+}
+
+static AST_DATA *update_day_data( const long ijd, const AST_DATA *old_data,
+                        const uint32_t old_full_checksum,
+                        const int old_n_asteroids)
+{
+   FILE *ifile = (*sof_diff_filename ?
+                  get_file_from_path( sof_diff_filename, "rb") : NULL);
+   AST_DATA *rval = NULL;
+   char tbuff[300];
+   long diff_old_n, diff_new_n, diff_old_checksum, diff_new_checksum;
+   unsigned long diff_old_full_checksum, diff_new_full_checksum;
+   long idx, count, n_out = 0, n_computed = 0;
+   double earth_loc[6];
+   const double jd = (double)ijd;
+   clock_t t0 = clock( );
+
+   if( !ifile)
+      return( NULL);
+   if( fgets( tbuff, sizeof( tbuff), ifile)
+         && 6 == sscanf( tbuff, "# SOF diff %ld %ld %ld %ld %lu %lu",
+                         &diff_old_n, &diff_old_checksum,
+                         &diff_new_n, &diff_new_checksum,
+                         &diff_old_full_checksum, &diff_new_full_checksum)
+         && diff_old_n == (long)old_n_asteroids
+         && (uint32_t)diff_old_full_checksum == old_full_checksum
+         && diff_new_n == (long)n_asteroids
+         && (uint32_t)diff_new_full_checksum == get_sof_full_checksum( )
+         && fgets( tbuff, sizeof( tbuff), ifile)
+         && !strcmp( tbuff, sof_header))
+      rval = (AST_DATA *)malloc( n_asteroids * sizeof( AST_DATA));
+   if( rval)
+      get_earth_loc( (jd      - 2451545.) / 365250., earth_loc);
+   while( rval && fgets( tbuff, sizeof( tbuff), ifile))
+      if( *tbuff == '=' && 2 == sscanf( tbuff + 1, "%ld %ld", &idx, &count)
+               && idx >= 0 && idx + count <= old_n_asteroids
+               && n_out + count <= n_asteroids)
+         {
+         memcpy( rval + n_out, old_data + idx, count * sizeof( AST_DATA));
+         n_out += count;
+         }
+      else if( *tbuff == '+' && 1 == sscanf( tbuff + 1, "%ld", &count)
+               && n_out + count <= n_asteroids)
+         {
+         while( rval && count--)
+            {
+            if( !fgets( tbuff, sizeof( tbuff), ifile)
+                        || strlen( tbuff) != (size_t)record_length)
+               {
+               free( rval);
+               rval = NULL;
+               }
+            else
+               {
+               compute_record_day_data( rval + n_out, earth_loc, jd, tbuff);
+               n_out++;
+               n_computed++;
+               }
+            }
+         }
+      else
+         {
+         free( rval);
+         rval = NULL;
+         }
+   fclose( ifile);
+   if( rval && n_out != n_asteroids)
+      {
+      free( rval);
+      rval = NULL;
+      }
+   if( rval && verbose)
+      printf( "Day data for %ld updated from '%s' (%ld of %d recomputed)\n"
+              "Time: %.1f seconds\n", ijd, sof_diff_filename, n_computed,
+              n_asteroids, (clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   return( rval);
+}
+
 static double centralize_angle( double ang)
 {
    while( ang > PI)
@@ -281,7 +452,7 @@ wait for the file to be ready.  So accessing and building of .chk
 files now works as follows :
 
 (1) We try to open the .chk day data file we need and read in the data.
-The file may not exist,  or may contain outdated data (the 'sof_checksum'
+The file may not exist,  or may contain outdated data (the checksums
 or other header data may not match what we're looking for).  If that's
 the case,  we drop through the code to the point where we generate the
 day data and create the day data file.  Right away,  we write out the
@@ -290,7 +461,7 @@ processes will see a header with no data (yet) and realize that they
 should wait a bit for the data to become available.
 
 (2) If we read in the header and it's what we're looking for (its
-"magic number",  checksum,  and the number of asteroids match),
+"magic number",  checksums,  and the number of asteroids match),
 we try to read in the actual asteroid data.  That part may simply
 succeed (because the .chk file in question has already been completed).
 If we only get none or some of the data,  we assume we'll have to
@@ -303,17 +474,23 @@ seriously wrong and bomb out;  this is to avoid having phantom
 processes left hanging.  (Haven't seen that actually happen yet.) We
 also close the input file and reopen it and fseek() to the start of
 the remaining data.  That's just to force an update to the input
-file size.         */
+file size.
+
+(3) If the header has the right "magic number" but is for a different
+'mpcorb.sof',  and the data is complete,  it's read in anyway.  If
+'mpc2sof -d' left a diff from that 'mpcorb.sof' to the current one,  we
+need only recompute the day data for the records that changed (see
+update_day_data( )).  Otherwise,  we compute all of it,  as before.   */
 
 #define HEADER_SIZE 4
 
 static AST_DATA *get_cached_day_data( const int ijd)
 {
-   AST_DATA *rval = NULL;
+   AST_DATA *rval = NULL, *old_data = NULL;
    char filename[20];
    FILE *ifile, *ofile;
-   int32_t header[HEADER_SIZE];
-   const int32_t magic_version_number = 1314159266;
+   int32_t header[HEADER_SIZE], old_header[HEADER_SIZE];
+   const int32_t magic_version_number = 1314159267;
 
                   /* Create a filename in 'YYYYMMDD.chk' form: */
    full_ctime( filename, (double)ijd, FULL_CTIME_YMD | FULL_CTIME_NO_SPACES
@@ -330,14 +507,31 @@ static AST_DATA *get_cached_day_data( const int ijd)
          printf( "Error reading header data in '%s'\n", filename);
          exit( -2);
          }
-      if( header[0] == magic_version_number &&
-                      header[1] == sof_checksum && header[2] == n_asteroids)
+      if( header[0] == magic_version_number && header[1] == sof_checksum
+                      && header[2] == n_asteroids
+                      && (uint32_t)header[3] == get_sof_full_checksum( ))
          {
          fseek( ifile, 0L, SEEK_END);
          if( ftell( ifile) == (n_asteroids + HEADER_SIZE) * 4L)
             rval = (AST_DATA *)malloc( n_asteroids * sizeof( AST_DATA));
          fseek( ifile, (long)sizeof( header), SEEK_SET);
          }
+      else if( header[0] == magic_version_number && header[2] > 0)
+         {           /* complete data from an older 'mpcorb.sof' */
+         memcpy( old_header, header, sizeof( header));
+         fseek( ifile, 0L, SEEK_END);
+         if( ftell( ifile) == (header[2] + HEADER_SIZE) * 4L)
+            {
+            old_data = (AST_DATA *)malloc( header[2] * sizeof( AST_DATA));
+            fseek( ifile, (long)sizeof( header), SEEK_SET);
+            if( old_data && (int)fread( old_data, sizeof( AST_DATA), header[2],
+                                            ifile) != header[2])
+               {
+               free( old_data);
+               old_data = NULL;
+               }
+            }
+         }
       if( rval)   /* appears to be legitimate cached data */
          {
          int n_read = 0, n_iterations = 0;
@@ -378,7 +572,7 @@ static AST_DATA *get_cached_day_data( const int ijd)
    header[0] = magic_version_number;
    header[1] = sof_checksum;
    header[2] = n_asteroids;
-   header[3] = -1;         /* not currently used */
+   header[3] = (int32_t)get_sof_full_checksum( );
    ofile = get_file_from_path( filename, "wb");
    if( !ofile)
       {
@@ -388,7 +582,14 @@ static AST_DATA *get_cached_day_data( const int ijd)
       }
    fwrite( header, HEADER_SIZE, sizeof( int), ofile);
    fflush( ofile);
-   rval = compute_day_data( ijd);
+   if( old_data)
+      {
+      rval = update_day_data( ijd, old_data, (uint32_t)old_header[3],
+                                                        old_header[2]);
+      free( old_data);
+      }
+   if( !rval)
+      rval = compute_day_data( ijd);
    fwrite( rval, n_asteroids, sizeof( AST_DATA), ofile);
    fclose( ofile);
 
@@ -564,6 +765,7 @@ static void err_message( void)
    printf( "   -m(mag)    Set limiting mag to 'mag'.  Default is 22.\n");
    printf( "   -l         Show distance from line of variations. Experimental.\n");
    printf( "   -h         No headers.\n");
+   printf( "   -b         Cache parsed station data in 'obscodes.bin'.\n");
    printf( "Alternatively,  one can get a list of asteroids/comets within a desired\n");
    printf( "area with\n\n");
    printf( "astcheck -c (date) (RA in degrees) (dec in degrees) (MPC code) (options)\n\n");
@@ -734,7 +936,7 @@ int main( const int argc, const char **argv)
    double jd, ra, dec;
    FILE *ifile, *json_ofile;
    const char *sof_filename = "mpcorb.sof";
-   char buff[400];
+   char buff[400], *sof_diff_ext;
    char **ilines = NULL;
    int show_lov = 0;
    int i, n_ilines = 0, max_n_ilines = 65000, n, max_results = 100;
@@ -743,7 +945,7 @@ int main( const int argc, const char **argv)
    double mag_limit = 22.;
    AST_DATA *day_data[2] = { NULL, NULL};
    long curr_loaded_day_data = 0;
-   FILE *mpc_station_file;
+   void *mpc_codes;
    char curr_station[7];
    double rho_sin_phi = 0., rho_cos_phi = 0., longitude = 0.;
    double motion_tolerance = 10.;  /* require a match to within 10"/hr */
@@ -751,6 +953,7 @@ int main( const int argc, const char **argv)
    char **results = (char **)calloc( results_array_size, sizeof( char *));
    bool is_list_file = false;
    bool show_header = true, is_json_pointing_file = false;
+   bool cache_station_data = false;
    const char *mpcorb_extracts = "";
    const char *json_filename = "astcheck.json";
    void *ades_context = init_ades2mpc( );
@@ -827,15 +1030,16 @@ int main( const int argc, const char **argv)
             case 'f':
                sof_filename = arg;
                break;
+            case 'b':
+               cache_station_data = true;
+               break;
             default:
                printf( "%s: unrecognized command-line option\n", argv[i]);
                break;
             }
          }
-   mpc_station_file = get_file_from_path( "ObsCodes.html", "rb");
-   if( !mpc_station_file)        /* perhaps stored with truncated extension? */
-      mpc_station_file = get_file_from_path( "ObsCodes.htm", "rb");
-   if( !mpc_station_file)
+   mpc_codes = load_station_data( cache_station_data);
+   if( !mpc_codes)
       {
       printf( "ObsCodes.html not found; parallax won't be included!\n");
       printf( "Astcheck can run without this file,  but will produce better\n");
@@ -851,6 +1055,11 @@ int main( const int argc, const char **argv)
       return( -1);
       }
 
+   strlcpy_error( sof_diff_filename, sof_filename);
+   sof_diff_ext = strrchr( sof_diff_filename, '.');  /* 'mpcorb.sof' -> 'mpcorb.dif' */
+   if( sof_diff_ext && !strchr( sof_diff_ext, '/'))
+      *sof_diff_ext = '\0';
+   strlcat_error( sof_diff_filename, ".dif");
    orbits_file = get_sof_file( sof_filename);
    if( !orbits_file)
       {
@@ -964,49 +1173,27 @@ int main( const int argc, const char **argv)
          bool singleton_observation;
 
          jd += delta_t;
-         if( mpc_station_file && memcmp( mpc_code, curr_station, 3))
+         if( mpc_codes && memcmp( mpc_code, curr_station, 3))
             {
-            int got_station_data = 0;
+            const mpc_code_t *code_info;
 
             strlcpy_error( curr_station, mpc_code);
             curr_station[3] = '\0';
-            fseek( mpc_station_file, 0L, SEEK_SET);
             rho_sin_phi = rho_cos_phi = longitude = 0.;
-            while( !got_station_data &&
-                           fgets( tbuff, sizeof( tbuff), mpc_station_file))
-               got_station_data = !memcmp( tbuff, curr_station, 3);
-            if( !got_station_data)
-               {
-               FILE *rovers_file = get_file_from_path( "rovers.txt", "rb");
-
-               if( !rovers_file)
-                  {
-                  fprintf( stderr, "Couldn't open 'rovers.txt'\n");
-                  return( -1);
-                  }
-               while( !got_station_data &&
-                           fgets( tbuff, sizeof( tbuff), rovers_file))
-                  got_station_data = !memcmp( tbuff, curr_station, 3);
-               fclose( rovers_file);
+            code_info = find_mpc_code( mpc_codes, curr_station);
+            if( code_info && code_info->format == MPC_CODE_SATELLITE)
+               {        /* no fixed location,  so no parallax constants */
+               fprintf( stderr, "Code '%s' not found; error -2\n",
+                                    curr_station);
+               code_info = NULL;
                }
-            if( got_station_data)
+            if( code_info)
                {
-               mpc_code_t code_info;
-               const int err_code = get_mpc_code_info( &code_info, tbuff);
-
-               if( err_code < 0)
-                  {
-                  fprintf( stderr, "Code '%s' not found; error %d\n", tbuff, err_code);
-                  got_station_data = 0;
-                  }
-               else
-                  {
-                  longitude = code_info.lon * 180. / PI;
-                  rho_cos_phi= code_info.rho_cos_phi;
-                  rho_sin_phi= code_info.rho_sin_phi;
-                  }
+               longitude = code_info->lon * 180. / PI;
+               rho_cos_phi= code_info->rho_cos_phi;
+               rho_sin_phi= code_info->rho_sin_phi;
                }
-            if( !got_station_data)
+            else
                printf( "FAILED to find MPC code %s\n", curr_station);
             longitude *= PI / 180.;
             }
@@ -1101,7 +1288,8 @@ int main( const int argc, const char **argv)
                   n_checked++;
                   fseek( orbits_file, (i + 1) * record_length, SEEK_SET);
                   if( fgets( tbuff, sizeof( tbuff), orbits_file))
-                     sof_rval = extract_sof_data( &class_elem, tbuff, sof_header);
+                     sof_rval = extract_sof_data_compiled( &class_elem, tbuff,
+                                                         sof_plan, NULL);
                   if( sof_rval)
                      {
                      fprintf( stderr, "Couldn't read .sof elements: ast %d, rval %d\n",
@@ -1286,6 +1474,7 @@ int main( const int argc, const char **argv)
    if( day_data[1])
       free( day_data[1]);
    fclose( orbits_file);
+   free_compiled_sof_header( sof_plan);
    if( show_header)
       printf( "The apparent motion and arc length for each object are shown,  followed\n"
            "by a list of possible matches,  in order of increasing distance.  For\n"
@@ -1293,10 +1482,10 @@ int main( const int argc, const char **argv)
            "the 'total' separation,  all in arcseconds.  Next,  the magnitude and\n"
            "apparent motion of the possible match are shown.  All motions are in\n"
            "arcseconds per hour.\n");
-   if( !mpc_station_file)
+   if( !mpc_codes)
       printf( "ObsCodes.html not found; parallax wasn't included!\n");
    else
-      fclose( mpc_station_file);
+      free_mpc_code_table( mpc_codes);
    if( show_header)
       printf( "\nRun time: %.1f seconds\n",
                   (double)clock( ) / (double)CLOCKS_PER_SEC);
@@ -54,7 +54,18 @@ and saved the result.  Then :
 
 ./chinese /tmp/log.txt 10000
 
-   generated the actual 'chinese.dat' file.        */
+   generated the actual 'chinese.dat' file.
+
+   'phases' now computes new moons and principal terms a few thousand
+at a time,  in parallel if built with 'make OPENMP=Y';  add '-t' to have
+it report the elapsed (wall-clock) time.  To time the whole job and check
+that the result hasn't changed (with sorting done in plain ASCII order) :
+
+time ./phases -3000 -m8000 -c -l/tmp/log.txt -t
+LC_ALL=C sort /tmp/log.txt -o /tmp/log.txt
+cp chinese.dat /tmp/chinese.old
+time ./chinese /tmp/log.txt 10000 > /dev/null
+cmp chinese.dat /tmp/chinese.old        */
 
 #include <stdio.h>
 #include <stdint.h>
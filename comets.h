@@ -39,6 +39,7 @@ ELEMENTS
 extern "C" {
 #endif
 
+#include <stdio.h>               /* required for FILE */
 #include <stdint.h>
 
 // void calc_vectors( ELEMENTS *elem, const double sqrt_gm);
@@ -58,6 +59,12 @@ int extract_sof_data( ELEMENTS *elem, const char *buff, const char *header);
 int extract_sof_data_ex( ELEMENTS *elem, const char *buff, const char *header,
                         double *extra_info);                /* sof.cpp */
 double extract_yyyymmdd_to_jd( const char *buff);           /* sof.cpp */
+void *compile_sof_header( const char *header);              /* sof.cpp */
+int extract_sof_data_compiled( ELEMENTS *elem, const char *buff,
+                        const void *compiled_header, double *extra_info);
+void free_compiled_sof_header( void *compiled_header);      /* sof.cpp */
+int32_t get_sof_file_checksum( FILE *ifile);                /* sof.cpp */
+uint32_t get_sof_file_full_checksum( FILE *ifile);          /* sof.cpp */
 
 typedef struct
 {
@@ -68,6 +75,13 @@ typedef struct
 
 double DLL_FUNC find_moid_full( const ELEMENTS *elem1, const ELEMENTS *elem2, moid_data_t *mdata);
 
+typedef void (*moid_callback_t)( void *context, const int idx1,
+                                 const int idx2, const double moid);
+long find_moids_batch( const ELEMENTS *elems1, const int n1,
+                       const ELEMENTS *elems2, int n2, const double max_moid,
+                       moid_callback_t callback, void *context,
+                       long *n_computed);                  /* moid.cpp */
+
 #ifdef __cplusplus
 }
 #endif
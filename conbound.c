@@ -1,5 +1,7 @@
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
 #include "watdefs.h"
 #include "afuncs.h"
 
@@ -16,9 +18,10 @@ parameters passed to constell_from_ra_dec( ).
 
    Compile with
 
-gcc -Wall -Wextra -pedantic -Werror -DTEST_MAIN -o conbound conbound.c
+gcc -Wall -Wextra -pedantic -Werror -DTEST_MAIN -o conbound conbound.c liblunar.a -lm
 
-   for a small program to test/demonstrate this function.
+   for a small program to test/demonstrate this function (and benchmark
+constells_from_j2000( ),  described below).
 
    Three-letter abbreviations for 88 constellations = 264-byte string : */
 const char *constell_names =
@@ -371,14 +374,15 @@ bits (the uppermost bit is unused).  */
 #ifdef TEST_MAIN
    #include <stdio.h>
    #include <stdlib.h>
+
+static int show_search = 0;
 #endif
 
-int DLL_FUNC constell_from_ra_dec( const double ra_degrees_1875,
-                                   const double dec_degrees_1875,
-                                   char DLLPTR *constell_name)
+/* Finds the constellation for RA in seconds of time (0 to 86399) and
+south polar distance in arcminutes.  */
+
+static int constell_from_ra_spd( const int32_t ra, const int16_t spd)
 {
-   const int32_t ra = ((int32_t)(ra_degrees_1875 * 240.) + 864000) % 86400;
-   const int16_t spd = (int16_t)( (dec_degrees_1875 + 90.) * 60.);
    int idx = -1, step = 512;
    int rval = -1;
    const int n_bounds = (int)( sizeof( bounds) / sizeof( bounds[0]));      /* = 324 */
@@ -394,7 +398,8 @@ int DLL_FUNC constell_from_ra_dec( const double ra_degrees_1875,
       const int32_t max_ra = min_ra + (int32_t)bounds[idx].d_ra;
 
 #ifdef TEST_MAIN
-      printf( "%4d %11.8f %11.8f %+011.7f %.3s\n", idx, (double)min_ra / 3600.,
+      if( show_search)
+         printf( "%4d %11.8f %11.8f %+011.7f %.3s\n", idx, (double)min_ra / 3600.,
                            (double)max_ra / 3600., (double)SPD( idx) / 60. - 90.,
                            constell_names + 3 * bounds[idx].constell_idx);
 #endif
@@ -404,6 +409,17 @@ int DLL_FUNC constell_from_ra_dec( const double ra_degrees_1875,
       }
    if( rval == -1)    /* Didn't hit anything;  must be in UMi */
       rval = 83;
+   return( rval);
+}
+
+int DLL_FUNC constell_from_ra_dec( const double ra_degrees_1875,
+                                   const double dec_degrees_1875,
+                                   char DLLPTR *constell_name)
+{
+   const int32_t ra = ((int32_t)(ra_degrees_1875 * 240.) + 864000) % 86400;
+   const int16_t spd = (int16_t)( (dec_degrees_1875 + 90.) * 60.);
+   const int rval = constell_from_ra_spd( ra, spd);
+
    if( constell_name)
       {
       memcpy( constell_name, constell_names + 3 * rval, 3);
@@ -412,18 +428,223 @@ int DLL_FUNC constell_from_ra_dec( const double ra_degrees_1875,
    return( rval);
 }
 
+/* For labelling entire catalogs,  the above binary search is replaced
+by a lookup in a grid of cells GRID_RA seconds of RA wide and GRID_SPD
+arcminutes high.  Each cell holds the constellation index if the entire
+cell lies within one constellation,  or GRID_MIXED if a boundary runs
+through it;  we fall back to the above search only in the latter case.
+
+   Given the search logic above,  a cell is uniform if (a) no boundary
+lies between its southern and northern edges,  so that every point in
+it sees the same set of boundaries to the north;  and (b) going north
+from the cell,  each boundary either misses the cell's RA range entirely
+(keep going) or covers all of it (that's the constellation).  A boundary
+covering only part of the RA range means the cell is mixed.  */
+
+#define GRID_RA         120            /* seconds of RA = 30 arcmin */
+#define GRID_SPD         30            /* arcminutes */
+#define GRID_N_RA       (86400 / GRID_RA)
+#define GRID_N_SPD      (10800 / GRID_SPD + 1)
+#define GRID_MIXED      0xff
+
+static unsigned char *constell_grid = NULL;
+
+static int ra_range_overlap( const int32_t ra0, const int32_t ra1,
+                             const int32_t min_ra, const int32_t max_ra)
+{
+   int rval = 0;
+
+   if( (ra0 >= min_ra && ra1 <= max_ra)
+            || (ra0 + 86400 >= min_ra && ra1 + 86400 <= max_ra))
+      rval = 2;            /* range entirely covered */
+   else if( (ra1 > min_ra && ra0 < max_ra)
+            || (ra1 + 86400 > min_ra && ra0 + 86400 < max_ra))
+      rval = 1;            /* partial overlap */
+   return( rval);
+}
+
+static unsigned char grid_cell_constell( const int32_t ra0,
+                                         const int16_t spd0)
+{
+   const int16_t spd1 = spd0 + GRID_SPD - 1;     /* last SPD in cell */
+   const int n_bounds = (int)( sizeof( bounds) / sizeof( bounds[0]));
+   int idx = -1, i, rval = -1;
+
+   for( i = 0; i < n_bounds; i++)
+      if( SPD( i) > spd0 && SPD( i) <= spd1)
+         return( GRID_MIXED);
+   while( idx + 1 < n_bounds && spd0 < SPD( idx + 1))
+      idx++;
+   while( idx >= 0 && rval == -1)
+      {
+      const int32_t min_ra = RA( idx);
+      const int overlap = ra_range_overlap( ra0, ra0 + GRID_RA, min_ra,
+                              min_ra + (int32_t)bounds[idx].d_ra);
+
+      if( overlap == 1)
+         return( GRID_MIXED);
+      if( overlap == 2)
+         rval = bounds[idx].constell_idx;
+      idx--;
+      }
+   return( (unsigned char)( rval == -1 ? 83 : rval));
+}
+
+/* The grid is built on the first call to constells_from_j2000( ).  That
+may happen on several threads at once,  so the check and the building
+are done in a critical section.  */
+
+static int init_constell_grid( void)
+{
+   int rval = 0;
+
+#ifdef _OPENMP
+   #pragma omp critical( constell_grid_init)
+#endif
+   if( !constell_grid)
+      {
+      unsigned char *grid = (unsigned char *)malloc( GRID_N_RA * GRID_N_SPD);
+      int i, j;
+
+      if( !grid)
+         rval = -1;
+      else
+         {
+         for( i = 0; i < GRID_N_SPD; i++)
+            for( j = 0; j < GRID_N_RA; j++)
+               grid[i * GRID_N_RA + j] = grid_cell_constell( (int32_t)j * GRID_RA,
+                                       (int16_t)( i * GRID_SPD));
+         constell_grid = grid;
+         }
+      }
+   return( rval);
+}
+
+/* Determines constellations for 'n_points' J2000 RA/decs (in degrees),
+storing indices (0 to 87,  into 'constell_names') in constell_idx[].  The
+points are precessed to B1875 here.  The results are exactly those you'd
+get by precessing with setup_precession( ) and calling
+constell_from_ra_dec( ).  Returns -1 if memory for the grid couldn't be
+allocated.  */
+
+int DLL_FUNC constells_from_j2000( const size_t n_points,
+                     const double DLLPTR *ra_degrees,
+                     const double DLLPTR *dec_degrees,
+                     char DLLPTR *constell_idx)
+{
+   const double pi =
+     3.1415926535897932384626433832795028841971693993751058209749445923078;
+   double matrix[9];
+   long i;
+
+   if( init_constell_grid( ))
+      return( -1);
+   setup_precession( matrix, 2000., 1875.);
+#ifdef _OPENMP
+   #pragma omp parallel for
+#endif
+   for( i = 0; i < (long)n_points; i++)
+      {
+      const double ra = ra_degrees[i] * pi / 180.;
+      const double dec = dec_degrees[i] * pi / 180.;
+      const double cos_dec = cos( dec);
+      const double v0 = cos( ra) * cos_dec, v1 = sin( ra) * cos_dec;
+      const double v2 = sin( dec);
+      const double x = matrix[0] * v0 + matrix[1] * v1 + matrix[2] * v2;
+      const double y = matrix[3] * v0 + matrix[4] * v1 + matrix[5] * v2;
+      const double z = matrix[6] * v0 + matrix[7] * v1 + matrix[8] * v2;
+      const double ra_1875 = atan2( y, x) * 180. / pi;
+      const double dec_1875 = asin( z) * 180. / pi;
+      const int32_t ira = ((int32_t)(ra_1875 * 240.) + 864000) % 86400;
+      const int16_t spd = (int16_t)( (dec_1875 + 90.) * 60.);
+      const unsigned char cell = constell_grid[(spd / GRID_SPD) * GRID_N_RA
+                                             + ira / GRID_RA];
+
+      constell_idx[i] = (char)( cell == GRID_MIXED ?
+                                 constell_from_ra_spd( ira, spd) : cell);
+      }
+   return( 0);
+}
+
 #ifdef TEST_MAIN
 
+#include <time.h>
+
+/* Benchmark:  labels 'n_points' pseudo-random J2000 points with
+constells_from_j2000( ),  then checks them (and times the checking)
+the "usual" way:  precess each point and call constell_from_ra_dec( ). */
+
+#define BLOCK_SIZE 1000000
+
+static void benchmark( const long n_points)
+{
+   double *ra = (double *)malloc( BLOCK_SIZE * 2 * sizeof( double));
+   double *dec = ra + BLOCK_SIZE, matrix[9];
+   char *idx = (char *)malloc( BLOCK_SIZE);
+   clock_t batch_time = 0, single_time = 0, t0;
+   long i, j, n_mismatches = 0;
+   uint32_t seed = 12345;
+   const double pi =
+     3.1415926535897932384626433832795028841971693993751058209749445923078;
+
+   init_constell_grid( );
+   for( i = j = 0; i < GRID_N_RA * GRID_N_SPD; i++)
+      if( constell_grid[i] == GRID_MIXED)
+         j++;
+   printf( "%ld of %d grid cells are mixed\n", j, GRID_N_RA * GRID_N_SPD);
+   setup_precession( matrix, 2000., 1875.);
+   for( i = 0; i < n_points; i += BLOCK_SIZE)
+      {
+      const long n = (n_points - i < BLOCK_SIZE ? n_points - i : BLOCK_SIZE);
+
+      for( j = 0; j < n; j++)
+         {           /* uniform over the sphere */
+         seed = seed * 1664525u + 1013904223u;
+         ra[j] = (double)seed * 360. / 4294967296.;
+         seed = seed * 1664525u + 1013904223u;
+         dec[j] = asin( (double)seed / 2147483648. - 1.) * 180. / pi;
+         }
+      t0 = clock( );
+      constells_from_j2000( (size_t)n, ra, dec, idx);
+      batch_time += clock( ) - t0;
+      t0 = clock( );
+      for( j = 0; j < n; j++)
+         {
+         double vect[3], ra_dec[2];
+
+         polar3_to_cartesian( vect, ra[j] * pi / 180., dec[j] * pi / 180.);
+         precess_vector( matrix, vect, vect);
+         ra_dec[0] = atan2( vect[1], vect[0]) * 180. / pi;
+         ra_dec[1] = asin( vect[2]) * 180. / pi;
+         if( constell_from_ra_dec( ra_dec[0], ra_dec[1], NULL) != idx[j])
+            n_mismatches++;
+         }
+      single_time += clock( ) - t0;
+      }
+   printf( "%ld points: %.3f s batch (%.1f million/s),  %.3f s one at a time\n",
+            n_points, (double)batch_time / (double)CLOCKS_PER_SEC,
+            (double)n_points * 1e-6 * (double)CLOCKS_PER_SEC / (double)batch_time,
+            (double)single_time / (double)CLOCKS_PER_SEC);
+   printf( "%ld mismatches\n", n_mismatches);
+   free( ra);
+   free( idx);
+}
+
 /* Run this with an RA/dec in decimal hours and degrees.  The corresponding
-constellation and some of the logic required to determine it will be shown. */
+constellation and some of the logic required to determine it will be shown.
+Or run with '-b' (and optionally a number of points) for a benchmark.  */
 
 int main( const int argc, const char **argv)
 {
-   if( argc == 3)
+   if( argc >= 2 && !strcmp( argv[1], "-b"))
+      benchmark( argc > 2 ? atol( argv[2]) : 300000000L);
+   else if( argc == 3)
       {
       char constell[4];
-      int rval = constell_from_ra_dec( atof( argv[1]) * 15, atof( argv[2]), constell);
+      int rval;
 
+      show_search = 1;
+      rval = constell_from_ra_dec( atof( argv[1]) * 15, atof( argv[2]), constell);
       printf( "Memory used: %d (%d bytes/entry)\n", (int)sizeof( bounds),
                               (int)sizeof( bounds[0]));
       printf( "rval %d = '%s'\n", rval, constell);
@@ -431,7 +652,8 @@ int main( const int argc, const char **argv)
    else
       printf( "Test/debugging code to determine constellation for a given point\n"
               "Usage : conbound (RA in decimal hours) (dec in decimal degrees)\n"
-              "Coordinates must be in B1875 epoch\n");
+              "Coordinates must be in B1875 epoch\n"
+              "   or : conbound -b (n_points)   to benchmark constells_from_j2000()\n");
    return( 0);
 }
 #endif
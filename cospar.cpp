@@ -22,15 +22,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #include <stdlib.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <stdint.h>
 #include <math.h>
 #include "watdefs.h"
 #include "afuncs.h"
 #include "lunar.h"
 
 #define PI 3.1415926535897932384626433832795028841971693993751058209749445923
-#define FREE_INTERNAL_DATA       -99999
 #define NO_OBJECT_SELECTED       -99999
-#define PLANET_SELECTED          -99998
 
 const char *cospar_filename = "cospar.txt";
 
@@ -48,236 +47,513 @@ that data.
 'cospar.txt' also has object dimensions.  These can be one number
 (for a sphere),  two (for an oblate spheroid),  or three (for a
 triaxial ellipsoid).  If 'radii' is non-NULL,  one,  two,  or three
-numbers will be set accordingly,  with the remainder set to zero. */
+numbers will be set accordingly,  with the remainder set to zero.
+
+   The text is read once and compiled into a table of objects,  each with
+expressions for the pole RA,  pole dec,  and W (one per rotation system).
+Each expression is a list of terms :  a constant,  linear and quadratic
+terms in days or centuries,  and sine/cosine terms whose arguments are
+copied from the relevant 'Planet:' section,  so that evaluating an
+orientation involves no text parsing at all.  Objects are sorted by
+number for lookup.   */
+
+#define COSPAR_CONSTANT      0
+#define COSPAR_LINEAR_D      1
+#define COSPAR_QUAD_D        2
+#define COSPAR_LINEAR_T      3
+#define COSPAR_QUAD_T        4
+#define COSPAR_SINE          5
+#define COSPAR_COSINE        6
+
+typedef struct
+{
+   double coeff;
+   double angle0, angle_rate;       /* for sine/cosine terms;  degrees */
+   int multiplier;
+   char type;                       /* see above COSPAR_xxx #defines */
+   char angle_unit;                 /* 'd' or 'T' */
+} cospar_term_t;
+
+typedef struct
+{
+   int start, n_terms;              /* index into the table's terms */
+   char system;                     /* for W : '=' (any),  '1'...'9' */
+} cospar_expr_t;
 
-static int get_cospar_data_from_text_file( int object_number,
-         const int system_number, const double jde,
-         double *pole_ra, double *pole_dec, double *omega,
-         double *radii, bool *is_retrograde)
+#define MAX_W_EXPRS 4
+
+typedef struct
 {
-   const double J2000 = 2451545.0;        /* JD 2451545.0 = 1.5 Jan 2000 */
-   const double d = (jde - J2000);
-   const double t_cen = d / 36525.;
-   static char **cospar_text = NULL;
+   int object_number, file_order, err, n_w;
+   double radii[3];
+   cospar_expr_t pole_ra, pole_dec, w[MAX_W_EXPRS];
+} cospar_obj_t;
+
+typedef struct
+{
+   int n_objects, n_terms, n_remaps;
+   bool out_of_memory;
+   cospar_obj_t *objects;
+   cospar_term_t *terms;
+   int *remaps;                     /* pairs:  remaps[2n + 1] -> remaps[2n] */
+} cospar_table_t;
+
+/* The table is compiled on first use.  That may happen on several
+threads at once,  so it's done (and the pointer to it is read) inside a
+critical section.  Within the library,  the pointer is fetched once per
+call and passed down,  so the batch functions don't contend for it.  */
+
+static cospar_table_t *cospar_table = NULL;
+
+/* Incremented whenever load_cospar_file( ) replaces the table,  so that
+the orientation caches (below) know to discard what they hold.  */
+
+static unsigned cospar_generation = 1;
+
+/* Reads the lines of 'cospar.txt' (up to any 'END' line),  stripping
+comments and (except for 'Remap:' lines) spaces.  Returns a NULL-terminated
+array of lines in one allocation,  or NULL if the file couldn't be read. */
+
+static char **load_cospar_text( const char *filename)
+{
+   FILE *ifile = fopen( filename, "rb");
+   char **cospar_text = NULL;
    char buff[300];
-   char planet = 0;
-   int line, angular_coeffs_line = 0;
-   int i, err = 0, done = 0, got_omega = 0;
-   int curr_obj_from_file = NO_OBJECT_SELECTED;
+   int i, line = 0, pass;
 
-   if( object_number == FREE_INTERNAL_DATA)
+   if( !ifile)
+      return( NULL);
+               /* make two passes through file:  one to count lines */
+               /* and file size, another to load the file           */
+   for( pass = 0; pass < 2; pass++)
       {
-      if( cospar_text)
-         free( cospar_text);
-      cospar_text = NULL;
-      return( 0);
+      size_t bytes_read = 0;
+
+      fseek( ifile, 0L, SEEK_SET);
+      line = 0;
+      while( fgets( buff, sizeof( buff), ifile) && memcmp( buff, "END", 3))
+         {
+         for( i = 0; buff[i] >= ' ' && buff[i] != '#'; i++)
+            ;
+         if( i)      /* yes,  it's a for-real line */
+            {
+            int j;
+
+            buff[i] = '\0';
+                     /* remove redundant spaces: */
+            if( memcmp( buff, "Remap:", 6))
+               for( i = j = 0; buff[j]; j++)
+                  if( buff[j] != ' ')
+                     buff[i++] = buff[j];
+            buff[i] = '\0';
+            if( pass)
+               {
+               strcpy( cospar_text[line], buff);
+               cospar_text[line + 1] = cospar_text[line] + i + 1;
+               }
+            else  /* just counting bytes and lines */
+               bytes_read += (size_t)i + 1;
+            line++;
+            }
+         }
+      if( !pass)     /* we've counted lines & bytes; now alloc memory */
+         {
+         cospar_text = (char **)malloc( (size_t)(line + 1) * sizeof( char *)
+                     + bytes_read);
+         if( !cospar_text)
+            break;
+         cospar_text[0] = (char *)(cospar_text + line + 1);
+         }
       }
+   if( cospar_text)
+      cospar_text[line] = NULL;
+   fclose( ifile);
+   return( cospar_text);
+}
+
+static cospar_term_t *add_cospar_term( cospar_table_t *table,
+                           const char type, const double coeff)
+{
+   cospar_term_t *rval;
 
-   if( !cospar_text)       /* must load file */
+   if( table->out_of_memory)
+      return( NULL);
+   if( !(table->n_terms & 0xff))
       {
-      FILE *ifile = fopen( cospar_filename, "rb");
-      int pass;
-
-      if( !ifile)
-         return( -1);
-                  /* make two passes through file:  one to count lines */
-                  /* and file size, another to load the file           */
-      for( pass = 0; pass < 2; pass++)
+      cospar_term_t *new_terms = (cospar_term_t *)realloc( table->terms,
+                   (table->n_terms + 0x100) * sizeof( cospar_term_t));
+
+      if( !new_terms)
          {
-         size_t bytes_read = 0;
+         table->out_of_memory = true;
+         return( NULL);
+         }
+      table->terms = new_terms;
+      }
+   rval = table->terms + table->n_terms++;
+   memset( rval, 0, sizeof( cospar_term_t));
+   rval->type = type;
+   rval->coeff = coeff;
+   return( rval);
+}
+
+/* Compiles an expression such as 'W=38.3213+13.17635815d-1.4e-12d2
++3.5610sinE1...' into terms.  'angles' points to the line before the
+first angle (E1,  E2,  etc.) definition of the current planet.  Returns
+an error code (zero if all went well),  matching those formerly returned
+when the text was parsed on the fly.  */
 
-         fseek( ifile, 0L, SEEK_SET);
-         line = 0;
-         while( fgets( buff, sizeof( buff), ifile) && memcmp( buff, "END", 3))
+static int compile_cospar_expr( cospar_table_t *table, cospar_expr_t *expr,
+            const char *tptr, char **angles, const char planet)
+{
+   int err = 0;
+
+   expr->start = table->n_terms;
+   while( *tptr != '=')
+      tptr++;
+   tptr++;
+   add_cospar_term( table, COSPAR_CONSTANT, atof( tptr));
+   if( *tptr == '-')     /* skip leading neg sign */
+      tptr++;
+   while( *tptr)
+      if( *tptr != '+' && *tptr != '-')
+         tptr++;        /* just skip on over... */
+      else
+         {
+         char *endptr;
+         const double coeff = strtod( tptr, &endptr);
+
+         tptr = endptr;
+         if( *tptr == 'd')
+            add_cospar_term( table, (tptr[1] == '2' ? COSPAR_QUAD_D
+                                    : COSPAR_LINEAR_D), coeff);
+         else if( *tptr == 'T')
+            add_cospar_term( table, (tptr[1] == '2' ? COSPAR_QUAD_T
+                                    : COSPAR_LINEAR_T), coeff);
+         else
             {
-            for( i = 0; buff[i] >= ' ' && buff[i] != '#'; i++)
-               ;
-            if( i)      /* yes,  it's a for-real line */
+            int idx, multiplier = 1;
+            char *ang_ptr;
+            cospar_term_t *term;
+
+            if( tptr[3] == planet)
+               idx = atoi( tptr + 4);
+            else
                {
-               int j;
-
-               buff[i] = '\0';
-                        /* remove redundant spaces: */
-               if( memcmp( buff, "Remap:", 6))
-                  for( i = j = 0; buff[j]; j++)
-                     if( buff[j] != ' ')
-                        buff[i++] = buff[j];
-               buff[i] = '\0';
-               if( pass)
-                  {
-                  strcpy( cospar_text[line], buff);
-                  cospar_text[line + 1] = cospar_text[line] + i + 1;
-                  }
-               else  /* just counting bytes and lines */
-                  bytes_read += (size_t)i + 1;
-               line++;
+               multiplier = atoi( tptr + 3);
+               idx = atoi( tptr + 5);
+               if( tptr[4] != planet)
+                  err = -4;
                }
-            }
-         if( !pass)     /* we've counted lines & bytes; now alloc memory */
-            {
-            cospar_text = (char **)malloc( (size_t)(line + 1) * sizeof( char *)
-                        + bytes_read);
-            cospar_text[0] = (char *)(cospar_text + line + 1);
+            assert( angles);
+            term = add_cospar_term( table, (*tptr == 's' ? COSPAR_SINE
+                                    : COSPAR_COSINE), coeff);
+            if( !term)        /* out of memory;  table will be discarded */
+               return( -1);
+            ang_ptr = angles[idx] + 1;
+            while( ang_ptr[-1] != '=')
+               ang_ptr++;
+            term->angle0 = strtod( ang_ptr, &ang_ptr);
+            term->angle_rate = strtod( ang_ptr, &ang_ptr);
+            term->angle_unit = *ang_ptr;
+            assert( term->angle_unit == 'd' || term->angle_unit == 'T');
+            term->multiplier = multiplier;
+            if( !multiplier)
+               err = -5;
+            else if( *tptr != 's' && *tptr != 'c')
+               err = -2;
             }
          }
-      cospar_text[line] = NULL;
-      fclose( ifile);
-      if( !omega)        /* just loading coefficients;  not actually */
-         return( 0);       /* computing orientations quite yet (see    */
-      }                    /* load_cospar_file( ) below)               */
-   *is_retrograde = false;
-   if( radii)
-      radii[0] = radii[1] = radii[2] = 0.;
-   for( line = 0; cospar_text[line] && !done && !err; line++)
+   expr->n_terms = table->n_terms - expr->start;
+   return( err);
+}
+
+static int compare_cospar_objs( const void *a, const void *b)
+{
+   const cospar_obj_t *aptr = (const cospar_obj_t *)a;
+   const cospar_obj_t *bptr = (const cospar_obj_t *)b;
+
+   if( aptr->object_number != bptr->object_number)
+      return( aptr->object_number > bptr->object_number ? 1 : -1);
+   return( aptr->file_order - bptr->file_order);
+}
+
+static void free_cospar_table( cospar_table_t *table)
+{
+   if( table)
       {
-      char *tptr = cospar_text[line];
+      free( table->objects);
+      free( table->terms);
+      free( table->remaps);
+      free( table);
+      }
+}
+
+static cospar_table_t *compile_cospar_table( const char *filename)
+{
+   char **cospar_text = load_cospar_text( filename);
+   cospar_table_t *table;
+   cospar_obj_t *curr_obj = NULL;
+   char planet = 0;
+   bool planet_selected = false;
+   int line, i, n_alloced = 0, angular_coeffs_line = 0;
+
+   if( !cospar_text)
+      return( NULL);
+   table = (cospar_table_t *)calloc( 1, sizeof( cospar_table_t));
+   if( !table)
+      {
+      free( cospar_text);
+      return( NULL);
+      }
+   for( line = 0; cospar_text[line] && !table->out_of_memory; line++)
+      {
+      const char *tptr = cospar_text[line];
 
       if( *tptr == 'R')        /* "Remap:" */
-         if( object_number > 9 && object_number < 1000) /* remap, e.g, 10 to 3001 */
-             {                                          /* or 28 to 4001.  Only   */
-             int loc = 6, bytes_read, idx1, idx2;   /* needed for idxs 10 to 999. */
-
-             while( sscanf( tptr + loc, "%d %d%n", &idx1, &idx2, &bytes_read) == 2)
-                {
-                if( object_number == idx2)
-                   object_number = idx1;
-                loc += bytes_read;
-                }
-             }
+         {
+         int loc = 6, bytes_read, idx1, idx2;
+
+         while( sscanf( tptr + loc, "%d %d%n", &idx1, &idx2, &bytes_read) == 2)
+            {
+            int *new_remaps = (int *)realloc( table->remaps,
+                           (table->n_remaps + 1) * 2 * sizeof( int));
+
+            if( !new_remaps)
+               {
+               table->out_of_memory = true;
+               break;
+               }
+            table->remaps = new_remaps;
+            table->remaps[table->n_remaps * 2] = idx1;
+            table->remaps[table->n_remaps * 2 + 1] = idx2;
+            table->n_remaps++;
+            loc += bytes_read;
+            }
+         }
       if( *tptr == 'P')   /* "Planet: "*/
          {
          planet = tptr[7];
-         if( curr_obj_from_file == object_number)
-            done = 1;
-         curr_obj_from_file = PLANET_SELECTED;
+         planet_selected = true;
+         curr_obj = NULL;
          }
       else if( *tptr == 'O')    /* "Object:" */
          {
-         if( curr_obj_from_file == object_number)
-            done = 1;
-         curr_obj_from_file = atoi( tptr + 4);
+         if( table->n_objects == n_alloced)
+            {
+            cospar_obj_t *new_objects = (cospar_obj_t *)realloc(
+                     table->objects, (n_alloced + 64) * sizeof( cospar_obj_t));
+
+            if( !new_objects)
+               {
+               table->out_of_memory = true;
+               break;
+               }
+            n_alloced += 64;
+            table->objects = new_objects;
+            }
+         curr_obj = table->objects + table->n_objects;
+         memset( curr_obj, 0, sizeof( cospar_obj_t));
+         curr_obj->object_number = atoi( tptr + 4);
+         curr_obj->file_order = table->n_objects++;
+         curr_obj->pole_ra.start = curr_obj->pole_dec.start = -1;
+         planet_selected = false;
          }
-      else if( planet && curr_obj_from_file == PLANET_SELECTED
-               && tptr[0] == planet && tptr[1] == '1'
-               && tptr[2] == '=')
+      else if( planet && planet_selected && tptr[0] == planet
+               && tptr[1] == '1' && tptr[2] == '=')
          angular_coeffs_line = line - 1;
-      else if( curr_obj_from_file == object_number)
+      else if( curr_obj)
          {
-         double *oval = NULL;
+         cospar_expr_t *expr = NULL;
 
          if( *tptr == 'r')
-            {
-            if( radii)
-               sscanf( tptr + 2, "%lf,%lf,%lf", radii, radii + 1, radii + 2);
-            }
+            sscanf( tptr + 2, "%lf,%lf,%lf", curr_obj->radii,
+                           curr_obj->radii + 1, curr_obj->radii + 2);
          else if( *tptr == 'a')    /* "a0=" */
-            oval = pole_ra;
+            expr = &curr_obj->pole_ra;
          else if( *tptr == 'd')   /* "d0=" */
-            oval = pole_dec;
-         else if( !got_omega && *tptr == 'W')
-            if( tptr[1] == (char)(system_number + '0') || tptr[1] == '=')
-               {
-               got_omega = 1;
-               oval = omega;
-               }
-         if( oval)
+            expr = &curr_obj->pole_dec;
+         else if( *tptr == 'W' && curr_obj->n_w < MAX_W_EXPRS)
             {
-            while( *tptr != '=')
-               tptr++;
-            tptr++;
-            *oval = atof( tptr);
-            if( *tptr == '-')     /* skip leading neg sign */
-               tptr++;
-            while( *tptr)
-               if( *tptr != '+' && *tptr != '-')
-                  tptr++;        /* just skip on over... */
-               else
-                  {
-                  double coeff = strtod( tptr, &tptr);
-
-                  assert( tptr);
-                  if( *tptr == 'd')
-                     {
-                     if( tptr[1] == '2')
-                        coeff *= d;
-                     else if( coeff < 0. && oval == omega)
-                        *is_retrograde = true;
-                     if( oval == omega && !pole_ra && !pole_dec)    /* just after the rotation rate */
-                        {
-                        *oval = coeff;
-                        return( 0);
-                        }
-                     coeff *= d;
-                     }
-                  else if( *tptr == 'T')
-                     {
-                     if( tptr[1] == '2')
-                        coeff *= t_cen;
-                     else if( coeff < 0. && oval == omega)
-                        *is_retrograde = true;
-                     coeff *= t_cen;
-                     }
-                  else
-                     {
-                     int idx, multiplier = 1;
-                     double angle;
-                     double linear, constant_term;
-                     char d_or_T, *ang_ptr;
-
-                     if( tptr[3] == planet)
-                        idx = atoi( tptr + 4);
-                     else
-                        {
-                        multiplier = atoi( tptr + 3);
-                        idx = atoi( tptr + 5);
-                        if( tptr[4] != planet)
-                           err = -4;
-                        }
-                     assert( angular_coeffs_line);
-                     ang_ptr = cospar_text[angular_coeffs_line + idx] + 1;
-                     while( ang_ptr[-1] != '=')
-                        ang_ptr++;
-
-                     constant_term = strtod( ang_ptr, &ang_ptr);
-                     assert( ang_ptr);
-                     linear = strtod( ang_ptr, &ang_ptr);
-                     assert( ang_ptr);
-                     d_or_T = *ang_ptr++;
-                     assert( d_or_T == 'd' || d_or_T == 'T');
-                     angle = constant_term + linear *
-                                   (d_or_T == 'd' ? d : t_cen);
-
-                     angle *= (double)multiplier * PI / 180.;
-                     if( !multiplier)
-                        err = -5;
-                     else if( angle == 0.)
-                        err = -3;
-                     else if( *tptr == 's')     /* sine term */
-                        coeff *= sin( angle);
-                     else if( *tptr == 'c')     /* cosine term */
-                        coeff *= cos( angle);
-                     else
-                        err = -2;
-                     }
-                  *oval += coeff;
-                  }
+            expr = curr_obj->w + curr_obj->n_w++;
+            expr->system = tptr[1];
+            }
+         if( expr)
+            {
+            const int err = compile_cospar_expr( table, expr, tptr,
+                 (angular_coeffs_line ? cospar_text + angular_coeffs_line : NULL),
+                 planet);
+
+            if( err && !curr_obj->err)
+               curr_obj->err = err;
             }
          }
       }
-   if( !err)
-      if( !done)    /* never did find the object... fill with  */
-         {          /* semi-random values and signal an error: */
-         if( pole_ra && pole_dec)
-            *pole_ra = *pole_dec = (double)( object_number * 20);
-         if( omega)
-            *omega = d * 360. / 1.3;   /* rotation once every 1.3 days */
-         err = -1;
-         }
-#ifdef TEST_MAIN
-   if( err && err != -1)
-      printf( "ERROR %d: %s\n", err, buff);
+   free( cospar_text);
+   if( table->out_of_memory)
+      {
+      free_cospar_table( table);
+      return( NULL);
+      }
+            /* If an object appears twice,  the first instance is used : */
+   qsort( table->objects, table->n_objects, sizeof( cospar_obj_t),
+                        compare_cospar_objs);
+   for( i = line = 0; i < table->n_objects; i++)
+      if( !i || table->objects[i].object_number != table->objects[line - 1].object_number)
+         table->objects[line++] = table->objects[i];
+   table->n_objects = line;
+   return( table);
+}
+
+static const cospar_table_t *get_cospar_table( void)
+{
+   const cospar_table_t *rval;
+
+#ifdef _OPENMP
+   #pragma omp critical( cospar_table_init)
 #endif
-   return( err);
+   {
+   if( !cospar_table)
+      cospar_table = compile_cospar_table( cospar_filename);
+   rval = cospar_table;
+   }
+   return( rval);
+}
+
+/* Remaps,  e.g, 10 to 3001 or 28 to 4001.  Only needed for idxs 10 to 999. */
+
+static const cospar_obj_t *find_cospar_obj( const cospar_table_t *table,
+                        int *object_number)
+{
+   int i, lo = 0, hi = table->n_objects;
+
+   if( *object_number > 9 && *object_number < 1000)
+      for( i = 0; i < table->n_remaps; i++)
+         if( *object_number == table->remaps[i * 2 + 1])
+            {
+            *object_number = table->remaps[i * 2];
+            break;
+            }
+   while( lo < hi)
+      {
+      const int mid = (lo + hi) / 2;
+
+      if( table->objects[mid].object_number < *object_number)
+         lo = mid + 1;
+      else
+         hi = mid;
+      }
+   if( lo < table->n_objects && table->objects[lo].object_number == *object_number)
+      return( table->objects + lo);
+   return( NULL);
+}
+
+static const cospar_expr_t *find_w_expr( const cospar_obj_t *obj,
+                                             const int system_number)
+{
+   int i;
+
+   for( i = 0; i < obj->n_w; i++)
+      if( obj->w[i].system == (char)(system_number + '0')
+                              || obj->w[i].system == '=')
+         return( obj->w + i);
+   return( NULL);
+}
+
+static double eval_cospar_expr( const cospar_table_t *table,
+               const cospar_expr_t *expr, const double d, const double t_cen,
+               int *err)
+{
+   const cospar_term_t *term = table->terms + expr->start;
+   double rval = 0.;
+   int i;
+
+   for( i = expr->n_terms; i; i--, term++)
+      switch( term->type)
+         {
+         case COSPAR_CONSTANT:
+            rval += term->coeff;
+            break;
+         case COSPAR_LINEAR_D:
+            rval += term->coeff * d;
+            break;
+         case COSPAR_QUAD_D:
+            rval += term->coeff * d * d;
+            break;
+         case COSPAR_LINEAR_T:
+            rval += term->coeff * t_cen;
+            break;
+         case COSPAR_QUAD_T:
+            rval += term->coeff * t_cen * t_cen;
+            break;
+         default:          /* sine & cosine terms */
+            {
+            double angle = term->angle0 + term->angle_rate *
+                              (term->angle_unit == 'd' ? d : t_cen);
+
+            angle *= (double)term->multiplier * PI / 180.;
+            if( angle == 0.)
+               *err = -3;
+            else
+               rval += term->coeff * (term->type == COSPAR_SINE ?
+                                          sin( angle) : cos( angle));
+            }
+            break;
+         }
+   return( rval);
+}
+
+static bool cospar_expr_is_retrograde( const cospar_table_t *table,
+                                       const cospar_expr_t *expr)
+{
+   const cospar_term_t *term = table->terms + expr->start;
+   int i;
+
+   for( i = expr->n_terms; i; i--, term++)
+      if( (term->type == COSPAR_LINEAR_D || term->type == COSPAR_LINEAR_T)
+                  && term->coeff < 0.)
+         return( true);
+   return( false);
+}
+
+static int get_cospar_data( const cospar_table_t *table, int object_number,
+         const int system_number, const double jde,
+         double *pole_ra, double *pole_dec, double *omega,
+         double *radii, bool *is_retrograde)
+{
+   const double J2000 = 2451545.0;        /* JD 2451545.0 = 1.5 Jan 2000 */
+   const double d = (jde - J2000);
+   const double t_cen = d / 36525.;
+   const cospar_obj_t *obj;
+   const cospar_expr_t *w_expr;
+   int err = 0;
+
+   *is_retrograde = false;
+   if( !table)
+      return( -1);
+   obj = find_cospar_obj( table, &object_number);
+   if( !obj)         /* never did find the object... fill with  */
+      {              /* semi-random values and signal an error: */
+      if( radii)
+         radii[0] = radii[1] = radii[2] = 0.;
+      if( pole_ra && pole_dec)
+         *pole_ra = *pole_dec = (double)( object_number * 20);
+      if( omega)
+         *omega = d * 360. / 1.3;   /* rotation once every 1.3 days */
+      return( -1);
+      }
+   if( radii)
+      memcpy( radii, obj->radii, 3 * sizeof( double));
+   if( pole_ra && obj->pole_ra.start >= 0)
+      *pole_ra = eval_cospar_expr( table, &obj->pole_ra, d, t_cen, &err);
+   if( pole_dec && obj->pole_dec.start >= 0)
+      *pole_dec = eval_cospar_expr( table, &obj->pole_dec, d, t_cen, &err);
+   w_expr = find_w_expr( obj, system_number);
+   if( omega)
+      *omega = (w_expr ? eval_cospar_expr( table, w_expr, d, t_cen, &err) : 0.);
+   if( w_expr)
+      *is_retrograde = cospar_expr_is_retrograde( table, w_expr);
+   return( obj->err ? obj->err : err);
 }
 
 /* Some programs (e.g.,  Find_Orb) put 'cospar.txt' in some directory
@@ -287,42 +563,61 @@ a specified file.          */
 
 int DLL_FUNC load_cospar_file( const char *filename)
 {
-   const char *temp_name = cospar_filename;
-   int rval, pass;
-
-   cospar_filename = filename;
-   for( pass = 0; pass < (filename ? 2 : 1); pass++)
-      rval = get_cospar_data_from_text_file( (pass ? 0 : FREE_INTERNAL_DATA),
-                    0, 0., NULL, NULL, NULL, NULL, NULL);
-   cospar_filename = temp_name;
+   int rval = 0;
+
+#ifdef _OPENMP
+   #pragma omp critical( cospar_table_init)
+#endif
+   {
+   free_cospar_table( cospar_table);
+   cospar_table = NULL;
+#ifdef _OPENMP
+   #pragma omp atomic update
+#endif
+   cospar_generation++;
+   if( filename)
+      {
+      cospar_table = compile_cospar_table( filename);
+      if( !cospar_table)
+         rval = -1;
+      }
+   }
    return( rval);
 }
 
+/* The rotation rate is the coefficient of the first term linear in 'd'
+in the expression for W.   */
+
 double DLL_FUNC planet_rotation_rate( const int planet_no, const int system_no)
 {
-   const double dummy_tdt = 2451545.;     /* not really used */
-   bool is_retrograde;
-   static int prev_planet_no = -99, prev_system_no;
-   static double omega;
+   const cospar_table_t *table = get_cospar_table( );
+   int object_number = planet_no;
+   const cospar_obj_t *obj = (table ? find_cospar_obj( table, &object_number) : NULL);
+   const cospar_expr_t *w_expr = (obj ? find_w_expr( obj, system_no) : NULL);
+   double rval = 0.;
 
-   if( planet_no != prev_planet_no || system_no != prev_system_no)
+   if( w_expr && !obj->err)
       {
-      const int rval = get_cospar_data_from_text_file( planet_no, system_no,
-              dummy_tdt, NULL, NULL, &omega, NULL, &is_retrograde);
-
-      if( rval)
-         omega = 0.;
-      prev_planet_no = planet_no;
-      prev_system_no = system_no;
+      const cospar_term_t *term = table->terms + w_expr->start;
+      int i, err = 0;
+
+      for( i = w_expr->n_terms; i; i--, term++)
+         if( term->type == COSPAR_LINEAR_D)
+            return( term->coeff);
+         else if( term->type == COSPAR_QUAD_D)
+            return( 0.);
+      rval = eval_cospar_expr( table, w_expr, 0., 0., &err);
+      if( err)
+         rval = 0.;
       }
-   return( omega);
+   return( rval);
 }
 
 int DLL_FUNC planet_radii( const int planet_no, double *radii_in_km)
 {
    const double dummy_tdt = 2451545.;     /* not really used */
    bool is_retrograde;
-   const int rval = get_cospar_data_from_text_file( planet_no, 0,
+   const int rval = get_cospar_data( get_cospar_table( ), planet_no, 0,
               dummy_tdt, NULL, NULL, NULL, radii_in_km, &is_retrograde);
 
    return( rval);
@@ -339,32 +634,14 @@ For a retrograde object,  the IAU's boneheaded convention results in a
 left-handed system (see the 'if( is_retrograde)' code that flips the
 middle of the above three vectors).  */
 
-#ifdef TEST_MAIN
-int DLL_FUNC calc_planet_orientation2( const int planet_no, const int system_no,
+static int compute_planet_orientation( const cospar_table_t *table,
+                  const int planet_no, const int system_no,
                   const double jd, double *matrix)
-#else
-int DLL_FUNC calc_planet_orientation( const int planet_no, const int system_no,
-                  const double jd, double *matrix)
-#endif
 {
-   static int prev_planet_no = NO_OBJECT_SELECTED;
-   static int prev_system_no = NO_OBJECT_SELECTED, prev_rval = 0;
-   static double prev_jd = -1.;
-   static double prev_matrix[9];
    int i, rval;
    bool is_retrograde;
-   double pole_ra, pole_dec, omega, tdt;
-
-   if( planet_no == prev_planet_no && system_no == prev_system_no
-                           && jd == prev_jd)
-      {
-      memcpy( matrix, prev_matrix, 9 * sizeof( double));
-      return( prev_rval);
-      }
+   double pole_ra = 0., pole_dec = 0., omega = 0., tdt;
 
-   prev_planet_no = planet_no;
-   prev_system_no = system_no;
-   prev_jd = jd;
    tdt = jd + td_minus_ut( jd) / seconds_per_day;
 
    if( planet_no == 3)        /* handle earth with "normal" precession: */
@@ -378,12 +655,10 @@ int DLL_FUNC calc_planet_orientation( const int planet_no, const int system_no,
                /* it to point at E90... go figure.       */
       for( i = 3; i < 6; i++)
          matrix[i] = -matrix[i];
-      memcpy( prev_matrix, matrix, 9 * sizeof( double));
-      prev_rval = 0;
       return( 0);
       }
 
-   rval = get_cospar_data_from_text_file( planet_no, system_no,
+   rval = get_cospar_data( table, planet_no, system_no,
               tdt, &pole_ra, &pole_dec, &omega, NULL, &is_retrograde);
    pole_ra *= PI / 180.;
    pole_dec *= PI / 180.;
@@ -395,16 +670,170 @@ int DLL_FUNC calc_planet_orientation( const int planet_no, const int system_no,
    if( is_retrograde)
       for( i = 3; i < 6; i++)
          matrix[i] *= -1.;
-   memcpy( prev_matrix, matrix, 9 * sizeof( double));
-   prev_rval = rval;
    return( rval);
 }
 
+/* Orientations are cached by (object,  system,  JD).  Each cache is a
+small direct-mapped table,  so that a loop mixing several objects (the
+usual case when,  say,  showing a planet and its satellites) doesn't keep
+evicting the matrices it's about to reuse.  calc_planet_orientation( )
+uses a default cache;  with OpenMP,  each thread gets its own.  Other
+multi-threaded code should give each thread its own cache from
+init_cospar_cache( ),  and use calc_planet_orientation_cached( ).  A
+cache may only be used by one thread at a time.  init_cospar_cache( )
+returns NULL if asked for fewer than one slot (or out of memory).
+
+   Each cache records the generation of the COSPAR data it was filled
+from.  After load_cospar_file( ),  the generation no longer matches,  and
+the cache is emptied on its next use.  */
+
+typedef struct
+{
+   int planet_no, system_no, rval;
+   double jd, matrix[9];
+} cospar_cache_slot_t;
+
+typedef struct
+{
+   int n_slots;
+   unsigned generation;          /* zero = never used */
+   cospar_cache_slot_t *slots;
+} cospar_cache_t;
+
+#define DEFAULT_COSPAR_CACHE_SLOTS 32
+
+void * DLL_FUNC init_cospar_cache( const int n_slots)
+{
+   cospar_cache_t *rval;
+
+   if( n_slots <= 0)
+      return( NULL);
+   rval = (cospar_cache_t *)malloc( sizeof( cospar_cache_t)
+                              + n_slots * sizeof( cospar_cache_slot_t));
+   if( rval)
+      {
+      rval->n_slots = n_slots;
+      rval->generation = 0;
+      rval->slots = (cospar_cache_slot_t *)( rval + 1);
+      }
+   return( rval);
+}
+
+void DLL_FUNC free_cospar_cache( void *cache)
+{
+   free( cache);
+}
+
+static unsigned cospar_cache_hash( const int planet_no, const int system_no,
+                                   const double jd)
+{
+   uint64_t bits;
+   unsigned rval = 2166136261u;
+   size_t i;
+
+   memcpy( &bits, &jd, sizeof( bits));
+   bits ^= (uint64_t)planet_no * 0x9e3779b97f4a7c15ull + (uint64_t)system_no;
+   for( i = 0; i < 8; i++, bits >>= 8)
+      rval = (rval ^ (unsigned)( bits & 0xff)) * 16777619u;
+   return( rval);
+}
+
+int DLL_FUNC calc_planet_orientation_cached( void *cache, const int planet_no,
+                  const int system_no, const double jd, double *matrix)
+{
+   cospar_cache_t *cptr = (cospar_cache_t *)cache;
+   cospar_cache_slot_t *slot = cptr->slots
+          + cospar_cache_hash( planet_no, system_no, jd) % (unsigned)cptr->n_slots;
+   unsigned generation;
+
+#ifdef _OPENMP
+   #pragma omp atomic read
+#endif
+   generation = cospar_generation;
+   if( cptr->generation != generation)
+      {
+      int i;
+
+      for( i = 0; i < cptr->n_slots; i++)
+         cptr->slots[i].planet_no = NO_OBJECT_SELECTED;
+      cptr->generation = generation;
+      }
+   if( slot->planet_no != planet_no || slot->system_no != system_no
+                           || slot->jd != jd)
+      {
+      slot->rval = compute_planet_orientation( get_cospar_table( ),
+                              planet_no, system_no, jd, slot->matrix);
+      slot->planet_no = planet_no;
+      slot->system_no = system_no;
+      slot->jd = jd;
+      }
+   memcpy( matrix, slot->matrix, 9 * sizeof( double));
+   return( slot->rval);
+}
+
+static cospar_cache_slot_t default_cache_slots[DEFAULT_COSPAR_CACHE_SLOTS];
+static cospar_cache_t default_cache;
+#ifdef _OPENMP
+   #pragma omp threadprivate( default_cache_slots, default_cache)
+#endif
+
+int DLL_FUNC calc_planet_orientation( const int planet_no, const int system_no,
+                  const double jd, double *matrix)
+{
+   if( !default_cache.slots)
+      {
+      default_cache.n_slots = DEFAULT_COSPAR_CACHE_SLOTS;
+      default_cache.slots = default_cache_slots;
+      }
+   return( calc_planet_orientation_cached( &default_cache, planet_no,
+                                    system_no, jd, matrix));
+}
+
+/* Computes orientation matrices for n objects (and systems and JDs;  if
+'system_nos' is NULL,  system 0 is used throughout).  Matrices are stored
+nine doubles apiece.  Return values for each object are stored in 'rvals'
+if that's non-NULL;  the function returns the number of failures.  Once
+the COSPAR data is loaded,  computing an orientation touches no shared
+state,  so that's done in parallel if OpenMP is enabled.  The earth is the
+exception (precession with EOPs),  and is handled outside the parallel
+loop.  If the COSPAR data can't be loaded,  every object but the earth
+counts as a failure.  */
+
+int DLL_FUNC calc_planet_orientations( const int n, const int *planet_nos,
+               const int *system_nos, const double *jds, double *matrices,
+               int *rvals)
+{
+   const cospar_table_t *table = get_cospar_table( );
+   int i, n_failed = 0;
+
+#ifdef _OPENMP
+   #pragma omp parallel for reduction( +:n_failed)
+#endif
+   for( i = 0; i < n; i++)
+      if( planet_nos[i] != 3)
+         {
+         const int rval = compute_planet_orientation( table, planet_nos[i],
+                  (system_nos ? system_nos[i] : 0), jds[i], matrices + i * 9);
+
+         if( rvals)
+            rvals[i] = rval;
+         if( rval)
+            n_failed++;
+         }
+   for( i = 0; i < n; i++)
+      if( planet_nos[i] == 3)
+         {
+         compute_planet_orientation( table, 3, 0, jds[i], matrices + i * 9);
+         if( rvals)
+            rvals[i] = 0;
+         }
+   return( n_failed);
+}
 
 #ifdef TEST_MAIN
-void main( int argc, char **argv)
+int main( int argc, char **argv)
 {
-   double pole_ra, pole_dec, omega;
+   double pole_ra, pole_dec, omega, radii[3], matrix[9];
    const int planet_number = atoi( argv[1]);
    const double jde = atof( argv[2]);
    const int system_number = (argc > 3 ? atoi( argv[3]) : 0);
@@ -413,31 +842,24 @@ void main( int argc, char **argv)
    for( i = (planet_number == -1 ? 0 : planet_number);
         i < (planet_number == -1 ? 100 : planet_number + 1); i++)
       {
-      int err = get_cospar_data_from_text_file( i, system_number, jde,
-                      &pole_ra, &pole_dec, NULL, &omega);
+      bool is_retrograde;
+      int err = get_cospar_data( get_cospar_table( ), i, system_number, jde,
+                      &pole_ra, &pole_dec, &omega, radii, &is_retrograde);
 
       printf( "Planet %d\n", i);
       if( !err)
          {
-         double old_mat[9], new_mat[9], delta = 0.;
-
          printf( "   pole RA: %lf\n", pole_ra);
          printf( "   pole dec %lf\n", pole_dec);
          printf( "   Omega    %lf (%lf)\n", omega, fmod( omega, 360.));
-         if( !calc_planet_orientation2( i, system_number, jde, new_mat))
-            if( !calc_planet_orientation( i, system_number, jde, old_mat))
-               {
-               for( j = 0; j < 9; j += 3)
-                  printf( "%10.6lf %10.6lf %10.6lf    %10.6lf %10.6lf %10.6lf\n",
-                           new_mat[j], new_mat[j + 1], new_mat[j + 2],
-                           old_mat[j], old_mat[j + 1], old_mat[j + 2]);
-               for( j = 0; j < 9; j++)
-                  delta += (new_mat[j] - old_mat[j]) * (new_mat[j] - old_mat[j]);
-               printf( "Diff: %lf\n", sqrt( delta));
-               }
+         if( !calc_planet_orientation( i, system_number, jde, matrix))
+            for( j = 0; j < 9; j += 3)
+               printf( "%10.6lf %10.6lf %10.6lf\n",
+                           matrix[j], matrix[j + 1], matrix[j + 2]);
          }
       else
          printf( "   Error %d\n", err);
       }
+   return( 0);
 }
 #endif
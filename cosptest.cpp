@@ -29,6 +29,44 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
       /* just to verify that only the things that were _supposed_ */
       /* to change,  actually changed.                            */
 
+#define N_BATCH_TIMES 2000
+
+/* Loops over times,  getting orientations for Jupiter and the Galileans
+(and the earth) at each,  first singly and then in one batch call,  and
+checks that the results match.   */
+
+static int check_batch_orientations( void)
+{
+   const int objects[6] = { 5, 11, 12, 13, 14, 3 };
+   int planets[N_BATCH_TIMES * 6], i, j, n_mismatches = 0;
+   double jds[N_BATCH_TIMES * 6], matrix[9];
+   double *matrices = (double *)malloc( N_BATCH_TIMES * 6 * 9 * sizeof( double));
+   clock_t t0 = clock( );
+
+   for( i = 0; i < N_BATCH_TIMES * 6; i++)
+      {
+      planets[i] = objects[i % 6];
+      jds[i] = 2451000. + (double)( i / 6) * 0.37;
+      }
+   calc_planet_orientations( N_BATCH_TIMES * 6, planets, NULL, jds,
+                     matrices, NULL);
+   printf( "Batch of %d orientations: %f s\n", N_BATCH_TIMES * 6,
+            (double)( clock() - t0) / (double)CLOCKS_PER_SEC);
+   t0 = clock( );
+   for( i = 0; i < N_BATCH_TIMES * 6; i++)
+      {
+      calc_planet_orientation( planets[i], 0, jds[i], matrix);
+      for( j = 0; j < 9; j++)
+         if( fabs( matrix[j] - matrices[i * 9 + j]) > 1e-14)
+            n_mismatches++;
+      }
+   printf( "%d orientations singly: %f s;  %d mismatches\n",
+            N_BATCH_TIMES * 6,
+            (double)( clock() - t0) / (double)CLOCKS_PER_SEC, n_mismatches);
+   free( matrices);
+   return( n_mismatches ? -1 : 0);
+}
+
 int main( const int argc, const char **argv)
 {
    double matrix[9], prev_matrix[9];
@@ -73,5 +111,5 @@ int main( const int argc, const char **argv)
       }
    printf( "Total time: %f\n",
             (double)( clock() - t0) / (double)CLOCKS_PER_SEC);
-   return( 0);
+   return( check_batch_orientations( ));
 }
@@ -40,17 +40,27 @@ SsoObservation_xx.csv
 for the offset by 11 eludes me.  It does mean that if you're looking
 for a specific object,  you can figure out which file will have data
 for it and then download only that file.  (Or you can run the above
-command and get an error message telling you which file wasn't found.) */
+command and get an error message telling you which file wasn't found.)
+
+   Converting everything (e.g., './csv2ades 1,999999') takes a long time
+this way.  Add '-p' :
+
+./csv2ades -p 1,999999 > all.ades
+
+   and the files are mapped into memory and converted in chunks,  in
+parallel if built with 'make OPENMP=Y'.  The output is the same.  */
 
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include "watdefs.h"
 #include "afuncs.h"
 #include "date.h"
+#include "mpc_func.h"
 
 static char *get_csv( char *obuff, const char *ibuff,
             const char *header, const char *tag, const size_t max_len)
@@ -79,71 +89,277 @@ static char *get_csv( char *obuff, const char *ibuff,
    return( obuff);
 }
 
-static void csv_to_ades( const char *ibuff, const char *header,
-                          const int low_num, const int high_num)
+/* Columns used from the Gaia CSV files,  and how many bytes of each we
+look at.  The photometry columns are only in DR3,  not FPR.   */
+
+#define N_GAIA_COLUMNS        16
+
+#define GAIA_NUMBER            0
+#define GAIA_POSN              1
+#define GAIA_EPOCH             7
+#define GAIA_RA                8
+#define GAIA_DEC               9
+#define GAIA_SIGMA_RA         10
+#define GAIA_SIGMA_DEC        11
+#define GAIA_CORR             12
+#define GAIA_G_MAG            13
+#define GAIA_G_FLUX           14
+#define GAIA_G_FLUX_ERR       15
+
+static const char *gaia_columns[N_GAIA_COLUMNS] = { "number_mp",
+         "x_gaia_geocentric", "y_gaia_geocentric", "z_gaia_geocentric",
+         "vx_gaia_geocentric", "vy_gaia_geocentric", "vz_gaia_geocentric",
+         "epoch_utc", "ra", "dec", "ra_error_random", "dec_error_random",
+         "ra_dec_correlation_random", "g_mag", "g_flux", "g_flux_error" };
+
+static const size_t gaia_column_len[N_GAIA_COLUMNS] = { 9,
+         29, 29, 29, 29, 29, 29, 99, 99, 99, 99, 99, 10, 9, 99, 99 };
+
+/* ADES output is accumulated in a buffer,  so that chunks of a file
+can be converted in parallel and then written out in order.   */
+
+typedef struct
+{
+   char *buff;
+   size_t len, alloced;
+} out_buff_t;
+
+static void out_printf( out_buff_t *obuff, const char *format, ...)
+{
+   for( ;;)
+      {
+      const size_t available = obuff->alloced - obuff->len;
+      va_list argptr;
+      int n_bytes;
+
+      va_start( argptr, format);
+      n_bytes = vsnprintf( obuff->buff + obuff->len, available, format, argptr);
+      va_end( argptr);
+      assert( n_bytes >= 0);
+      if( (size_t)n_bytes < available)
+         {
+         obuff->len += (size_t)n_bytes;
+         return;
+         }
+      obuff->alloced = obuff->alloced * 2 + (size_t)n_bytes + 4096;
+      obuff->buff = (char *)realloc( obuff->buff, obuff->alloced);
+      assert( obuff->buff);
+      }
+}
+
+static void values_to_ades( out_buff_t *obuff,
+                      char values[N_GAIA_COLUMNS][100])
 {
+   const double jd_epoch = 2455197.5;    /* 2010 Jan 1.0 */
    char tbuff[90];
+   double jd_obs;
+   int i;
+
+   out_printf( obuff, "   <optical>\n");
+   out_printf( obuff, "    <permID>%s</permID>\n", values[GAIA_NUMBER]);
+   out_printf( obuff, "    <mode>TDI</mode>\n");
+   out_printf( obuff, "    <stn>258</stn>\n");
+   out_printf( obuff, "    <sys>ICRF_KM</sys>\n");
+   out_printf( obuff, "    <ctr>399</ctr>\n");
+   for( i = 0; i < 6; i++)
+      {
+      double value = atof( values[GAIA_POSN + i]);
+      const double LB = 1.550519768e-8;   /* conversion from TCB to TDB;  see */
+               /* https://github.com/IAU-ADES/ADES-Master/issues/52#issuecomment-2024035881 */
+
+      value *= AU_IN_KM;
+      if( i < 3)
+         out_printf( obuff, "    <pos%d>%.4f</pos%d>\n", i + 1, value * (1 - LB), i + 1);
+      else
+         out_printf( obuff, "    <vel%d>%.10f</vel%d>\n", i - 2, value / seconds_per_day, i - 2);
+      }
+   jd_obs = atof( values[GAIA_EPOCH]) + jd_epoch;
+   full_ctime( tbuff, jd_obs, FULL_CTIME_MILLISECS | FULL_CTIME_YMD
+                        | FULL_CTIME_LEADING_ZEROES | FULL_CTIME_MONTHS_AS_DIGITS);
+   tbuff[4] = tbuff[7] = '-';
+   tbuff[10] = 'T';
+   out_printf( obuff, "    <obsTime>%sZ</obsTime>\n", tbuff);
+   out_printf( obuff, "    <ra>%.9f</ra>\n",           atof( values[GAIA_RA]));
+   out_printf( obuff, "    <dec>%.9f</dec>\n",         atof( values[GAIA_DEC]));
+   out_printf( obuff, "    <rmsRA>%.5f</rmsRA>\n",     atof( values[GAIA_SIGMA_RA]) / 1000.);
+   out_printf( obuff, "    <rmsDec>%.5f</rmsDec>\n",   atof( values[GAIA_SIGMA_DEC]) / 1000.);
+   out_printf( obuff, "    <rmsCorr>%s</rmsCorr>\n", values[GAIA_CORR]);
+   out_printf( obuff, "    <astCat>Gaia3</astCat>\n");
+   if( *values[GAIA_G_MAG] >= '0' && *values[GAIA_G_MAG] <= '9')
+      {
+      const double g_flux       = atof( values[GAIA_G_FLUX]);
+      const double g_flux_sigma = atof( values[GAIA_G_FLUX_ERR]);
+
+      out_printf( obuff, "    <mag>%s</mag>\n", values[GAIA_G_MAG]);
+      out_printf( obuff, "    <rmsMag>%.3f</rmsMag>\n",
+                           (g_flux_sigma / g_flux) / log( 2.512));
+      out_printf( obuff, "    <band>G</band>\n");
+      out_printf( obuff, "    <photCat>Gaia2</photCat>\n");
+      }
+   out_printf( obuff, "   </optical>\n");
+}
+
+static void csv_to_ades( out_buff_t *obuff, const char *ibuff,
+           const char *header, const int low_num, const int high_num)
+{
+   char values[N_GAIA_COLUMNS][100];
    int num;
 
-   get_csv( tbuff, ibuff, header, "number_mp,", 9);
-   num = atoi( tbuff);
+   get_csv( values[GAIA_NUMBER], ibuff, header, "number_mp,", 9);
+   num = atoi( values[GAIA_NUMBER]);
    if( num >= low_num && num <= high_num)
       {
-      const double jd_epoch = 2455197.5;    /* 2010 Jan 1.0 */
-      double jd_obs;
-      int i;
-
-      printf( "   <optical>\n");
-      printf( "    <permID>%s</permID>\n", tbuff);
-      printf( "    <mode>TDI</mode>\n");
-      printf( "    <stn>258</stn>\n");
-      printf( "    <sys>ICRF_KM</sys>\n");
-      printf( "    <ctr>399</ctr>\n");
-      for( i = 0; i < 6; i++)
-         {
-         char tag[30];
-         double value;
-         const double LB = 1.550519768e-8;   /* conversion from TCB to TDB;  see */
-                  /* https://github.com/IAU-ADES/ADES-Master/issues/52#issuecomment-2024035881 */
-
-         snprintf( tag, sizeof( tag), "%s%c_gaia_geocentric",
-                                          (i < 3 ? "" : "v"), 'x' + i % 3);
-         value = atof( get_csv( tbuff, ibuff, header, tag, sizeof( tag) - 1));
-         value *= AU_IN_KM;
-         if( i < 3)
-            printf( "    <pos%d>%.4f</pos%d>\n", i + 1, value * (1 - LB), i + 1);
+      const bool has_mags = (strstr( header, "g_mag,") != NULL);
+      int i;        /* FPR doesn't have magnitude data */
+
+      for( i = 1; i < N_GAIA_COLUMNS; i++)
+         if( i < GAIA_G_MAG || has_mags)
+            {
+            char tag[30];
+
+            snprintf( tag, sizeof( tag), "%s,", gaia_columns[i]);
+            get_csv( values[i], ibuff, header, tag, gaia_column_len[i]);
+            }
          else
-            printf( "    <vel%d>%.10f</vel%d>\n", i - 2, value / seconds_per_day, i - 2);
+            *values[i] = '\0';
+      values_to_ades( obuff, values);
+      }
+}
+
+/* The following is used for the faster '-p' mode.  Each needed CSV
+file is mapped into memory and split into chunks of about CHUNK_SIZE
+bytes at line boundaries.  The chunks of all the files go into one
+queue;  they're converted to ADES in parallel (if compiled with OpenMP;
+'make OPENMP=Y'),  with the output for each chunk written in order.
+Each line is split into fields in a single pass,  and the fields we
+want are picked out by column numbers found once from the file header,
+rather than searching the header and line for each field.  */
+
+#define CHUNK_SIZE         (1 << 24)
+#define MAX_CSV_FIELDS     64
+
+typedef struct
+{
+   const char *ptr;
+   size_t len;
+} csv_field_t;
+
+typedef struct
+{
+   const char *buff;
+   size_t size;
+   int columns[N_GAIA_COLUMNS];
+} csv_file_t;
+
+typedef struct
+{
+   const char *start, *end;
+   const int *columns;
+} csv_chunk_t;
+
+static const char *next_line( const char *ptr, const char *end)
+{
+   const char *tptr = (const char *)memchr( ptr, '\n', end - ptr);
+
+   return( tptr ? tptr + 1 : end);
+}
+
+/* Splits the line from 'line' up to 'eol' (exclusive;  any trailing
+CR/LF is dropped) at commas,  returning the number of fields.   */
+
+static int split_csv_line( csv_field_t *fields, const char *line,
+                           const char *eol)
+{
+   int n_fields = 0;
+
+   while( eol > line && (eol[-1] == 10 || eol[-1] == 13))
+      eol--;
+   while( n_fields < MAX_CSV_FIELDS)
+      {
+      const char *comma = (const char *)memchr( line, ',', eol - line);
+
+      fields[n_fields].ptr = line;
+      if( !comma)
+         {
+         fields[n_fields++].len = eol - line;
+         break;
          }
-      jd_obs = atof( get_csv( tbuff, ibuff, header, "epoch_utc,", 99)) + jd_epoch;
-      full_ctime( tbuff, jd_obs, FULL_CTIME_MILLISECS | FULL_CTIME_YMD
-                           | FULL_CTIME_LEADING_ZEROES | FULL_CTIME_MONTHS_AS_DIGITS);
-      tbuff[4] = tbuff[7] = '-';
-      tbuff[10] = 'T';
-      printf( "    <obsTime>%sZ</obsTime>\n", tbuff);
-      printf( "    <ra>%.9f</ra>\n",           atof( get_csv( tbuff, ibuff, header, "ra,", 99)));
-      printf( "    <dec>%.9f</dec>\n",         atof( get_csv( tbuff, ibuff, header, "dec,", 99)));
-      printf( "    <rmsRA>%.5f</rmsRA>\n",     atof( get_csv( tbuff, ibuff, header, "ra_error_random,", 99)) / 1000.);
-      printf( "    <rmsDec>%.5f</rmsDec>\n",   atof( get_csv( tbuff, ibuff, header, "dec_error_random,", 99)) / 1000.);
-      printf( "    <rmsCorr>%s</rmsCorr>\n", get_csv( tbuff, ibuff, header, "ra_dec_correlation_random,", 10));
-      printf( "    <astCat>Gaia3</astCat>\n");
-      if( strstr( header, "g_mag,"))   /* FPR doesn't have magnitude data */
+      fields[n_fields++].len = comma - line;
+      line = comma + 1;
+      }
+   return( n_fields);
+}
+
+static char *field_text( char *obuff, const csv_field_t *fields,
+            const int n_fields, const int column, const size_t max_len)
+{
+   size_t len = 0;
+
+   if( column >= 0 && column < n_fields)
+      {
+      len = fields[column].len;
+      if( len > max_len)
+         len = max_len;
+      memcpy( obuff, fields[column].ptr, len);
+      }
+   obuff[len] = '\0';
+   return( obuff);
+}
+
+/* Figures out which column holds each field we want.  Returns -1 if
+any of the (non-photometric) columns is missing.   */
+
+static int find_columns( int *columns, const char *header, const char *eol)
+{
+   csv_field_t fields[MAX_CSV_FIELDS];
+   const int n_fields = split_csv_line( fields, header, eol);
+   int i, j;
+
+   for( i = 0; i < N_GAIA_COLUMNS; i++)
+      {
+      const size_t len = strlen( gaia_columns[i]);
+
+      columns[i] = -1;
+      for( j = 0; j < n_fields && columns[i] < 0; j++)
+         if( fields[j].len == len && !memcmp( fields[j].ptr, gaia_columns[i], len))
+            columns[i] = j;
+      if( columns[i] < 0 && i < GAIA_G_MAG)
          {
-         get_csv( tbuff, ibuff, header, "g_mag,", 9);
-         if( *tbuff >= '0' && *tbuff <= '9')
+         fprintf( stderr, "Couldn't find '%s'\n", gaia_columns[i]);
+         return( -1);
+         }
+      }
+   return( 0);
+}
+
+static void chunk_to_ades( out_buff_t *obuff, const csv_chunk_t *chunk,
+                           const int low_num, const int high_num)
+{
+   const char *ptr = chunk->start;
+   csv_field_t fields[MAX_CSV_FIELDS];
+   char values[N_GAIA_COLUMNS][100];
+
+   while( ptr < chunk->end)
+      {
+      const char *eol = next_line( ptr, chunk->end);
+
+      if( *ptr != '#')
+         {
+         const int n_fields = split_csv_line( fields, ptr, eol);
+         int i, num;
+
+         field_text( values[GAIA_NUMBER], fields, n_fields,
+                     chunk->columns[GAIA_NUMBER], gaia_column_len[GAIA_NUMBER]);
+         num = atoi( values[GAIA_NUMBER]);
+         if( num >= low_num && num <= high_num)
             {
-            double g_flux, g_flux_sigma;
-
-            printf( "    <mag>%s</mag>\n", tbuff);
-            g_flux       = atof( get_csv( tbuff, ibuff, header, "g_flux", 99));
-            g_flux_sigma = atof( get_csv( tbuff, ibuff, header, "g_flux_error", 99));
-            printf( "    <rmsMag>%.3f</rmsMag>\n",
-                              (g_flux_sigma / g_flux) / log( 2.512));
-            printf( "    <band>G</band>\n");
-            printf( "    <photCat>Gaia2</photCat>\n");
+            for( i = 1; i < N_GAIA_COLUMNS; i++)
+               field_text( values[i], fields, n_fields,
+                                 chunk->columns[i], gaia_column_len[i]);
+            values_to_ades( obuff, values);
             }
          }
-      printf( "   </optical>\n");
+      ptr = eol;
       }
 }
 
@@ -153,7 +369,8 @@ static void error_exit( void)
             "object,  or 'csv2ades (lownum,highnum)' for ADES data for a range\n"
             "of numbered objects.  Output is to stdout.  See 'csv2ades.c' for\n"
             "information about where to get the Gaia data in CSV files,  needed\n"
-            "as input to this program.\n");
+            "as input to this program.  Add '-p' to map the files into memory\n"
+            "and convert them in parallel,  which is much faster for large ranges.\n");
    exit( -1);
 }
 
@@ -171,18 +388,97 @@ static bool file_needed( const int file_no, const int low_num, const int high_nu
    return( false);
 }
 
+/* Converts the needed CSV files in the '-p' mode described above.  All
+are mapped at the outset,  so that threads can move on to chunks from
+the next file while the last chunks of the previous one are finishing.  */
+
+static void convert_files_in_parallel( const int low_num, const int high_num)
+{
+   csv_file_t files[20];
+   csv_chunk_t *chunks = NULL;
+   int i, n_files = 0, n_chunks = 0, n_alloced = 0;
+
+   for( i = 0; i < 20; i++)
+      if( file_needed( i, low_num, high_num))
+         {
+         csv_file_t *file = files + n_files;
+         const char *ptr, *end;
+         char filename[30];
+
+         snprintf( filename, sizeof( filename), "SsoObservation_%02d.csv", i);
+         file->buff = map_file( filename, &file->size);
+         if( !file->buff)
+            {
+            fprintf( stderr, "File '%s' not found\n"
+                  "'csv2ades.c' contains directions on where to get Gaia data\n", filename);
+            exit( -2);
+            }
+         n_files++;
+         ptr = file->buff;
+         end = file->buff + file->size;
+         while( ptr < end && (end - ptr < 11 || memcmp( ptr, "solution_id", 11)))
+            ptr = next_line( ptr, end);
+         if( ptr == end || find_columns( file->columns, ptr, next_line( ptr, end)))
+            {
+            fprintf( stderr, "No usable header found in '%s'\n", filename);
+            exit( -2);
+            }
+         ptr = next_line( ptr, end);
+         while( ptr < end)
+            {
+            if( n_chunks == n_alloced)
+               {
+               n_alloced = n_alloced * 2 + 64;
+               chunks = (csv_chunk_t *)realloc( chunks, n_alloced * sizeof( csv_chunk_t));
+               assert( chunks);
+               }
+            chunks[n_chunks].start = ptr;
+            chunks[n_chunks].columns = file->columns;
+            if( end - ptr > CHUNK_SIZE)
+               ptr = next_line( ptr + CHUNK_SIZE - 1, end);
+            else
+               ptr = end;
+            chunks[n_chunks++].end = ptr;
+            }
+         }
+#ifdef _OPENMP
+   #pragma omp parallel for ordered schedule( dynamic)
+#endif
+   for( i = 0; i < n_chunks; i++)
+      {
+      out_buff_t obuff = { NULL, 0, 0};
+
+      chunk_to_ades( &obuff, chunks + i, low_num, high_num);
+#ifdef _OPENMP
+      #pragma omp ordered
+#endif
+      fwrite( obuff.buff, 1, obuff.len, stdout);
+      free( obuff.buff);
+      }
+   for( i = 0; i < n_files; i++)
+      unmap_file( files[i].buff, files[i].size);
+   free( chunks);
+}
+
 int main( const int argc, const char **argv)
 {
    FILE *hdr_file = fopen( "gaia.hdr", "rb");
    char buff[800];
-   int low_num, high_num = -1, file_num;
+   const char *range = NULL;
+   bool parallel = false;
+   int low_num, high_num = -1, file_num, i;
 
    if( !hdr_file)
       {
       perror( "Can't open 'gaia.hdr'");
       return( -1);
       }
-   if( argc != 2 || sscanf( argv[1], "%d,%d", &low_num, &high_num) < 1)
+   for( i = 1; i < argc; i++)
+      if( !strcmp( argv[i], "-p"))
+         parallel = true;
+      else
+         range = argv[i];
+   if( !range || sscanf( range, "%d,%d", &low_num, &high_num) < 1)
       {
       fprintf( stderr, "No asteroids specified on the command line\n");
       error_exit( );
@@ -192,11 +488,17 @@ int main( const int argc, const char **argv)
    while( fgets( buff, sizeof( buff), hdr_file))
       if( *buff != '*')
          printf( "%s", buff);
+      else if( parallel)
+         {
+         fflush( stdout);
+         convert_files_in_parallel( low_num, high_num);
+         }
       else for( file_num = 0; file_num < 20; file_num++)
          if( file_needed( file_num, low_num, high_num))
             {
             FILE *ifile;
             char header[800];
+            out_buff_t obuff = { NULL, 0, 0};
 
             snprintf( buff, sizeof( buff), "SsoObservation_%02d.csv", file_num);
             ifile = fopen( buff, "rb");
@@ -212,8 +514,13 @@ int main( const int argc, const char **argv)
                if( !memcmp( buff, "solution_id", 11))
                   strcpy( header, buff);
                else if( *buff != '#')
-                  csv_to_ades( buff, header, low_num, high_num);
+                  {
+                  obuff.len = 0;
+                  csv_to_ades( &obuff, buff, header, low_num, high_num);
+                  fwrite( obuff.buff, 1, obuff.len, stdout);
+                  }
                }
+            free( obuff.buff);
             fclose( ifile);
             }
    fclose( hdr_file);
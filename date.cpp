@@ -859,3 +859,184 @@ void DLL_FUNC day_to_dmy( const long jd, int DLLPTR *day,
       }
    return;
 }
+
+/* The following functions convert arrays of dates at a time.  For the
+Gregorian and Julian calendars,  which are by far the most commonly used,
+they skip the year-data machinery above entirely and use straight integer
+arithmetic (essentially the 'days from civil' algorithms as described by
+Howard Hinnant),  counting years from 1 March so that leap days fall at
+the end of the 'computational' year.  There are no function calls or
+table lookups inside those loops,  so a good compiler can vectorize them.
+
+   For the other calendars,  we keep the data for the most recently used
+year around;  successive dates in a column of output are usually in the
+same year,  and then we needn't recompute the month lengths. */
+
+#define MARCH_1_YEAR_0_GREGORIAN   1721120L
+#define MARCH_1_YEAR_0_JULIAN      1721118L
+
+typedef struct
+   {
+   long year, year_ends[2];
+   int calendar;
+   char month_data[N_MONTHS];
+   } year_cache_t;
+
+static int get_cached_calendar_data( year_cache_t *cache, const long year,
+                                          const int calendar)
+{
+   int rval = 0;
+
+   if( cache->calendar != calendar || cache->year != year)
+      {
+      rval = get_calendar_data( year, cache->year_ends, cache->month_data,
+                                    calendar);
+      cache->year = year;
+      cache->calendar = (rval ? -1 : calendar);
+      }
+   return( rval);
+}
+
+static void day_to_dmy_cached( year_cache_t *cache, const long jd, int *day,
+                  int *month, long *year, const int calendar)
+{
+   long curr_jd;
+
+            /* The search for the year follows that in day_to_dmy( ) step */
+            /* by step,  so that errors (e.g.,  Persian years outside the */
+            /* range we can handle) are found in exactly the same cases.  */
+            /* The cache just saves recomputing the year data.            */
+   *day = *month = -1;           /* to signal an error */
+   *year = approx_year( jd, calendar);
+   do
+      {
+      if( get_cached_calendar_data( cache, *year, calendar))
+         return;
+      if( cache->year_ends[0] > jd)
+         (*year)--;
+      if( cache->year_ends[1] <= jd)
+         (*year)++;
+      }
+   while( cache->year_ends[0] > jd || cache->year_ends[1] <= jd);
+
+   curr_jd = cache->year_ends[0];
+   for( int i = 0; i < N_MONTHS; i++)
+      {
+      *day = (int)( jd - curr_jd);
+      if( *day < (int)cache->month_data[i])
+         {
+         *month = i + 1;
+         (*day)++;
+         return;
+         }
+      curr_jd += (long)cache->month_data[i];
+      }
+}
+
+/* Converts n_dates JDs to day/month/year.  Results are the same as those
+from calling day_to_dmy( ) for each JD in turn,  including day = -1 for
+dates that can't be converted;  in that case,  month is also set to -1. */
+
+void DLL_FUNC day_to_dmy_array( const size_t n_dates, const long *jd,
+                  int *day, int *month, long *year, const int calendar)
+{
+   size_t i;
+
+   if( calendar == CALENDAR_GREGORIAN || calendar == CALENDAR_JULIAN
+                        || calendar == CALENDAR_JULIAN_GREGORIAN)
+      {
+      for( i = 0; i < n_dates; i++)
+         {
+         const int is_julian = (calendar == CALENDAR_JULIAN ||
+                     (calendar == CALENDAR_JULIAN_GREGORIAN
+                                 && jd[i] <= GREGORIAN_SWITCHOVER_JD));
+         const long z = jd[i] - (is_julian ? MARCH_1_YEAR_0_JULIAN
+                                           : MARCH_1_YEAR_0_GREGORIAN);
+         const long days_per_era = (is_julian ? 1461L : 146097L);
+         const long era = (z >= 0 ? z : z - days_per_era + 1) / days_per_era;
+         const long day_of_era = z - era * days_per_era;
+         const long centuries = (is_julian ? 0 :
+                         day_of_era / 36524L - day_of_era / 146096L);
+         const long year_of_era =
+                  (day_of_era - day_of_era / 1460L + centuries) / 365L;
+         const long day_of_year = day_of_era - 365L * year_of_era
+                  - year_of_era / 4L
+                  + (is_julian ? 0 : year_of_era / 100L);
+         const long mp = (5L * day_of_year + 2L) / 153L;
+
+         day[i] = (int)( day_of_year - (153L * mp + 2L) / 5L + 1L);
+         month[i] = (int)( mp < 10 ? mp + 3 : mp - 9);
+         year[i] = year_of_era + era * (is_julian ? 4L : 400L)
+                                  + (mp >= 10);
+         }
+      }
+   else
+      {
+      year_cache_t cache;
+
+      cache.calendar = -1;
+      for( i = 0; i < n_dates; i++)
+         day_to_dmy_cached( &cache, jd[i], day + i, month + i, year + i,
+                                    calendar);
+      }
+}
+
+/* Reverse of the above;  results match those from dmy_to_day( ).  Invalid
+months and day = RETURN_DAYS_IN_MONTH fall back to the general (non-batch)
+code,  so that the results still match.  */
+
+void DLL_FUNC dmy_to_day_array( const size_t n_dates, const int *day,
+                  const int *month, const long *year, long *jd,
+                  const int calendar)
+{
+   size_t i;
+
+   if( calendar == CALENDAR_GREGORIAN || calendar == CALENDAR_JULIAN
+                        || calendar == CALENDAR_JULIAN_GREGORIAN)
+      {
+      for( i = 0; i < n_dates; i++)
+         {
+         const int is_julian = (calendar == CALENDAR_JULIAN ||
+                     (calendar == CALENDAR_JULIAN_GREGORIAN && (year[i] < 1582
+                     || (year[i] == 1582 && (month[i] < 10
+                     || (month[i] == 10 && day[i] <= 5))))));
+         const long y = year[i] - (month[i] <= 2);
+         const long years_per_era = (is_julian ? 4L : 400L);
+         const long era = (y >= 0 ? y : y - years_per_era + 1) / years_per_era;
+         const long year_of_era = y - era * years_per_era;
+         const long day_of_year = (153L * (month[i] > 2 ? month[i] - 3
+                                                  : month[i] + 9) + 2L) / 5L
+                                   + (long)day[i] - 1L;
+         const long day_of_era = year_of_era * 365L + year_of_era / 4L
+                  - (is_julian ? 0 : year_of_era / 100L) + day_of_year;
+
+         jd[i] = era * (is_julian ? 1461L : 146097L) + day_of_era
+                  + (is_julian ? MARCH_1_YEAR_0_JULIAN
+                               : MARCH_1_YEAR_0_GREGORIAN);
+         }
+      for( i = 0; i < n_dates; i++)
+         if( month[i] < 1 || month[i] > 12 || day[i] == RETURN_DAYS_IN_MONTH)
+            jd[i] = dmy_to_day( day[i], month[i], year[i], calendar);
+      }
+   else
+      {
+      year_cache_t cache;
+
+      cache.calendar = -1;
+      for( i = 0; i < n_dates; i++)
+         {
+         long jd0 = 0;
+
+         if( month[i] < 1 || month[i] > N_MONTHS
+                          || day[i] == RETURN_DAYS_IN_MONTH)
+            jd0 = dmy_to_day( day[i], month[i], year[i], calendar);
+         else if( !get_cached_calendar_data( &cache, year[i], calendar))
+            {
+            jd0 = cache.year_ends[0] + (long)day[i] - 1;
+            for( int j = 0; j < month[i] - 1; j++)
+               jd0 += cache.month_data[j];
+            }
+         jd[i] = jd0;
+         }
+      }
+}
@@ -16,6 +16,8 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 02110-1301, USA.    */
 
+#include <stddef.h>              /* required for size_t */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -26,6 +28,24 @@ void DLL_FUNC day_to_dmy( const long jd, int DLLPTR *day,
                   int DLLPTR *month, long DLLPTR *year, const int calendar);
 void DLL_FUNC full_ctime( char *buff, double jd, const int format);
 void DLL_FUNC full_ctimel( char *buff, long double t2k, const int format);
+
+            /* See miscell.cpp for details on formatting many times with */
+            /* a "plan" (same output as full_ctime(),  but faster).      */
+typedef struct
+{
+   long double add_on;
+   long units, prefix_day;
+   int format, precision, calendar, output_format;
+   int prefix_is_reusable, prefix_valid, day_of_week;
+   size_t prefix_len;
+   char prefix[80];       /* as long as full_ctime( ) output can be */
+} full_ctime_plan_t;
+
+void DLL_FUNC init_full_ctime_plan( full_ctime_plan_t *plan, const int format);
+void DLL_FUNC full_ctimel_with_plan( char *buff, long double t2k,
+                                    full_ctime_plan_t *plan);
+void DLL_FUNC full_ctime_array( char *obuff, const size_t obuff_stride,
+                  const double *jd, const size_t n_times, const int format);
 const char * DLL_FUNC set_month_name( const int month, const char *new_name);
 const char * DLL_FUNC set_day_of_week_name( const int day_of_week,
                                             const char *new_name);
@@ -41,6 +61,11 @@ long double DLL_FUNC get_time_from_stringl( long double initial_t2k,
          const char *time_str, const int time_format, int *is_ut);
 int DLL_FUNC days_in_month( const int month, const long year,
                             const int calendar);
+void DLL_FUNC day_to_dmy_array( const size_t n_dates, const long *jd,
+                  int *day, int *month, long *year, const int calendar);
+void DLL_FUNC dmy_to_day_array( const size_t n_dates, const int *day,
+                  const int *month, const long *year, long *jd,
+                  const int calendar);
 
 #define FULL_CTIME_FORMAT_MASK           0x700
 #define FULL_CTIME_FORMAT_SECONDS        0x000
@@ -18,6 +18,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 /* 2012 Jul 22:  (BJG) Debugging statements are now shown only if
 one defines DEBUGGING_STATEMENTS.  The Vincenty routine will compute
@@ -65,32 +66,57 @@ void vincenty_direct( const double lat1, const double lon1,
                             double *lat2, double *lon2,
                             const double flat, const double azimuth,
                             const double dist);
-
-double earth_dist( const double lat1, const double lon1,
-                   const double lat2, const double lon2,
+void earth_dist_pairs( const size_t n, const double *lat1, const double *lon1,
+                   const double *lat2, const double *lon2,
+                   const double flattening, double *dists);
+void earth_dist_one_to_many( const double lat0, const double lon0,
+                   const size_t n, const double *lat, const double *lon,
+                   const double flattening, double *dists);
+void vincenty_dist_pairs( const size_t n, const double *lat1,
+                   const double *lon1, const double *lat2,
+                   const double *lon2, const double flat, double *dists);
+void vincenty_dist_one_to_many( const double lat0, const double lon0,
+                   const size_t n, const double *lat, const double *lon,
+                   const double flat, double *dists);
+
+/* Andoyer's formula,  given the sines and cosines of f = the mean of
+the latitudes,  g = half their difference,  and lambda = half the
+difference in longitude.  Separated out so that the batch functions
+below can get those sines and cosines more cheaply.  */
+
+static double andoyer_dist( const double sin_f, const double cos_f,
+                   const double sin_g, const double cos_g,
+                   const double sin_lambda, const double cos_lambda,
                    const double flattening)
 {
-   const double f = (lat1 + lat2) / 2.;
-   const double g = (lat1 - lat2) / 2.;
-   const double lambda = (lon1 - lon2) / 2.;
-   const double sin_g = sin( g), cos_g = cos( g);
-   const double sin_f = sin( f), cos_f = cos( f);
-   const double sin_lambda = sin( lambda), cos_lambda = cos( lambda);
    const double sin_g2 = sin_g * sin_g, cos_g2 = cos_g * cos_g;
    const double sin_f2 = sin_f * sin_f, cos_f2 = cos_f * cos_f;
    const double sin_lambda2 = sin_lambda * sin_lambda;
    const double cos_lambda2 = cos_lambda * cos_lambda;
    const double s = sin_g2 * cos_lambda2 + cos_f2 * sin_lambda2;
    const double c = cos_g2 * cos_lambda2 + sin_f2 * sin_lambda2;
-   const double omega = atan( sqrt( s / c));
-   const double r = sqrt( s * c) / omega;
-   const double d = 2. * omega;
-   const double h1 = (3. * r - 1.) / (2. * c);
-   const double h2 = (3. * r + 1.) / (2. * s);
-   const double rval = d * (1. + flattening *
-                       (h1 * sin_f2 * cos_g2 - h2 * cos_f2 * sin_g2));
+   double omega, r, h1, h2;
 
-   return( rval);
+   if( s == 0.)         /* points are identical */
+      return( 0.);
+   omega = atan( sqrt( s / c));
+   r = sqrt( s * c) / omega;
+   h1 = (3. * r - 1.) / (2. * c);
+   h2 = (3. * r + 1.) / (2. * s);
+   return( 2. * omega * (1. + flattening *
+                       (h1 * sin_f2 * cos_g2 - h2 * cos_f2 * sin_g2)));
+}
+
+double earth_dist( const double lat1, const double lon1,
+                   const double lat2, const double lon2,
+                   const double flattening)
+{
+   const double f = (lat1 + lat2) / 2.;
+   const double g = (lat1 - lat2) / 2.;
+   const double lambda = (lon1 - lon2) / 2.;
+
+   return( andoyer_dist( sin( f), cos( f), sin( g), cos( g),
+                         sin( lambda), cos( lambda), flattening));
 }
 
 /* This uses the 'haversine' method for solving the spherical triangle.
@@ -225,6 +251,23 @@ static double cvt_lat( const double b, const double lat)
    return( atan2( b * sin( lat), cos( lat)));;
 }
 
+/* Once lambda has converged,  this gives the length of the geodesic. */
+
+static double vincenty_length( const double b, const double cos2_a,
+            const double sin_o, const double cos_o, const double o,
+            const double cos_2om)
+{
+   const double usquared = cos2_a * (1.-b*b) / (b*b);
+   const double big_b = big_b_poly( usquared);
+   const double temp3 = 2. * cos_2om * cos_2om - 1.;
+   const double delta_o = big_b * sin_o *
+              (cos_2om + (big_b / 4.) * (cos_o * temp3
+            - (big_b / 6.) * cos_2om * (-3 + 4 * sin_o * sin_o)
+            * (-3. + 4. * cos_o * cos_o)));
+
+   return( b * big_a_poly( usquared) * (o - delta_o));
+}
+
 double vincenty_earth_dist( const double lat1, const double lon1,
                             const double lat2, const double lon2,
                             const double flat, double *azimuth,
@@ -356,13 +399,7 @@ double vincenty_earth_dist( const double lat1, const double lon1,
       }
    while( fabs( delta_lambda) > tolerance && iter < max_iter);
 
-   const double usquared = cos2_a * (1.-b*b) / (b*b);
-   const double big_b = big_b_poly( usquared);
-   const double delta_o = big_b * sin_o *
-              (cos_2om + (big_b / 4.) * (cos_o * temp3
-            - (big_b / 6.) * cos_2om * (-3 + 4 * sin_o * sin_o)
-            * (-3. + 4. * cos_o * cos_o)));
-   const double rval = b * big_a_poly( usquared) * (o - delta_o);
+   const double rval = vincenty_length( b, cos2_a, sin_o, cos_o, o, cos_2om);
    if( azimuth)
       {
       *azimuth = atan2( temp1, temp2);
@@ -438,6 +475,214 @@ void vincenty_direct( const double lat1, const double lon1,
    *lon2 = lon1 + big_l;
 }
 
+/* Batch versions of the above,  for (say) getting distances from each
+of many observatories to each of many points along ground tracks.  The
+results are,  as for the single-pair functions,  in units of the
+ellipsoid's equatorial radius.  The '_pairs' functions find the
+distance from (lat1[i], lon1[i]) to (lat2[i], lon2[i]);  the
+'_one_to_many' ones,  that from (lat0, lon0) to each (lat[i], lon[i]).
+
+   For Andoyer's formula,  the one-to-many case gets the sines and
+cosines of half of the origin's latitude and longitude once;  those for
+the sums and differences of angles then come from the addition formulae,
+so that each point costs two sincos pairs instead of three.
+
+   For Vincenty's method,  pairs are handled in blocks of VINCENTY_LANES.
+The reduced latitudes' sines and cosines are found directly,  skipping
+the atan2( ) in cvt_lat( ).  Each 'lane' of a block is then iterated
+independently until it converges;  converged lanes are dropped from
+later passes.  The first pass is a plain fixed-point step,  as in
+Vincenty's paper;  after that,  the last two steps give a secant step
+(falling back to a fixed-point step if the secant would leave [0, pi]),
+as in vincenty_earth_dist( ),  but without its bisection safeguard.
+That's fine except near the antipodes,  where convergence is slow or
+fails (see above).  So pairs within that region,  or which haven't
+converged after MAX_LANE_ITER passes,  are handed to
+vincenty_earth_dist( ) instead.  Results agree with the single-
+pair function to within the .006 mm iteration tolerance.
+
+   If compiled with OpenMP ('make OPENMP=Y'),  blocks of pairs are
+handled in parallel.     */
+
+#define VINCENTY_LANES     16
+#define MAX_LANE_ITER      20
+
+void earth_dist_pairs( const size_t n, const double *lat1, const double *lon1,
+                   const double *lat2, const double *lon2,
+                   const double flattening, double *dists)
+{
+   long i;
+
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( static)
+#endif
+   for( i = 0; i < (long)n; i++)
+      dists[i] = earth_dist( lat1[i], lon1[i], lat2[i], lon2[i], flattening);
+}
+
+void earth_dist_one_to_many( const double lat0, const double lon0,
+                   const size_t n, const double *lat, const double *lon,
+                   const double flattening, double *dists)
+{
+   const double sin_lat0 = sin( lat0 / 2.), cos_lat0 = cos( lat0 / 2.);
+   const double sin_lon0 = sin( lon0 / 2.), cos_lon0 = cos( lon0 / 2.);
+   long i;
+
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( static)
+#endif
+   for( i = 0; i < (long)n; i++)
+      {
+      const double sin_lat = sin( lat[i] / 2.), cos_lat = cos( lat[i] / 2.);
+      const double sin_lon = sin( lon[i] / 2.), cos_lon = cos( lon[i] / 2.);
+
+      dists[i] = andoyer_dist(
+               sin_lat0 * cos_lat + cos_lat0 * sin_lat,      /* sin( f) */
+               cos_lat0 * cos_lat - sin_lat0 * sin_lat,      /* cos( f) */
+               sin_lat0 * cos_lat - cos_lat0 * sin_lat,      /* sin( g) */
+               cos_lat0 * cos_lat + sin_lat0 * sin_lat,      /* cos( g) */
+               sin_lon0 * cos_lon - cos_lon0 * sin_lon,      /* sin( lambda) */
+               cos_lon0 * cos_lon + sin_lon0 * sin_lon,      /* cos( lambda) */
+               flattening);
+      }
+}
+
+/* Sine and cosine of the reduced latitude,  without the atan2( ) :
+tan( u) = b tan( lat),  so cos( u) is proportional to cos( lat) and
+sin( u) to b sin( lat).   */
+
+static void reduced_lat( const double b, const double lat,
+                         double *sin_u, double *cos_u)
+{
+   const double y = b * sin( lat), x = cos( lat);
+   const double r = sqrt( x * x + y * y);
+
+   *sin_u = y / r;
+   *cos_u = x / r;
+}
+
+/* Computes up to VINCENTY_LANES distances.  The second point of lane i
+is (lat2[i * stride], lon2[i * stride]),  so that a stride of zero gives
+the one-to-many case.  */
+
+static void vincenty_block( const int n, const double *lat1,
+               const double *lon1, const double *lat2, const double *lon2,
+               const int stride, const double flat, double *dists)
+{
+   const double b = 1. - flat;
+   const double tolerance = 1e-12;     /* corresponds to .006 mm */
+   double sin_u1[VINCENTY_LANES], cos_u1[VINCENTY_LANES];
+   double sin_u2[VINCENTY_LANES], cos_u2[VINCENTY_LANES];
+   double dlon[VINCENTY_LANES], lambda[VINCENTY_LANES];
+   double prev_lambda[VINCENTY_LANES], prev_delta[VINCENTY_LANES];
+   int active[VINCENTY_LANES], n_active = 0, i, iter;
+
+   for( i = 0; i < n; i++)
+      {
+      double dl = fmod( lon2[i * stride] - lon1[i], 2. * pi);
+
+      if( dl > pi)
+         dl -= 2. * pi;
+      else if( dl < -pi)
+         dl += 2. * pi;
+      dlon[i] = lambda[i] = fabs( dl);
+      reduced_lat( b, lat1[i], sin_u1 + i, cos_u1 + i);
+      reduced_lat( b, lat2[i * stride], sin_u2 + i, cos_u2 + i);
+      if( lat1[i] == lat2[i * stride] && dl == 0.)
+         dists[i] = 0.;
+      else if( dlon[i] > pi * b)     /* near the antipodes */
+         dists[i] = vincenty_earth_dist( lat1[i], lon1[i], lat2[i * stride],
+                                 lon2[i * stride], flat, NULL, NULL);
+      else
+         active[n_active++] = i;
+      }
+   for( iter = 0; n_active && iter < MAX_LANE_ITER; iter++)
+      {
+      int n_still_active = 0;
+
+      for( i = 0; i < n_active; i++)
+         {
+         const int j = active[i];
+         const double sin_lambda = sin( lambda[j]);
+         const double cos_lambda = cos( lambda[j]);
+         const double temp1 = cos_u2[j] * sin_lambda;
+         const double temp2 = cos_u1[j] * sin_u2[j]
+                                 - sin_u1[j] * cos_u2[j] * cos_lambda;
+         const double cos_o = sin_u1[j] * sin_u2[j]
+                                 + cos_u1[j] * cos_u2[j] * cos_lambda;
+         const double sin_o = sqrt( temp1 * temp1 + temp2 * temp2);
+         const double o = atan2( sin_o, cos_o);
+         const double sin_a = cos_u1[j] * cos_u2[j] * sin_lambda / sin_o;
+         const double cos2_a = 1. - sin_a * sin_a;
+         const double cos_2om = (cos2_a == 0. ? 0. :
+                           cos_o - 2. * sin_u1[j] * sin_u2[j] / cos2_a);
+         const double big_c = flat * cos2_a * (4. + flat * (4 - 3 * cos2_a)) / 16.;
+         double new_lambda = dlon[j] + (1. - big_c) * flat * sin_a
+                   * (o + big_c * sin_o * (cos_2om + big_c * cos_o
+                   * (2. * cos_2om * cos_2om - 1.)));
+
+         const double delta = new_lambda - lambda[j];
+
+         if( fabs( delta) <= tolerance)
+            dists[j] = vincenty_length( b, cos2_a, sin_o, cos_o, o, cos_2om);
+         else
+            {
+            const double dy = delta - prev_delta[j];
+
+            active[n_still_active++] = j;
+            if( !iter || dy == 0.)
+               new_lambda = lambda[j] + delta;
+            else
+               new_lambda = lambda[j] - delta * (lambda[j] - prev_lambda[j]) / dy;
+            if( new_lambda < 0. || new_lambda > pi)   /* secant went astray */
+               new_lambda = lambda[j] + delta;
+            prev_lambda[j] = lambda[j];
+            prev_delta[j] = delta;
+            lambda[j] = new_lambda;
+            }
+         }
+      n_active = n_still_active;
+      }
+   for( i = 0; i < n_active; i++)      /* didn't converge briskly */
+      {
+      const int j = active[i];
+
+      dists[j] = vincenty_earth_dist( lat1[j], lon1[j], lat2[j * stride],
+                                 lon2[j * stride], flat, NULL, NULL);
+      }
+}
+
+void vincenty_dist_pairs( const size_t n, const double *lat1,
+                   const double *lon1, const double *lat2,
+                   const double *lon2, const double flat, double *dists)
+{
+   long i;
+
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( static)
+#endif
+   for( i = 0; i < (long)n; i += VINCENTY_LANES)
+      vincenty_block( ((long)n - i < VINCENTY_LANES ? (int)( n - i) : VINCENTY_LANES),
+               lat1 + i, lon1 + i, lat2 + i, lon2 + i, 1, flat, dists + i);
+}
+
+/* Note that here,  the 'many' points are the first of each pair;  the
+distance is the same either way.  */
+
+void vincenty_dist_one_to_many( const double lat0, const double lon0,
+                   const size_t n, const double *lat, const double *lon,
+                   const double flat, double *dists)
+{
+   long i;
+
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( static)
+#endif
+   for( i = 0; i < (long)n; i += VINCENTY_LANES)
+      vincenty_block( ((long)n - i < VINCENTY_LANES ? (int)( n - i) : VINCENTY_LANES),
+               lat + i, lon + i, &lat0, &lon0, 0, flat, dists + i);
+}
+
 static void reset_max_diff( double *max_diff, const double a, const double b)
 {
    if( *max_diff < fabs( a))
@@ -513,6 +758,89 @@ static void run_test_cases( void)
                  max_diff, max_diff * semimajor);
 }
 
+/* Benchmark of the batch functions against the single-pair ones,  run
+with 'dist -b' (optionally followed by a number of points).  Points are
+uniformly distributed over the globe,  from a simple linear congruential
+generator (so results are the same on all systems).  Reports CPU time
+and the largest difference from the single-pair results.  */
+
+static double pseudorandom_double( void)
+{
+   static unsigned long long rval = 1;
+
+   rval = rval * 6364136223846793005ULL + 1442695040888963407ULL;
+   return( (double)( rval >> 11) / 9007199254740992.0);
+}
+
+static double elapsed( const clock_t t0)
+{
+   return( (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+}
+
+static double max_abs_diff( const size_t n, const double *a, const double *b)
+{
+   double rval = 0.;
+   size_t i;
+
+   for( i = 0; i < n; i++)
+      if( rval < fabs( a[i] - b[i]))
+         rval = fabs( a[i] - b[i]);
+   return( rval);
+}
+
+static int run_benchmark( const size_t n, const double flat,
+                          const double semimajor)
+{
+   double *lat = (double *)calloc( 6 * n, sizeof( double));
+   double *lon = lat + n, *lat2 = lat + 2 * n, *lon2 = lat + 3 * n;
+   double *d1 = lat + 4 * n, *d2 = lat + 5 * n;
+   size_t i;
+   clock_t t0;
+
+   if( !lat)
+      return( -1);
+   for( i = 0; i < n; i++)
+      {
+      lat[i] = asin( 2. * pseudorandom_double( ) - 1.);
+      lon[i] = (2. * pseudorandom_double( ) - 1.) * pi;
+      lat2[i] = asin( 2. * pseudorandom_double( ) - 1.);
+      lon2[i] = (2. * pseudorandom_double( ) - 1.) * pi;
+      }
+   printf( "%lu pairs of points\n", (unsigned long)n);
+   t0 = clock( );
+   for( i = 0; i < n; i++)
+      d1[i] = earth_dist( lat[i], lon[i], lat2[i], lon2[i], flat);
+   printf( "Andoyer,  one pair at a time: %.3f s\n", elapsed( t0));
+   t0 = clock( );
+   earth_dist_pairs( n, lat, lon, lat2, lon2, flat, d2);
+   printf( "Andoyer,  pairs:              %.3f s (max diff %.3g m)\n",
+               elapsed( t0), max_abs_diff( n, d1, d2) * semimajor);
+   for( i = 0; i < n; i++)
+      d1[i] = earth_dist( lat[0], lon[0], lat2[i], lon2[i], flat);
+   t0 = clock( );
+   earth_dist_one_to_many( lat[0], lon[0], n, lat2, lon2, flat, d2);
+   printf( "Andoyer,  one to many:        %.3f s (max diff %.3g m)\n",
+               elapsed( t0), max_abs_diff( n, d1, d2) * semimajor);
+   t0 = clock( );
+   for( i = 0; i < n; i++)
+      d1[i] = vincenty_earth_dist( lat[i], lon[i], lat2[i], lon2[i], flat,
+                                       NULL, NULL);
+   printf( "Vincenty,  one pair at a time: %.3f s\n", elapsed( t0));
+   t0 = clock( );
+   vincenty_dist_pairs( n, lat, lon, lat2, lon2, flat, d2);
+   printf( "Vincenty,  pairs:              %.3f s (max diff %.3g m)\n",
+               elapsed( t0), max_abs_diff( n, d1, d2) * semimajor);
+   for( i = 0; i < n; i++)
+      d1[i] = vincenty_earth_dist( lat[0], lon[0], lat2[i], lon2[i], flat,
+                                       NULL, NULL);
+   t0 = clock( );
+   vincenty_dist_one_to_many( lat[0], lon[0], n, lat2, lon2, flat, d2);
+   printf( "Vincenty,  one to many:        %.3f s (max diff %.3g m)\n",
+               elapsed( t0), max_abs_diff( n, d1, d2) * semimajor);
+   free( lat);
+   return( 0);
+}
+
 /* For the 'spherical earth' formula,  we use a radius of 6371 km (close to
 the average of the polar and equatorial radii.)  For the 'flattened earth',
 the equatorial radius of 6378.140 km is used. */
@@ -525,10 +853,14 @@ int main( const int argc, const char **argv)
 // const double semimajor = 6378.14;
    double lat1, lon1;
 
+   if( argc > 1 && argv[1][0] == '-' && argv[1][1] == 'b')
+      return( run_benchmark( (argc > 2 ? (size_t)atol( argv[2]) : 1000000),
+                     flattening, semimajor * 1000.));
    if( argc < 5)
       {
       printf( "usage: dist lat1 lon1 lat2 lon2\n");
       printf( "or:    dist lat1 lon1 dist(km) azim -d\n");
+      printf( "or:    dist -b (n_points)   to benchmark batch functions\n");
       run_test_cases( );
       return( 0);
       }
@@ -72,63 +72,60 @@ and velocities with one relatively simple function.
 #define PI 3.1415926535897932384626433832795028841971693993751058209749445923
 #define DEGREES_TO_RADIANS (PI/180.)
 
-static double an[5], ae[5], ai[5];         // satellite position data
+//   gust86_init_context
+//   Compute basic orbital position data for the satellites.  These
+//   depend only on the time,  and are shared by all five satellites;
+//   they're stored in a caller-supplied context,  so that different
+//   threads (or different times) don't step on one another.
 
-//   OrbitalPosition
-//   Compute basic orbital position data for the satellites.
-
-static void gust86_mean_parameters( const double jde )
+void __stdcall gust86_init_context( gust86_context_t *context, const double jde)
 {
-   static double curr_jde_set = -1.;
+   const double t0 = 2444239.5;   // origin date for the theory: 1980 Jan 1
+   const double days_since_1980 = jde - t0;             // time from origin
+   const double days_per_year = 365.25;                 // days in a year
+   const double years_since_1980 = days_since_1980 / days_per_year;
+   int i;                           // loop counter
 
-   if( jde != curr_jde_set)
+   static const double fqn[5] =    /* mean motion at epoch in radians/day */
       {
-      const double t0 = 2444239.5;   // origin date for the theory: 1980 Jan 1
-      const double days_since_1980 = jde - t0;             // time from origin
-      const double days_per_year = 365.25;                 // days in a year
-      const double years_since_1980 = days_since_1980 / days_per_year;
-      int i;                           // loop counter
-
-      static const double fqn[5] =    /* mean motion at epoch in radians/day */
-         {
-         4445190.550e-06, 2492952.519e-06, 1516148.111e-06,
-          721718.509e-06, 466692.120e-06
-         };
+      4445190.550e-06, 2492952.519e-06, 1516148.111e-06,
+       721718.509e-06, 466692.120e-06
+      };
 
-      static const double fqe[5] =     /* in degrees/year */
-         {
-         20.082, 6.217, 2.865, 2.078, 0.386
-         };
+   static const double fqe[5] =     /* in degrees/year */
+      {
+      20.082, 6.217, 2.865, 2.078, 0.386
+      };
 
-      static const double fqi[5] =     /* in degrees/year */
-         {
-         -20.309, -6.288, -2.836, -1.843, -0.259
-         };
+   static const double fqi[5] =     /* in degrees/year */
+      {
+      -20.309, -6.288, -2.836, -1.843, -0.259
+      };
 
-      static const double phn[5] =     /* mean longitude at epoch in radians */
-         {
-         -238051.e-06, 3098046.e-06, 2285402.e-06,
-           856359.e-06, -915592.e-06
-         };
+   static const double phn[5] =     /* mean longitude at epoch in radians */
+      {
+      -238051.e-06, 3098046.e-06, 2285402.e-06,
+        856359.e-06, -915592.e-06
+      };
 
-      static const double phe[5] =   /* in radians */
-         {
-         0.611392, 2.408974, 2.067774, 0.735131, 0.426767
-         };
+   static const double phe[5] =   /* in radians */
+      {
+      0.611392, 2.408974, 2.067774, 0.735131, 0.426767
+      };
 
-      static const double phi[5] =   /* in radians */
-         {
-         5.702313, 0.395757, 0.589326, 1.746237, 4.206896
-         };
+   static const double phi[5] =   /* in radians */
+      {
+      5.702313, 0.395757, 0.589326, 1.746237, 4.206896
+      };
 
-      // Compute the orbital data.
+   // Compute the orbital data.
 
-      for( i = 0; i < 5; i++)
-         {
-         an[i] = fqn[i] * days_since_1980 + phn[i];
-         ae[i] = fqe[i] * DEGREES_TO_RADIANS * years_since_1980 + phe[i];
-         ai[i] = fqi[i] * DEGREES_TO_RADIANS * years_since_1980 + phi[i];
-         }
+   context->jde = jde;
+   for( i = 0; i < 5; i++)
+      {
+      context->an[i] = fqn[i] * days_since_1980 + phn[i];
+      context->ae[i] = fqe[i] * DEGREES_TO_RADIANS * years_since_1980 + phe[i];
+      context->ai[i] = fqi[i] * DEGREES_TO_RADIANS * years_since_1980 + phi[i];
       }
 }
 
@@ -158,8 +155,10 @@ static void sum_uranian_series( double *elems,
 //   miranda_elems
 //   Compute the orbital elements of Miranda.
 
-static void miranda_elems( const double t, double *elems)
+static void miranda_elems( const gust86_context_t *context,
+                          const double t, double *elems)
 {
+   const double *an = context->an, *ae = context->ae, *ai = context->ai;
 /* --- Z = K + IH  ---- */
    static const double ae_series[5] = { 1312.38e-6, 71.81e-6, 69.77e-6,
             6.75e-6, 6.27e-6 };
@@ -201,8 +200,10 @@ static void miranda_elems( const double t, double *elems)
 //   ariel_elems
 //   Compute the orbital elements of Ariel.
 
-static void ariel_elems( const double t, double *elems)
+static void ariel_elems( const gust86_context_t *context,
+                          const double t, double *elems)
 {
+   const double *an = context->an, *ae = context->ae, *ai = context->ai;
 /* --- Z = K + IH --- */
    static const double ae_series[5] = { -3.35e-6, 1187.63e-6, 861.59e-6,
          71.50e-6, 55.59e-6 };
@@ -247,8 +248,10 @@ static void ariel_elems( const double t, double *elems)
 //   umbriel_elems
 //   Compute the orbital elements of Umbriel.
 
-static void umbriel_elems( const double t, double *elems)
+static void umbriel_elems( const gust86_context_t *context,
+                          const double t, double *elems)
 {
+   const double *an = context->an, *ae = context->ae, *ai = context->ai;
 /* --- Z = K + IH --- */
    static const double ae_series[5] = { -0.21e-6, -227.95e-6, 3904.69e-6,
           309.17e-6, 221.92e-6 };
@@ -321,8 +324,10 @@ static void umbriel_elems( const double t, double *elems)
 //   titania_elems
 //   Compute the orbital elements of Titania.
 
-static void titania_elems( const double t, double *elems)
+static void titania_elems( const gust86_context_t *context,
+                          const double t, double *elems)
 {
+   const double *an = context->an, *ae = context->ae, *ai = context->ai;
    static const double ae_series[5] = { -0.02e-6, -1.29e-6, -324.51e-6,
                   932.81e-6, 1120.89e-6 };
    static const double ai_series[5] = { -1.43e-6, -1.06e-06, -140.13e-06,
@@ -399,8 +404,10 @@ static void titania_elems( const double t, double *elems)
 //   oberon_elems
 //   Compute the orbital elements of Oberon.
 
-static void oberon_elems( const double t, double *elems)
+static void oberon_elems( const gust86_context_t *context,
+                          const double t, double *elems)
 {
+   const double *an = context->an, *ae = context->ae, *ai = context->ai;
    static const double ae_series[5] = { 0.00e-6, -0.35e-6, 74.53e-6,
            -758.68e-6, 1397.34e-6 };
    static const double ai_series[5] = { -0.44e-6, -0.31e-06, 36.89e-06,
@@ -647,10 +654,11 @@ static void ellipx( const double ell[6], const double rmu, double xyz[6] )
 #include <stdio.h>
 #endif
 
-void __stdcall gust86_posn( const double jde, const int isat, double *r )
+void __stdcall gust86_context_posn( const gust86_context_t *context,
+                                    const int isat, double *r )
 
 // Input arguments:
-//   jde      Julian date, TDT
+//   context  Mean parameters set up by gust86_init_context( )
 //   isat   Satellite index
 //
 //   Output arguments
@@ -675,6 +683,7 @@ void __stdcall gust86_posn( const double jde, const int isat, double *r )
                /* Above is GM of Uranus plus the satellite we want */
    const double seconds_per_day = 24. * 60. * 60.;
    const double seconds_per_day_squared = seconds_per_day * seconds_per_day;
+   const double jde = context->jde;
    const double days_since_1980 = jde - t0;
    double el[6], xu[6];
    int i, j;
@@ -683,29 +692,28 @@ void __stdcall gust86_posn( const double jde, const int isat, double *r )
 
 /*---- Test parameters: ----------------------------------------------*/
 
-   gust86_mean_parameters( jde);
    // The function to call depends on the satellite.
 
    switch (isat)
    {
    case GUST86_ARIEL:
-      ariel_elems( days_since_1980, el);
+      ariel_elems( context, days_since_1980, el);
       break;
 
    case GUST86_UMBRIEL:
-      umbriel_elems( days_since_1980, el);
+      umbriel_elems( context, days_since_1980, el);
       break;
 
    case GUST86_TITANIA:
-      titania_elems( days_since_1980, el);
+      titania_elems( context, days_since_1980, el);
       break;
 
    case GUST86_OBERON:
-      oberon_elems( days_since_1980, el);
+      oberon_elems( context, days_since_1980, el);
       break;
 
    case GUST86_MIRANDA:
-      miranda_elems( days_since_1980, el);
+      miranda_elems( context, days_since_1980, el);
       break;
 
    default:       /* should never happen */
@@ -761,3 +769,25 @@ void __stdcall gust86_posn( const double jde, const int isat, double *r )
    for (i=0; i<6; i++)        /* scale output to be in AU & AU/s */
       r[i] /= AU_in_km;
 }
+
+void __stdcall gust86_posn( const double jde, const int isat, double *r )
+{
+   gust86_context_t context;
+
+   gust86_init_context( &context, jde);
+   gust86_context_posn( &context, isat, r);
+}
+
+/* Computes state vectors for all five satellites,  in the order given by
+the GUST86_ARIEL... GUST86_MIRANDA indices,  at six doubles each,  with
+the mean parameters computed only once.     */
+
+void __stdcall gust86_posns( const double jde, double *r )
+{
+   gust86_context_t context;
+   int i;
+
+   gust86_init_context( &context, jde);
+   for( i = 0; i < 5; i++)
+      gust86_context_posn( &context, i, r + i * 6);
+}
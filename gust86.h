@@ -22,10 +22,26 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #define __stdcall
 #endif
 
+/* The mean parameters of the theory depend only on the time,  and are
+shared by all five satellites.  gust86_init_context( ) computes them
+once;  gust86_context_posn( ) can then be called for each satellite.
+Nothing is kept in static storage,  so these (and gust86_posn( ) and
+gust86_posns( )) can safely be called from multiple threads.  */
+
+typedef struct
+{
+   double jde;
+   double an[5], ae[5], ai[5];   /* mean longitudes; pericentre, node args */
+} gust86_context_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 void __stdcall gust86_posn( const double jde, const int isat, double *r );
+void __stdcall gust86_posns( const double jde, double *r );
+void __stdcall gust86_init_context( gust86_context_t *context, const double jde);
+void __stdcall gust86_context_posn( const gust86_context_t *context,
+                                    const int isat, double *r );
 #ifdef __cplusplus
 }
 #endif
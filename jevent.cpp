@@ -37,6 +37,7 @@ do all the math itself.   */
 #include "lunar.h"
 #include "afuncs.h"
 #include "date.h"
+#include "brentmin.h"
 
 #define PI 3.1415926535897932384626433832795028841971693993751058209749445923
 #define JUPITER_DIAMETER_IN_KM (88000. * 1.609)
@@ -79,101 +80,463 @@ static void show_event( FILE *ofile, EVENT *e)
               (e->event_type & EVENT_START) ? "start" : "end  ", buff);
 }
 
-static unsigned find_events( unsigned sat_no, double t1, double t2, int viewpoint, EVENT *e)
+/* Events are found as follows.  Jupiter's and the earth's heliocentric
+positions change slowly,  so they're computed (with VSOP) only once a day
+and interpolated in between.  All the satellites we want are computed at
+once,  on a grid of times five degrees of Io's orbital motion (or that of
+the fastest satellite we want) apart,  using calc_jsat_loc_grid( ),  and
+are also interpolated in between.  At each grid point,  we get each
+satellite's offset in longitude from Jupiter,  in Jovian radii,  as seen
+from the sun (for eclipses and shadow transits) and from the earth (for
+occultations and transits).
+
+   When that offset changes sign,  the satellite has passed in front of or
+behind Jupiter.  The contact times,  when the satellite's distance from
+Jupiter's center (stretched in latitude for Jupiter's oblateness) is one
+Jovian radius,  are then found by root-finding on either side of the
+conjunction.  If the satellite misses the disk at conjunction,  but only
+barely,  we look for a nearby closest approach that _does_ hit it.
+Light-time from Jupiter to the earth is then added.
+
+   The time span is cut into chunks that can be handled independently;
+if compiled with OpenMP ('make OPENMP=Y'),  they're handled in parallel.
+Each chunk's satellite grid is padded at both ends,  so that contacts
+for conjunctions near the ends of the chunk can be found.   */
+
+#define EVENT_GRID struct event_grid
+
+EVENT_GRID
+   {
+   double planet_t0, sat_t0, step;
+   int n_planet_nodes, n_sat_nodes;
+   double *planets;     /* six per node:  Jupiter xyz,  then earth xyz */
+   double *sats;        /* fifteen per node,  from calc_jsat_loc_grid( ) */
+   };
+
+#define PLANET_NODE_STEP   1.
+#define SAT_STEP_DEGREES   5.
+#define GRID_PAD          12
+#define STEPS_PER_CHUNK  4096
+#define EVENT_TOLERANCE  1e-7
+#define GRAZE_LIMIT       .05
+
+static void heliocentric_locs( const double t, double *loc)
 {
-   double t, lon_j, lat_j, rad_j, lon_e, lat_e, rad_e;
-   double loc[9], tloc[18], *tptr, step, delta_lat, prev_delta_lat = 0.;
-   double tc, lon_s, lat_s, rad_s, prev_delta = 0., delta;
+   const double tc = (t - 2451545.) / 36525.;  /* re-cvt to julian centuries */
    int i;
-   unsigned rval = 0;
 
-   t = t1;
-   step = 10. / speeds[sat_no - 1];
-   while( t < t2)
+   for( i = 0; i < 2; i++)
       {
-      tc = (t - 2451545.) / 36525.;     /* re-cvt to julian centuries */
+      const int planet = (i ? 3 : 5);
+      const double lon = calc_vsop_loc( vsop_data, planet, 0, tc, 0.);
+      const double lat = calc_vsop_loc( vsop_data, planet, 1, tc, 0.);
+      const double rad = calc_vsop_loc( vsop_data, planet, 2, tc, 0.);
+
+      loc[i * 3] = rad * cos( lat) * cos( lon);
+      loc[i * 3 + 1] = rad * cos( lat) * sin( lon);
+      loc[i * 3 + 2] = rad * sin( lat);
+      }
+}
+
+/* Sets up planet and satellite positions from grid step 'first_step'
+(times t0 + first_step * step) through 'first_step + n_steps',  plus
+padding.  Returns 0 on success,  -1 if memory runs out.  */
+
+static int make_event_grid( EVENT_GRID *grid, const double t0,
+            const double step, const int first_step, const int n_steps,
+            const unsigned sat_mask)
+{
+   int i;
+
+   grid->step = step;
+   grid->sat_t0 = t0 + (double)( first_step - GRID_PAD) * step;
+   grid->n_sat_nodes = n_steps + 1 + 2 * GRID_PAD;
+   grid->planet_t0 = floor( grid->sat_t0) - PLANET_NODE_STEP;
+   grid->n_planet_nodes = (int)ceil( (double)grid->n_sat_nodes * step
+                                 / PLANET_NODE_STEP) + 4;
+   grid->planets = (double *)malloc( grid->n_planet_nodes * 6 * sizeof( double));
+   grid->sats = (double *)malloc( grid->n_sat_nodes * 15 * sizeof( double));
+   if( !grid->planets || !grid->sats)
+      return( -1);
+   for( i = 0; i < grid->n_planet_nodes; i++)
+      heliocentric_locs( grid->planet_t0 + (double)i * PLANET_NODE_STEP,
+                         grid->planets + i * 6);
+   calc_jsat_loc_grid( grid->sat_t0, step, grid->n_sat_nodes, grid->sats,
+                         (int)sat_mask);
+   return( 0);
+}
 
-      lon_j = calc_vsop_loc( vsop_data, 5, 0, tc, 0.);
-      lat_j = calc_vsop_loc( vsop_data, 5, 1, tc, 0.);
-      rad_j = calc_vsop_loc( vsop_data, 5, 2, tc, 0.);
+static void free_event_grid( EVENT_GRID *grid)
+{
+   free( grid->planets);
+   free( grid->sats);
+}
 
-      lon_e = calc_vsop_loc( vsop_data, 3, 0, tc, 0.);
-      lat_e = calc_vsop_loc( vsop_data, 3, 1, tc, 0.);
-      rad_e = calc_vsop_loc( vsop_data, 3, 2, tc, 0.);
+/* Four-point Lagrange interpolation of 'n_vals' values,  found every
+'stride' doubles in 'nodes',  at the (fractional) node number x.   */
 
-      loc[0] = rad_j * cos( lat_j) * cos( lon_j);
-      loc[1] = rad_j * cos( lat_j) * sin( lon_j);
-      loc[2] = rad_j * sin( lat_j);
+static void interpolate( const double *nodes, const int n_nodes,
+            const int stride, const double x, double *vals, const int n_vals)
+{
+   int i = (int)floor( x) - 1, j;
+   double u, coeff[4];
+
+   if( i < 0)
+      i = 0;
+   if( i > n_nodes - 4)
+      i = n_nodes - 4;
+   u = x - (double)i;
+   coeff[0] = -(u - 1.) * (u - 2.) * (u - 3.) / 6.;
+   coeff[1] = u * (u - 2.) * (u - 3.) / 2.;
+   coeff[2] = -u * (u - 1.) * (u - 3.) / 2.;
+   coeff[3] = u * (u - 1.) * (u - 2.) / 6.;
+   nodes += i * stride;
+   for( j = 0; j < n_vals; j++)
+      vals[j] = coeff[0] * nodes[j] + coeff[1] * nodes[j + stride]
+             + coeff[2] * nodes[j + 2 * stride] + coeff[3] * nodes[j + 3 * stride];
+}
 
-      loc[6] = rad_e * cos( lat_e) * cos( lon_e);
-      loc[7] = rad_e * cos( lat_e) * sin( lon_e);
-      loc[8] = rad_e * sin( lat_e);
+/* With nodes a day apart,  the interpolated planet positions are off by
+a few hundred metres;  with satellite nodes five degrees of Io's motion
+apart,  Io's position is off by about half a kilometre.  Both amount to
+a small fraction of a second in event times.  */
 
-      calc_jsat_loc( t, tloc, 1 << (sat_no - 1), 0L);
-      tptr = tloc + (sat_no - 1) * 3;
-      loc[3] = loc[0] + tptr[0] * AU_PER_JRAD;
-      loc[4] = loc[1] + tptr[1] * AU_PER_JRAD;
-      loc[5] = loc[2] + tptr[2] * AU_PER_JRAD;
+static void interpolate_planets( const EVENT_GRID *grid, const double t,
+                                 double *loc)
+{
+   interpolate( grid->planets, grid->n_planet_nodes, 6,
+               (t - grid->planet_t0) / PLANET_NODE_STEP, loc, 6);
+}
 
+static void interpolate_sat( const EVENT_GRID *grid, const int sat,
+                             const double t, double *loc)
+{
+   interpolate( grid->sats + sat * 3, grid->n_sat_nodes, 15,
+               (t - grid->sat_t0) / grid->step, loc, 3);
+}
+
+/* Given heliocentric Jupiter and earth positions in 'planets' and the
+satellite's jovicentric position (ecliptic of date,  in Jovian radii),
+sets delta[0] to the satellite's offset from Jupiter in longitude and
+delta[1] to its offset in latitude (stretched for Jupiter's oblateness),
+both in Jovian radii,  as seen from the sun (viewpoint == 0) or earth. */
+
+static void sat_offsets( const double *planets, const double *sat,
+                         const int viewpoint, double *delta)
+{
+   double jup[3], loc[3], lon_j, lat_j, lon_s, lat_s, rad_s;
+   int i;
+
+   for( i = 0; i < 3; i++)
+      {
+      jup[i] = planets[i];
       if( viewpoint)
+         jup[i] -= planets[i + 3];
+      loc[i] = jup[i] + sat[i] * AU_PER_JRAD;
+      }
+   lon_j = atan2( jup[1], jup[0]);
+   lat_j = atan( jup[2] / sqrt( jup[0] * jup[0] + jup[1] * jup[1]));
+   rad_s = sqrt( loc[0] * loc[0] + loc[1] * loc[1] + loc[2] * loc[2]);
+   lon_s = atan2( loc[1], loc[0]);
+   while( lon_s - lon_j > PI)
+      lon_s -= PI + PI;
+   while( lon_s - lon_j <-PI)
+      lon_s += PI + PI;
+   lat_s = asin( loc[2] / rad_s);
+   delta[0] = (lon_s - lon_j) * rad_s / AU_PER_JRAD;
+   delta[1] = (lat_s - lat_j) * rad_s / AU_PER_JRAD;
+   delta[1] *= 1.071374;     /* stretch for jup's oblateness */
+}
+
+typedef struct
+{
+   const EVENT_GRID *grid;
+   int sat, viewpoint;          /* sat = 0 for Io,  ... 3 for Callisto */
+} event_search_t;
+
+/* Returns the squared distance of the satellite from Jupiter's center,
+minus one,  so that zeroes are contacts with Jupiter's limb (or shadow). */
+
+static double event_func( const event_search_t *s, const double t)
+{
+   double planets[6], sat[3], delta[2];
+
+   interpolate_planets( s->grid, t, planets);
+   interpolate_sat( s->grid, s->sat, t, sat);
+   sat_offsets( planets, sat, s->viewpoint, delta);
+   return( delta[0] * delta[0] + delta[1] * delta[1] - 1.);
+}
+
+/* Illinois-modified regula falsi;  f0 and f1 must differ in sign.  */
+
+static double find_event_root( const event_search_t *s,
+                        double t0, double f0, double t1, double f1)
+{
+   double t = t0, prev_t = t1;
+   int side = 0, iter;
+
+   for( iter = 0; iter < 60 && fabs( t - prev_t) > EVENT_TOLERANCE; iter++)
+      {
+      double f;
+
+      prev_t = t;
+      t = (t0 * f1 - t1 * f0) / (f1 - f0);
+      f = event_func( s, t);
+      if( f == 0.)
+         break;
+      if( (f > 0.) == (f1 > 0.))
          {
-         for( i = 0; i < 9; i++)
-            loc[i] -= loc[6 + i % 3];
-         lon_j = atan2( loc[1], loc[0]);
-         lat_j = atan( loc[2] / sqrt( loc[0] * loc[0] + loc[1] * loc[1]));
+         t1 = t;
+         f1 = f;
+         if( side == -1)
+            f0 /= 2.;
+         side = -1;
          }
-      rad_s = sqrt( loc[3] * loc[3] + loc[4] * loc[4] + loc[5] * loc[5]);
-      lon_s = atan2( loc[4], loc[3]);
-      while( lon_s - lon_j > PI)
-         lon_s -= PI + PI;
-      while( lon_s - lon_j <-PI)
-         lon_s += PI + PI;
-      lat_s = asin( loc[5] / rad_s);
-      delta = (lon_s - lon_j) * rad_s / AU_PER_JRAD;
-      delta_lat = (lat_s - lat_j) * rad_s / AU_PER_JRAD;
-      delta_lat *= 1.071374;     /* stretch for jup's oblateness */
-      if( delta * prev_delta < 0.)     /* zero crossed */
+      else
+         {
+         t0 = t;
+         f0 = f;
+         if( side == 1)
+            f1 /= 2.;
+         side = 1;
+         }
+      }
+   return( t);
+}
+
+/* The satellite barely missed the disk at conjunction.  Look for a nearby
+closest approach;  if it's inside the disk,  return its time (and set
+*f_min),  else return zero.  */
+
+static double find_graze( const event_search_t *s, const double t_c,
+                          const double f_c, const double dt, double *f_min)
+{
+   const double f0 = event_func( s, t_c - dt);
+   const double f2 = event_func( s, t_c + dt);
+   brent_min_t brent;
+
+   if( f0 <= f_c || f2 <= f_c)
+      return( 0.);
+   brent_min_init( &brent, t_c - dt, f0, t_c, f_c, t_c + dt, f2);
+   brent.tolerance = EVENT_TOLERANCE * 10.;
+   brent.ytolerance = 0.;
+   while( brent.step_type && brent.n_iterations < 100)
+      {
+      const double new_t = brent_min_next( &brent);
+
+      if( brent.step_type)
          {
-         double t_crossing, diff, a, b, c, dx, dy, dist = 0.;
-
-         dx = prev_delta - delta;
-         dy = prev_delta_lat - delta_lat;
-         a = dx * dx + dy * dy;              /* quadratic for intercept */
-         b = 2. * (dx * delta + dy * delta_lat);
-         c = delta_lat * delta_lat + delta * delta - 1.;
-         diff = b * b - 4. * a * c;
-         t_crossing = t + b * step / (2. * a);
-         t = t_crossing + (180. / speeds[sat_no - 1]) * .9;
-         if( diff > 0.)       /* if real solution, ie, sat doesn't miss */
+         *f_min = event_func( s, new_t);
+         brent_min_add( &brent, *f_min);
+         if( *f_min < 0.)
+            return( new_t);
+         }
+      }
+   return( 0.);
+}
+
+/* Given a conjunction bracketed by t0 and t1 (where the longitude offsets
+are d0 and d1),  finds the contact times and stores the start and end
+events in e[0] and e[1].  Returns 2 if there are events,  else zero.
+
+   The conjunction time needn't be exact;  linear interpolation suffices
+to tell us if the satellite hits the disk,  and roughly when.  If it
+moved in a straight line at constant speed,  it would reach the limb
+'half_width' days later (or earlier).  It actually moves a little slower
+(we see its orbit projected),  so the contacts are just outside that;
+a bracket from there to 5% further out is usually enough to pin them
+down with only a few evaluations.  */
+
+static unsigned find_contacts( const event_search_t *s, const double t0,
+               const double d0, const double t1, const double d1, EVENT *e)
+{
+   const double t_c = (t0 * d1 - t1 * d0) / (d1 - d0);
+   const double speed = fabs( d1 - d0) / (t1 - t0);   /* Jovian radii/day */
+   double t_mid = t_c, f_mid = event_func( s, t_c), t_ext, f_ext;
+   double half_width, planets[6], dist = 0.;
+   int i;
+
+   if( f_mid >= 0. && f_mid < GRAZE_LIMIT)
+      {
+      t_ext = find_graze( s, t_c, f_mid, .3 / speed, &f_ext);
+      if( t_ext)
+         {
+         t_mid = t_ext;
+         f_mid = f_ext;
+         }
+      }
+   if( f_mid >= 0.)        /* satellite misses the disk */
+      return( 0);
+   half_width = sqrt( -f_mid) / speed;
+   for( i = 0; i < 2; i++)
+      {
+      const double dir = (i ? 1. : -1.);
+      double t_in = t_mid + dir * half_width;
+      double f_in = event_func( s, t_in);
+      double t_out = t_in + dir * (.05 * half_width + 1e-4);
+      double f_out;
+
+      if( f_in >= 0.)         /* shouldn't happen,  but just in case */
+         {
+         t_out = t_in;
+         f_out = f_in;
+         t_in = t_mid;
+         f_in = f_mid;
+         }
+      else
+         while( (f_out = event_func( s, t_out)) <= 0.)
             {
-            diff = sqrt( diff) * step / (2. * a);
-            diff = fabs( diff);
-            for( i = 0; i < 3; i++)
-               dist += (loc[i + 6] - loc[i]) * (loc[i + 6] - loc[i]);
-            t_crossing += sqrt( dist) / AU_PER_DAY;
-            e[0].t = t_crossing - diff;
-            e[0].sat = sat_no;
-            e[0].event_type = (prev_delta > 0.);
-            if( !viewpoint)
-               e[0].event_type |= FROM_SUN;
-            e[1].t = t_crossing + diff;
-            e[1].sat = sat_no;
-            e[1].event_type = e[0].event_type;
-            e[0].event_type |= EVENT_START;
-            if( !quiet)
+            t_in = t_out;
+            f_in = f_out;
+            t_out += dir * (.05 * half_width + 1e-4);
+            }
+      e[i].t = find_event_root( s, t_out, f_out, t_in, f_in);
+      e[i].sat = (unsigned)s->sat + 1;
+      e[i].event_type = (d0 > 0.) | (s->viewpoint ? 0 : FROM_SUN);
+      }
+   e[0].event_type |= EVENT_START;
+   interpolate_planets( s->grid, t_c, planets);
+   for( i = 0; i < 3; i++)
+      dist += (planets[i + 3] - planets[i]) * (planets[i + 3] - planets[i]);
+   for( i = 0; i < 2; i++)
+      e[i].t += sqrt( dist) / AU_PER_DAY;
+   return( 2);
+}
+
+/* Events found in one chunk of the time grid.  Each satellite and each
+viewpoint gets its own list,  so they can be gathered in that order.  */
+
+typedef struct
+{
+   EVENT *events[4][2];
+   unsigned n_events[4][2], n_alloced[4][2];
+} chunk_events_t;
+
+static int find_chunk_events( chunk_events_t *c, const double t0,
+             const double step, const int first_step, const int n_steps,
+             const unsigned sat_mask)
+{
+   EVENT_GRID grid;
+   double prev_delta[4][2];
+   int i, sat, viewpoint, rval;
+
+   memset( c, 0, sizeof( chunk_events_t));
+   rval = make_event_grid( &grid, t0, step, first_step, n_steps, sat_mask);
+   for( i = GRID_PAD; !rval && i <= GRID_PAD + n_steps; i++)
+      {
+      const double t = grid.sat_t0 + (double)i * step;
+      double planet_locs[6];
+
+      interpolate_planets( &grid, t, planet_locs);
+      for( sat = 0; sat < 4; sat++)
+         if( sat_mask & (1u << sat))
+            for( viewpoint = 0; viewpoint < 2; viewpoint++)
                {
-               show_event( stdout, e);
-               show_event( stdout, e + 1);
+               double delta[2];
+
+               sat_offsets( planet_locs, grid.sats + i * 15 + sat * 3,
+                                    viewpoint, delta);
+               if( i > GRID_PAD && delta[0] * prev_delta[sat][viewpoint] < 0.)
+                  {              /* zero crossed */
+                  event_search_t s;
+                  EVENT e[2];
+                  unsigned *n = &c->n_events[sat][viewpoint];
+
+                  s.grid = &grid;
+                  s.sat = sat;
+                  s.viewpoint = viewpoint;
+                  if( !rval && find_contacts( &s, t - step,
+                              prev_delta[sat][viewpoint], t, delta[0], e))
+                     {
+                     if( *n + 2 > c->n_alloced[sat][viewpoint])
+                        {     /* on failure,  the old array is kept, */
+                              /* and find_events( ) frees it          */
+                        const unsigned new_size = *n * 2 + 16;
+                        EVENT *new_events = (EVENT *)realloc(
+                                 c->events[sat][viewpoint],
+                                 new_size * sizeof( EVENT));
+
+                        if( !new_events)
+                           rval = -1;        /* out of memory */
+                        else
+                           {
+                           c->events[sat][viewpoint] = new_events;
+                           c->n_alloced[sat][viewpoint] = new_size;
+                           }
+                        }
+                     if( !rval)
+                        {
+                        memcpy( c->events[sat][viewpoint] + *n, e,
+                                                   2 * sizeof( EVENT));
+                        *n += 2;
+                        }
+                     }
+                  }
+               prev_delta[sat][viewpoint] = delta[0];
                }
-            e += 2;
-            rval += 2;
-            }
-         delta = 0.;
-         }
-      prev_delta = delta;
-      prev_delta_lat = delta_lat;
-      t += step;
       }
+   free_event_grid( &grid);
+   return( rval);
+}
+
+/* Finds all events between t1 and t2 for the satellites in 'sat_mask'.
+The returned array (which the caller must free) holds the events for
+each satellite in turn:  first those seen from the sun,  then those seen
+from the earth.  n_found[sat][viewpoint] tells you how many there are
+of each.  Returns NULL if memory runs out.  */
+
+static EVENT *find_events( const double t1, const double t2,
+                     const unsigned sat_mask, unsigned n_found[4][2])
+{
+   double step = 1.;
+   int i, n_steps, n_chunks, sat, viewpoint, err = 0;
+   chunk_events_t *chunks;
+   EVENT *rval = NULL;
+   unsigned n_total = 0;
+
+   for( sat = 3; sat >= 0; sat--)
+      if( sat_mask & (1u << sat))
+         step = SAT_STEP_DEGREES / speeds[sat];
+   n_steps = (int)ceil( (t2 - t1) / step);
+   n_chunks = (n_steps + STEPS_PER_CHUNK - 1) / STEPS_PER_CHUNK;
+   chunks = (chunk_events_t *)calloc( n_chunks + 1, sizeof( chunk_events_t));
+   if( !chunks)
+      return( NULL);
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( dynamic) reduction( |:err)
+#endif
+   for( i = 0; i < n_chunks; i++)
+      {
+      const int first_step = i * STEPS_PER_CHUNK;
+      const int n = (n_steps - first_step < STEPS_PER_CHUNK ?
+                        n_steps - first_step : STEPS_PER_CHUNK);
+
+      err |= find_chunk_events( chunks + i, t1, step, first_step, n, sat_mask);
+      }
+   for( sat = 0; sat < 4; sat++)
+      for( viewpoint = 0; viewpoint < 2; viewpoint++)
+         {
+         n_found[sat][viewpoint] = 0;
+         for( i = 0; i < n_chunks; i++)
+            n_found[sat][viewpoint] += chunks[i].n_events[sat][viewpoint];
+         n_total += n_found[sat][viewpoint];
+         }
+   if( !err)
+      rval = (EVENT *)malloc( (n_total + 1) * sizeof( EVENT));
+   n_total = 0;
+   for( sat = 0; sat < 4; sat++)
+      for( viewpoint = 0; viewpoint < 2; viewpoint++)
+         for( i = 0; i < n_chunks; i++)
+            {
+            const unsigned n = chunks[i].n_events[sat][viewpoint];
+
+            if( rval)
+               memcpy( rval + n_total, chunks[i].events[sat][viewpoint],
+                                    n * sizeof( EVENT));
+            n_total += n;
+            free( chunks[i].events[sat][viewpoint]);
+            }
+   free( chunks);
    return( rval);
 }
 
@@ -232,8 +595,7 @@ int main( int argc, char **argv)
 {
    unsigned i, julian = 0;
    unsigned n_days = 30, sat_no = 15;
-   unsigned max_events;
-   unsigned n_events = 0, n_sun, n_earth;
+   unsigned n_events = 0, n_sun, n_earth, n_found[4][2];
    double t1, t2;
    long jd;
    EVENT *e;
@@ -302,24 +664,29 @@ int main( int argc, char **argv)
             default:
                break;
             }
-                     /* We seem to average about eight events/day,  before */
-                     /* sorting and removing 'hidden' events.  But let's   */
-                     /* allow a little margin :                            */
-   max_events = n_days * 10 + 50;
-   e = (EVENT *)calloc( max_events, sizeof( EVENT));
-   if( !e)
-      return( -1);
    jd = dmy_to_day( 0, atoi( argv[2]), atol( argv[3]), (int)julian);
    t1 = (double)jd - .5 + atof( argv[1]);
    t2 = t1 + (double)n_days;
    printf( "JD %f to %f\n", t1, t2);
+   e = find_events( t1 - 1., t2 + 1., sat_no & 15, n_found);
+   if( !e)
+      {
+      fprintf( stderr, "Ran out of memory finding events\n");
+      return( -1);
+      }
    for( i = 0; i < 4; i++)
       if( sat_no & (1 << i))
          {
+         unsigned j;
+
+         n_sun = n_found[i][0];
+         n_earth = n_found[i][1];
          printf( "Sat %u from sun\n", i + 1);
-         n_sun = find_events( i + 1, t1 - 1., t2 + 1., 0, e + n_events);
+         for( j = 0; !quiet && j < n_sun; j++)
+            show_event( stdout, e + n_events + j);
          printf( "Sat %u from earth\n", i + 1);
-         n_earth = find_events( i + 1, t1 - 1., t2 + 1., 1, e + n_events + n_sun);
+         for( j = 0; !quiet && j < n_earth; j++)
+            show_event( stdout, e + n_events + n_sun + j);
          printf( "Finding hidden events\n");
          _mark_hidden_events( e + n_events, n_sun + n_earth);
          n_events += n_earth + n_sun;
@@ -361,5 +728,6 @@ int main( int argc, char **argv)
                }
       fclose( data_file);
       }
+   free( e);
    return( 0);
 }
@@ -45,7 +45,6 @@ ftp://ftp.imcce.fr/pub/ephem/satel/galilean/L1/L1.2/     */
 #define PI 3.1415926535897932384626433832795028841971693993751058209749445923
 #define DEG2RAD (PI / 180.)
 #define COEFF2RAD (PI / 180.e+5)
-#define PER (13.469942 * PI / 180.)
 #define J1900 ( 2451545. - 36525.)
 #define J2000   2451545.
 
@@ -59,29 +58,317 @@ ftp://ftp.imcce.fr/pub/ephem/satel/galilean/L1/L1.2/     */
 #define CUBIC_FUNC( A, B, C, D, t) (A * DEG2RAD + t * (B * DEG2RAD \
                         + t * (C * DEG2RAD + D * DEG2RAD * t)))
 
-static void rotate_vector( const double angle, double *x, double *y)
-{
-   const double sin_angle = sin( angle);
-   const double cos_angle = cos( angle);
-   const double temp = cos_angle * *x - sin_angle * *y;
+/* The series below are stored as tables of terms.  Each term is a
+coefficient times the sine (for longitudes and latitudes) or cosine (for
+radii) of an integer combination of the fundamental arguments of the
+theory,  plus (for the latitude terms) a multiple of the perturbation
+in longitude 'del',  plus a constant phase.  Doing it this way lets
+calc_jsat_loc( ) and calc_jsat_loc_grid( ) share one copy of the terms.
+
+   With one exception,  all fundamental arguments are linear in time.
+That exception is the mean anomaly of Jupiter,  'g',  which includes
+the small 'great inequality' gamma.  So the linear part of g is kept
+in the table,  and gamma is added in separately.
+
+   Summing the terms in a different order from the original code changes
+the roundoff,  so calc_jsat_loc( ) doesn't match it exactly.  Sampling
+every 0.37 day,  the largest difference found was 5.4e-11 Jovian radii
+within a century of J2000,  and 8.2e-10 within a millennium.   */
+
+#define JA_L1        0
+#define JA_L2        1
+#define JA_L3        2
+#define JA_L4        3
+#define JA_PI1       4
+#define JA_PI2       5
+#define JA_PI3       6
+#define JA_PI4       7
+#define JA_OME1      8
+#define JA_OME2      9
+#define JA_OME3     10
+#define JA_OME4     11
+#define JA_PSI      12
+#define JA_LIB      13
+#define JA_G        14
+#define JA_GP       15
+#define JA_PER      16
+#define N_JSAT_ARGS 17
+
+         /* Each fundamental argument is A + B * t,  with A in degrees and */
+         /* B in degrees/day,  t in days from 1976 Aug 10 0h TD.            */
+static const double jsat_args[N_JSAT_ARGS][2] = {
+                  /* mean longitudes of satellites, p 289: */
+       { 106.07719, 203.488955790 },
+       { 175.73161, 101.374724735 },
+       { 120.55883,  50.317609209 },
+       {  84.44459,  21.571071177 },
+                  /* longitudes of perijoves: */
+       {  97.0881, 0.16138586 },
+       { 154.8663, 0.04726307 },
+       { 188.1840, 0.00712734 },
+       { 335.2868, 0.00184000 },
+                  /* longitudes of ascending nodes */
+                  /* on Jupiter's equatorial plane: */
+       { 312.3346, -0.13279386 },
+       { 100.4411, -0.03263064 },
+       { 119.1942, -0.00717703 },
+       { 322.6168, -0.00175934 },
+      /* Longitude of the node of the equator of Jupiter on the ecliptic: */
+       { 316.5182, -2.08e-6 },
+         /* "There is a small libration, with a period of 2071 days,  in */
+         /* the longitudes of the three inner satellites: when satellite */
+         /* II decelerates,  I and III accelerate.  To take this into    */
+         /* account,  we need the phase of free libration..."            */
+       { 199.6766, 0.17379190 },
+      /* Mean anomalies of Jupiter (less gamma) and Saturn: */
+       {  30.23756, 0.0830925701 },
+       {  31.97853, 0.0334597339 },
+       {  13.469942, 0. } };          /* PER is constant */
 
-   *y = sin_angle * *x + cos_angle * *y;
-   *x = temp;
-}
+typedef struct
+{
+   double coeff, del_mult, phase;      /* phase is in degrees */
+   signed char arg[4], mult[4];
+} jsat_term_t;
+
+      /* Most terms involve no 'del' and no constant phase,  and have */
+      /* one to four arguments.  Unused slots have multiplier zero.   */
+#define T( c, a1, m1)                { c, 0., 0., { a1 }, { m1 } }
+#define T2( c, a1, m1, a2, m2)       { c, 0., 0., { a1, a2 }, { m1, m2 } }
+#define T3( c, a1, m1, a2, m2, a3, m3)  \
+                     { c, 0., 0., { a1, a2, a3 }, { m1, m2, m3 } }
+#define T4( c, a1, m1, a2, m2, a3, m3, a4, m4)  \
+                     { c, 0., 0., { a1, a2, a3, a4 }, { m1, m2, m3, m4 } }
+      /* Latitude terms in the true longitude lon = l + del : */
+#define D2( c, a1, m1, a2, m2)       { c, 1., 0., { a1, a2 }, { m1, m2 } }
+#define D3( c, a1, m1, a2, m2, a3, m3)  \
+                     { c, 1., 0., { a1, a2, a3 }, { m1, m2, m3 } }
+#define D4( c, a1, m1, a2, m2, a3, m3, a4, m4)  \
+                     { c, 1., 0., { a1, a2, a3, a4 }, { m1, m2, m3, m4 } }
 
 /* 28 Sep 2002:  Kazumi Akiyama pointed out two slightly wrong
    coefficients (marked 'KA fix' below).  These change the position
    of Europa by as much as 300 km (worst case),  of Callisto by
    as much as 3 km.
- */
 
-/* Formulae taken from Jean Meeus' _Astronomical Algorithms_.  WARNING:
-   the coordinates returned in the 'jsats' array are ecliptic Cartesian
-   coordinates of _date_,  not J2000 or B1950!  Units are Jovian radii.
-   Input time is in TD.                            */
+   NOTE: smaller terms omitted in all of the following!     */
+
+            /* Io : longitude (units of 1e-5 degree),  latitude,  radius */
+static const jsat_term_t io_del[] = {
+   T2( 47259., JA_L1, 2, JA_L2, -2),
+   T2( -3478., JA_PI3, 1, JA_PI4, -1),
+   T3(  1081., JA_L2, 1, JA_L3, -2, JA_PI3, 1),
+   T(    738., JA_LIB, 1),
+   T3(   713., JA_L2, 1, JA_L3, -2, JA_PI2, 1),
+   T4(  -674., JA_PI1, 1, JA_PI3, 1, JA_G, -2, JA_PER, -2),
+   T3(   666., JA_L2, 1, JA_L3, -2, JA_PI4, 1),
+   T2(   445., JA_L1, 1, JA_PI3, -1),
+   T2(  -354., JA_L1, 1, JA_L2, -1),
+   T2(  -317., JA_PSI, 2, JA_PER, -2),
+   T2(   265., JA_L1, 1, JA_PI4, -1),
+   T(   -186., JA_G, 1),
+   T2(   162., JA_PI2, 1, JA_PI3, -1),
+   T2(   158., JA_L1, 4, JA_L2, -4),
+   T2(  -155., JA_L1, 1, JA_L3, -1) };
+
+static const jsat_term_t io_lat[] = {
+   D2(  6393., JA_L1, 1, JA_OME1, -1),
+   D2(  1825., JA_L1, 1, JA_OME2, -1),
+   D2(   329., JA_L1, 1, JA_OME3, -1),
+   D2(   311., JA_L1, 1, JA_PSI, -1),
+   D2(    93., JA_L1, 1, JA_OME4, -1) };
+
+static const jsat_term_t io_rad[] = {
+   T2(-41339., JA_L1, 2, JA_L2, -2),
+   T2(  -387., JA_L1, 1, JA_PI1, -1),
+   T2(  -214., JA_L1, 1, JA_PI4, -1),
+   T2(   170., JA_L1, 1, JA_L2, -1),
+   T2(  -131., JA_L1, 4, JA_L2, -4),
+   T2(   106., JA_L1, 1, JA_L3, -1) };
+
+            /* Europa */
+static const jsat_term_t europa_del[] = {
+   T2(106476., JA_L2, 2, JA_L3, -2),
+   T3(  4256., JA_L1, 1, JA_L2, -2, JA_PI3, 1),
+   T2(  3581., JA_L2, 1, JA_PI3, -1),
+   T3(  2395., JA_L1, 1, JA_L2, -2, JA_PI4, 1),
+   T2(  1984., JA_L2, 1, JA_PI4, -1),
+   T(  -1778., JA_LIB, 1),
+   T2(  1654., JA_L2, 1, JA_PI2, -1),
+   T3(  1334., JA_L2, 1, JA_L3, -2, JA_PI2, 1),
+   T2(  1294., JA_PI3, 1, JA_PI4, -1),       /* KA fix */
+   T2( -1142., JA_L2, 1, JA_L3, -1),
+   T(  -1057., JA_G, 1),
+   T2(  -775., JA_PSI, 2, JA_PER, -2),
+   T2(   524., JA_L1, 2, JA_L2, -2),
+   T2(  -460., JA_L1, 1, JA_L3, -1),
+   T4(   316., JA_PSI, 1, JA_OME3, 1, JA_G, -2, JA_PER, -2),
+   T4(  -203., JA_PI1, 1, JA_PI3, 1, JA_G, -2, JA_PER, -2),
+   T2(   146., JA_PSI, 1, JA_OME3, -1),
+   T(   -145., JA_G, 2),
+   T2(   125., JA_PSI, 1, JA_OME4, -1),
+   T3(  -115., JA_L1, 1, JA_L3, -2, JA_PI3, 1),
+   T2(   -94., JA_L2, 2, JA_OME2, -2) };
+
+static const jsat_term_t europa_lat[] = {
+   D2( 81004., JA_L2, 1, JA_OME2, -1),
+   D2(  4512., JA_L2, 1, JA_OME3, -1),
+   D2( -3284., JA_L2, 1, JA_PSI, -1),
+   D2(  1160., JA_L2, 1, JA_OME4, -1),
+   { 272., 1.0146, 0., { JA_L1, JA_L3, JA_OME2 }, { 1, -2, 1 } },
+   D2(  -144., JA_L2, 1, JA_OME1, -1),
+   D4(   143., JA_L2, 1, JA_PSI, 1, JA_G, -2, JA_PER, -2) };
+
+static const jsat_term_t europa_rad[] = {
+   T2( 93848., JA_L1, 1, JA_L2, -1),
+   T2( -3116., JA_L2, 1, JA_PI3, -1),
+   T2( -1744., JA_L2, 1, JA_PI4, -1),
+   T2( -1442., JA_L2, 1, JA_PI2, -1),
+   T2(   553., JA_L2, 1, JA_L3, -1),
+   T2(   523., JA_L1, 1, JA_L3, -1),
+   T2(  -290., JA_L1, 2, JA_L2, -2),
+   T2(   164., JA_L2, 2, JA_OME2, -2),
+   T3(   107., JA_L1, 1, JA_L3, -2, JA_PI3, 1),
+   T2(  -102., JA_L2, 1, JA_PI1, -1),
+   T2(   -91., JA_L1, 2, JA_L3, -2) };
+
+            /* Ganymede */
+static const jsat_term_t ganymede_del[] = {
+   T2( 16490., JA_L3, 1, JA_PI3, -1),
+   T2(  9081., JA_L3, 1, JA_PI4, -1),
+   T2( -6907., JA_L2, 1, JA_L3, -1),
+   T2(  3784., JA_PI3, 1, JA_PI4, -1),
+   T2(  1846., JA_L3, 2, JA_L4, -2),
+   T(  -1340., JA_G, 1),
+   T2( -1014., JA_PSI, 2, JA_PER, -2),
+   T3(   704., JA_L2, 1, JA_L3, -2, JA_PI3, 1),
+   T3(  -620., JA_L2, 1, JA_L3, -2, JA_PI2, 1),
+   T2(  -541., JA_L3, 1, JA_L4, -1),
+   T3(   381., JA_L2, 1, JA_L3, -2, JA_PI4, 1),
+   T2(   235., JA_PSI, 1, JA_OME3, -1),
+   T2(   198., JA_PSI, 1, JA_OME4, -1),
+   T(    176., JA_LIB, 1),
+   T2(   130., JA_L3, 3, JA_L4, -3),
+   T2(   125., JA_L1, 1, JA_L3, -1),
+   { -119., 0., 52.225, { JA_GP, JA_G }, { 5, -2 } },
+   T2(   109., JA_L1, 1, JA_L2, -1),
+   T3(  -100., JA_L3, 3, JA_L4, -7, JA_PI4, 4),
+   T2(    91., JA_OME3, 1, JA_OME4, -1),
+   T4(    80., JA_L3, 3, JA_L4, -7, JA_PI3, 1, JA_PI4, 3),
+   T3(   -75., JA_L2, 2, JA_L3, -3, JA_PI3, 1),
+   T4(    72., JA_PI1, 1, JA_PI3, 1, JA_G, -2, JA_PER, -2),
+   T2(    69., JA_PI4, 1, JA_PER, -1),
+   T3(   -58., JA_L3, 2, JA_L4, -3, JA_PI4, 1),
+   T3(   -57., JA_L3, 1, JA_L4, -2, JA_PI4, 1),
+   T4(    56., JA_L3, 1, JA_PI3, 1, JA_G, -2, JA_PER, -2),
+   T3(   -52., JA_L2, 1, JA_L3, -2, JA_PI1, 1),
+   T2(   -50., JA_PI2, 1, JA_PI3, -1) };
+
+static const jsat_term_t ganymede_lat[] = {
+   D2( 32402., JA_L3, 1, JA_OME3, -1),
+   D2(-16911., JA_L3, 1, JA_PSI, -1),
+   D2(  6847., JA_L3, 1, JA_OME4, -1),
+   D2( -2797., JA_L3, 1, JA_OME2, -1),
+   D4(   321., JA_L3, 1, JA_PSI, 1, JA_G, -2, JA_PER, -2),
+   D3(    51., JA_L3, 1, JA_PSI, -1, JA_G, 1),
+   D3(   -45., JA_L3, 1, JA_PSI, -1, JA_G, -1),
+   D3(   -45., JA_L3, 1, JA_PSI, -1, JA_PER, -2) };
+
+static const jsat_term_t ganymede_rad[] = {
+   T2(-14388., JA_L3, 1, JA_PI3, -1),
+   T2( -7919., JA_L3, 1, JA_PI4, -1),
+   T2(  6342., JA_L2, 1, JA_L3, -1),
+   T2( -1761., JA_L3, 2, JA_L4, -2),
+   T2(   294., JA_L3, 1, JA_L4, -1),
+   T2(  -156., JA_L3, 3, JA_L4, -3),
+   T2(   156., JA_L1, 1, JA_L3, -1),
+   T2(  -153., JA_L1, 1, JA_L2, -1),
+   T3(   -70., JA_L2, 2, JA_L3, -3, JA_PI3, 1) };
+
+            /* Callisto */
+static const jsat_term_t callisto_del[] = {
+   T2( 84287., JA_L4, 1, JA_PI4, -1),
+   T2(  3431., JA_PI4, 1, JA_PI3, -1),
+   T2( -3305., JA_PSI, 2, JA_PER, -2),
+   T(  -3211., JA_G, 1),
+   T2( -1862., JA_L4, 1, JA_PI3, -1),
+   T2(  1186., JA_PSI, 1, JA_OME4, -1),
+   T4(   623., JA_L4, 1, JA_PI4, 1, JA_G, -2, JA_PER, -2),
+   T2(   387., JA_L4, 2, JA_PI4, -2),
+   { -284., 0., 52.225, { JA_GP, JA_G }, { 5, -2 } },
+   T2(  -234., JA_PSI, 2, JA_PI4, -2),
+   T2(  -223., JA_L3, 1, JA_L4, -1),        /* KA fix */
+   T2(  -208., JA_L4, 1, JA_PER, -1),
+   T3(   178., JA_PSI, 1, JA_OME4, 1, JA_PI4, -2),
+   T2(   134., JA_PI4, 1, JA_PER, -1),
+   T3(   125., JA_L4, 2, JA_G, -2, JA_PER, -2),
+   T(   -117., JA_G, 2),
+   T2(  -112., JA_L3, 2, JA_L4, -2) };
+
+static const jsat_term_t callisto_lat[] = {
+   D2(-76579., JA_L4, 1, JA_PSI, -1),
+   D2( 44134., JA_L4, 1, JA_OME4, -1),
+   D2( -5112., JA_L4, 1, JA_OME3, -1),
+   D4(   773., JA_L4, 1, JA_PSI, 1, JA_G, -2, JA_PER, -2),
+   D3(   104., JA_L4, 1, JA_PSI, -1, JA_G, 1),
+   D3(  -102., JA_L4, 1, JA_PSI, -1, JA_G, -1),
+   D4(    88., JA_L4, 1, JA_PSI, 1, JA_G, -3, JA_PER, -2),
+   D4(   -38., JA_L4, 1, JA_PSI, 1, JA_G, -1, JA_PER, -2) };
+
+static const jsat_term_t callisto_rad[] = {
+   T2(-73546., JA_L4, 1, JA_PI4, -1),
+   T2(  1621., JA_L4, 1, JA_PI3, -1),
+   T2(   974., JA_L3, 1, JA_L4, -1),
+   T4(  -543., JA_L4, 1, JA_PI4, 1, JA_G, -2, JA_PER, -2),
+   T2(  -271., JA_L4, 2, JA_PI4, -2),
+   T2(   182., JA_L4, 1, JA_PER, -1),
+   T2(   177., JA_L3, 2, JA_L4, -2),
+   T3(  -167., JA_L4, 2, JA_PSI, -1, JA_OME4, -1),
+   T2(   167., JA_PSI, 1, JA_OME4, -1),
+   T3(  -155., JA_L4, 2, JA_G, -2, JA_PER, -2),
+   T2(   142., JA_L4, 2, JA_PSI, -2),
+   T2(   105., JA_L1, 1, JA_L4, -1),
+   T2(    92., JA_L2, 1, JA_L4, -1),
+   T3(   -89., JA_L4, 1, JA_PER, -1, JA_G, -1),
+   T4(   -62., JA_L4, 1, JA_PI4, 1, JA_G, -3, JA_PER, -2),
+   T2(    48., JA_L4, 2, JA_OME4, -2) };
+
+#undef T
+#undef T2
+#undef T3
+#undef T4
+#undef D2
+#undef D3
+#undef D4
+
+typedef struct
+{
+   const jsat_term_t *terms;
+   int n_terms;
+} jsat_series_t;
 
-int DLL_FUNC calc_jsat_loc( const double jd, double DLLPTR *jsats,
-                         const int sats_wanted, const long precision)
+#define SERIES( x)  { x, (int)( sizeof( x) / sizeof( x[0])) }
+
+            /* For each satellite:  longitude,  latitude,  radius series */
+static const jsat_series_t jsat_series[4][3] = {
+       { SERIES( io_del),       SERIES( io_lat),       SERIES( io_rad) },
+       { SERIES( europa_del),   SERIES( europa_lat),   SERIES( europa_rad) },
+       { SERIES( ganymede_del), SERIES( ganymede_lat), SERIES( ganymede_rad) },
+       { SERIES( callisto_del), SERIES( callisto_lat), SERIES( callisto_rad) } };
+
+#define MAX_JSAT_TERMS 200
+
+/* Things that depend only on the epoch,  shared by all four satellites :
+the fundamental arguments,  gamma,  and sines and cosines of the angles
+by which we rotate to ecliptic coordinates of date.  */
+
+typedef struct
+{
+   double args[N_JSAT_ARGS], gam;
+   double rot_sin[4], rot_cos[4];
+} jsat_epoch_t;
+
+static void setup_jsat_epoch( jsat_epoch_t *e, const double jd)
 {
    const double t = jd - 2443000.5;          /* 1976 aug 10, 0:00 TD */
                /* calc precession since B1950 epoch */
@@ -89,24 +376,6 @@ int DLL_FUNC calc_jsat_loc( const double jd, double DLLPTR *jsats,
    const double precession =
               LINEAR_FUNC( 1.3966626, .0003088, precess_time) * precess_time;
    const double dt = (jd - J2000) / 36525.;
-                  /* mean longitudes of satellites, p 289: */
-   const double l1 = LINEAR_FUNC( 106.07719, 203.488955790, t);
-   const double l2 = LINEAR_FUNC( 175.73161, 101.374724735, t);
-   const double l3 = LINEAR_FUNC( 120.55883,  50.317609209, t);
-   const double l4 = LINEAR_FUNC(  84.44459,  21.571071177, t);
-
-                  /* longitudes of perijoves: */
-   const double pi1 = LINEAR_FUNC(  97.0881, 0.16138586, t);
-   const double pi2 = LINEAR_FUNC( 154.8663, 0.04726307, t);
-   const double pi3 = LINEAR_FUNC( 188.1840, 0.00712734, t);
-   const double pi4 = LINEAR_FUNC( 335.2868, 0.00184000, t);
-
-                  /* longitudes of ascending nodes */
-                  /* on Jupiter's equatorial plane: */
-   const double ome1 = LINEAR_FUNC( 312.3346, -0.13279386, t);
-   const double ome2 = LINEAR_FUNC( 100.4411, -0.03263064, t);
-   const double ome3 = LINEAR_FUNC( 119.1942, -0.00717703, t);
-   const double ome4 = LINEAR_FUNC( 322.6168, -0.00175934, t);
          /* Longitude of Jupiter's ascending node;  p. 213 */
          /* (table 31A)                                    */
    const double asc_node = CUBIC_FUNC( 100.464407, 1.0209774, .00040315, 4.04e-7, dt);
@@ -115,247 +384,321 @@ int DLL_FUNC calc_jsat_loc( const double jd, double DLLPTR *jsats,
          /* gam = Gamma, principal inequality in the longitude of Jupiter */
    const double temp1 = LINEAR_FUNC( 163.679,  0.0010512, t);
    const double temp2 = LINEAR_FUNC(  34.486, -0.0161731, t);
-   const double gam = 0.33033 * DEG2RAD * sin( temp1) + 0.03439 * DEG2RAD * sin( temp2);
-         /* "There is a small libration, with a period of 2071 days,  in */
-         /* the longitudes of the three inner satellites: when satellite */
-         /* II decelerates,  I and III accelerate.  To take this into    */
-         /* account,  we need the phase of free libration..."            */
-   const double libration = LINEAR_FUNC( 199.6766, 0.17379190, t);
-      /* Longitude of the node of the equator of Jupiter on the ecliptic: */
-   const double psi = LINEAR_FUNC( 316.5182, -2.08e-6, t);
-      /* Mean anomalies of Jupiter and Saturn: */
-   const double g = LINEAR_FUNC( 30.23756, 0.0830925701, t) + gam;
-   const double g_prime = LINEAR_FUNC( 31.97853, 0.0334597339, t);
-   const double twice_per_plus_g = 2. * g + 2. * PER;
               /* Inclination of Jupiter's axis to its orbital plane: */
    const double incl = LINEAR_FUNC( 3.120262, .0006, (jd - J1900) / 36525.);
-   double lon[5], tan_lat[5], rad[5];
-   double loc[18];
+   double rot_angle[4];
    int i;
 
-   INTENTIONALLY_UNUSED_PARAMETER( precision);
-   for( i = 1; i < 5; i++)
-      lon[i] = tan_lat[i] = rad[i] = 0.;
-
-   if( sats_wanted & 1)       /* Io */
-      {                       /* NOTE: smaller terms omitted here! */
-      const double del1 =
-               47259. * COEFF2RAD * sin( 2. * (l1 - l2))
-               -3478. * COEFF2RAD * sin( pi3 - pi4)
-               +1081. * COEFF2RAD * sin( l2 - 2. * l3 + pi3)
-               + 738. * COEFF2RAD * sin( libration)
-               + 713. * COEFF2RAD * sin( l2 - l3 - l3 + pi2)
-               - 674. * COEFF2RAD * sin( pi1 + pi3 - twice_per_plus_g)
-               + 666. * COEFF2RAD * sin( l2 - 2. * l3 + pi4)
-               + 445. * COEFF2RAD * sin( l1 - pi3)
-               - 354. * COEFF2RAD * sin( l1 - l2)
-               - 317. * COEFF2RAD * sin( 2. * psi - 2. * PER)
-               + 265. * COEFF2RAD * sin( l1 - pi4)
-               - 186. * COEFF2RAD * sin( g)
-               + 162. * COEFF2RAD * sin( pi2 - pi3)
-               + 158. * COEFF2RAD * sin( 4. * (l1 - l2))
-               - 155. * COEFF2RAD * sin( l1 - l3);
-
-      lon[1] = l1 + del1;
-      tan_lat[1] = 6393.e-7 * sin( lon[1] - ome1)
-             + 1825.e-7 * sin( lon[1] - ome2)
-             +  329.e-7 * sin( lon[1] - ome3)
-             +  311.e-7 * sin( lon[1] - psi)
-             +   93.e-7 * sin( lon[1] - ome4);
-      rad[1] = -41339.e-7 * cos( 2. * (l1 - l2))
-               -  387.e-7 * cos( l1 - pi1)
-               -  214.e-7 * cos( l1 - pi4)
-               +  170.e-7 * cos( l1 - l2)
-               -  131.e-7 * cos( 4. * (l1 - l2))
-               +  106.e-7 * cos( l1 - l3);
+   for( i = 0; i < N_JSAT_ARGS; i++)
+      e->args[i] = LINEAR_FUNC( jsat_args[i][0], jsat_args[i][1], t);
+   e->gam = 0.33033 * DEG2RAD * sin( temp1) + 0.03439 * DEG2RAD * sin( temp2);
+   rot_angle[0] = incl;           /* rotate to plane of Jup's orbit */
+                                  /* rotate to Jup's ascending node */
+   rot_angle[1] = e->args[JA_PSI] + precession - asc_node;
+   rot_angle[2] = incl_orbit;     /* rotate to the ecliptic */
+   rot_angle[3] = asc_node;       /* rotate to vernal equinox */
+   for( i = 0; i < 4; i++)
+      {
+      e->rot_sin[i] = sin( rot_angle[i]);
+      e->rot_cos[i] = cos( rot_angle[i]);
       }
+}
 
-   if( sats_wanted & 2)       /* europa */
-      {                       /* NOTE: smaller terms omitted here! */
-      const double del2 =
-               106476. * COEFF2RAD * sin( 2. * (l2 - l3))
-                +4256. * COEFF2RAD * sin( l1 - l2 - l2 + pi3)
-                +3581. * COEFF2RAD * sin( l2 - pi3)
-                +2395. * COEFF2RAD * sin( l1 - l2 - l2 + pi4)
-                +1984. * COEFF2RAD * sin( l2 - pi4)
-                -1778. * COEFF2RAD * sin( libration)
-                +1654. * COEFF2RAD * sin( l2 - pi2)
-                +1334. * COEFF2RAD * sin( l2 - l3 - l3 + pi2)
-                +1294. * COEFF2RAD * sin( pi3 - pi4)    /* KA fix */
-                -1142. * COEFF2RAD * sin( l2 - l3)
-                -1057. * COEFF2RAD * sin( g)
-                - 775. * COEFF2RAD * sin( 2. * ( psi - PER))
-                + 524. * COEFF2RAD * sin( 2. * (l1 - l2))
-                - 460. * COEFF2RAD * sin( l1 - l3)
-                + 316. * COEFF2RAD * sin( psi + ome3 - twice_per_plus_g)
-                - 203. * COEFF2RAD * sin( pi1 + pi3 - twice_per_plus_g)
-                + 146. * COEFF2RAD * sin( psi - ome3)
-                - 145. * COEFF2RAD * sin( g + g)
-                + 125. * COEFF2RAD * sin( psi - ome4)
-                - 115. * COEFF2RAD * sin( l1 - 2. * l3 + pi3)
-                -  94. * COEFF2RAD * sin( 2. * (l2 - ome2));
-
-      lon[2] = l2 + del2;
-      tan_lat[2] = 81004.e-7 * sin( lon[2] - ome2)
-               +4512.e-7 * sin( lon[2] - ome3)
-               -3284.e-7 * sin( lon[2] - psi)
-               +1160.e-7 * sin( lon[2] - ome4)
-               + 272.e-7 * sin( l1 - 2. * l3 + 1.0146 * del2 + ome2)
-               - 144.e-7 * sin( lon[2] - ome1)
-               + 143.e-7 * sin( lon[2] + psi - twice_per_plus_g);
-      rad[2] = 93848.e-7 * cos( l1 - l2)
-               -3116.e-7 * cos( l2 - pi3)
-               -1744.e-7 * cos( l2 - pi4)
-               -1442.e-7 * cos( l2 - pi2)
-               + 553.e-7 * cos( l2 - l3)
-               + 523.e-7 * cos( l1 - l3)
-               - 290.e-7 * cos( 2. * (l1 - l2))
-               + 164.e-7 * cos( 2. * (l2 - ome2))
-               + 107.e-7 * cos( l1 - 2. * l3 + pi3)
-               - 102.e-7 * cos( l2 - pi1)
-               -  91.e-7 * cos( 2. * (l1 - l3));
-      }
+/* Argument of a term,  less the 'del' part,  and with g lacking gamma. */
 
-   if( sats_wanted & 4)       /* ganymede */
-      {                       /* NOTE: smaller terms omitted here! */
-      const double del3 =
-               16490. * COEFF2RAD * sin( l3 - pi3)
-               +9081. * COEFF2RAD * sin( l3 - pi4)
-               -6907. * COEFF2RAD * sin( l2 - l3)
-               +3784. * COEFF2RAD * sin( pi3 - pi4)
-               +1846. * COEFF2RAD * sin( 2. * (l3 - l4))
-               -1340. * COEFF2RAD * sin( g)
-               -1014. * COEFF2RAD * sin( 2. * ( psi - PER))
-               + 704. * COEFF2RAD * sin( l2 - l3 - l3 + pi3)
-               - 620. * COEFF2RAD * sin( l2 - l3 - l3 + pi2)
-               - 541. * COEFF2RAD * sin( l3 - l4)
-               + 381. * COEFF2RAD * sin( l2 - l3 - l3 + pi4)
-               + 235. * COEFF2RAD * sin( psi - ome3)
-               + 198. * COEFF2RAD * sin( psi - ome4)
-               + 176. * COEFF2RAD * sin( libration)
-               + 130. * COEFF2RAD * sin( 3. * (l3 - l4))
-               + 125. * COEFF2RAD * sin( l1 - l3)
-               - 119. * COEFF2RAD * sin( 5. * g_prime - 2. * g + 52.225 * DEG2RAD)
-               + 109. * COEFF2RAD * sin( l1 - l2)
-               - 100. * COEFF2RAD * sin( 3. * l3 - 7. * l4 + 4. * pi4)
-               +  91. * COEFF2RAD * sin( ome3 - ome4)
-               +  80. * COEFF2RAD * sin( 3. * l3 - 7. * l4 + pi3 + 3. * pi4)
-               -  75. * COEFF2RAD * sin( 2. * l2 - 3. * l3 + pi3)
-               +  72. * COEFF2RAD * sin( pi1 + pi3 - twice_per_plus_g)
-               +  69. * COEFF2RAD * sin( pi4 - PER)
-               -  58. * COEFF2RAD * sin( 2. * l3 - 3. * l4 + pi4)
-               -  57. * COEFF2RAD * sin( l3 - 2. * l4 + pi4)
-               +  56. * COEFF2RAD * sin( l3 + pi3 - twice_per_plus_g)
-               -  52. * COEFF2RAD * sin( l2 - 2. * l3 + pi1)
-               -  50. * COEFF2RAD * sin( pi2 - pi3);
-
-      lon[3] = l3 + del3;
-      tan_lat[3] = 32402.e-7 * sin( lon[3] - ome3)
-              -16911.e-7 * sin( lon[3] - psi)
-               +6847.e-7 * sin( lon[3] - ome4)
-               -2797.e-7 * sin( lon[3] - ome2)
-               + 321.e-7 * sin( lon[3] + psi - twice_per_plus_g)
-               +  51.e-7 * sin( lon[3] - psi + g)
-               -  45.e-7 * sin( lon[3] - psi - g)
-               -  45.e-7 * sin( lon[3] - psi - 2. * PER);
-      rad[3] = -14388.e-7 * cos( l3 - pi3)
-                -7919.e-7 * cos( l3 - pi4)
-                +6342.e-7 * cos( l2 - l3)
-                -1761.e-7 * cos( 2. * (l3 - l4))
-                + 294.e-7 * cos( l3 - l4)
-                - 156.e-7 * cos( 3. * (l3 - l4))
-                + 156.e-7 * cos( l1 - l3)
-                - 153.e-7 * cos( l1 - l2)
-                -  70.e-7 * cos( 2. * l2 - 3. * l3 + pi3);
-      }
+static double jsat_term_linear_arg( const jsat_term_t *term, const double *args)
+{
+   double rval = term->phase * DEG2RAD;
+   int i;
+
+   for( i = 0; i < 4 && term->mult[i]; i++)
+      rval += (double)term->mult[i] * args[(int)term->arg[i]];
+   return( rval);
+}
 
-   if( sats_wanted & 8)       /* callisto */
-      {                       /* NOTE: smaller terms omitted here! */
-      const double del4 =
-               84287. * COEFF2RAD * sin( l4 - pi4)
-              + 3431. * COEFF2RAD * sin( pi4 - pi3)
-              - 3305. * COEFF2RAD * sin( 2. * (psi - PER))
-              - 3211. * COEFF2RAD * sin( g)
-              - 1862. * COEFF2RAD * sin( l4 - pi3)
-              + 1186. * COEFF2RAD * sin( psi - ome4)
-              +  623. * COEFF2RAD * sin( l4 + pi4 - twice_per_plus_g)
-              +  387. * COEFF2RAD * sin( 2. * (l4 - pi4))
-              -  284. * COEFF2RAD * sin( 5. * g_prime - 2. * g + 52.225 * DEG2RAD)
-              -  234. * COEFF2RAD * sin( 2. * (psi - pi4))
-              -  223. * COEFF2RAD * sin( l3 - l4)         /* KA fix */
-              -  208. * COEFF2RAD * sin( l4 - PER)
-              +  178. * COEFF2RAD * sin( psi + ome4 - 2. * pi4)
-              +  134. * COEFF2RAD * sin( pi4 - PER)
-              +  125. * COEFF2RAD * sin( 2. * l4 - twice_per_plus_g)
-              -  117. * COEFF2RAD * sin( 2. * g)
-              -  112. * COEFF2RAD * sin( 2. * (l3 - l4));
-
-      lon[4] = l4 + del4;
-      tan_lat[4] = - 76579.e-7 * sin( lon[4] - psi)
-               + 44134.e-7 * sin( lon[4] - ome4)
-               -  5112.e-7 * sin( lon[4] - ome3)
-               +   773.e-7 * sin( lon[4] + psi - twice_per_plus_g)
-               +   104.e-7 * sin( lon[4] - psi + g)
-               -   102.e-7 * sin( lon[4] - psi - g)
-               +    88.e-7 * sin( lon[4] + psi - twice_per_plus_g - g)
-               -    38.e-7 * sin( lon[4] + psi - twice_per_plus_g + g);
-      rad[4] = -73546.e-7 * cos( l4 - pi4)
-                +1621.e-7 * cos( l4 - pi3)
-                + 974.e-7 * cos( l3 - l4)
-                - 543.e-7 * cos( l4 + pi4 - twice_per_plus_g)
-                - 271.e-7 * cos( 2. * (l4 - pi4))
-                + 182.e-7 * cos( l4 - PER)
-                + 177.e-7 * cos( 2. * (l3 - l4))
-                - 167.e-7 * cos( 2. * l4 - psi - ome4)
-                + 167.e-7 * cos( psi - ome4)
-                - 155.e-7 * cos( 2. * l4 - twice_per_plus_g)
-                + 142.e-7 * cos( 2. * (l4 - psi))
-                + 105.e-7 * cos( l1 - l4)
-                +  92.e-7 * cos( l2 - l4)
-                -  89.e-7 * cos( l4 - PER - g)
-                -  62.e-7 * cos( l4 + pi4 - twice_per_plus_g - g)
-                +  48.e-7 * cos( 2. * (l4 - ome4));
+static int gamma_multiple( const jsat_term_t *term)
+{
+   int i;
+
+   for( i = 0; i < 4 && term->mult[i]; i++)
+      if( term->arg[i] == JA_G)
+         return( term->mult[i]);
+   return( 0);
+}
+
+static double sum_jsat_series( const jsat_series_t *series,
+               const jsat_epoch_t *e, const double del, const bool use_cos)
+{
+   double rval = 0.;
+   int i;
+
+   for( i = 0; i < series->n_terms; i++)
+      {
+      const jsat_term_t *term = series->terms + i;
+      const double arg = jsat_term_linear_arg( term, e->args)
+                  + (double)gamma_multiple( term) * e->gam + term->del_mult * del;
+
+      rval += term->coeff * (use_cos ? cos( arg) : sin( arg));
       }
+   return( rval);
+}
 
-   for( i = 0; i < 15; i++)
-      loc[i] = 0.;
-   for( i = 1; i < 6; i++)
-      if( sats_wanted & (1 << (i - 1)))
-         {
-         double FAR *tptr = (double FAR *)loc + (i - 1) * 3;
+static void rotate_vector_sc( const double sin_angle, const double cos_angle,
+                                 double *x, double *y)
+{
+   const double temp = cos_angle * *x - sin_angle * *y;
 
-                                    /* calc coords by Jupiter's equator */
-         if( i != 5)
-            {
-            static const double r0[4] = { 5.90569, 9.39657, 14.98832, 26.36273 };
-            const double csc_lat = sqrt( 1. + tan_lat[i] * tan_lat[i]);
-            const double r = r0[i - 1] * (1. + rad[i]);
+   *y = sin_angle * *x + cos_angle * *y;
+   *x = temp;
+}
 
-            tptr[0] = r * cos( lon[i] - psi) / csc_lat;
-            tptr[1] = r * sin( lon[i] - psi) / csc_lat;
-            tptr[2] = r * tan_lat[i] / csc_lat;
-            }
-         else
-            tptr[2] = 1.;     /* fictitious fifth satellite */
+/* Given the satellite's true longitude,  tangent of latitude,  and radius
+perturbation,  get ecliptic coords of date.  Satellite 4 is the fictitious
+fifth satellite,  on Jupiter's axis.   */
 
+static void jsat_to_ecliptic( double *tptr, const jsat_epoch_t *e,
+         const int sat, const double lon, const double tan_lat, const double rad)
+{
+   if( sat != 4)
+      {
+      static const double r0[4] = { 5.90569, 9.39657, 14.98832, 26.36273 };
+      const double csc_lat = sqrt( 1. + tan_lat * tan_lat);
+      const double r = r0[sat] * (1. + rad);
+
+      tptr[0] = r * cos( lon - e->args[JA_PSI]) / csc_lat;
+      tptr[1] = r * sin( lon - e->args[JA_PSI]) / csc_lat;
+      tptr[2] = r * tan_lat / csc_lat;
+      }
+   else
+      {
+      tptr[0] = tptr[1] = 0.;
+      tptr[2] = 1.;     /* fictitious fifth satellite */
+      }
                             /* rotate to plane of Jup's orbit: */
-         rotate_vector( incl, tptr + 1, tptr + 2);
+   rotate_vector_sc( e->rot_sin[0], e->rot_cos[0], tptr + 1, tptr + 2);
                             /* rotate to Jup's ascending node: */
-         rotate_vector( psi + precession - asc_node, tptr, tptr + 1);
+   rotate_vector_sc( e->rot_sin[1], e->rot_cos[1], tptr, tptr + 1);
                             /* rotate to the ecliptic */
-         rotate_vector( incl_orbit, tptr + 1, tptr + 2);
+   rotate_vector_sc( e->rot_sin[2], e->rot_cos[2], tptr + 1, tptr + 2);
                             /* rotate to vernal equinox.  This results */
                             /* in ecliptic coords of date.  In Meeus,  */
                             /* topo[0...2] will be A4, B4, C4.         */
-         rotate_vector( asc_node, tptr, tptr + 1);
+   rotate_vector_sc( e->rot_sin[3], e->rot_cos[3], tptr, tptr + 1);
                             /* Meeus does further rotations to get into */
                             /* a system in which the z-axis points from */
                             /* earth to Jupiter and y points along the  */
                             /* rotation axis of Jupiter.  We don't need */
                             /* any of that here.                        */
+}
+
+/* Formulae taken from Jean Meeus' _Astronomical Algorithms_.  WARNING:
+   the coordinates returned in the 'jsats' array are ecliptic Cartesian
+   coordinates of _date_,  not J2000 or B1950!  Units are Jovian radii.
+   Input time is in TD.                            */
+
+int DLL_FUNC calc_jsat_loc( const double jd, double DLLPTR *jsats,
+                         const int sats_wanted, const long precision)
+{
+   jsat_epoch_t e;
+   double loc[15];
+   int i;
+
+   INTENTIONALLY_UNUSED_PARAMETER( precision);
+   setup_jsat_epoch( &e, jd);
+   for( i = 0; i < 15; i++)
+      loc[i] = 0.;
+   for( i = 0; i < 5; i++)
+      if( sats_wanted & (1 << i))
+         {
+         double del = 0., tan_lat = 0., rad = 0.;
+
+         if( i != 4)
+            {
+            del = sum_jsat_series( &jsat_series[i][0], &e, 0., false) * COEFF2RAD;
+            tan_lat = sum_jsat_series( &jsat_series[i][1], &e, del, false) * 1e-7;
+            rad = sum_jsat_series( &jsat_series[i][2], &e, del, true) * 1e-7;
+            }
+         jsat_to_ecliptic( loc + i * 3, &e, i, e.args[JA_L1 + i] + del,
+                                    tan_lat, rad);
          }
    FMEMCPY( jsats, loc, 12 * sizeof( double));
    if( sats_wanted & 16)      /* imaginary sat wanted */
       FMEMCPY( jsats + 12, loc + 12, 3 * sizeof( double));
    return( sats_wanted);
 }
+
+/* calc_jsat_loc_grid( ) computes the same positions as calc_jsat_loc( ),
+for 'n_steps' evenly spaced times jd0,  jd0 + step,  jd0 + 2 * step...
+Output is fifteen doubles per time (five satellites,  fictitious fifth
+one included;  zeroes for those not wanted).
+
+   Since every term's argument is linear in time,  except for the 'gamma'
+and 'del' parts,  the sine and cosine of the linear part can be stepped
+along by rotating through a fixed angle,  which costs four multiplies
+and two adds instead of a sin( ).  Gamma and 'del' are then folded in
+with the angle-addition formulae.  To keep roundoff from accumulating,
+the sines/cosines are recomputed directly every JSAT_RESYNC steps.  The
+grid is processed in blocks,  in parallel if OpenMP is enabled.   */
+
+#define JSAT_RESYNC       128
+#define JSAT_BLOCK_SIZE  4096
+
+typedef struct
+{
+   double sin_arg, cos_arg, sin_step, cos_step;
+} recurrence_t;
+
+static void init_jsat_recurrences( recurrence_t *rec, const double jd,
+                                   const double step)
+{
+   jsat_epoch_t e, e_rates;
+   int i, j, k;
+
+   setup_jsat_epoch( &e, jd);
+   for( i = 0; i < N_JSAT_ARGS; i++)
+      e_rates.args[i] = jsat_args[i][1] * DEG2RAD * step;
+   for( i = 0; i < 4; i++)
+      for( j = 0; j < 3; j++)
+         for( k = 0; k < jsat_series[i][j].n_terms; k++)
+            {
+            const jsat_term_t *term = jsat_series[i][j].terms + k;
+            const double arg = jsat_term_linear_arg( term, e.args);
+            const double d_arg = jsat_term_linear_arg( term, e_rates.args)
+                                    - term->phase * DEG2RAD;
+
+            rec->sin_arg = sin( arg);
+            rec->cos_arg = cos( arg);
+            rec->sin_step = sin( d_arg);
+            rec->cos_step = cos( d_arg);
+            rec++;
+            }
+}
+
+/* Sums a series using the current state of the recurrences,  then steps
+them along to the next time.  'sc_gam' holds the sine and cosine of
+gamma times -3 to +3;  'sc_del' is the sine and cosine of 'del'.   */
+
+static double sum_jsat_series_rec( const jsat_series_t *series,
+            recurrence_t *rec, const double sc_gam[7][2],
+            const double *sc_del, const double del, const bool use_cos)
+{
+   double rval = 0.;
+   int i;
+
+   for( i = 0; i < series->n_terms; i++, rec++)
+      {
+      const jsat_term_t *term = series->terms + i;
+      const int gam_mult = gamma_multiple( term);
+      double s = rec->sin_arg, c = rec->cos_arg;
+      const double new_sin = s * rec->cos_step + c * rec->sin_step;
+
+      rec->cos_arg = c * rec->cos_step - s * rec->sin_step;
+      rec->sin_arg = new_sin;
+      if( gam_mult || term->del_mult)
+         {
+         double sin_b = sc_gam[gam_mult + 3][0], cos_b = sc_gam[gam_mult + 3][1];
+         double temp;
+
+         if( term->del_mult == 1.)
+            {
+            temp = sin_b * sc_del[1] + cos_b * sc_del[0];
+            cos_b = cos_b * sc_del[1] - sin_b * sc_del[0];
+            sin_b = temp;
+            }
+         else if( term->del_mult)
+            {
+            const double sin_d = sin( term->del_mult * del);
+            const double cos_d = cos( term->del_mult * del);
+
+            temp = sin_b * cos_d + cos_b * sin_d;
+            cos_b = cos_b * cos_d - sin_b * sin_d;
+            sin_b = temp;
+            }
+         temp = s * cos_b + c * sin_b;
+         c = c * cos_b - s * sin_b;
+         s = temp;
+         }
+      rval += term->coeff * (use_cos ? c : s);
+      }
+   return( rval);
+}
+
+static void calc_jsat_block( const double jd0, const double step,
+               const int n_steps, double *jsats, const int sats_wanted)
+{
+   recurrence_t rec[MAX_JSAT_TERMS];
+   int step_no, i;
+
+   for( step_no = 0; step_no < n_steps; step_no++, jsats += 15)
+      {
+      const double jd = jd0 + (double)step_no * step;
+      recurrence_t *rptr = rec;
+      jsat_epoch_t e;
+      double sc_gam[7][2];
+
+      if( step_no % JSAT_RESYNC == 0)
+         init_jsat_recurrences( rec, jd, step);
+      setup_jsat_epoch( &e, jd);
+      sc_gam[3][0] = 0.;
+      sc_gam[3][1] = 1.;
+      sc_gam[4][0] = sin( e.gam);
+      sc_gam[4][1] = cos( e.gam);
+      for( i = 5; i < 7; i++)
+         {
+         sc_gam[i][0] = sc_gam[i - 1][0] * sc_gam[4][1] + sc_gam[i - 1][1] * sc_gam[4][0];
+         sc_gam[i][1] = sc_gam[i - 1][1] * sc_gam[4][1] - sc_gam[i - 1][0] * sc_gam[4][0];
+         }
+      for( i = 0; i < 3; i++)
+         {
+         sc_gam[i][0] = -sc_gam[6 - i][0];
+         sc_gam[i][1] =  sc_gam[6 - i][1];
+         }
+      for( i = 0; i < 15; i++)
+         jsats[i] = 0.;
+      for( i = 0; i < 5; i++)
+         {
+         double del = 0., tan_lat = 0., rad = 0.;
+
+         if( i != 4)
+            {
+            double sc_del[2];
+
+            del = sum_jsat_series_rec( &jsat_series[i][0], rptr, sc_gam,
+                                 NULL, 0., false) * COEFF2RAD;
+            rptr += jsat_series[i][0].n_terms;
+            sc_del[0] = sin( del);
+            sc_del[1] = cos( del);
+            tan_lat = sum_jsat_series_rec( &jsat_series[i][1], rptr, sc_gam,
+                                 sc_del, del, false) * 1e-7;
+            rptr += jsat_series[i][1].n_terms;
+            rad = sum_jsat_series_rec( &jsat_series[i][2], rptr, sc_gam,
+                                 sc_del, del, true) * 1e-7;
+            rptr += jsat_series[i][2].n_terms;
+            }
+         if( sats_wanted & (1 << i))
+            jsat_to_ecliptic( jsats + i * 3, &e, i, e.args[JA_L1 + i] + del,
+                                    tan_lat, rad);
+         }
+      }
+}
+
+int DLL_FUNC calc_jsat_loc_grid( const double jd0, const double step,
+               const int n_steps, double DLLPTR *jsats, const int sats_wanted)
+{
+   const int n_blocks = (n_steps + JSAT_BLOCK_SIZE - 1) / JSAT_BLOCK_SIZE;
+   int block;
+
+#ifdef _OPENMP
+   #pragma omp parallel for
+#endif
+   for( block = 0; block < n_blocks; block++)
+      {
+      const int start = block * JSAT_BLOCK_SIZE;
+      const int n = (n_steps - start < JSAT_BLOCK_SIZE ?
+                                 n_steps - start : JSAT_BLOCK_SIZE);
+
+      calc_jsat_block( jd0 + (double)start * step, step, n,
+                                 jsats + start * 15, sats_wanted);
+      }
+   return( sats_wanted);
+}
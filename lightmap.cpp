@@ -0,0 +1,270 @@
+/* Copyright (C) 2026, Project Pluto
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+
+   Code to look up brightnesses in the light pollution map at
+
+https://www.nasa.gov/feature/goddard/2017/new-night-lights-maps-open-up-possible-real-time-applications/
+
+   (see pollute.c for how to get it as a PGM image).  make_light_map( )
+rearranges that image into a file of TILE_SIZE x TILE_SIZE-pixel tiles,
+which load_light_map( ) memory-maps.  Finding the brightness at a given
+lat/lon is then a matter of computing an offset into the map;  a window
+around a point touches at most a few tiles,  rather than many widely
+separated rows of the image.
+
+   The tile file starts with a sixteen-byte header :  the eight bytes
+'LightMap',  then the image width and height as 32-bit integers in the
+native byte order.  Tiles follow,  left to right,  then top to bottom,
+each stored row by row.  Tiles at the right and bottom edges are padded
+with zeroes.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include "watdefs.h"
+#include "mpc_func.h"
+
+#define TILE_SIZE          64
+#define TILE_BYTES         (TILE_SIZE * TILE_SIZE)
+#define LIGHT_MAP_HEADER   16
+
+typedef struct
+{
+   const char *mapped;
+   size_t file_size;
+   const unsigned char *tiles;
+   int xsize, ysize, n_tiles_across;
+} light_map_t;
+
+/* Reads the header of a binary PGM,  leaving the file positioned at
+the first pixel.  Returns -1 if it's not an eight-bit binary PGM.  */
+
+static int read_pgm_header( FILE *ifile, int *xsize, int *ysize)
+{
+   int i, c, vals[3];
+
+   if( getc( ifile) != 'P' || getc( ifile) != '5')
+      return( -1);
+   for( i = 0; i < 3; i++)
+      {
+      c = getc( ifile);
+      while( c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#')
+         {
+         if( c == '#')           /* skip comments */
+            while( c != '\n' && c != EOF)
+               c = getc( ifile);
+         c = getc( ifile);
+         }
+      vals[i] = 0;
+      while( c >= '0' && c <= '9')
+         {
+         vals[i] = vals[i] * 10 + c - '0';
+         c = getc( ifile);
+         }
+      }
+   *xsize = vals[0];
+   *ysize = vals[1];
+   return( (vals[2] == 255 && *xsize > 0 && *ysize > 0) ? 0 : -1);
+}
+
+/* Converts the PGM image to the tiled format described above,  reading
+one row of tiles' worth of the image at a time.  Returns 0 on success,
+-1 if the PGM can't be opened,  -2 if it's not a PGM we can read,  -3 if
+the tile file can't be opened,  -4 if the PGM is truncated,  -5 if we
+run out of memory,  or -6 if writing the tile file fails.  On failure,
+any partial tile file is removed.  */
+
+int make_light_map( const char *pgm_filename, const char *tile_filename)
+{
+   FILE *ifile = fopen( pgm_filename, "rb"), *ofile;
+   int xsize, ysize, tx, y, y0, n_across, rval = 0;
+   unsigned char *rows, *tile;
+   char header[LIGHT_MAP_HEADER];
+   int32_t dims[2];
+
+   if( !ifile)
+      return( -1);
+   if( read_pgm_header( ifile, &xsize, &ysize))
+      {
+      fclose( ifile);
+      return( -2);
+      }
+   ofile = fopen( tile_filename, "wb");
+   if( !ofile)
+      {
+      fclose( ifile);
+      return( -3);
+      }
+   n_across = (xsize + TILE_SIZE - 1) / TILE_SIZE;
+   rows = (unsigned char *)calloc( (size_t)n_across * TILE_BYTES, 1);
+   tile = (unsigned char *)malloc( TILE_BYTES);
+   if( !rows || !tile)
+      rval = -5;
+   memcpy( header, "LightMap", 8);
+   dims[0] = (int32_t)xsize;
+   dims[1] = (int32_t)ysize;
+   memcpy( header + 8, dims, 8);
+   if( !rval && !fwrite( header, LIGHT_MAP_HEADER, 1, ofile))
+      rval = -6;
+   for( y0 = 0; y0 < ysize && !rval; y0 += TILE_SIZE)
+      {
+      for( y = 0; y < TILE_SIZE; y++)
+         {
+         unsigned char *row = rows + (size_t)y * n_across * TILE_SIZE;
+
+         if( y0 + y >= ysize)
+            memset( row, 0, xsize);
+         else if( !fread( row, xsize, 1, ifile))
+            rval = -4;
+         }
+      for( tx = 0; tx < n_across && !rval; tx++)
+         {
+         for( y = 0; y < TILE_SIZE; y++)
+            memcpy( tile + y * TILE_SIZE,
+                    rows + (size_t)y * n_across * TILE_SIZE + tx * TILE_SIZE,
+                    TILE_SIZE);
+         if( !fwrite( tile, TILE_BYTES, 1, ofile))
+            rval = -6;
+         }
+      }
+   free( rows);
+   free( tile);
+   fclose( ifile);
+   if( fclose( ofile) && !rval)
+      rval = -6;
+   if( rval)
+      remove( tile_filename);
+   return( rval);
+}
+
+/* Maps the tile file into memory.  Returns NULL if it can't be mapped,
+isn't a valid tile file,  or we run out of memory.  The result should
+be released with free_light_map( ).  */
+
+void *load_light_map( const char *tile_filename)
+{
+   light_map_t *rval;
+   int32_t dims[2];
+   size_t file_size;
+   const char *mapped = map_file( tile_filename, &file_size);
+
+   if( !mapped)
+      return( NULL);
+   if( file_size >= LIGHT_MAP_HEADER)
+      memcpy( dims, mapped + 8, 8);
+   if( file_size < LIGHT_MAP_HEADER || memcmp( mapped, "LightMap", 8)
+            || dims[0] <= 0 || dims[1] <= 0
+            || file_size != LIGHT_MAP_HEADER + (size_t)TILE_BYTES
+                   * ((dims[0] + TILE_SIZE - 1) / TILE_SIZE)
+                   * ((dims[1] + TILE_SIZE - 1) / TILE_SIZE))
+      {
+      unmap_file( mapped, file_size);
+      return( NULL);
+      }
+   rval = (light_map_t *)malloc( sizeof( light_map_t));
+   if( !rval)
+      {
+      unmap_file( mapped, file_size);
+      return( NULL);
+      }
+   rval->mapped = mapped;
+   rval->file_size = file_size;
+   rval->tiles = (const unsigned char *)mapped + LIGHT_MAP_HEADER;
+   rval->xsize = dims[0];
+   rval->ysize = dims[1];
+   rval->n_tiles_across = (dims[0] + TILE_SIZE - 1) / TILE_SIZE;
+   return( rval);
+}
+
+void free_light_map( void *map)
+{
+   light_map_t *lmap = (light_map_t *)map;
+
+   if( lmap)
+      {
+      unmap_file( lmap->mapped, lmap->file_size);
+      free( lmap);
+      }
+}
+
+/* Pixel x wraps around in longitude;  y is clamped to the poles.  */
+
+static int light_map_pixel( const light_map_t *lmap, int x, int y)
+{
+   const unsigned char *tile;
+
+   x %= lmap->xsize;
+   if( x < 0)
+      x += lmap->xsize;
+   if( y < 0)
+      y = 0;
+   if( y >= lmap->ysize)
+      y = lmap->ysize - 1;
+   tile = lmap->tiles + (size_t)TILE_BYTES
+               * ((y / TILE_SIZE) * lmap->n_tiles_across + x / TILE_SIZE);
+   return( tile[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE]);
+}
+
+static void lat_lon_to_pixel( const light_map_t *lmap, const double lon,
+                                const double lat, int *x, int *y)
+{
+   *x = (int)floor( ( 180. + lon) * (double)lmap->xsize / 360.);
+   *y = (int)floor( ( 90. - lat) * (double)lmap->ysize / 180.);
+}
+
+/* Returns the brightness (0-255) at the given longitude and latitude,
+both in degrees. */
+
+int light_map_value( const void *map, const double lon, const double lat)
+{
+   const light_map_t *lmap = (const light_map_t *)map;
+   int x, y;
+
+   lat_lon_to_pixel( lmap, lon, lat, &x, &y);
+   return( light_map_pixel( lmap, x, y));
+}
+
+/* Batch version of the above,  for 'n' points. */
+
+void light_map_values( const void *map, const size_t n,
+            const double *lon, const double *lat, unsigned char *values)
+{
+   long i;
+
+#ifdef _OPENMP
+   #pragma omp parallel for
+#endif
+   for( i = 0; i < (long)n; i++)
+      values[i] = (unsigned char)light_map_value( map, lon[i], lat[i]);
+}
+
+/* Fills 'obuff' with the (2 * size) x (2 * size) pixels centered on
+the given point,  row by row from the north. */
+
+void light_map_window( const void *map, const double lon,
+            const double lat, const int size, unsigned char *obuff)
+{
+   const light_map_t *lmap = (const light_map_t *)map;
+   int x, y, x0, y0;
+
+   lat_lon_to_pixel( lmap, lon, lat, &x0, &y0);
+   for( y = y0 - size; y < y0 + size; y++)
+      for( x = x0 - size; x < x0 + size; x++)
+         *obuff++ = (unsigned char)light_map_pixel( lmap, x, y);
+}
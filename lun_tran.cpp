@@ -40,35 +40,41 @@ int get_zip_code_data( const int zip_code, double *latitude,
       char *place_name);                              /* lun_tran.cpp */
 void format_hh_mm( char *buff, const double time);    /* lun_tran.cpp */
 
-static double look_for_transit_time( const int planet_no,
-                  double jd,
-                  const double observer_lat, const double observer_lon,
+/* Lunar positions come from a POSN_TABLE (see riseset3.cpp),  kept from
+one call to the next and rebuilt only when a date falls outside it,  and
+find_transit_time( ) brackets and refines the transit.  For the usual
+case of a call or two for each day of a month,  that's about half as
+many evaluations of the lunar theory as the iterative search formerly
+used here.  The transit nearest 'jd' (local noon),  within a day either
+way,  is returned;  -1 if we ran out of memory. */
+
+#define TRANSIT_TABLE_SPAN    32.
+
+static double look_for_transit_time( const double jd,
+                  const double observer_lon,
                   const char *vsop_data, const int real_transit)
 {
-   int iterations = 10;
-   double delta = 1.;
+   static POSN_TABLE table;
+   double rval = -1.;
+   int i;
 
-   do
+   if( !table.vects || jd - 1.5 < table.jd0 + table.step
+            || jd + 1.5 > table.jd0 + (double)( table.n_nodes - 3) * table.step)
       {
-      PLANET_DATA pdata;
-
-      fill_planet_data( &pdata, planet_no, jd,
-                          observer_lat, observer_lon, vsop_data);
-
-      delta = atan2( pdata.altaz_loc[1], pdata.altaz_loc[0]);
-      if( !real_transit)
-         delta += pi;
-      while( delta < -pi)
-         delta += pi + pi;
-      while( delta > pi)
-         delta -= pi + pi;
-      if( planet_no == 10)       /* moon moves a little faster */
-         delta *= 30.5 / 29.5;
-      delta *= sqrt( 1. - pdata.altaz_loc[2] * pdata.altaz_loc[2]);
-      jd += delta / (2. * pi);
+      free_posn_table( &table);
+      if( make_posn_table( &table, 10, jd - 3.5, jd + TRANSIT_TABLE_SPAN,
+                                          vsop_data))
+         return( -1.);
       }
-      while( fabs( delta) > .0001 && iterations--);
-   return( jd);
+   for( i = -1; i <= 1; i++)
+      {
+      const double t = find_transit_time( &table, jd - .5 + (double)i,
+                                          observer_lon, real_transit);
+
+      if( t >= 0. && (rval < 0. || fabs( t - jd) < fabs( rval - jd)))
+         rval = t;
+      }
+   return( rval);
 }
 
 /* 2006 and before:  US Daylight "Saving" Time changes are on the
@@ -117,6 +123,7 @@ static int is_dst( const int minutes, const int day_of_year, const int year)
    Return values:
 
       -2.         The 'vsop.bin' file wasn't found.
+      -3.         Out of memory.
       <0. or >=1. The event occurred slightly before or slightly after
                   that calendar day.  Lunar transits average about 25 hours
                   apart,  so this will happen about once a month for each
@@ -145,6 +152,7 @@ double get_lunar_transit_time( const int year, const int month,
    static char *vsop_data = NULL;
    int dst_hours = (dst ? is_dst( 720, (int)day_of_year, year) : 0);
 
+   INTENTIONALLY_UNUSED_PARAMETER( latitude);  /* transits don't need it */
    if( !vsop_data)
       vsop_data = load_file_into_memory( "vsop.bin", NULL);
    if( !vsop_data)
@@ -152,9 +160,10 @@ double get_lunar_transit_time( const int year, const int month,
    jd -= (double)time_zone / 24.;      /* convert local to UT */
    jd -= dst_hours / 24.;
 
-   jd = look_for_transit_time( 10, jd,
-            latitude * pi / 180., longitude * pi / 180.,
+   jd = look_for_transit_time( jd, longitude * pi / 180.,
             vsop_data, real_transit);
+   if( jd < 0.)
+      return( -3.);
    jd += (double)time_zone / 24.;      /* convert UT back to local */
    jd += dst_hours / 24.;
    return( jd - (double)jd0 + .5);
@@ -66,8 +66,12 @@ int DLL_FUNC calc_pluto_loc( const void FAR *data, double DLLPTR *loc,
                                 const double t, const long precision);
 int DLL_FUNC calc_jsat_loc( const double jd, double DLLPTR *jsats,
                          const int sats_wanted, const long precision);
+int DLL_FUNC calc_jsat_loc_grid( const double jd0, const double step,
+               const int n_steps, double DLLPTR *jsats, const int sats_wanted);
 int DLL_FUNC calc_ssat_loc( const double t, double DLLPTR *ssat,
                                 const int sat_wanted, const long precision);
+int DLL_FUNC calc_ssat_loc_grid( const double jd0, const double step,
+               const int n_steps, double DLLPTR *ssats, const int sats_wanted);
 void DLL_FUNC calc_triton_loc( const double jd, double *vect);
 double DLL_FUNC calc_vsop_loc( const void FAR *data, const int planet,
                           const int value, double t, double prec);
@@ -77,11 +81,20 @@ int DLL_FUNC compute_planet( const char FAR *vsop_data, const int planet_no,
             const double t_c, double DLLPTR *ovals);
 int DLL_FUNC calc_planet_orientation( const int planet_no, const int system_no,
                const double jd, double *matrix);
+void * DLL_FUNC init_cospar_cache( const int n_slots);
+void DLL_FUNC free_cospar_cache( void *cache);
+int DLL_FUNC calc_planet_orientation_cached( void *cache, const int planet_no,
+               const int system_no, const double jd, double *matrix);
+int DLL_FUNC calc_planet_orientations( const int n, const int *planet_nos,
+               const int *system_nos, const double *jds, double *matrices,
+               int *rvals);
 int DLL_FUNC planet_radii( const int planet_no, double *radii_in_km);
 double DLL_FUNC planet_rotation_rate( const int planet_no, const int system_no);
 int DLL_FUNC load_cospar_file( const char *filename);
 int DLL_FUNC evaluate_rock( const double jd, const int jpl_id,
                                                   double *output_vect);
+int DLL_FUNC evaluate_rocks( const int planet_no, const int n_times,
+                  const double *jdes, double *output, int *jpl_ids);
 double planet_radius_in_meters( const int planet_idx);   /* mpc_code.cpp */
 double planet_axis_ratio( const int planet_idx);         /* mpc_code.cpp */
 
@@ -8,7 +8,7 @@ EXES= add_off.exe adestest.exe astcheck.exe astephem.exe \
       easter.exe get_test.exe gtest.exe htc20b.exe jd.exe jevent.exe \
       jpl2b32.exe jsattest.exe lun_test.exe marstime.exe \
       moidtest.exe mpc_time.exe mpc2sof.exe oblitest.exe parallax.exe \
-      persian.exe phases.exe prectest.exe prectes2.exe ps_1996.exe \
+      persian.exe phases.exe pollute.exe prectest.exe prectes2.exe ps_1996.exe \
       relativi.exe ssattest.exe tables.exe test_des.exe test_ref.exe \
       testprec.exe test_ref.exe themis.exe them_cat.exe uranus1.exe utc_test.exe
 
@@ -19,8 +19,8 @@ LIB_OBJS= ades2mpc.obj alt_az.obj astfuncs.obj \
       com_file.obj conbound.obj cospar.obj date.obj \
       de_plan.obj delta_t.obj dist_pa.obj  \
       elp82dat.obj eop_prec.obj getplane.obj \
-      get_time.obj jsats.obj lunar2.obj miscell.obj mpc_code.obj \
-      mpc_fmt.obj mpc_fmt2.obj moid.obj nanosecs.obj \
+      get_time.obj jsats.obj lightmap.obj lunar2.obj miscell.obj mpc_code.obj \
+      mpc_fmt.obj mpc_fmt2.obj mpc_load.obj moid.obj nanosecs.obj \
       nutation.obj obliquit.obj pluto.obj precess.obj  \
       refract.obj refract4.obj rocks.obj showelem.obj sof.obj \
       snprintf.obj spline.obj ssats.obj \
@@ -72,7 +72,7 @@ clean:
    $(RM) jpl2b32.obj jsattest.obj lun_test.obj lun_tran.obj
    $(RM) marstime.obj mpc_code.obj mpc_fmt.obj mpc_fmt2.obj mpcorb.obj
    $(RM) moidtest.obj mpc_time.obj mpc2sof.obj obliqui2.obj oblitest.obj
-   $(RM) parallax.obj persian.obj phases.obj ps_1996.obj
+   $(RM) parallax.obj persian.obj phases.obj pollute.obj ps_1996.obj
    $(RM) prectest.obj prectes2.obj relativi.obj riseset3.obj
    $(RM) sof.obj solseqn.obj spline.obj ssattest.obj tables.obj
    $(RM) testprec.obj test_des.obj test_ref.obj themis.obj
@@ -164,6 +164,9 @@ persian.exe: persian.obj solseqn.obj $(LIBNAME).lib
 phases.exe: phases.obj $(LIBNAME).lib
    $(LINK)  phases.obj $(LIBNAME).lib
 
+pollute.exe: pollute.obj $(LIBNAME).lib
+   $(LINK)  pollute.obj $(LIBNAME).lib
+
 prectest.exe: prectest.obj $(LIBNAME).lib
    $(LINK)    prectest.obj $(LIBNAME).lib
 
@@ -185,8 +188,8 @@ ssattest.exe: ssattest.obj $(LIBNAME).lib
 ssats.obj: ssats.cpp
    cl -c $(COMMON_FLAGS) ssats.cpp
 
-tables.exe: tables.obj riseset3.obj $(LIBNAME).lib
-   $(LINK)  tables.obj riseset3.obj $(LIBNAME).lib
+tables.exe: tables.obj lun_tran.obj riseset3.obj $(LIBNAME).lib
+   $(LINK)  tables.obj lun_tran.obj riseset3.obj $(LIBNAME).lib
 
 testprec.exe: testprec.obj $(LIBNAME).lib
    $(LINK)    testprec.obj $(LIBNAME).lib
@@ -194,8 +197,8 @@ testprec.exe: testprec.obj $(LIBNAME).lib
 test_des.exe: test_des.obj $(LIBNAME).lib
    $(LINK)    test_des.obj $(LIBNAME).lib
 
-test_ref.exe: test_ref.obj refract.obj refract4.obj
-   $(LINK)    test_ref.obj refract.obj refract4.obj
+test_ref.exe: test_ref.obj refract.obj refract4.obj spline.obj
+   $(LINK)    test_ref.obj refract.obj refract4.obj spline.obj
 
 them_cat.exe: them_cat.c snprintf.obj
    cl -DTEST_CODE $(BASE_FLAGS) them_cat.c snprintf.obj
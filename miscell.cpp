@@ -295,97 +295,78 @@ static void remove_char( char *buff, const char removed)
    handles dates previous to 1970 (at least back to -5.5 million years
    and forward to 5.5 million years) and allows for other calendars
    (Gregorian, Julian,  Hebrew,  etc.;  see 'date.cpp' for details).
-   Also,  greater control over the output format is provided. */
-
-void DLL_FUNC full_ctimel( char *buff, long double t2k, const int format)
+   Also,  greater control over the output format is provided.
+
+   If you're going to output many times in the same format,  it's faster
+to call init_full_ctime_plan( ) once,  then full_ctimel_with_plan( ) for
+each time (or full_ctime_array( ) for a batch of times).  The plan holds
+everything that depends only on the format bits,  plus the date part of
+the most recently output day;  successive times on the same day (the
+usual case for an ephemeris) then skip the calendar conversion and most of
+the formatting.  A plan is modified as it's used,  so each thread needs
+its own.  The output is the same as that from full_ctimel( ),  which just
+makes a plan and uses it once.  */
+
+void DLL_FUNC init_full_ctime_plan( full_ctime_plan_t *plan, const int format)
 {
-   const int precision = (format >> 4) & 0xf, calendar = format & 0xf;
    const int output_format = (format & FULL_CTIME_FORMAT_MASK);
-   char *ibuff = buff;   /* keep track of the start of the output */
-   int day, month;
-   long units, i;
-   const int leading_zeroes = (format & FULL_CTIME_LEADING_ZEROES);
-   long year, int_t2k, day_of_week;
-   long double add_on = 1.;
-   long double remains;
-   const size_t max_buff_size = 80;
-   char *leading_digit_ptr;
 
+   plan->format = format;
+   plan->precision = (format >> 4) & 0xf;
+   plan->calendar = format & 0xf;
+   plan->output_format = output_format;
    if( output_format == FULL_CTIME_FORMAT_SECONDS)
-      units = seconds_per_day;
+      plan->units = seconds_per_day;
    else if( output_format == FULL_CTIME_FORMAT_HH_MM)
-      units = minutes_per_day;
+      plan->units = minutes_per_day;
    else if( output_format == FULL_CTIME_FORMAT_HH)
-      units = hours_per_day;
+      plan->units = hours_per_day;
    else                   /* output in days */
-      units = 1;
-   for( i = precision; i; i--)
-      add_on /= 10.;
+      plan->units = 1;
+   plan->add_on = 1.;
+   for( int i = plan->precision; i; i--)
+      plan->add_on /= 10.;
    if( format & FULL_CTIME_ROUNDING)
-      add_on *= 0.5 / (double)units;
+      plan->add_on *= 0.5 / (double)plan->units;
    else
-      add_on *= 0.05 / seconds_per_day;
-   t2k += add_on;
-
-   if( output_format == FULL_CTIME_FORMAT_YEAR)
-      {
-      char tbuff[40];
+      plan->add_on *= 0.05 / seconds_per_day;
+            /* A fractional day gets shown within the date part,  so   */
+            /* that part can't be reused from one time to the next:    */
+   plan->prefix_is_reusable = (output_format != FULL_CTIME_FORMAT_DAY
+                                          || !plan->precision);
+   plan->prefix_valid = 0;
+}
 
-#ifdef _WIN32
-      snprintf( tbuff, sizeof( tbuff), "%21.16Lf", t2k / 365.25 + 2000.);
-#else
-      snprintf_err( tbuff, sizeof( tbuff), "%21.16Lf", t2k / 365.25 + 2000.);
-#endif
-      tbuff[precision + 5] = '\0';
-      if( !precision)
-         tbuff[4] = '\0';
-      strlcpy_err( buff, tbuff, max_buff_size);
-      if( leading_zeroes)
-         while( *buff == ' ')
-            *buff++ = '0';
-      return;
-      }
-   if( output_format == FULL_CTIME_FORMAT_JD
-                     || output_format == FULL_CTIME_FORMAT_MJD)
-      {
-      char format_str[10];
+/* Sets up the part of the output preceding the time of day,  i.e.,  the
+optional day of the week,  then the date.  */
 
-      snprintf_err( format_str, sizeof( format_str), "JD %%.%dLf", precision);
-      if( output_format == FULL_CTIME_FORMAT_MJD)
-         {
-         *buff++ = 'M';
-         t2k += j2000 - 2400000.5;
-         }
-      else
-         t2k += j2000;
-      snprintf_err( buff, max_buff_size, format_str, t2k);
-      if( leading_zeroes)
-         while( *buff == ' ')
-            *buff++ = '0';
-      return;
-      }
+static void set_full_ctime_prefix( full_ctime_plan_t *plan,
+                           const long int_t2k, const long double remains)
+{
+   const int format = plan->format;
+   const int leading_zeroes = (format & FULL_CTIME_LEADING_ZEROES);
+   const size_t max_buff_size = sizeof( plan->prefix);
+   char *buff = plan->prefix;
+   long year, day_of_week;
+   int day, month;
 
-   t2k += .5;
-   int_t2k = (long)floorl( t2k);
    day_of_week = (int_t2k + 6) % 7;
    if( day_of_week < 0)    /* keep 0 <= day_of_week < 7: */
       day_of_week += 7;
+   plan->day_of_week = (int)day_of_week;
    if( format & FULL_CTIME_DAY_OF_WEEK_FIRST)
       snprintf_err( buff, max_buff_size, "%s ",
                      set_day_of_week_name( (int)day_of_week, NULL));
    else
       *buff = '\0';
 
-   day_to_dmy( int_t2k + 2451545, &day, &month, &year, calendar);
-
-   remains = t2k - (long double)int_t2k;
-          /* i.e.,  fractional part of day */
    if( !(format & FULL_CTIME_TIME_ONLY))     /* we want the date: */
       {
       char month_str[25];
       char year_str[20];
-      char day_str[15];
+      char day_str[20];
 
+      day_to_dmy( int_t2k + 2451545, &day, &month, &year, plan->calendar);
       if( format & FULL_CTIME_MONTHS_AS_DIGITS)
          snprintf_err( month_str, sizeof( month_str), (leading_zeroes ? "%02d" : "%2d"), month);
       else
@@ -401,12 +382,12 @@ void DLL_FUNC full_ctimel( char *buff, long double t2k, const int format)
             snprintf_append( buff, max_buff_size, "%s ", year_str);
 
       snprintf_err( day_str, sizeof( day_str), (leading_zeroes ? "%02d" : "%2d"), day);
-      if( output_format == FULL_CTIME_FORMAT_DAY && precision)
-         show_remainder( day_str + 2, remains, (unsigned)precision);
+      if( plan->output_format == FULL_CTIME_FORMAT_DAY && plan->precision)
+         show_remainder( day_str + 2, remains, (unsigned)plan->precision);
 
       if( format & FULL_CTIME_DAY_OF_YEAR)
          {
-         const int day_of_year = int_t2k + 2451545 - dmy_to_day( 0, 1, year, calendar);
+         const int day_of_year = int_t2k + 2451545 - dmy_to_day( 0, 1, year, plan->calendar);
 
          snprintf_append( buff, max_buff_size, "%03d%s", day_of_year, day_str + 2);
          }
@@ -418,50 +399,154 @@ void DLL_FUNC full_ctimel( char *buff, long double t2k, const int format)
       if( !(format & FULL_CTIME_YEAR_FIRST))       /* year comes at end */
          if( !(format & FULL_CTIME_NO_YEAR))
             snprintf_append( buff, max_buff_size, " %s", year_str);
-      if( output_format != FULL_CTIME_FORMAT_DAY)
+      if( plan->output_format != FULL_CTIME_FORMAT_DAY)
          strlcat_err( buff, " ", max_buff_size);
       }
+   plan->prefix_len = strlen( buff);
+   plan->prefix_day = int_t2k;
+   plan->prefix_valid = 1;
+}
+
+/* Equivalent to snprintf( buff, "%2ld", value) or "%02ld",  for the
+case 0 <= value < 100 (i.e.,  hours, minutes, or seconds) */
+
+static char *put_two_digits( char *buff, const long value, const char pad)
+{
+   *buff++ = (value < 10 ? pad : (char)( '0' + value / 10));
+   *buff++ = (char)( '0' + value % 10);
+   return( buff);
+}
+
+void DLL_FUNC full_ctimel_with_plan( char *buff, long double t2k,
+                                    full_ctime_plan_t *plan)
+{
+   const int format = plan->format, precision = plan->precision;
+   const int output_format = plan->output_format;
+   const long units = plan->units;
+   char *ibuff = buff;   /* keep track of the start of the output */
+   long i;
+   const int leading_zeroes = (format & FULL_CTIME_LEADING_ZEROES);
+   long int_t2k;
+   long double remains;
+   const size_t max_buff_size = 80;
+   char *leading_digit_ptr;
+
+   t2k += plan->add_on;
+   if( output_format == FULL_CTIME_FORMAT_YEAR)
+      {
+      char tbuff[40];
+
+#ifdef _WIN32
+      snprintf( tbuff, sizeof( tbuff), "%21.16Lf", t2k / 365.25 + 2000.);
+#else
+      snprintf_err( tbuff, sizeof( tbuff), "%21.16Lf", t2k / 365.25 + 2000.);
+#endif
+      tbuff[precision + 5] = '\0';
+      if( !precision)
+         tbuff[4] = '\0';
+      strlcpy_err( buff, tbuff, max_buff_size);
+      if( leading_zeroes)
+         while( *buff == ' ')
+            *buff++ = '0';
+      return;
+      }
+   if( output_format == FULL_CTIME_FORMAT_JD
+                     || output_format == FULL_CTIME_FORMAT_MJD)
+      {
+      char format_str[10];
+
+      snprintf_err( format_str, sizeof( format_str), "JD %%.%dLf", precision);
+      if( output_format == FULL_CTIME_FORMAT_MJD)
+         {
+         *buff++ = 'M';
+         t2k += j2000 - 2400000.5;
+         }
+      else
+         t2k += j2000;
+      snprintf_err( buff, max_buff_size, format_str, t2k);
+      if( leading_zeroes)
+         while( *buff == ' ')
+            *buff++ = '0';
+      return;
+      }
+
+   t2k += .5;
+   int_t2k = (long)floorl( t2k);
+   remains = t2k - (long double)int_t2k;
+          /* i.e.,  fractional part of day */
+   if( !plan->prefix_valid || plan->prefix_day != int_t2k
+                           || !plan->prefix_is_reusable)
+      set_full_ctime_prefix( plan, int_t2k, remains);
+   memcpy( buff, plan->prefix, plan->prefix_len);
+   buff += plan->prefix_len;
 
    remains *= (double)units;
    i = (long)remains;
    if( i == units)   /* keep things from rounding up incorrectly */
       i--;
-   leading_digit_ptr = buff + strlen( buff);
+   leading_digit_ptr = buff;
    switch( output_format)
       {
       case FULL_CTIME_FORMAT_SECONDS:
-         snprintf_append( buff, max_buff_size, "%2ld:%02ld:%02ld", i / 3600L, (i / 60) % 60L,
-                           i % 60L);
+         buff = put_two_digits( buff, i / 3600L, ' ');
+         *buff++ = ':';
+         buff = put_two_digits( buff, (i / 60) % 60L, '0');
+         *buff++ = ':';
+         buff = put_two_digits( buff, i % 60L, '0');
          break;
       case FULL_CTIME_FORMAT_HH_MM:
-         snprintf_append( buff, max_buff_size, "%2ld:%02ld", i / 60L, i % 60L);
+         buff = put_two_digits( buff, i / 60L, ' ');
+         *buff++ = ':';
+         buff = put_two_digits( buff, i % 60L, '0');
          break;
       case FULL_CTIME_FORMAT_HH:
-         snprintf_append( buff, max_buff_size, "%2ld", i);
+         buff = put_two_digits( buff, i, ' ');
          break;
       }
+   *buff = '\0';
    if( output_format != FULL_CTIME_FORMAT_DAY)
       {
       if( leading_zeroes && *leading_digit_ptr == ' ')
          *leading_digit_ptr = '0';
       if( precision)
-         show_remainder( buff + strlen( buff), remains - (double)i,
-                                                      (unsigned)precision);
+         show_remainder( buff, remains - (double)i, (unsigned)precision);
       }
    if( format & FULL_CTIME_DAY_OF_WEEK_LAST)
-      snprintf_append( buff, max_buff_size, " %s",
-                     set_day_of_week_name( (int)day_of_week, NULL));
+      snprintf_append( ibuff, max_buff_size, " %s",
+                     set_day_of_week_name( plan->day_of_week, NULL));
    if( format & FULL_CTIME_NO_SPACES)
       remove_char( ibuff, ' ');
    if( format & FULL_CTIME_NO_COLONS)
       remove_char( ibuff, ':');
 }
 
+void DLL_FUNC full_ctimel( char *buff, long double t2k, const int format)
+{
+   full_ctime_plan_t plan;
+
+   init_full_ctime_plan( &plan, format);
+   full_ctimel_with_plan( buff, t2k, &plan);
+}
+
 void DLL_FUNC full_ctime( char *buff, double jd, const int format)
 {
    full_ctimel( buff, (long double)jd - j2000, format);
 }
 
+/* Formats n_times JDs,  putting the output for jd[i] at
+obuff + i * obuff_stride.  Each output can take up to 80 bytes. */
+
+void DLL_FUNC full_ctime_array( char *obuff, const size_t obuff_stride,
+                  const double *jd, const size_t n_times, const int format)
+{
+   full_ctime_plan_t plan;
+
+   init_full_ctime_plan( &plan, format);
+   for( size_t i = 0; i < n_times; i++)
+      full_ctimel_with_plan( obuff + i * obuff_stride,
+                           (long double)jd[i] - j2000, &plan);
+}
+
 void DLL_FUNC polar3_to_cartesian( double *vect, const double lon, const double lat)
 {
    double clat = cos( lat);
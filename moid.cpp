@@ -50,6 +50,7 @@ https://www.researchgate.net/publication/325922027_On_the_minimum_orbital_inters
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "watdefs.h"
 #include "brentmin.h"
 #include "comets.h"
@@ -398,3 +399,235 @@ static const double planet_elem_rate[N_PLANET_RATES * 6] = {
    return( 0);
 }
 
+
+/* Batch MOID computation.  Given one set of orbits and,  optionally,  a
+second set (planets,  say),  we want every pair with a MOID at or below
+'max_moid'.  Most pairs can be ruled out cheaply before calling
+find_moid_full( ) :
+
+   (1) Radially :  no point on one orbit can be closer to the other orbit
+than the gap between their [q, Q] ranges.
+
+   (2) Using the mutual node line :  a point on orbit 2 at angle u (in its
+own plane) from the mutual node line is r2 * |sin u| * sin( I) from the
+plane of orbit 1,  where I is the mutual inclination,  and the same holds
+with 1 and 2 swapped.  So within 'max_moid',  both points must lie within
+asin( max_moid / (q * sin I)) of a node.  We work out the range of radii
+each orbit has in those arcs;  if the ranges near matching nodes don't
+overlap to within max_moid,  the pair can't qualify.  (Points near
+opposite nodes are,  when the arcs are narrow,  at least 90 degrees apart
+as seen from the sun,  hence at least sqrt( q1^2 + q2^2) apart.)
+
+   Both are lower bounds,  so nothing that find_moid_full( ) would put
+under 'max_moid' gets dropped.  Surviving pairs are run through the full
+solver in parallel (if compiled with OpenMP;  'make OPENMP=Y') a block of
+rows at a time,  and hits are passed to the callback in row order,  so
+the output is the same with or without threads.       */
+
+#define FAR_AWAY 1e+30
+
+typedef struct
+{
+   double normal[3];
+   double q, big_q;
+} moid_prep_t;
+
+static void prep_for_moid( moid_prep_t *prep, const ELEMENTS *elem)
+{
+   vector_cross_product( prep->normal, elem->perih_vec, elem->sideways);
+   prep->q = elem->q;
+   prep->big_q = (elem->ecc < 1. ? elem->major_axis * 2. - elem->q : FAR_AWAY);
+}
+
+static double radius_at_true_anom( const ELEMENTS *elem, const double true_anom)
+{
+   const double denom = 1. + elem->ecc * cos( true_anom);
+
+   return( denom > 0. ? elem->q * (1. + elem->ecc) / denom : FAR_AWAY);
+}
+
+/* Finds the range of radii for true anomalies within 'half_width' of
+'center'.  For hyperbolic orbits,  parts of that arc may not be on the
+orbit at all;  those are treated as being very far away.  */
+
+static void radius_range( const ELEMENTS *elem, const moid_prep_t *prep,
+          const double center, const double half_width, double *range)
+{
+   const double r1 = radius_at_true_anom( elem, center - half_width);
+   const double r2 = radius_at_true_anom( elem, center + half_width);
+   const double ang = fabs( centralize_angle( center));
+
+   range[0] = (r1 < r2 ? r1 : r2);
+   range[1] = (r1 > r2 ? r1 : r2);
+   if( ang <= half_width)
+      range[0] = prep->q;
+   if( ang >= PI - half_width)
+      range[1] = prep->big_q;
+}
+
+static double range_gap( const double *range1, const double *range2)
+{
+   double rval = 0.;
+
+   if( range1[0] > range2[1])
+      rval = range1[0] - range2[1];
+   if( range2[0] > range1[1])
+      rval = range2[0] - range1[1];
+   return( rval);
+}
+
+static double moid_lower_bound( const ELEMENTS *elem1, const moid_prep_t *prep1,
+         const ELEMENTS *elem2, const moid_prep_t *prep2, const double max_moid)
+{
+   double rval = 0., node_vect[3], sin_incl, half_width[2];
+   double ranges[2][2][2], node_bound = FAR_AWAY;
+   int i, j;
+
+   if( prep1->q > prep2->big_q)
+      rval = prep1->q - prep2->big_q;
+   if( prep2->q > prep1->big_q)
+      rval = prep2->q - prep1->big_q;
+   if( rval > max_moid)
+      return( rval);
+   vector_cross_product( node_vect, prep1->normal, prep2->normal);
+   sin_incl = vector3_length( node_vect);
+   half_width[0] = half_width[1] = PI / 2.;
+   if( max_moid < prep1->q * sin_incl)
+      half_width[0] = asin( max_moid / (prep1->q * sin_incl));
+   if( max_moid < prep2->q * sin_incl)
+      half_width[1] = asin( max_moid / (prep2->q * sin_incl));
+   if( half_width[0] == PI / 2. && half_width[1] == PI / 2.)
+      return( rval);       /* nearly coplanar;  node test won't help */
+   for( i = 0; i < 2; i++)
+      {
+      const ELEMENTS *elem = (i ? elem2 : elem1);
+      const double node_true_anom = atan2( dot_product( node_vect, elem->sideways),
+                                     dot_product( node_vect, elem->perih_vec));
+
+      for( j = 0; j < 2; j++)      /* j=0 : one node;  j=1 : the other */
+         radius_range( elem, (i ? prep2 : prep1), node_true_anom + j * PI,
+                              half_width[i], ranges[i][j]);
+      }
+   for( i = 0; i < 2; i++)
+      for( j = 0; j < 2; j++)
+         {
+         double bound;
+
+         if( i == j || half_width[0] + half_width[1] > PI / 2.)
+            bound = range_gap( ranges[0][i], ranges[1][j]);
+         else
+            bound = sqrt( prep1->q * prep1->q + prep2->q * prep2->q);
+         if( node_bound > bound)
+            node_bound = bound;
+         }
+   return( rval > node_bound ? rval : node_bound);
+}
+
+typedef struct
+{
+   int idx2;
+   double moid;
+} moid_hit_t;
+
+typedef struct
+{
+   int n_hits, n_alloced;
+   moid_hit_t *hits;
+} moid_row_t;
+
+#define MOID_ROWS_PER_BLOCK 256
+
+/* Computes MOIDs between each orbit in 'elems1' and each orbit in
+'elems2',  calling 'callback' for each pair with a MOID at or below
+'max_moid'.  If 'elems2' is NULL,  all pairs within 'elems1' are
+checked instead (each pair once,  with idx1 < idx2).  Elements must
+have been run through derive_quantities( ).  Pairs where both orbits
+are open are skipped,  since find_moid_full( ) requires at least one
+to be closed.  Returns the number of hits;  if 'n_computed' is non-NULL,
+it's set to the number of pairs that had to go to find_moid_full( ).  */
+
+long find_moids_batch( const ELEMENTS *elems1, const int n1,
+                       const ELEMENTS *elems2, int n2, const double max_moid,
+                       moid_callback_t callback, void *context,
+                       long *n_computed)
+{
+   const bool self_check = (elems2 == NULL);
+   moid_prep_t *prep1, *prep2;
+   moid_row_t rows[MOID_ROWS_PER_BLOCK];
+   long n_hits = 0, n_full = 0;
+   int i, block;
+
+   if( self_check)
+      {
+      elems2 = elems1;
+      n2 = n1;
+      }
+   prep1 = (moid_prep_t *)malloc( (n1 + n2 + 1) * sizeof( moid_prep_t));
+   assert( prep1);
+   prep2 = prep1 + n1;
+   for( i = 0; i < n1; i++)
+      prep_for_moid( prep1 + i, elems1 + i);
+   for( i = 0; i < n2; i++)
+      prep_for_moid( prep2 + i, elems2 + i);
+   memset( rows, 0, sizeof( rows));
+   for( block = 0; block < n1; block += MOID_ROWS_PER_BLOCK)
+      {
+      const int n_rows = (n1 - block < MOID_ROWS_PER_BLOCK ?
+                                 n1 - block : MOID_ROWS_PER_BLOCK);
+
+#ifdef _OPENMP
+      #pragma omp parallel for schedule( dynamic) reduction( +:n_full)
+#endif
+      for( i = 0; i < n_rows; i++)
+         {
+         const int idx1 = block + i;
+         const ELEMENTS *elem1 = elems1 + idx1;
+         moid_row_t *row = rows + i;
+         int j;
+
+         row->n_hits = 0;
+         for( j = (self_check ? idx1 + 1 : 0); j < n2; j++)
+            {
+            const ELEMENTS *elem2 = elems2 + j;
+
+            if( (elem1->ecc < 1. || elem2->ecc < 1.)
+                  && moid_lower_bound( elem1, prep1 + idx1, elem2, prep2 + j,
+                                       max_moid) <= max_moid)
+               {
+               const double moid = (elem2->ecc < elem1->ecc ?
+                           find_moid_full( elem2, elem1, NULL) :
+                           find_moid_full( elem1, elem2, NULL));
+
+               n_full++;
+               if( moid <= max_moid)
+                  {
+                  if( row->n_hits == row->n_alloced)
+                     {
+                     row->n_alloced = row->n_alloced * 2 + 16;
+                     row->hits = (moid_hit_t *)realloc( row->hits,
+                                 row->n_alloced * sizeof( moid_hit_t));
+                     assert( row->hits);
+                     }
+                  row->hits[row->n_hits].idx2 = j;
+                  row->hits[row->n_hits++].moid = moid;
+                  }
+               }
+            }
+         }
+      for( i = 0; i < n_rows; i++)
+         {
+         int j;
+
+         for( j = 0; j < rows[i].n_hits; j++)
+            callback( context, block + i, rows[i].hits[j].idx2,
+                                          rows[i].hits[j].moid);
+         n_hits += rows[i].n_hits;
+         }
+      }
+   for( i = 0; i < MOID_ROWS_PER_BLOCK; i++)
+      free( rows[i].hits);
+   free( prep1);
+   if( n_computed)
+      *n_computed = n_full;
+   return( n_hits);
+}
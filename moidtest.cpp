@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 #include "watdefs.h"
 #include "comets.h"
 #include "afuncs.h"
@@ -87,6 +88,117 @@ static int run_intraobject_check( const char *header, FILE *ifile)
    return( 0);
 }
 
+/* With '-b (max MOID)',  we compare find_moids_batch( ) to a naive
+double loop over all pairs of objects in the input file,  checking that
+both find the same pairs,  then time the objects against the planets. */
+
+typedef struct
+{
+   int n_hits, n_alloced;
+   int *idx1, *idx2;
+   double *moid;
+} moid_list_t;
+
+static void add_moid_to_list( void *context, const int idx1, const int idx2,
+                              const double moid)
+{
+   moid_list_t *list = (moid_list_t *)context;
+
+   if( list->n_hits == list->n_alloced)
+      {
+      list->n_alloced = list->n_alloced * 2 + 100;
+      list->idx1 = (int *)realloc( list->idx1, list->n_alloced * sizeof( int));
+      list->idx2 = (int *)realloc( list->idx2, list->n_alloced * sizeof( int));
+      list->moid = (double *)realloc( list->moid, list->n_alloced * sizeof( double));
+      assert( list->idx1 && list->idx2 && list->moid);
+      }
+   list->idx1[list->n_hits] = idx1;
+   list->idx2[list->n_hits] = idx2;
+   list->moid[list->n_hits++] = moid;
+}
+
+static int run_batch_benchmark( const char *header, FILE *ifile,
+                                const double max_moid)
+{
+   int i, j, n_objects = 0, n_alloced = 1000, n_mismatches = 0;
+   char buff[300];
+   ELEMENTS *elem = (ELEMENTS *)malloc( n_alloced * sizeof( ELEMENTS));
+   ELEMENTS planets[8];
+   moid_list_t naive, batch;
+   long n_computed;
+   clock_t t0;
+
+   while( fgets( buff, sizeof( buff), ifile))
+      {
+      if( n_objects == n_alloced)
+         {
+         n_alloced *= 2;
+         elem = (ELEMENTS *)realloc( elem, n_alloced * sizeof( ELEMENTS));
+         }
+      assert( elem);
+      if( !extract_sof_data( elem + n_objects, buff, header))
+         derive_quantities( elem + n_objects++, SOLAR_GM);
+      }
+   fclose( ifile);
+   printf( "%d objects;  %ld pairs\n", n_objects,
+                  (long)n_objects * (long)( n_objects - 1) / 2L);
+   memset( &naive, 0, sizeof( naive));
+   memset( &batch, 0, sizeof( batch));
+   t0 = clock( );
+   for( i = 0; i < n_objects; i++)
+      for( j = i + 1; j < n_objects; j++)
+         if( elem[i].ecc < 1. || elem[j].ecc < 1.)
+            {
+            const double moid = (elem[j].ecc < elem[i].ecc ?
+                        find_moid_full( elem + j, elem + i, NULL) :
+                        find_moid_full( elem + i, elem + j, NULL));
+
+            if( moid <= max_moid)
+               add_moid_to_list( &naive, i, j, moid);
+            }
+   printf( "Naive loop : %d pairs within %f AU;  %.3f s\n", naive.n_hits,
+            max_moid, (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   t0 = clock( );
+   find_moids_batch( elem, n_objects, NULL, 0, max_moid, add_moid_to_list,
+                     &batch, &n_computed);
+   printf( "Batch      : %d pairs within %f AU;  %.3f s (%ld pairs computed)\n",
+            batch.n_hits, max_moid,
+            (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC, n_computed);
+   for( i = j = 0; i < naive.n_hits; i++)
+      {           /* both lists are in the same order,  so we can merge */
+      while( j < batch.n_hits && (batch.idx1[j] < naive.idx1[i]
+               || (batch.idx1[j] == naive.idx1[i] && batch.idx2[j] < naive.idx2[i])))
+         j++;
+      if( j == batch.n_hits || batch.idx1[j] != naive.idx1[i]
+               || batch.idx2[j] != naive.idx2[i] || batch.moid[j] != naive.moid[i])
+         {
+         printf( "Mismatch : %d %d %.10f\n", naive.idx1[i], naive.idx2[i],
+                                               naive.moid[i]);
+         n_mismatches++;
+         }
+      }
+   if( naive.n_hits != batch.n_hits)
+      n_mismatches++;
+   printf( "%d mismatches\n", n_mismatches);
+   for( i = 0; i < 8; i++)
+      setup_planet_elem( planets + i, i + 1, 0.);
+   batch.n_hits = 0;
+   t0 = clock( );
+   find_moids_batch( elem, n_objects, planets, 8, max_moid, add_moid_to_list,
+                     &batch, &n_computed);
+   printf( "Vs. planets: %d pairs within %f AU;  %.3f s (%ld pairs computed)\n",
+            batch.n_hits, max_moid,
+            (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC, n_computed);
+   free( naive.idx1);
+   free( naive.idx2);
+   free( naive.moid);
+   free( batch.idx1);
+   free( batch.idx2);
+   free( batch.moid);
+   free( elem);
+   return( n_mismatches);
+}
+
 int main( const int argc, const char **argv)
 {
    ELEMENTS elem, earth_elem;
@@ -96,6 +208,7 @@ int main( const int argc, const char **argv)
    char header[300], buff[300], obj_name[60];
    int i, planet_number = 3;
    bool elems_found = false, reversing = false, intraobject_check = false;
+   double batch_max_moid = 0.;
    moid_data_t mdata;
 
    *obj_name = '\0';
@@ -116,6 +229,9 @@ int main( const int argc, const char **argv)
             case 'i':
                intraobject_check = true;
                break;
+            case 'b':
+               batch_max_moid = atof( arg);
+               break;
             case 'f':
                ifilename = arg;
                break;
@@ -144,6 +260,8 @@ int main( const int argc, const char **argv)
    memset( &elem, 0, sizeof( ELEMENTS));
    if( intraobject_check)
       return( run_intraobject_check( header, ifile));
+   if( batch_max_moid)
+      return( run_batch_benchmark( header, ifile, batch_max_moid));
    while( fgets( buff, sizeof( buff), ifile))
       if( strstr( buff, obj_name))
          {
@@ -13,16 +13,37 @@ unified format.
 The asteroid elements can be in either 'mpcorb.dat' or 'MPCORB.DAT'.  For
 Find_Orb,  the file should be placed in ~./find_orb.   I'll make sure that
 other programs using this file (astcheck,  for example) look in that
-directory as well.  */
+directory as well.
+
+   Run with '-m' to add Earth and Jupiter MOID columns.  Computing those
+for the entire catalogue takes a while,  so the previous 'mpcorb.sof'
+(if it has MOID columns) is read first,  and MOIDs are only recomputed
+for objects whose orbits have changed since.  Build with 'make OPENMP=Y'
+to have the MOIDs computed in parallel.
+
+   'mpcorb.dat' is mapped into memory and converted in blocks of about a
+megabyte;  with OpenMP,  the blocks are converted in parallel.  Each
+block's output is written (or,  with '-m',  appended to the in-memory
+copy) in an 'ordered' section,  so the output is in input order,  and
+at most one block per thread is awaiting its turn at any time.
+
+   Run with '-d' to also write 'mpcorb.dif',  a diff from the previous
+'mpcorb.sof' to the new one (see write_sof_diff( ) below).  astcheck uses
+this to update its cached day data for only the records that changed.
+'mpc2sof -p' applies such a diff to 'mpcorb.sof' (use '-p(filename)' if
+it's not 'mpcorb.dif'),  so that updates can be distributed as diffs. */
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include <assert.h>
+#include <stdint.h>
 #include "watdefs.h"
 #include "date.h"
 #include "comets.h"
 #include "stringex.h"
+#include "mpc_func.h"
 
 long extract_mpcorb_dat( ELEMENTS *elem, const char *buff);
 
@@ -31,7 +52,8 @@ const double PI =
 #define GAUSS_K .01720209895
 #define SOLAR_GM (GAUSS_K * GAUSS_K)
 
-#define IS_POWER_OF_TWO( n)    (((n) & ((n)-1)) == 0)
+#define J2000 2451545.0
+#define MAX_OUT 200
 
 static int parse_elements_dot_comet( ELEMENTS *elem, const char *buff)
 {
@@ -99,6 +121,190 @@ static void output_sof( const ELEMENTS *elem, char *obuff)
                   elem->arg_per * 180. / PI, elem->ecc);
 }
 
+const char *sof_moid_header_end = "G .  |MOID_E   |MOID_J  ^\n";
+
+/* MOIDs depend only on the orbit (the epoch matters too,  since the
+planetary elements are computed for it).  If this hash of those values
+is unchanged,  the MOIDs from the previous run can be reused.   */
+
+static uint32_t orbit_hash( const ELEMENTS *elem)
+{
+   const double vals[7] = { elem->perih_time, elem->epoch, elem->q,
+                  elem->ecc, elem->incl, elem->asc_node, elem->arg_per };
+   const unsigned char *bytes = (const unsigned char *)vals;
+   uint32_t rval = 2166136261u;        /* FNV-1a */
+   size_t i;
+
+   for( i = 0; i < sizeof( vals); i++)
+      rval = (rval ^ bytes[i]) * 16777619u;
+   return( rval);
+}
+
+typedef struct
+{
+   char name[13];
+   uint32_t hash;
+   double moid[2];
+} prev_moid_t;
+
+static int prev_moid_compare( const void *a, const void *b)
+{
+   return( memcmp( a, b, 12));
+}
+
+/* Reads MOIDs from a previous run,  if there was one.  Returns NULL if
+the file isn't there,  has no MOID columns,  or its header can't be
+parsed (or we run out of memory);  in all those cases,  every MOID
+just gets computed afresh.   */
+
+static prev_moid_t *load_previous_moids( const char *filename, size_t *n_found)
+{
+   FILE *ifile = fopen( filename, "rb");
+   prev_moid_t *rval = NULL;
+   char header[400], buff[400];
+   size_t n_alloced = 0;
+   const char *moid_e, *moid_j;
+   void *plan;
+
+   *n_found = 0;
+   if( !ifile)
+      return( NULL);
+   if( !fgets( header, sizeof( header), ifile)
+               || !(moid_e = strstr( header, "|MOID_E"))
+               || !(moid_j = strstr( header, "|MOID_J")))
+      {
+      fclose( ifile);
+      return( NULL);
+      }
+   plan = compile_sof_header( header);
+   if( !plan)
+      {
+      fprintf( stderr, "Couldn't parse header of '%s';  computing all MOIDs\n",
+                     filename);
+      fclose( ifile);
+      return( NULL);
+      }
+   while( fgets( buff, sizeof( buff), ifile))
+      {
+      ELEMENTS elem;
+
+      if( strlen( buff) == strlen( header)
+                  && !extract_sof_data_compiled( &elem, buff, plan, NULL))
+         {
+         if( *n_found == n_alloced)
+            {
+            prev_moid_t *new_rval;
+
+            n_alloced = n_alloced * 2 + 1000;
+            new_rval = (prev_moid_t *)realloc( rval,
+                                          n_alloced * sizeof( prev_moid_t));
+            if( !new_rval)
+               {
+               free( rval);
+               rval = NULL;
+               *n_found = 0;
+               break;
+               }
+            rval = new_rval;
+            }
+         memcpy( rval[*n_found].name, buff, 12);
+         rval[*n_found].name[12] = '\0';
+         rval[*n_found].hash = orbit_hash( &elem);
+         rval[*n_found].moid[0] = atof( buff + (moid_e - header) + 1);
+         rval[*n_found].moid[1] = atof( buff + (moid_j - header) + 1);
+         (*n_found)++;
+         }
+      }
+   free_compiled_sof_header( plan);
+   fclose( ifile);
+   if( rval)
+      qsort( rval, *n_found, sizeof( prev_moid_t), prev_moid_compare);
+   return( rval);
+}
+
+/* The MOID columns are nine bytes wide.  That's six places below
+100 AU;  larger (and rarer) MOIDs get fewer places,  rather than
+overflowing into the next column and changing the record length. */
+
+static void format_moid( char *obuff, double moid)
+{
+   int n_places = 6;
+
+   if( moid > 999999999.)
+      moid = 999999999.;
+   while( n_places && moid >= pow( 10., (double)( 8 - n_places))
+                              - .5 * pow( 10., (double)-n_places))
+      n_places--;              /* i.e.,  would round up to ten bytes */
+   snprintf_err( obuff, 10, "%9.*f", n_places, moid);
+}
+
+/* Computes Earth and Jupiter MOIDs for each record in 'obuff',  reusing
+those from 'prev' for unchanged orbits.  Returns the number reused.  If
+the header can't be compiled,  we use the (slower) uncompiled parser. */
+
+static long compute_moids( const char *obuff, const long n_recs,
+            const size_t reclen, double *moids, const prev_moid_t *prev,
+            const size_t n_prev)
+{
+   long i, n_reused = 0;
+   void *plan = compile_sof_header( sof_header);
+
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( dynamic, 64) reduction( +:n_reused)
+#endif
+   for( i = 0; i < n_recs; i++)
+      {
+      char tbuff[MAX_OUT];
+      ELEMENTS elem;
+
+      memcpy( tbuff, obuff + i * reclen, reclen);
+      tbuff[reclen] = '\0';
+      moids[i * 2] = moids[i * 2 + 1] = 0.;
+      if( !(plan ? extract_sof_data_compiled( &elem, tbuff, plan, NULL)
+                 : extract_sof_data( &elem, tbuff, sof_header)))
+         {
+         const uint32_t hash = orbit_hash( &elem);
+         const prev_moid_t *prev_rec = (prev ? (const prev_moid_t *)bsearch(
+                     tbuff, prev, n_prev, sizeof( prev_moid_t),
+                     prev_moid_compare) : NULL);
+
+         if( prev_rec)     /* names needn't be unique;  check all matches */
+            {
+            while( prev_rec > prev && !prev_moid_compare( prev_rec - 1, tbuff))
+               prev_rec--;
+            while( prev_rec < prev + n_prev && prev_rec->hash != hash
+                           && !prev_moid_compare( prev_rec, tbuff))
+               prev_rec++;
+            if( prev_rec == prev + n_prev || prev_rec->hash != hash
+                           || prev_moid_compare( prev_rec, tbuff))
+               prev_rec = NULL;
+            }
+         if( prev_rec)
+            {
+            moids[i * 2] = prev_rec->moid[0];
+            moids[i * 2 + 1] = prev_rec->moid[1];
+            n_reused++;
+            }
+         else
+            {
+            const double t_cen = (elem.epoch - J2000) / 36525.;
+            int j;
+
+            for( j = 0; j < 2; j++)
+               {
+               ELEMENTS planet_elem;
+
+               setup_planet_elem( &planet_elem, (j ? 5 : 3), t_cen);
+               moids[i * 2 + j] = find_moid_full( &planet_elem, &elem, NULL);
+               }
+            }
+         }
+      }
+   if( plan)
+      free_compiled_sof_header( plan);
+   return( n_reused);
+}
+
 static FILE *err_fopen( const char *filename, const char *permits)
 {
    FILE *rval = fopen( filename, permits);
@@ -114,68 +320,518 @@ static FILE *err_fopen( const char *filename, const char *permits)
    return( rval);
 }
 
-#define MAX_OUT 200
+/* Converts one 'mpcorb.dat' line (which must be NUL-terminated) to an
+SOF record in 'tbuff'.  Returns 0 on success,  -1 if the line isn't an
+orbit (header text,  blank lines,  etc.)   */
+
+static int mpcorb_line_to_sof( char *tbuff, const char *buff)
+{
+   ELEMENTS elem;
+   char name[13], tfirst_buff[20];
+   double jd;
+
+   if( strlen( buff) != 203 || extract_mpcorb_dat( &elem, buff) <= 0L)
+      return( -1);
+   extract_name( name, buff);
+   snprintf_err( tbuff, 14, "%-13s", name);
+   output_sof( &elem, tbuff + 13);
+   snprintf_append( tbuff, MAX_OUT, "%.4s %.5s ",
+                buff + 137, buff + 117);         /* rms, number obs */
+   jd = get_time_from_string( 0., buff + 194, FULL_CTIME_YMD, NULL);
+   if( !memcmp( buff + 132, "days", 4))
+      jd -= atof( buff + 128);
+   else
+      {
+      int year1, year2, n_scanned;
+
+      n_scanned = sscanf( buff + 127, "%d-%d", &year1, &year2);
+      assert( n_scanned == 2);
+      assert( year1 > 1700);
+      assert( year2 >= year1);
+      assert( year2 < 2100);
+      jd -= (double)( 365 * (year2 - year1 + 1));
+      }
+   full_ctime( tfirst_buff, jd, FULL_CTIME_YMD | FULL_CTIME_NO_SPACES
+                     | FULL_CTIME_MONTHS_AS_DIGITS | FULL_CTIME_DATE_ONLY
+                     | FULL_CTIME_LEADING_ZEROES);
+   snprintf_append( tbuff, MAX_OUT, "%.8s %.8s %.7s %.5s %.5s\n",
+            tfirst_buff, buff + 194,             /* Tfirst, Tlast */
+            buff + 142, buff + 8, buff + 14);    /* perts, H, G */
+   return( 0);
+}
+
+/* Converts the lines from 'iptr' up to 'end',  storing SOF records in
+'obuff'.  Returns the number of records made.  */
+
+static size_t convert_mpcorb_block( char *obuff, const char *iptr,
+                                    const char *end, const size_t reclen)
+{
+   size_t n_out = 0;
+
+   while( iptr < end)
+      {
+      const char *eol = (const char *)memchr( iptr, '\n', end - iptr);
+      const size_t len = (eol ? eol + 1 : end) - iptr;
+      char buff[400], tbuff[MAX_OUT];
+
+      if( len < sizeof( buff))
+         {
+         memcpy( buff, iptr, len);
+         buff[len] = '\0';
+         if( !mpcorb_line_to_sof( tbuff, buff))
+            {
+            assert( strlen( tbuff) == reclen);
+            memcpy( obuff + n_out * reclen, tbuff, reclen);
+            n_out++;
+            }
+         }
+      iptr += len;
+      }
+   return( n_out);
+}
+
+/* Returns the start of the first line beginning at or after 'ptr'. */
+
+static const char *line_start( const char *buff, const char *ptr,
+                               const char *end)
+{
+   if( ptr > buff && ptr < end && ptr[-1] != '\n')
+      {
+      ptr = (const char *)memchr( ptr, '\n', end - ptr);
+      ptr = (ptr ? ptr + 1 : end);
+      }
+   return( ptr < end ? ptr : end);
+}
+
+/* With '-d',  a diff between the previous 'mpcorb.sof' and the new one
+is written to 'mpcorb.dif',  so that astcheck can update its cached
+day data for just the records that changed (and so that the new file can
+be made from the old one with '-p';  see apply_sof_diff( ) below).  The
+diff is text.  The first line gives the number of records and the
+sampled checksum (see get_sof_file_checksum( ) in sof.cpp) of the old
+and new files,  then a checksum of the full contents of each (see
+get_sof_file_full_checksum( ),  also in sof.cpp;  the sampled checksum
+can't tell apart files differing in a few records,  so astcheck relies
+on the full one).  The second line is the header of the new file.  The
+records of the new file are then described in order,  by lines of the
+forms
+
+= (idx) (n)       the next n records are records idx,  idx+1,  ... of the
+                  old file (counting from zero,  not counting the header)
++ (n)             the next n records are given in the following n lines
+
+   Records are matched by name,  then by a hash of the entire record,
+and finally by comparing the records themselves (so a hash collision
+can't cause a changed record to be missed).  A record counts as changed
+if anything in it (number of observations,  H,  etc.) changed,  even if
+the orbit didn't.  */
+
+typedef struct
+{
+   char name[13];
+   uint32_t hash;
+   long idx;
+   const char *rec;           /* points into the text of the old file */
+   size_t len;
+} prev_rec_t;
+
+   /* Same FNV-1a hash as get_sof_file_full_checksum( ),  so that the */
+   /* full checksum can also be computed on a file already in memory.  */
+#define FNV_SEED 2166136261u
+
+static uint32_t fnv_hash( uint32_t hash, const char *buff, const size_t len)
+{
+   size_t i;
+
+   for( i = 0; i < len; i++)                 /* FNV-1a */
+      hash = (hash ^ (unsigned char)buff[i]) * 16777619u;
+   return( hash);
+}
+
+static int prev_rec_compare( const void *a, const void *b)
+{
+   const prev_rec_t *aptr = (const prev_rec_t *)a;
+   const prev_rec_t *bptr = (const prev_rec_t *)b;
+   const int rval = memcmp( aptr->name, bptr->name, 12);
+
+   if( rval)
+      return( rval);
+   return( (aptr->idx > bptr->idx) - (aptr->idx < bptr->idx));
+}
+
+/* Reads the previous SOF file into '*text' (which the caller frees),
+along with the names and record hashes of its records,  its header,
+record count,  astcheck checksum,  and full checksum.  Returns NULL if the
+file isn't there.  */
+
+static prev_rec_t *load_previous_records( const char *filename,
+         char *header, const size_t header_size, long *n_recs,
+         int32_t *checksum, uint32_t *full_checksum, char **text)
+{
+   FILE *ifile = fopen( filename, "rb");
+   prev_rec_t *rval = NULL;
+   size_t n_alloced = 0, file_size, len;
+   const char *tptr, *end, *eol;
+
+   *n_recs = 0;
+   *text = NULL;
+   if( !ifile)
+      return( NULL);
+   *checksum = get_sof_file_checksum( ifile);
+   fseek( ifile, 0L, SEEK_END);
+   file_size = (size_t)ftell( ifile);
+   fseek( ifile, 0L, SEEK_SET);
+   *text = (char *)malloc( file_size + 1);
+   if( !*text || fread( *text, 1, file_size, ifile) != file_size
+              || !(eol = (const char *)memchr( *text, '\n', file_size)))
+      {
+      fclose( ifile);
+      free( *text);
+      *text = NULL;
+      return( NULL);
+      }
+   fclose( ifile);
+   (*text)[file_size] = '\0';
+   *full_checksum = fnv_hash( FNV_SEED, *text, file_size);
+   len = eol - *text + 1;
+   if( len >= header_size)
+      len = header_size - 1;
+   memcpy( header, *text, len);
+   header[len] = '\0';
+   end = *text + file_size;
+   for( tptr = eol + 1; tptr < end; tptr += len)
+      {
+      eol = (const char *)memchr( tptr, '\n', end - tptr);
+      len = (eol ? eol + 1 : end) - tptr;
+      if( (size_t)*n_recs == n_alloced)
+         {
+         n_alloced = n_alloced * 2 + 1000;
+         rval = (prev_rec_t *)realloc( rval, n_alloced * sizeof( prev_rec_t));
+         assert( rval);
+         }
+      memset( rval[*n_recs].name, 0, sizeof( rval[*n_recs].name));
+      memcpy( rval[*n_recs].name, tptr, (len < 12 ? len : 12));
+      rval[*n_recs].hash = fnv_hash( FNV_SEED, tptr, len);
+      rval[*n_recs].idx = *n_recs;
+      rval[*n_recs].rec = tptr;
+      rval[*n_recs].len = len;
+      (*n_recs)++;
+      }
+   if( !rval)        /* header,  but no records */
+      rval = (prev_rec_t *)malloc( sizeof( prev_rec_t));
+   qsort( rval, *n_recs, sizeof( prev_rec_t), prev_rec_compare);
+   return( rval);
+}
+
+/* Finds the index of the old record identical to 'rec',  or -1 if there
+is none.  If several match (duplicated records),  the one following
+'prev_idx' is preferred,  so that runs of copied records aren't broken. */
+
+static long find_previous_record( const prev_rec_t *prev, const long n_prev,
+                           const char *rec, const long prev_idx)
+{
+   const size_t len = strlen( rec);
+   const uint32_t hash = fnv_hash( FNV_SEED, rec, len);
+   long lo = 0, hi = n_prev, rval = -1;
+
+   while( lo < hi)            /* find first record with this name */
+      {
+      const long mid = (lo + hi) / 2;
+
+      if( memcmp( prev[mid].name, rec, 12) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+      }
+   while( lo < n_prev && !memcmp( prev[lo].name, rec, 12))
+      {
+      if( prev[lo].hash == hash && prev[lo].len == len
+                                && !memcmp( prev[lo].rec, rec, len))
+         {
+         if( rval < 0 || prev[lo].idx == prev_idx + 1)
+            rval = prev[lo].idx;
+         }
+      lo++;
+      }
+   return( rval);
+}
+
+static void flush_diff_run( FILE *ofile, const long copy_start,
+               long *n_copied, char *changed, const size_t reclen,
+               long *n_changed)
+{
+   if( *n_copied)
+      fprintf( ofile, "= %ld %ld\n", copy_start, *n_copied);
+   if( *n_changed)
+      {
+      fprintf( ofile, "+ %ld\n", *n_changed);
+      fwrite( changed, reclen, *n_changed, ofile);
+      }
+   *n_copied = *n_changed = 0;
+}
+
+/* Compares the newly written 'sof_filename' to the previous version
+(described by 'prev' et al.),  writing the diff to 'diff_filename'.
+Returns the number of records that changed.  */
+
+static long write_sof_diff( const char *diff_filename,
+         const char *sof_filename, const prev_rec_t *prev, long n_prev,
+         const char *prev_header, const int32_t prev_checksum,
+         const uint32_t prev_full_checksum)
+{
+   FILE *ifile = err_fopen( sof_filename, "rb");
+   FILE *ofile = err_fopen( diff_filename, "wb");
+   const int32_t checksum = get_sof_file_checksum( ifile);
+   const uint32_t full_checksum = get_sof_file_full_checksum( ifile);
+   char header[400], buff[400], *changed;
+   long n_recs, filelen, n_copied = 0, n_changed = 0, n_total_changed = 0;
+   long copy_start = 0, idx;
+   size_t reclen, n_alloced = 1000;
+
+   if( !fgets( header, sizeof( header), ifile))
+      {
+      fprintf( stderr, "Couldn't read '%s'\n", sof_filename);
+      exit( -1);
+      }
+   reclen = strlen( header);
+   fseek( ifile, 0L, SEEK_END);
+   filelen = ftell( ifile);
+   n_recs = filelen / (long)reclen - 1;
+   fseek( ifile, (long)reclen, SEEK_SET);
+   fprintf( ofile, "# SOF diff %ld %ld %ld %ld %lu %lu\n%s", n_prev,
+                  (long)prev_checksum, n_recs, (long)checksum,
+                  (unsigned long)prev_full_checksum,
+                  (unsigned long)full_checksum, header);
+   if( strcmp( header, prev_header))   /* layout changed;  nothing in */
+      n_prev = 0;                      /* common with the old file   */
+   changed = (char *)malloc( n_alloced * reclen);
+   assert( changed);
+   while( fgets( buff, sizeof( buff), ifile))
+      {
+      idx = find_previous_record( prev, n_prev, buff,
+                           copy_start + n_copied - 1);
+      if( idx >= 0 && n_copied && idx == copy_start + n_copied && !n_changed)
+         n_copied++;
+      else if( idx >= 0)
+         {
+         flush_diff_run( ofile, copy_start, &n_copied, changed, reclen,
+                                       &n_changed);
+         copy_start = idx;
+         n_copied = 1;
+         }
+      else
+         {
+         if( n_copied)
+            flush_diff_run( ofile, copy_start, &n_copied, changed, reclen,
+                                       &n_changed);
+         if( (size_t)n_changed == n_alloced)
+            {
+            n_alloced *= 2;
+            changed = (char *)realloc( changed, n_alloced * reclen);
+            assert( changed);
+            }
+         memcpy( changed + n_changed * reclen, buff, reclen);
+         n_changed++;
+         n_total_changed++;
+         }
+      }
+   flush_diff_run( ofile, copy_start, &n_copied, changed, reclen, &n_changed);
+   free( changed);
+   fclose( ifile);
+   fclose( ofile);
+   return( n_total_changed);
+}
+
+/* Makes a new 'sof_filename' from the old one and the diff written by
+write_sof_diff( ).  The old file must be the one from which the diff was
+made (checked with the full checksum of its contents).  Returns 0 on
+success,  -1 if it isn't,  or -2 if the diff is garbled (including if
+the result doesn't match the full checksum of the file it should make).
+The old file is only replaced on success.  */
+
+static int apply_sof_diff( const char *diff_filename, const char *sof_filename)
+{
+   FILE *ifile = err_fopen( diff_filename, "rb");
+   FILE *ofile;
+   char buff[400], header[400], temp_filename[400];
+   long old_n, new_n, old_checksum, new_checksum, idx, count, n_out = 0;
+   unsigned long old_full_checksum, new_full_checksum;
+   size_t reclen, old_reclen = 0, file_size = 0;
+   const char *mapped, *eol;
+   int rval = 0;
+
+   if( !fgets( buff, sizeof( buff), ifile)
+         || 6 != sscanf( buff, "# SOF diff %ld %ld %ld %ld %lu %lu", &old_n,
+                           &old_checksum, &new_n, &new_checksum,
+                           &old_full_checksum, &new_full_checksum)
+         || !fgets( header, sizeof( header), ifile))
+      {
+      fprintf( stderr, "'%s' isn't an SOF diff\n", diff_filename);
+      fclose( ifile);
+      return( -2);
+      }
+   reclen = strlen( header);
+   mapped = map_file( sof_filename, &file_size);
+   if( mapped && (eol = (const char *)memchr( mapped, '\n', file_size)) != NULL)
+      old_reclen = eol - mapped + 1;
+   if( !old_reclen || file_size != (size_t)( old_n + 1) * old_reclen
+                   || fnv_hash( FNV_SEED, mapped, file_size)
+                                    != (uint32_t)old_full_checksum)
+      {
+      fprintf( stderr, "'%s' isn't the file from which '%s' was made\n",
+                     sof_filename, diff_filename);
+      rval = -1;
+      }
+   snprintf_err( temp_filename, sizeof( temp_filename), "%s.tmp", sof_filename);
+   ofile = err_fopen( temp_filename, "wb");
+   fwrite( header, reclen, 1, ofile);
+   while( !rval && fgets( buff, sizeof( buff), ifile))
+      if( *buff == '=' && 2 == sscanf( buff + 1, "%ld %ld", &idx, &count)
+               && idx >= 0 && idx + count <= old_n && old_reclen == reclen)
+         {
+         fwrite( mapped + (idx + 1) * reclen, reclen, count, ofile);
+         n_out += count;
+         }
+      else if( *buff == '+' && 1 == sscanf( buff + 1, "%ld", &count))
+         {
+         while( !rval && count--)
+            if( !fgets( buff, sizeof( buff), ifile) || strlen( buff) != reclen)
+               rval = -2;
+            else
+               {
+               fwrite( buff, reclen, 1, ofile);
+               n_out++;
+               }
+         }
+      else
+         rval = -2;
+   fclose( ifile);
+   fclose( ofile);
+   if( mapped)
+      unmap_file( mapped, file_size);
+   if( !rval && n_out != new_n)
+      rval = -2;
+   if( !rval)
+      {
+      ofile = err_fopen( temp_filename, "rb");
+      if( get_sof_file_full_checksum( ofile) != (uint32_t)new_full_checksum)
+         rval = -2;
+      fclose( ofile);
+      }
+   if( rval == -2)
+      fprintf( stderr, "'%s' is garbled\n", diff_filename);
+   if( !rval)
+      {
+      remove( sof_filename);
+      rename( temp_filename, sof_filename);
+      }
+   else
+      remove( temp_filename);
+   return( rval);
+}
+
+#define BLOCK_SIZE (1 << 20)
+#define MPCORB_LINE_LEN 203
 
 int main( const int argc, const char **argv)
 {
    const size_t reclen = strlen( sof_header);
    char buff[400], *obuff = NULL;
    char tbuff[MAX_OUT];
-   FILE *ifile = fopen( (argc > 1 ? argv[1] : "mpcorb.dat"), "rb");
-   FILE *ofile = err_fopen( "mpcorb.sof", "wb");
+   const char *args[2] = { NULL, NULL};
+   const char *mapped;
+   FILE *ifile, *ofile = NULL, *comet_file = NULL;
    ELEMENTS elem;
-   long epoch;
-   int i;
-   size_t n_out = 0, n_written;
+   int i, n_args = 0, n_blocks;
+   size_t n_out = 0, n_alloced = 0, n_written, file_size = 0;
+   bool compute_moid_columns = false, write_diff = false;
+   prev_rec_t *prev_recs = NULL;
+   long n_prev_recs = 0;
+   int32_t prev_checksum = 0;
+   uint32_t prev_full_checksum = 0;
+   char prev_header[400], *prev_text = NULL;
 
-   if( !ifile)
-      ifile = err_fopen( "MPCORB.DAT", "rb");
-// while( fgets( buff, sizeof( buff), ifile) && memcmp( buff, "------", 6))
-//    ;           /* skip over header */
-   fprintf( ofile, "%s", sof_header);
-   while( fgets( buff, sizeof( buff), ifile))
-      if( strlen( buff) == 203 &&
-                       (epoch = extract_mpcorb_dat( &elem, buff)) > 0L)
+   for( i = 1; i < argc; i++)
+      if( !strcmp( argv[i], "-m"))
+         compute_moid_columns = true;
+      else if( !strcmp( argv[i], "-d"))
+         write_diff = true;
+      else if( !strncmp( argv[i], "-p", 2))
+         return( apply_sof_diff( (argv[i][2] ? argv[i] + 2 : "mpcorb.dif"),
+                                 "mpcorb.sof"));
+      else if( n_args < 2)
+         args[n_args++] = argv[i];
+   if( write_diff)
+      {
+      prev_recs = load_previous_records( "mpcorb.sof", prev_header,
+                        sizeof( prev_header), &n_prev_recs, &prev_checksum,
+                        &prev_full_checksum, &prev_text);
+      if( !prev_recs)
+         printf( "No previous 'mpcorb.sof';  no diff will be written\n");
+      }
+   mapped = map_file( (args[0] ? args[0] : "mpcorb.dat"), &file_size);
+   if( !mapped)
+      mapped = map_file( "MPCORB.DAT", &file_size);
+   if( !mapped)         /* either it's not there,  or it's empty */
+      fclose( err_fopen( (args[0] ? args[0] : "MPCORB.DAT"), "rb"));
+   if( !args[1] || strcmp( args[1], "i"))
+      comet_file = err_fopen( (args[1] ? args[1] : "ELEMENTS.COMET"), "rb");
+   if( !compute_moid_columns)
+      {                 /* we can stream output as we go */
+      ofile = err_fopen( "mpcorb.sof", "wb");
+      fprintf( ofile, "%s", sof_header);
+      }
+   n_blocks = (int)( (file_size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+#ifdef _OPENMP
+   #pragma omp parallel for ordered schedule( dynamic, 1)
+#endif
+   for( i = 0; i < n_blocks; i++)
+      {
+      const char *end = mapped + file_size;
+      const char *block_start = mapped + (size_t)i * BLOCK_SIZE;
+      const char *block_end = block_start + BLOCK_SIZE;
+      size_t n_recs;
+      char *block_buff;
+
+            /* Lines belong to the block in which they start : */
+      block_start = line_start( mapped, block_start, end);
+      block_end = line_start( mapped, (i == n_blocks - 1 ? end : block_end), end);
+      block_buff = (char *)malloc( ((block_end - block_start)
+                                 / MPCORB_LINE_LEN + 1) * reclen);
+      assert( block_buff);
+      n_recs = convert_mpcorb_block( block_buff, block_start, block_end,
+                                                      reclen);
+#ifdef _OPENMP
+      #pragma omp ordered
+#endif
          {
-         char name[13], tfirst_buff[20];
-         double jd;
-
-         extract_name( name, buff);
-         snprintf_err( tbuff, 14, "%-13s", name);
-         output_sof( &elem, tbuff + 13);
-         snprintf_append( tbuff, sizeof( tbuff), "%.4s %.5s ",
-                      buff + 137, buff + 117);         /* rms, number obs */
-         jd = get_time_from_string( 0., buff + 194, FULL_CTIME_YMD, NULL);
-         if( !memcmp( buff + 132, "days", 4))
-            jd -= atof( buff + 128);
+         if( ofile)
+            {
+            n_written = fwrite( block_buff, reclen, n_recs, ofile);
+            assert( n_written == n_recs);
+            }
          else
             {
-            int year1, year2, n_scanned;
-
-            n_scanned = sscanf( buff + 127, "%d-%d", &year1, &year2);
-            assert( n_scanned == 2);
-            assert( year1 > 1700);
-            assert( year2 >= year1);
-            assert( year2 < 2100);
-            jd -= (double)( 365 * (year2 - year1 + 1));
+            if( n_out + n_recs > n_alloced)
+               {
+               n_alloced = (n_out + n_recs) * 2;
+               obuff = (char *)realloc( obuff, n_alloced * reclen);
+               assert( obuff);
+               }
+            memcpy( obuff + n_out * reclen, block_buff, n_recs * reclen);
             }
-         full_ctime( tfirst_buff, jd, FULL_CTIME_YMD | FULL_CTIME_NO_SPACES
-                           | FULL_CTIME_MONTHS_AS_DIGITS | FULL_CTIME_DATE_ONLY
-                           | FULL_CTIME_LEADING_ZEROES);
-         snprintf_append( tbuff, sizeof( tbuff), "%.8s %.8s %.7s %.5s %.5s\n",
-                  tfirst_buff, buff + 194,             /* Tfirst, Tlast */
-                  buff + 142, buff + 8, buff + 14);    /* perts, H, G */
-         assert( strlen( tbuff) == reclen);
-         n_out++;
-         if( IS_POWER_OF_TWO( n_out))
-            obuff = (char *)realloc( obuff, n_out * 2 * reclen);
-         memcpy( obuff + (n_out - 1) * reclen, tbuff, reclen);
+         n_out += n_recs;
          }
-   fclose( ifile);
+      free( block_buff);
+      }
+   if( mapped)
+      unmap_file( mapped, file_size);
 
-   if( argc <= 2 || strcmp( argv[2], "i"))
+   if( comet_file)
       {
-      ifile = err_fopen( (argc > 2 ? argv[2] : "ELEMENTS.COMET"), "rb");
+      size_t n_comets = 0;
+
+      ifile = comet_file;
       for( i = 0; i < 2; i++)       /* ELEMENTS.COMET has two header lines */
          if( !fgets( buff, sizeof( buff), ifile))
             {
@@ -211,14 +867,60 @@ int main( const int argc, const char **argv)
             strcat( tbuff, "           ");    /* rms, number obs */
             strcat( tbuff, "                                     \n");     /* Tlast, perts, H, G */
             assert( strlen( tbuff) == reclen);
-            memcpy( obuff + n_out * reclen, tbuff, reclen);
-            n_out++;
+            if( ofile)
+               fwrite( tbuff, reclen, 1, ofile);
+            else
+               {
+               if( n_out + n_comets >= n_alloced)
+                  {
+                  n_alloced = n_alloced * 2 + 1000;
+                  obuff = (char *)realloc( obuff, n_alloced * reclen);
+                  assert( obuff);
+                  }
+               memcpy( obuff + (n_out + n_comets) * reclen, tbuff, reclen);
+               }
+            n_comets++;
             }
+      n_out += n_comets;
       fclose( ifile);
       }
-   n_written = fwrite( obuff, reclen, n_out, ofile);
-   assert( n_written == n_out);
+   if( compute_moid_columns)
+      {
+      size_t n_prev;
+      prev_moid_t *prev = load_previous_moids( "mpcorb.sof", &n_prev);
+      double *moids = (double *)malloc( (n_out * 2 + 1) * sizeof( double));
+      long n_reused;
+
+      assert( moids);
+      n_reused = compute_moids( obuff, (long)n_out, reclen, moids, prev, n_prev);
+      printf( "%ld of %ld MOIDs reused\n", n_reused, (long)n_out);
+      free( prev);
+      ofile = err_fopen( "mpcorb.sof", "wb");
+      fprintf( ofile, "%.*s%s", (int)( reclen - 6), sof_header,
+                                                sof_moid_header_end);
+      for( n_written = 0; n_written < n_out; n_written++)
+         {
+         char moid_e[10], moid_j[10];
+
+         format_moid( moid_e, moids[n_written * 2]);
+         format_moid( moid_j, moids[n_written * 2 + 1]);
+         fwrite( obuff + n_written * reclen, reclen - 1, 1, ofile);
+         fprintf( ofile, " %s %s\n", moid_e, moid_j);
+         }
+      free( moids);
+      }
    free( obuff);
    fclose( ofile);
+   if( prev_recs)
+      {
+      const long n_changed = write_sof_diff( "mpcorb.dif", "mpcorb.sof",
+                     prev_recs, n_prev_recs, prev_header, prev_checksum,
+                     prev_full_checksum);
+
+      printf( "%ld of %ld records changed;  diff written to 'mpcorb.dif'\n",
+                     n_changed, (long)n_out);
+      free( prev_recs);
+      free( prev_text);
+      }
    return( 0);
 }
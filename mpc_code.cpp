@@ -22,6 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #include <stdio.h>
 #include <ctype.h>
 #include <time.h>
+#include <stdint.h>
+#include <sys/stat.h>
 #include "watdefs.h"
 #include "mpc_func.h"
 #include "lunar.h"
@@ -770,6 +772,291 @@ int get_xxx_location_info( mpc_code_t *cinfo, const char *buff)
    return( rval);
 }
 
+/* Tools that handle many stations (astcheck,  for example) used to rescan
+ObsCodes.html each time the station changed.  load_mpc_code_table( ) instead
+parses ObsCodes.html (and,  optionally,  rovers.txt and similar files) once
+into an array of mpc_code_t with the parallax constants already computed,
+indexed by an open-addressing hash table,  so that find_mpc_code( ) is O(1).
+If a station appears in more than one file,  the first file given "wins";
+put ObsCodes.html ahead of rovers.txt.
+
+   If 'cache_filename' is non-NULL,  the parsed table is written to that file
+in binary form,  along with the size and modification time of each source
+file.  On later runs,  the table is read from the cache unless one of the
+source files has changed.  The cache is a raw dump of the structures,  so
+it's only meaningful on the machine (and with the build) that wrote it;
+the header includes enough to reject a cache from some other build.
+Failure to write the cache is silently ignored.      */
+
+typedef struct
+{
+   int n_codes, hash_size;
+   mpc_code_t *codes;
+   uint32_t *name_offsets;
+   int *hash;           /* index into codes[] + 1;  zero = empty slot */
+   char *names;
+   size_t names_size;
+} mpc_code_table_t;
+
+#define CODE_TABLE_MAGIC      0x0b5c0de5
+#define CODE_TABLE_VERSION    1
+#define N_CACHE_HEADER        6
+
+static uint32_t hash_mpc_code( const char *code)
+{
+   uint32_t rval = 2166136261u;      /* FNV-1a */
+   size_t i;
+
+   for( i = 0; i < 4 && code[i] > ' ' && code[i] != '!'; i++)
+      rval = (rval ^ (uint32_t)(unsigned char)code[i]) * 16777619u;
+   return( rval);
+}
+
+static bool mpc_codes_match( const char *code, const char *key)
+{
+   size_t i;
+
+   for( i = 0; i < 4 && key[i] > ' ' && key[i] != '!'; i++)
+      if( code[i] != key[i])
+         return( false);
+   return( i == 4 || !code[i]);
+}
+
+/* Builds the hash table,  dropping any codes that already appeared
+earlier in the list,  and sets the name pointers (which can only be done
+once the names buffer has stopped moving around).     */
+
+static void build_mpc_code_hash( mpc_code_table_t *table)
+{
+   int i, n_unique = 0;
+
+   table->hash_size = 16;
+   while( table->hash_size < table->n_codes * 2)
+      table->hash_size <<= 1;
+   table->hash = (int *)calloc( table->hash_size, sizeof( int));
+   assert( table->hash);
+   for( i = 0; i < table->n_codes; i++)
+      {
+      const char *code = table->codes[i].code;
+      uint32_t loc = hash_mpc_code( code);
+      int idx;
+      bool is_duplicate = false;
+
+      while( !is_duplicate
+              && (idx = table->hash[loc & (table->hash_size - 1)]) != 0)
+         {
+         is_duplicate = mpc_codes_match( table->codes[idx - 1].code, code);
+         loc++;
+         }
+      if( !is_duplicate)
+         {
+         table->codes[n_unique] = table->codes[i];
+         table->name_offsets[n_unique] = table->name_offsets[i];
+         table->hash[loc & (table->hash_size - 1)] = ++n_unique;
+         }
+      }
+   table->n_codes = n_unique;
+   for( i = 0; i < n_unique; i++)
+      table->codes[i].name = table->names + table->name_offsets[i];
+}
+
+const mpc_code_t *find_mpc_code( const void *table_ptr, const char *code)
+{
+   const mpc_code_table_t *table = (const mpc_code_table_t *)table_ptr;
+   uint32_t loc = hash_mpc_code( code);
+   int idx;
+
+   while( (idx = table->hash[loc & (table->hash_size - 1)]) != 0)
+      {
+      if( mpc_codes_match( table->codes[idx - 1].code, code))
+         return( table->codes + idx - 1);
+      loc++;
+      }
+   return( NULL);
+}
+
+void free_mpc_code_table( void *table_ptr)
+{
+   mpc_code_table_t *table = (mpc_code_table_t *)table_ptr;
+
+   if( table)
+      {
+      free( table->codes);
+      free( table->name_offsets);
+      free( table->hash);
+      free( table->names);
+      free( table);
+      }
+}
+
+static void add_mpc_code( mpc_code_table_t *table, const mpc_code_t *cinfo,
+                              int *n_alloced, size_t *names_alloced)
+{
+   size_t len = 0;
+
+   while( (unsigned char)cinfo->name[len] >= ' ')
+      len++;
+   if( table->n_codes == *n_alloced)
+      {
+      *n_alloced = (*n_alloced ? *n_alloced * 2 : 1024);
+      table->codes = (mpc_code_t *)realloc( table->codes,
+                                 *n_alloced * sizeof( mpc_code_t));
+      table->name_offsets = (uint32_t *)realloc( table->name_offsets,
+                                 *n_alloced * sizeof( uint32_t));
+      assert( table->codes && table->name_offsets);
+      }
+   while( table->names_size + len + 1 > *names_alloced)
+      {
+      *names_alloced = (*names_alloced ? *names_alloced * 2 : 32768);
+      table->names = (char *)realloc( table->names, *names_alloced);
+      assert( table->names);
+      }
+   table->codes[table->n_codes] = *cinfo;
+   table->codes[table->n_codes].name = NULL;
+   table->name_offsets[table->n_codes++] = (uint32_t)table->names_size;
+   memcpy( table->names + table->names_size, cinfo->name, len);
+   table->names_size += len;
+   table->names[table->names_size++] = '\0';
+}
+
+/* The 'signature' of the source files is their sizes and modification
+times (-1 for missing files),  plus enough about the build to reject
+caches made by some other one.      */
+
+static void get_source_signature( int64_t *sig, const char **filenames,
+                                  const int n_files)
+{
+   int i;
+
+   sig[0] = CODE_TABLE_MAGIC;
+   sig[1] = CODE_TABLE_VERSION;
+   sig[2] = (int64_t)sizeof( mpc_code_t);
+   sig[3] = n_files;
+   for( i = 0; i < n_files; i++)
+      {
+      struct stat st;
+
+      if( stat( filenames[i], &st))
+         sig[N_CACHE_HEADER + i * 2] = sig[N_CACHE_HEADER + i * 2 + 1] = -1;
+      else
+         {
+         sig[N_CACHE_HEADER + i * 2] = (int64_t)st.st_size;
+         sig[N_CACHE_HEADER + i * 2 + 1] = (int64_t)st.st_mtime;
+         }
+      }
+}
+
+static mpc_code_table_t *load_cached_mpc_codes( const char *cache_filename,
+                                 const int64_t *sig, const size_t sig_size)
+{
+   FILE *ifile = fopen( cache_filename, "rb");
+   int64_t *file_sig = (int64_t *)malloc( sig_size * sizeof( int64_t));
+   mpc_code_table_t *table = NULL;
+
+   if( ifile && file_sig
+           && sig_size == fread( file_sig, sizeof( int64_t), sig_size, ifile)
+           && !memcmp( file_sig, sig, (sig_size - 2) * sizeof( int64_t)))
+      {
+      const int n_codes = (int)file_sig[sig_size - 2];
+      const size_t names_size = (size_t)file_sig[sig_size - 1];
+
+      table = (mpc_code_table_t *)calloc( 1, sizeof( mpc_code_table_t));
+      assert( table);
+      table->n_codes = n_codes;
+      table->names_size = names_size;
+      table->codes = (mpc_code_t *)malloc( (n_codes + 1) * sizeof( mpc_code_t));
+      table->name_offsets = (uint32_t *)malloc( (n_codes + 1) * sizeof( uint32_t));
+      table->names = (char *)malloc( names_size + 1);
+      if( !table->codes || !table->name_offsets || !table->names
+         || (size_t)n_codes != fread( table->codes, sizeof( mpc_code_t), n_codes, ifile)
+         || (size_t)n_codes != fread( table->name_offsets, sizeof( uint32_t), n_codes, ifile)
+         || names_size != fread( table->names, 1, names_size, ifile))
+         {
+         free_mpc_code_table( table);
+         table = NULL;
+         }
+      }
+   if( ifile)
+      fclose( ifile);
+   free( file_sig);
+   return( table);
+}
+
+static void save_cached_mpc_codes( const char *cache_filename,
+              int64_t *sig, const size_t sig_size, const mpc_code_table_t *table)
+{
+   FILE *ofile = fopen( cache_filename, "wb");
+
+   if( ofile)
+      {
+      sig[sig_size - 2] = table->n_codes;
+      sig[sig_size - 1] = (int64_t)table->names_size;
+      fwrite( sig, sizeof( int64_t), sig_size, ofile);
+      fwrite( table->codes, sizeof( mpc_code_t), table->n_codes, ofile);
+      fwrite( table->name_offsets, sizeof( uint32_t), table->n_codes, ofile);
+      fwrite( table->names, 1, table->names_size, ofile);
+      fclose( ofile);
+      }
+}
+
+void *load_mpc_code_table( const char **filenames, const int n_files,
+                           const char *cache_filename)
+{
+   const size_t sig_size = N_CACHE_HEADER + n_files * 2 + 2;
+   int64_t *sig = (int64_t *)calloc( sig_size, sizeof( int64_t));
+   mpc_code_table_t *table = NULL;
+   int i;
+
+   assert( sig);
+   get_source_signature( sig, filenames, n_files);
+   if( cache_filename)
+      table = load_cached_mpc_codes( cache_filename, sig, sig_size);
+   if( !table)
+      {
+      int n_alloced = 0;
+      size_t names_alloced = 0;
+
+      table = (mpc_code_table_t *)calloc( 1, sizeof( mpc_code_table_t));
+      assert( table);
+      for( i = 0; i < n_files; i++)
+         {
+         FILE *ifile = fopen( filenames[i], "rb");
+         char buff[300];
+
+         if( ifile)
+            {
+            while( fgets( buff, sizeof( buff), ifile))
+               {
+               mpc_code_t cinfo;
+
+               if( get_mpc_code_info( &cinfo, buff) != -1)
+                  {        /* short rovers.txt lines can lack a name : */
+                  if( cinfo.name > buff + strlen( buff) && cinfo.name < buff + sizeof( buff))
+                     cinfo.name = "";
+                  add_mpc_code( table, &cinfo, &n_alloced, &names_alloced);
+                  }
+               }
+            fclose( ifile);
+            }
+         }
+      if( !table->n_codes)
+         {
+         free_mpc_code_table( table);
+         table = NULL;
+         }
+      else
+         {
+         build_mpc_code_hash( table);
+         if( cache_filename)
+            save_cached_mpc_codes( cache_filename, sig, sig_size, table);
+         }
+      }
+   else
+      build_mpc_code_hash( table);
+   free( sig);
+   return( table);
+}
+
 #ifdef TEST_CODE
 
 static int _text_search_and_replace( char *str, const char *oldstr,
@@ -56,6 +56,10 @@ int DLL_FUNC text_search_and_replace( char *str, const char *oldstr,
 int get_mpc_code_info( mpc_code_t *cinfo, const char *buff);
 int get_xxx_location_info( mpc_code_t *cinfo, const char *buff);
 int get_lat_lon_info( mpc_code_t *cinfo, const char *buff);
+void *load_mpc_code_table( const char **filenames, const int n_files,
+                           const char *cache_filename);
+const mpc_code_t *find_mpc_code( const void *table, const char *code);
+void free_mpc_code_table( void *table);          /* mpc_code.cpp */
 double get_ra_from_string( const char *buff, int *bytes_read);
 double get_dec_from_string( const char *buff, int *bytes_read);
 void output_angle_to_buff( char *obuff, double angle, int precision);
@@ -76,6 +80,42 @@ int xlate_ades2mpc_in_place( void *context, char *buff);
 int free_ades2mpc_context( void *context);
 int fgets_with_ades_xlation( char *buff, const size_t len,
                                       void *ades_context, FILE *ifile);
+
+typedef struct
+{
+   long double t2k;        /* observation time,  UTC,  days from J2000 */
+   double ra, dec;         /* in degrees */
+   double sigma_ra, sigma_dec, sigma_corr;   /* arcsec;  zero if not given */
+   double sigma_time;      /* seconds;  zero if not given */
+   double mag, sigma_mag;  /* zero if not given */
+   char desig[26], stn[5], band[4], mode[4];
+} ades_obs_t;
+
+void *init_ades_reader( const char *buff, const size_t buff_len);
+void *init_ades_file_reader( FILE *ifile);
+int get_next_ades_observation( void *reader_context, ades_obs_t *obs);
+void free_ades_reader( void *reader);
+
+typedef struct
+{
+   double jd, ra, dec;     /* RA/dec in radians */
+   size_t offset;          /* location of the line within the input */
+   char desig[13], mpc_code[4];
+} mpc_obs_line_t;
+
+const char *map_file( const char *filename, size_t *file_size);
+void unmap_file( const char *mapped, const size_t file_size);
+mpc_obs_line_t *load_mpc_obs_lines( const char *buff, const size_t buff_size,
+                                    size_t *n_obs);    /* mpc_load.cpp */
+int make_light_map( const char *pgm_filename,
+                                const char *tile_filename);  /* lightmap.cpp */
+void *load_light_map( const char *tile_filename);
+int light_map_value( const void *map, const double lon, const double lat);
+void light_map_values( const void *map, const size_t n,
+            const double *lon, const double *lat, unsigned char *values);
+void light_map_window( const void *map, const double lon,
+            const double lat, const int size, unsigned char *obuff);
+void free_light_map( void *map);
 int mutant_hex_char_to_int( const char c);
 char int_to_mutant_hex_char( const int ival);
 int get_mutant_hex_value( const char *buff, size_t n_digits);
@@ -0,0 +1,314 @@
+/* Copyright (C) 2026, Project Pluto
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+
+   Code to load large files of 80-column astrometry quickly.  Rather than
+reading a line at a time,  allocating memory for each line,  and sorting
+an array of pointers to lines,  the file is mapped into memory and split
+into chunks at line boundaries.  The chunks are parsed independently
+(in parallel,  if compiled with OpenMP;  run 'make OPENMP=Y') into a
+compact array of mpc_obs_line_t structures,  which are then sorted
+by designation and time,  again in parallel.
+
+   Compile with -DTEST_CODE to get a small program that loads a file
+and reports how long that took.   */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#ifdef _WIN32
+   #include <windows.h>
+#else
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+#endif
+#include "watdefs.h"
+#include "mpc_func.h"
+
+/* Maps a file into memory (read-only),  returning NULL on failure.  The
+result must be released with unmap_file( ).   On Windows,  we use the
+native file mapping API;  elsewhere,  mmap( ).  */
+
+const char *map_file( const char *filename, size_t *file_size)
+{
+   const char *rval = NULL;
+#ifdef _WIN32
+   HANDLE hfile = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   LARGE_INTEGER size;
+
+   if( hfile == INVALID_HANDLE_VALUE)
+      return( NULL);
+   if( GetFileSizeEx( hfile, &size) && size.QuadPart)
+      {
+      HANDLE hmap = CreateFileMappingA( hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+      if( hmap)
+         {
+         rval = (const char *)MapViewOfFile( hmap, FILE_MAP_READ, 0, 0, 0);
+         CloseHandle( hmap);
+         }
+      *file_size = (size_t)size.QuadPart;
+      }
+   CloseHandle( hfile);
+#else
+   const int fd = open( filename, O_RDONLY);
+   struct stat st;
+
+   if( fd < 0)
+      return( NULL);
+   if( !fstat( fd, &st) && st.st_size)
+      {
+      void *mapped = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                                    fd, 0);
+
+      if( mapped != MAP_FAILED)
+         {
+         rval = (const char *)mapped;
+         *file_size = (size_t)st.st_size;
+         }
+      }
+   close( fd);
+#endif
+   return( rval);
+}
+
+void unmap_file( const char *mapped, const size_t file_size)
+{
+#ifdef _WIN32
+   INTENTIONALLY_UNUSED_PARAMETER( file_size);
+   UnmapViewOfFile( mapped);
+#else
+   munmap( (void *)mapped, file_size);
+#endif
+}
+
+/* Returns a pointer to the start of the line following 'ptr' (or 'end',
+if there is no following line).  */
+
+static const char *next_line( const char *ptr, const char *end)
+{
+   const char *tptr = (const char *)memchr( ptr, '\n', end - ptr);
+
+   return( tptr ? tptr + 1 : end);
+}
+
+/* Parses the lines from 'ptr' up to 'end'.  Lines that aren't 80-column
+astrometry are skipped,  as are the second lines of satellite,  roving,
+and radar observations (the first line has all we want here).  */
+
+static size_t parse_chunk( mpc_obs_line_t *obs, const char *buff,
+                           const char *ptr, const char *end)
+{
+   size_t n_found = 0;
+
+   while( ptr < end)
+      {
+      const char *eol = next_line( ptr, end);
+      size_t len = eol - ptr;
+
+      while( len && (ptr[len - 1] == 10 || ptr[len - 1] == 13))
+         len--;
+      if( len >= 80 && ptr[14] != 's' && ptr[14] != 'v' && ptr[14] != 'r')
+         {
+         char line[81];
+         double jd;
+
+         memcpy( line, ptr, 80);
+         line[80] = '\0';
+         jd = extract_date_from_mpc_report( line, NULL);
+         if( jd && !get_ra_dec_from_mpc_report( line, NULL, &obs->ra, NULL,
+                                                  NULL, &obs->dec, NULL))
+            {
+            obs->jd = jd;
+            obs->offset = ptr - buff;
+            memcpy( obs->desig, line, 12);
+            obs->desig[12] = '\0';
+            memcpy( obs->mpc_code, line + 77, 3);
+            obs->mpc_code[3] = '\0';
+            obs++;
+            n_found++;
+            }
+         }
+      ptr = eol;
+      }
+   return( n_found);
+}
+
+static int compare_obs( const mpc_obs_line_t *a, const mpc_obs_line_t *b)
+{
+   int rval = memcmp( a->desig, b->desig, 12);
+
+   if( !rval)
+      rval = (a->jd > b->jd) - (a->jd < b->jd);
+   return( rval);
+}
+
+static int qsort_obs_cmp( const void *a, const void *b)
+{
+   return( compare_obs( (const mpc_obs_line_t *)a, (const mpc_obs_line_t *)b));
+}
+
+static void merge_runs( mpc_obs_line_t *obuff, const mpc_obs_line_t *run1,
+         const size_t n1, const mpc_obs_line_t *run2, const size_t n2)
+{
+   size_t i = 0, j = 0;
+
+   while( i < n1 && j < n2)
+      if( compare_obs( run2 + j, run1 + i) < 0)
+         *obuff++ = run2[j++];
+      else
+         *obuff++ = run1[i++];
+   memcpy( obuff, run1 + i, (n1 - i) * sizeof( mpc_obs_line_t));
+   obuff += n1 - i;
+   memcpy( obuff, run2 + j, (n2 - j) * sizeof( mpc_obs_line_t));
+}
+
+#define N_CHUNKS 64
+
+/* Parses 80-column astrometry from a buffer (often from map_file( ),
+but it needn't be),  returning an array sorted by designation and then by
+time.  The array must be freed by the caller.  Each entry's 'offset' tells
+you where in the buffer the line in question begins.   NULL is returned if
+memory allocation fails.  */
+
+mpc_obs_line_t *load_mpc_obs_lines( const char *buff, const size_t buff_size,
+                                    size_t *n_obs)
+{
+   const char *chunk_start[N_CHUNKS + 1];
+   size_t n_lines[N_CHUNKS], start[N_CHUNKS + 1];
+   mpc_obs_line_t *rval, *temp;
+   int i, n_chunks = N_CHUNKS;
+
+   *n_obs = 0;
+   chunk_start[0] = buff;
+   for( i = 1; i < n_chunks; i++)
+      {
+      const char *tptr = buff + (buff_size / n_chunks) * i;
+
+      if( tptr > chunk_start[i - 1])
+         chunk_start[i] = next_line( tptr - 1, buff + buff_size);
+      else
+         chunk_start[i] = chunk_start[i - 1];
+      }
+   chunk_start[n_chunks] = buff + buff_size;
+
+            /* Count lines,  to get an upper bound on the number of */
+            /* observations in each chunk :                         */
+#ifdef _OPENMP
+   #pragma omp parallel for
+#endif
+   for( i = 0; i < n_chunks; i++)
+      {
+      const char *tptr = chunk_start[i];
+
+      n_lines[i] = 0;
+      while( tptr < chunk_start[i + 1])
+         {
+         tptr = next_line( tptr, chunk_start[i + 1]);
+         n_lines[i]++;
+         }
+      }
+   start[0] = 0;
+   for( i = 0; i < n_chunks; i++)
+      start[i + 1] = start[i] + n_lines[i];
+   rval = (mpc_obs_line_t *)malloc( (start[n_chunks] + 1) * sizeof( mpc_obs_line_t));
+   if( !rval)
+      return( NULL);
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( dynamic)
+#endif
+   for( i = 0; i < n_chunks; i++)
+      {
+      n_lines[i] = parse_chunk( rval + start[i], buff,
+                                 chunk_start[i], chunk_start[i + 1]);
+      qsort( rval + start[i], n_lines[i], sizeof( mpc_obs_line_t), qsort_obs_cmp);
+      }
+            /* Squeeze out the gaps left by non-astrometric lines : */
+   for( i = 0; i < n_chunks; i++)
+      {
+      memmove( rval + *n_obs, rval + start[i], n_lines[i] * sizeof( mpc_obs_line_t));
+      start[i] = *n_obs;
+      *n_obs += n_lines[i];
+      }
+   start[n_chunks] = *n_obs;
+            /* Each chunk is now a sorted run.  Merge pairs of runs,   */
+            /* in parallel,  until only one is left :                  */
+   temp = (mpc_obs_line_t *)malloc( (*n_obs + 1) * sizeof( mpc_obs_line_t));
+   if( !temp)
+      {
+      free( rval);
+      return( NULL);
+      }
+   while( n_chunks > 1)
+      {
+      mpc_obs_line_t *swap_ptr;
+
+#ifdef _OPENMP
+      #pragma omp parallel for
+#endif
+      for( i = 0; i < n_chunks; i += 2)
+         if( i + 1 < n_chunks)
+            merge_runs( temp + start[i], rval + start[i], start[i + 1] - start[i],
+                        rval + start[i + 1], start[i + 2] - start[i + 1]);
+         else
+            memcpy( temp + start[i], rval + start[i],
+                        (start[i + 1] - start[i]) * sizeof( mpc_obs_line_t));
+      for( i = 0; i < n_chunks; i += 2)
+         start[i / 2] = start[i];
+      n_chunks = (n_chunks + 1) / 2;
+      start[n_chunks] = *n_obs;
+      swap_ptr = rval;
+      rval = temp;
+      temp = swap_ptr;
+      }
+   free( temp);
+   return( rval);
+}
+
+#ifdef TEST_CODE
+
+#include <time.h>
+
+#define PI 3.1415926535897932384626433832795028841971693993751058209749445923
+
+int main( const int argc, const char **argv)
+{
+   size_t file_size, n_obs;
+   const char *buff = (argc > 1 ? map_file( argv[1], &file_size) : NULL);
+   mpc_obs_line_t *obs;
+   clock_t t0;
+
+   if( !buff)
+      {
+      fprintf( stderr, "Give the name of a file of 80-column astrometry\n");
+      return( -1);
+      }
+   t0 = clock( );
+   obs = load_mpc_obs_lines( buff, file_size, &n_obs);
+   printf( "%u observations loaded in %.3f seconds (CPU time)\n",
+               (unsigned)n_obs, (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   for( size_t i = 0; i < n_obs && i < 10; i++)
+      printf( "%s %s %.6f %10.6f %+10.6f\n", obs[i].desig, obs[i].mpc_code,
+               obs[i].jd, obs[i].ra * 180. / PI, obs[i].dec * 180. / PI);
+   free( obs);
+   unmap_file( buff, file_size);
+   return( 0);
+}
+#endif
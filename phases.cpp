@@ -69,18 +69,165 @@ static double approx_solar_dist( double t)
    return( rval);
 }
 
+/* Computes the time (TD) of the given phase for lunation 'k'.  Meeus'
+approximation gets us within a few minutes;  we then compute the actual
+lunar and solar longitudes at that time and a time adjusted to fix the
+difference,  and interpolate between them.   */
+
+static double find_phase( const void FAR *vsop_data, const double k,
+                        const int phase, const int verbose, const int julian)
+{
+   const double j2000 = 2451545.;    /* 1.5 Jan 2000 = JD 2451545 */
+   const double rate = 29.5306;
+   double t, t2, dlon_1, dlon_2, phase_angle, solar_lon, time_lag;
+   double m, mp, f, e, lunar, dist, fund[N_FUND];
+   double t_centuries, t_cen2, t_cen3, t_cen4;
+   char buff[80];
+
+   t_centuries = k / 1236.85;       /* first approx */
+   t = 2451550.09765 + 29.530588853 * k
+         + (1.337e-4 - 1.5e-7 * t_centuries) * t_centuries * t_centuries;
+   t_centuries = (t - j2000) / 36525.;
+   t_cen2 = t_centuries * t_centuries;
+   t_cen3 = t_cen2 * t_centuries;
+   t_cen4 = t_cen3 * t_centuries;
+   m = 2.5534 + 29.10535669 * k
+              -  2.18e-5 * t_cen2
+              -  1.1e-7 * t_cen3;
+   mp = 201.5643 + 385.81693528 * k
+                 +    .0107438 * t_cen2
+                 +   1.239e-5 * t_cen3
+                 -   5.8e-8 * t_cen4;
+   f = 160.7108 + 390.67050274 * k
+                -   1.6541e-3 * t_cen2
+                -   2.27e-6 * t_cen3
+                +   1.1e-8 * t_cen4;
+   m *= PI / 180.;
+   f *= PI / 180.;
+   mp *= PI / 180.;
+   e = 1. - .002516 * t_centuries - 7.4e-6 * t_cen2;
+   switch( phase)
+      {
+      case NEW_MOON:
+         t +=   -.40720 * sin( mp)
+                +.17241 * sin( m) * e
+                +.01608 * sin( mp + mp)
+                +.01039 * sin( f + f)
+                +.00739 * sin( mp - m) * e
+                -.00514 * sin(  mp + m) * e
+                +.00208 * sin( m + m) * e * e
+                -.00111 * sin( mp - f - f);
+         break;
+      case FIRST_QUARTER:
+      case LAST_QUARTER:
+         t +=   -.62801 * sin( mp)
+                +.17172 * sin( m) *  e
+                -.01183 * sin( mp + m) * e
+                +.00862 * sin( mp + mp)
+                +.00804 * sin( f + f)
+                +.00454 * sin( mp - m) * e
+                +.00204 * sin( m + m) * e * e
+                -.00180 * sin( mp - f - f);
+         t += ((phase == FIRST_QUARTER) ? .00306 : -.00306);
+         break;
+      case FULL_MOON:
+         t +=   -.40614 * sin( mp)
+                +.17302 * sin( m) * e
+                +.01614 * sin( mp + mp)
+                +.01043 * sin( f + f)
+                +.00734 * sin( mp - m) * e
+                -.00515 * sin(  mp + m) * e
+                +.00209 * sin( m + m) * e * e
+                -.00111 * sin( mp - f - f);
+         break;
+      default:
+         break;
+      }
+   phase_angle = (double)phase * 90.;
+   t_centuries = (t - j2000) / days_per_julian_century;
+   time_lag = approx_solar_dist( t_centuries) / SPEED_OF_LIGHT;
+   time_lag /= seconds_per_day * days_per_julian_century;
+   lunar_fundamentals( vsop_data, t_centuries, fund);
+   lunar_lon_and_dist( vsop_data, fund, &lunar, &dist, 0L);
+   solar_lon = calc_vsop_loc( vsop_data, 3, 0, t_centuries - time_lag, 0.);
+   solar_lon = solar_lon * 180. / PI - 180.;
+   dlon_1 = lunar - solar_lon - phase_angle;
+   while( dlon_1 < -180.) dlon_1 += 360.;
+   while( dlon_1 >  180.) dlon_1 -= 360.;
+   if( verbose)
+      {
+      full_ctime( buff, t, julian);
+      printf( "   first  time is %s;  lon diff %f\n", buff, dlon_1);
+      }
+
+   t2 = t - rate * dlon_1 / 360.;
+   t_centuries = (t2 - j2000) / 36525.;
+   lunar_fundamentals( vsop_data, t_centuries, fund);
+   lunar_lon_and_dist( vsop_data, fund, &lunar, &dist, 0L);
+   solar_lon = calc_vsop_loc( vsop_data, 3, 0, t_centuries - time_lag, 0.);
+   solar_lon = solar_lon * 180. / PI - 180.;
+   dlon_2 = lunar - solar_lon - phase_angle;
+   while( dlon_2 < -180.) dlon_2 += 360.;
+   while( dlon_2 >  180.) dlon_2 -= 360.;
+   if( verbose)
+      {
+      full_ctime( buff, t2, julian);
+      printf( "   second time is %s;  lon diff %f\n", buff, dlon_2);
+      }
+   return( (t * dlon_2 - t2 * dlon_1) / (dlon_2 - dlon_1));
+}
+
+/* Finds the time (TD) when the sun's apparent longitude is at the
+multiple of 30 degrees nearest to it at time t0,  and that multiple. */
+
+static double find_principal_term( const void FAR *vsop_data, double t0,
+                        long *solar_month, const int verbose)
+{
+   const double j2000 = 2451545.;    /* 1.5 Jan 2000 = JD 2451545 */
+   const double thirty_deg = PI / 6.;
+   double delta_t = 1.;
+
+   while( fabs( delta_t) > .00001)  /* resolution a little better than 1s */
+      {
+      const double t_centuries = (t0 - j2000) / 36525.;
+      double time_lag, solar_lon;
+
+      time_lag = approx_solar_dist( t_centuries) / SPEED_OF_LIGHT;
+      time_lag /= seconds_per_day * days_per_julian_century;
+      solar_lon = calc_vsop_loc( vsop_data, 3, 0, t_centuries - time_lag, 0.);
+      *solar_month = (long)floor( solar_lon / thirty_deg + .5);
+      solar_lon -= (double)*solar_month * thirty_deg;
+      delta_t = solar_lon * 365.25 / (2. * PI);
+      t0 -= delta_t;
+      if( verbose)
+         printf( "delta_t: %.5f   JD %.5f\n", delta_t, t0);
+      }
+   return( t0);
+}
+
+/* Each phase (or principal term) can be computed independently of the
+others.  So we compute them a block at a time (in parallel,  if compiled
+with OpenMP;  run 'make OPENMP=Y'),  then output that block in order.
+With '-v',  the intermediate results would be jumbled together,  so that
+turns the parallelism off.  */
+
+#define BLOCK_SIZE 4096
+#define MEAN_TERM_SPACING (365.2422 / 12.)
+
 int main( const int argc, const char **argv)
 {
    const double j2000 = 2451545.;    /* 1.5 Jan 2000 = JD 2451545 */
-   int i, julian = 0, verbose = 0, chinese_calendar = 0;
-   double t,  t0, utc_time;
-   double m, mp, f, e, max_date = 4000. * 365.25 + j2000;
-   double lunar, dist, fund[N_FUND], rate = 29.5306, t_final;
+   int i, julian = 0, verbose = 0, chinese_calendar = 0, show_timing = 0;
+   int n_per_row, n_in_block, done = 0;
+   double t0, utc_time, max_date = 4000. * 365.25 + j2000;
+   double t_final, *times;
+   long *solar_months;
    char buff[80];
-   double k;
+   double k, k_step;
    FILE *log_file = NULL, *vsop_file, *data_file = NULL;
    char *vsop_tbuff, FAR *vsop_data;
    time_t curr_time = time( NULL);
+   const int64_t t_start = nanoseconds_since_1970( );
 
    vsop_file = fopen( "vsop.bin", "rb");
    if( !vsop_file)
@@ -90,6 +237,14 @@ int main( const int argc, const char **argv)
       }
    vsop_tbuff = (char *)malloc( VSOP_CHUNK);
    vsop_data = (char *)malloc( VSOP_CHUNK * 22U);
+   if( !vsop_tbuff || !vsop_data)
+      {
+      printf( "Out of memory\n");
+      free( vsop_tbuff);
+      free( vsop_data);
+      fclose( vsop_file);
+      return( -3);
+      }
    for( i = 0; i < 22; i++)
       {
       if( !fread( vsop_tbuff, VSOP_CHUNK, 1, vsop_file))
@@ -126,10 +281,13 @@ int main( const int argc, const char **argv)
             case 'm': case 'M':
                max_date = (atof( argv[i] + 2) - 2000.) * 365.25 + j2000;
                break;
+            case 't': case 'T':
+               show_timing = 1;
+               break;
             default:
                break;
             }
-   t0 = t = j2000 + 365.25 * (atof( argv[1]) - 2000.);
+   t0 = j2000 + 365.25 * (atof( argv[1]) - 2000.);
    k = floor( (atof( argv[1]) - 2000.) * 12.3685);
    if( data_file)
       {
@@ -137,109 +295,41 @@ int main( const int argc, const char **argv)
 
       fwrite( &int32_t_to_write, 1, sizeof( int32_t), data_file);
       }
-   t_final = max_date - 1.;
-   while( t_final < max_date)
-      for( i = 0; i < 4; i++)
+   times = (double *)malloc( BLOCK_SIZE * sizeof( double));
+   solar_months = (long *)malloc( BLOCK_SIZE * sizeof( long));
+   if( !times || !solar_months)
+      {
+      printf( "Out of memory\n");
+      free( times);
+      free( solar_months);
+      free( vsop_data);
+      return( -3);
+      }
+   n_per_row = (chinese_calendar ? 1 : 4);    /* just new moons for Chinese */
+   k_step = 1. / (double)n_per_row;
+   t_final = 2451550.09765 + 29.530588853 * k;
+   while( !done)
+      {           /* don't compute (much) more than we'll actually need : */
+      n_in_block = n_per_row *
+               ((int)( (max_date - t_final) / 29.530588853) + 2);
+      if( n_in_block > BLOCK_SIZE)
+         n_in_block = BLOCK_SIZE;
+#ifdef _OPENMP
+      #pragma omp parallel for schedule( dynamic, 16) if( !verbose)
+#endif
+      for( i = 0; i < n_in_block; i++)
+         times[i] = find_phase( vsop_data, k + (double)i * k_step,
+                                 i % n_per_row, verbose, julian);
+      for( i = 0; i < n_in_block && !done; i++)
          {
-         double t2, dlon_1, dlon_2, phase_angle, solar_lon, time_lag;
          static const char *phase_name[4] = {
                   "New moon ",
                   "1st qtr. ",
                   "Full moon",
                   "last qtr." };
-         double t_centuries, t_cen2, t_cen3, t_cen4;
+         const int phase = i % n_per_row;
 
-         t_centuries = k / 1236.85;       /* first approx */
-         t = 2451550.09765 + 29.530588853 * k
-               + (1.337e-4 - 1.5e-7 * t_centuries) * t_centuries * t_centuries;
-         t_centuries = (t - j2000) / 36525.;
-         t_cen2 = t_centuries * t_centuries;
-         t_cen3 = t_cen2 * t_centuries;
-         t_cen4 = t_cen3 * t_centuries;
-         m = 2.5534 + 29.10535669 * k
-                    -  2.18e-5 * t_cen2
-                    -  1.1e-7 * t_cen3;
-         mp = 201.5643 + 385.81693528 * k
-                       +    .0107438 * t_cen2
-                       +   1.239e-5 * t_cen3
-                       -   5.8e-8 * t_cen4;
-         f = 160.7108 + 390.67050274 * k
-                      -   1.6541e-3 * t_cen2
-                      -   2.27e-6 * t_cen3
-                      +   1.1e-8 * t_cen4;
-         m *= PI / 180.;
-         f *= PI / 180.;
-         mp *= PI / 180.;
-         e = 1. - .002516 * t_centuries - 7.4e-6 * t_cen2;
-         switch( i)
-            {
-            case NEW_MOON:
-               t +=   -.40720 * sin( mp)
-                      +.17241 * sin( m) * e
-                      +.01608 * sin( mp + mp)
-                      +.01039 * sin( f + f)
-                      +.00739 * sin( mp - m) * e
-                      -.00514 * sin(  mp + m) * e
-                      +.00208 * sin( m + m) * e * e
-                      -.00111 * sin( mp - f - f);
-               break;
-            case FIRST_QUARTER:
-            case LAST_QUARTER:
-               t +=   -.62801 * sin( mp)
-                      +.17172 * sin( m) *  e
-                      -.01183 * sin( mp + m) * e
-                      +.00862 * sin( mp + mp)
-                      +.00804 * sin( f + f)
-                      +.00454 * sin( mp - m) * e
-                      +.00204 * sin( m + m) * e * e
-                      -.00180 * sin( mp - f - f);
-               t += ((i == FIRST_QUARTER) ? .00306 : -.00306);
-               break;
-            case FULL_MOON:
-               t +=   -.40614 * sin( mp)
-                      +.17302 * sin( m) * e
-                      +.01614 * sin( mp + mp)
-                      +.01043 * sin( f + f)
-                      +.00734 * sin( mp - m) * e
-                      -.00515 * sin(  mp + m) * e
-                      +.00209 * sin( m + m) * e * e
-                      -.00111 * sin( mp - f - f);
-               break;
-            default:
-               break;
-            }
-         phase_angle = (double)i * 90.;
-         t_centuries = (t - j2000) / days_per_julian_century;
-         time_lag = approx_solar_dist( t_centuries) / SPEED_OF_LIGHT;
-         time_lag /= seconds_per_day * days_per_julian_century;
-         lunar_fundamentals( vsop_data, t_centuries, fund);
-         lunar_lon_and_dist( vsop_data, fund, &lunar, &dist, 0L);
-         solar_lon = calc_vsop_loc( vsop_data, 3, 0, t_centuries - time_lag, 0.);
-         solar_lon = solar_lon * 180. / PI - 180.;
-         dlon_1 = lunar - solar_lon - phase_angle;
-         while( dlon_1 < -180.) dlon_1 += 360.;
-         while( dlon_1 >  180.) dlon_1 -= 360.;
-         if( verbose)
-            {
-            full_ctime( buff, t, julian);
-            printf( "   first  time is %s;  lon diff %f\n", buff, dlon_1);
-            }
-
-         t2 = t - rate * dlon_1 / 360.;
-         t_centuries = (t2 - j2000) / 36525.;
-         lunar_fundamentals( vsop_data, t_centuries, fund);
-         lunar_lon_and_dist( vsop_data, fund, &lunar, &dist, 0L);
-         solar_lon = calc_vsop_loc( vsop_data, 3, 0, t_centuries - time_lag, 0.);
-         solar_lon = solar_lon * 180. / PI - 180.;
-         dlon_2 = lunar - solar_lon - phase_angle;
-         while( dlon_2 < -180.) dlon_2 += 360.;
-         while( dlon_2 >  180.) dlon_2 -= 360.;
-         if( verbose)
-            {
-            full_ctime( buff, t2, julian);
-            printf( "   second time is %s;  lon diff %f\n", buff, dlon_2);
-            }
-         t_final = (t * dlon_2 - t2 * dlon_1) / (dlon_2 - dlon_1);
+         t_final = times[i];
          utc_time = t_final - td_minus_utc( t_final) / seconds_per_day;
          full_ctime( buff, utc_time, julian);
          if( log_file)
@@ -248,13 +338,13 @@ int main( const int argc, const char **argv)
                fprintf( log_file, "%7ld    %s\n",
                                 (long)floor( utc_time - 1. / 6.), buff);
             else
-               fprintf( log_file, "%s: %s\n", phase_name[i], buff);
+               fprintf( log_file, "%s: %s\n", phase_name[phase], buff);
             }
          buff[17] = '\0';        /* trim the seconds */
          if( !chinese_calendar)
             {
             printf( "%s  ", buff);
-            if( i == 3)
+            if( phase == 3)
                printf( "\n");
             }
          if( data_file)
@@ -268,43 +358,52 @@ int main( const int argc, const char **argv)
             int32_t_to_write = (int32_t)diff;
             fwrite( &int32_t_to_write, 1, sizeof( int32_t), data_file);
             }
-         if( chinese_calendar)
-            {
-            k++;
-            i = 4;
-            }
-         else        /* just moving to next _phase_ */
-            k += .25;
+         k += k_step;
          if( curr_time != time( NULL))
             {
             curr_time = time( NULL);
             printf( "JD %.3f (%.3f)\r", t_final,
                      (t_final - j2000) / 365.25 + 2000.);
             }
+         if( phase == n_per_row - 1 && t_final >= max_date)
+            done = 1;
          }
+      }
 
    if( chinese_calendar)
+      {
+      double t_prev = 0.;
+
+      i = n_in_block = 0;
       while( t0 < max_date)
          {
-         double t_centuries, time_lag, delta_t = 1.;
-         double solar_lon;
-         const double thirty_deg = PI / 6.;
-         long solar_month = 0L, year;
+         long solar_month, year;
 
-         while( fabs( delta_t) > .00001)  /* resolution a little better than 1s */
+         if( i == n_in_block)    /* compute the next block of terms */
             {
-            t_centuries = (t0 - j2000) / 36525.;
-            time_lag = approx_solar_dist( t_centuries) / SPEED_OF_LIGHT;
-            time_lag /= seconds_per_day * days_per_julian_century;
-            solar_lon = calc_vsop_loc( vsop_data, 3, 0, t_centuries - time_lag, 0.);
-            solar_month = (long)floor( solar_lon / thirty_deg + .5);
-            solar_lon -= (double)solar_month * thirty_deg;
-            delta_t = solar_lon * 365.25 / (2. * PI);
-            t0 -= delta_t;
-            if( verbose)
-               printf( "delta_t: %.5f   JD %.5f\n", delta_t, t0);
+            if( !t_prev)         /* first term: solve for it by itself */
+               {
+               n_in_block = 1;
+               times[0] = find_principal_term( vsop_data, t0, solar_months,
+                                                verbose);
+               }
+            else
+               {
+               n_in_block = (int)( (max_date - t0) / MEAN_TERM_SPACING) + 2;
+               if( n_in_block > BLOCK_SIZE)
+                  n_in_block = BLOCK_SIZE;
+#ifdef _OPENMP
+               #pragma omp parallel for schedule( dynamic, 16) if( !verbose)
+#endif
+               for( i = 0; i < n_in_block; i++)
+                  times[i] = find_principal_term( vsop_data,
+                           t_prev + (double)( i + 1) * MEAN_TERM_SPACING,
+                           solar_months + i, verbose);
+               }
+            i = 0;
             }
-         solar_month = (solar_month + 7) % 12;  /* flip around to winter sol */
+         t0 = times[i];
+         solar_month = (solar_months[i] + 7) % 12;  /* flip around to winter sol */
          year = (long)
                   floor( (t0 - (double)solar_month * 30.5 - 100.) / 365.25);
          year -= 2074L;
@@ -314,7 +413,7 @@ int main( const int argc, const char **argv)
             fprintf( log_file, "%7ld z  %s  %2ld %5ld\n",
                           (long)floor( utc_time - 1. / 6.),
                           buff, solar_month + 1, year);
-         if( chinese_calendar && curr_time != time( NULL))
+         if( curr_time != time( NULL))
             {
             curr_time = time( NULL);
             printf( "%7ld z  %s   %2ld %5ld: %.3f\n",
@@ -322,8 +421,16 @@ int main( const int argc, const char **argv)
                           buff, solar_month + 1, year,
                           (utc_time - j2000) / 365.25 + 2000.);
             }
+         t_prev = t0;
          t0 += 365.25 / 12.;
+         i++;
          }
+      }
+   free( times);
+   free( solar_months);
+   if( show_timing)        /* wall-clock time;  clock( ) would add up */
+      printf( "%.3f seconds\n",            /* the time on all threads */
+               (double)( nanoseconds_since_1970( ) - t_start) * 1e-9);
    if( data_file)
       fclose( data_file);
    if( log_file)
@@ -1,5 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "watdefs.h"
+#include "mpc_func.h"
 
 #define CSI "\x1b\x5b"
 
@@ -16,24 +20,150 @@ https://www.nasa.gov/specials/blackmarble/2016/globalmaps/BlackMarble_2016_3km.j
 
    Run 'convert BlackMarble_2016_3km.jpg /tmp/night.pgm',  and you have
 something this program can use.  I doubt that anyone else is apt to use
-this code,  but it's helped me to visualize the map.  */
+this code,  but it's helped me to visualize the map.
+
+   For looking up many locations (site selection,  for example),  run
+'./pollute -t' once.  That rearranges /tmp/night.pgm into /tmp/night.til,
+a tiled file which can be memory-mapped and read quickly (see
+lightmap.cpp).  './pollute -b (filename)' reads lines of 'longitude
+latitude' and outputs the brightness at each;  '-b -' reads them from
+stdin.  Once /tmp/night.til exists,  the window display uses it too. */
+
+/* Returns 0 on success,  -1 if the file can't be opened,  or -2 if we
+run out of memory.  */
+
+static int batch_lookup( const void *map, const char *filename)
+{
+   FILE *ifile = (strcmp( filename, "-") ? fopen( filename, "rb") : stdin);
+   char buff[200];
+   double *lon = NULL, *lat = NULL, tlon, tlat;
+   unsigned char *values = NULL;
+   size_t i, n = 0, n_alloced = 0;
+   int rval = 0;
+
+   if( !ifile)
+      {
+      fprintf( stderr, "Couldn't open '%s'\n", filename);
+      return( -1);
+      }
+   while( fgets( buff, sizeof( buff), ifile))
+      if( sscanf( buff, "%lf %lf", &tlon, &tlat) == 2)
+         {
+         if( n == n_alloced)
+            {
+            double *new_lon, *new_lat;
+
+            n_alloced = n_alloced * 2 + 1000;
+            new_lon = (double *)realloc( lon, n_alloced * sizeof( double));
+            if( new_lon)
+               lon = new_lon;
+            new_lat = (double *)realloc( lat, n_alloced * sizeof( double));
+            if( new_lat)
+               lat = new_lat;
+            if( !new_lon || !new_lat)
+               {
+               rval = -2;
+               break;
+               }
+            }
+         lon[n] = tlon;
+         lat[n++] = tlat;
+         }
+   if( ifile != stdin)
+      fclose( ifile);
+   if( !rval)
+      {
+      values = (unsigned char *)malloc( n + 1);
+      if( !values)
+         rval = -2;
+      }
+   if( !rval)
+      {
+      light_map_values( map, n, lon, lat, values);
+      for( i = 0; i < n; i++)
+         printf( "%.5f %.5f %3d\n", lon[i], lat[i], values[i]);
+      }
+   else
+      fprintf( stderr, "Out of memory reading '%s'\n", filename);
+   free( lon);
+   free( lat);
+   free( values);
+   return( rval);
+}
 
 int main( const int argc, const char **argv)
 {
    const int xsize = 13500, ysize = xsize / 2;
-   FILE *ifile = fopen( "/tmp/night.pgm", "rb");
+   FILE *ifile;
+   void *map;
    int x0, y0;
    int x, y, size = (argc > 3 ? atoi( argv[3]) : 20);
    long header_size = 18;
    unsigned char buff[200];
 
+   if( argc > 1 && !strcmp( argv[1], "-t"))
+      {
+      const int err_code = make_light_map( "/tmp/night.pgm", "/tmp/night.til");
+
+      if( err_code)
+         printf( "Error %d making /tmp/night.til from /tmp/night.pgm\n", err_code);
+      return( err_code);
+      }
+   map = load_light_map( "/tmp/night.til");
+   if( argc > 2 && !strcmp( argv[1], "-b"))
+      {
+      int rval;
+
+      if( !map)
+         {
+         printf( "Couldn't load /tmp/night.til.  Run './pollute -t' first.\n");
+         return( -1);
+         }
+      rval = batch_lookup( map, argv[2]);
+      free_light_map( map);
+      return( rval);
+      }
+   if( argc < 3)
+      {
+      printf( "Usage : ./pollute longitude latitude\n");
+      return( -1);
+      }
+   if( map)
+      {
+      unsigned char *window;
+
+      if( size < 1)
+         size = 1;
+      window = (unsigned char *)malloc( 4 * size * size);
+      if( !window)
+         {
+         printf( "Out of memory\n");
+         free_light_map( map);
+         return( -1);
+         }
+      light_map_window( map, atof( argv[1]), atof( argv[2]), size, window);
+      for( y = 0; y < size * 2; y++)
+         {
+         const unsigned char *row = window + y * size * 2;
+
+         for( x = 0; x < size * 2; x++)
+            if( x == size && y == size)
+               printf( CSI "48;2;255;128;0m  ");
+            else
+               printf( CSI "48;2;%d;%d;%dm  ", row[x], row[x], row[x]);
+         printf( CSI "49m\n");     /* reset default bkgrnd */
+         }
+      free( window);
+      free_light_map( map);
+      return( -1);
+      }
+   ifile = fopen( "/tmp/night.pgm", "rb");
    if( !ifile)
+      {
       printf( "This program gets data from /tmp/night.pgm,  and cannot\n"
               "open that file.  See 'pollute.c' for details.\n");
-   if( argc < 3)
-      printf( "Usage : ./pollute longitude latitude\n");
-   if( !ifile || argc < 3)
       return( -1);
+      }
    x0 = (int)( ( 180. + atof( argv[1])) * (double)xsize / 360.);
    y0 = (int)( ( 90. - atof( argv[2])) * (double)ysize / 180.);
    x0 %= xsize;
@@ -52,5 +182,6 @@ int main( const int argc, const char **argv)
          printf( CSI "49m\n");     /* reset default bkgrnd */
          }
       }
+   fclose( ifile);
    return( -1);
 }
@@ -18,6 +18,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 02110-1301, USA.    */
 
 #include <math.h>
+#include <stdlib.h>
 #include "watdefs.h"
 #include "afuncs.h"
 
@@ -133,14 +134,16 @@ static void compute_integrand( LOCALS *loc)
    loc->integrand = r_dn_dr / (loc->n + r_dn_dr);   /* (3.281-8) */
 }
 
+#define DEFAULT_INTEGRATION_TOLERANCE .0001
+
 static double total_refraction( const REFRACT *ref,
         const LOCALS *l1, const LOCALS *l2, const int is_troposphere,
-        const int recursion_depth)
+        const int recursion_depth, const double integration_tolerance,
+        const int min_recursion_depth)
 {
    LOCALS mid;
    double change;
    const double iteration_limit = 1.;     /* get 'r' within a meter */
-   const double integration_tolerance = .0001;
    const int max_recursion_depth = 20;
 
    mid.z = (l1->z + l2->z) * .5;
@@ -160,10 +163,19 @@ static double total_refraction( const REFRACT *ref,
    change = 2. * mid.integrand - (l1->integrand + l2->integrand);
 // if( recursion_depth >= max_recursion_depth)
 //    printf( "!!! recursed too deep\n");
-            /* ...and if it's too great,  recurse with each half: */
-   if( fabs( change) > integration_tolerance && recursion_depth < max_recursion_depth)
-      return( total_refraction( ref, l1, &mid, is_troposphere, recursion_depth + 1)
-            + total_refraction( ref, &mid, l2, is_troposphere, recursion_depth + 1));
+            /* ...and if it's too great,  recurse with each half.  The */
+            /* first 'min_recursion_depth' levels always recurse:  over */
+            /* the whole range,  the midpoint can agree with the ends by */
+            /* coincidence,  causing errors of an arcsecond or more at   */
+            /* some altitudes near the horizon.  integrated_refraction( ) */
+            /* uses zero,  as it always has;  refraction profiles use more. */
+   if( (recursion_depth < min_recursion_depth
+                  || fabs( change) > integration_tolerance)
+                  && recursion_depth < max_recursion_depth)
+      return( total_refraction( ref, l1, &mid, is_troposphere,
+                   recursion_depth + 1, integration_tolerance, min_recursion_depth)
+            + total_refraction( ref, &mid, l2, is_troposphere,
+                   recursion_depth + 1, integration_tolerance, min_recursion_depth));
    else
       {                    /* Simpson's rule is good enough: */
       const double h = (l2->z - l1->z) / 6.;
@@ -172,10 +184,17 @@ static double total_refraction( const REFRACT *ref,
       }
 }
 
-double DLL_FUNC integrated_refraction( const double latitude,
+/* integrated_refraction( ) uses DEFAULT_INTEGRATION_TOLERANCE and no
+forced subdivision.  The refraction profile code (below) forces some
+subdivision,  and also needs tighter integrations to estimate the error
+of the usual one;  hence this function.  */
+
+static double integrated_refraction_tol( const double latitude,
                   const double observed_alt, const double wavelength_microns,
                   const double height_in_meters, const double rel_humid_pct,
-                  const double temp_kelvins, const double pressure_mb)
+                  const double temp_kelvins, const double pressure_mb,
+                  const double integration_tolerance,
+                  const int min_recursion_depth)
 {
    const double g_bar = 9.784 * (1. - .0026 * cos( 2. * latitude)
                         - 2.8e-7 * height_in_meters);      /* (3.281-4) */
@@ -209,7 +228,8 @@ double DLL_FUNC integrated_refraction( const double latitude,
 
    ref.nt = lt.n;
    ref.n0_r0_sin_z0 = l0.n * l0.r * sin( l0.z);
-   rval = total_refraction( &ref, &l0, &lt, 1, 0);
+   rval = total_refraction( &ref, &l0, &lt, 1, 0, integration_tolerance,
+                                    min_recursion_depth);
 
          /* Now for the stratospheric portion... we need to recompute */
          /* dn/dr at the tropopause, because there's a discontinuity  */
@@ -223,7 +243,18 @@ double DLL_FUNC integrated_refraction( const double latitude,
    ls.z = asin( ls.n * ref.r0 * sin( l0.z) / (ls.n * rs));
    compute_integrand( &ls);
 
-   return( rval + total_refraction( &ref, &lt, &ls, 0, 0));
+   return( rval + total_refraction( &ref, &lt, &ls, 0, 0,
+                                    integration_tolerance, min_recursion_depth));
+}
+
+double DLL_FUNC integrated_refraction( const double latitude,
+                  const double observed_alt, const double wavelength_microns,
+                  const double height_in_meters, const double rel_humid_pct,
+                  const double temp_kelvins, const double pressure_mb)
+{
+   return( integrated_refraction_tol( latitude, observed_alt,
+                  wavelength_microns, height_in_meters, rel_humid_pct,
+                  temp_kelvins, pressure_mb, DEFAULT_INTEGRATION_TOLERANCE, 0));
 }
 
 /* reverse_integrated_refraction( ) attempts to find the inverse of the
@@ -281,3 +312,257 @@ double DLL_FUNC reverse_integrated_refraction( const double latitude,
    while( n_iterations < 10);
    return( x2 - refracted_alt);
 }
+
+/* If you need many refractions for the same observer and conditions,
+the above functions are a slow way to get them.  init_refraction_profile( )
+precomputes integrated_refraction( ) for that observer and those conditions,
+on a grid of observed altitudes from the horizon to the zenith.  (The
+table's integrations always subdivide at least twice;  see
+total_refraction( ).  So they don't have the occasional narrow spikes
+that integrated_refraction( ) has,  mostly within a few degrees of the
+horizon;  those reach half an arcsecond at 20 C,  and several arcseconds
+in very cold air.)  After
+that,  profile_refraction( ) and reverse_profile_refraction( ) get their
+answers by cubic spline interpolation within that table (see spline.cpp),
+at a cost of a few dozen floating-point operations each.
+
+   The grid is evenly spaced in u = sqrt( observed_alt / 90 degrees).
+Near the horizon,  where refraction changes quickly,  that makes it
+denser.  We start with 32 intervals.  For each interval,  the refraction
+is computed at three points (1/4,  1/2,  3/4 of the way across) and
+compared to the interpolated values.  So are the table points;  the
+spline is extrapolated in the first and last intervals (see spline.cpp),
+so it doesn't quite match the table at the horizon and zenith.  The
+error bound is the largest of those differences,  plus twice the error
+of the table's integrations.  (That error is found once,  by
+comparing it to a much tighter and slower integration at the 33 starting
+grid points.  It's counted twice because the table and the values it's
+checked against both carry it.)
+
+   An error e in R(x) becomes an error of up to e / (1 - dR/dx) in the
+reverse direction.  dR/dx is normally tiny,  but it can approach 1 near
+the horizon under extreme conditions,  so the bound is scaled by that
+factor (using the largest dR/dx found in the table) and then covers
+both profile_refraction( ) and reverse_profile_refraction( ) within the
+table.  If the bound exceeds 'max_error',  the midpoints are added to the
+table,  doubling the number of intervals,  and the checks are repeated
+(the old quarter points are the new midpoints).  That stops when the
+bound is met,  and refraction_profile_error( ) returns it.  If it's
+still not met at MAX_PROFILE_INTERVALS,  NULL is returned:  the profile
+can't deliver the accuracy asked for.  (That happens for hot air near
+the horizon,  where dR/dx gets close to 1;  ask for a looser bound.)
+
+   Outside the table (negative altitudes,  mostly),  the profile
+functions fall back on integrated_refraction( ) and friends,  at the
+usual (much higher) cost.  For reverse_profile_refraction( ),  that
+happens for unrefracted altitudes below -R(0),  where R(0) is the
+refraction at the horizon.  Normally,  that's about half a degree below
+the horizon.  But under extreme conditions (very hot air,  say),  R(0)
+can be negative,  and then the fallback is used for some positive
+altitudes too.  (It can't be avoided by extending the table below the
+horizon:  in such cases,  refraction changes faster than altitude
+below the horizon,  so those altitudes have no solution there.)  The
+caller is told when that happens.  NULL is also returned if memory
+allocation fails. */
+
+#define MAX_PROFILE_INTERVALS 1024
+#define TIGHT_INTEGRATION_TOLERANCE 1e-7
+#define REFRACTION_PROFILE struct refraction_profile
+
+REFRACTION_PROFILE
+   {
+   double latitude, wavelength_microns, height_in_meters;
+   double rel_humid_pct, temp_kelvins, pressure_mb;
+   double max_error;
+   int n_intervals;
+   double table[MAX_PROFILE_INTERVALS + 1];
+   };
+
+double cubic_spline_interpolate_within_table(      /* spline.cpp */
+         const double *table, const int n_entries, double x, int *err_code);
+
+   /* The integrator returns NaN at the zenith itself,  where the      */
+   /* refraction is zero.  Profile values always subdivide at least    */
+   /* twice (see total_refraction( )),  so a coincidental agreement   */
+   /* over the whole range can't put a spike in the table.             */
+
+#define PROFILE_MIN_RECURSION_DEPTH    2
+
+static double profile_integrated_refraction( const REFRACTION_PROFILE *prof,
+                           const double u, const double tolerance)
+{
+   if( u >= 1.)
+      return( 0.);
+   return( integrated_refraction_tol( prof->latitude, u * u * PI / 2.,
+                  prof->wavelength_microns, prof->height_in_meters,
+                  prof->rel_humid_pct, prof->temp_kelvins, prof->pressure_mb,
+                  tolerance, PROFILE_MIN_RECURSION_DEPTH));
+}
+
+void * DLL_FUNC init_refraction_profile( const double latitude,
+                  const double wavelength_microns,
+                  const double height_in_meters, const double rel_humid_pct,
+                  const double temp_kelvins, const double pressure_mb,
+                  const double max_error)
+{
+   REFRACTION_PROFILE *prof =
+               (REFRACTION_PROFILE *)malloc( sizeof( REFRACTION_PROFILE));
+   double mid[MAX_PROFILE_INTERVALS], quarters[2 * MAX_PROFILE_INTERVALS];
+   double integ_err = 0.;
+   int i, j, n = 32;
+
+   if( !prof)
+      return( NULL);
+   prof->latitude = latitude;
+   prof->wavelength_microns = wavelength_microns;
+   prof->height_in_meters = height_in_meters;
+   prof->rel_humid_pct = rel_humid_pct;
+   prof->temp_kelvins = temp_kelvins;
+   prof->pressure_mb = pressure_mb;
+   for( i = 0; i <= n; i++)
+      {
+      const double u = (double)i / (double)n;
+      const double err = fabs( profile_integrated_refraction( prof, u,
+                                          TIGHT_INTEGRATION_TOLERANCE)
+         - (prof->table[i] = profile_integrated_refraction( prof, u,
+                                          DEFAULT_INTEGRATION_TOLERANCE)));
+
+      if( !(err <= integ_err))     /* written this way so NaNs propagate */
+         integ_err = err;
+      }
+   for( i = 0; i < n; i++)
+      mid[i] = profile_integrated_refraction( prof,
+                  ((double)i + .5) / (double)n, DEFAULT_INTEGRATION_TOLERANCE);
+   for( ;;)
+      {
+      double interp_err = 0., max_slope = 0.;
+
+      for( i = 0; i < n; i++)
+         {
+         const double n2 = 2. * (double)n * (double)n;
+         const double slope = (prof->table[i + 1] - prof->table[i])
+                  / ((double)( 2 * i + 1) * PI / n2);  /* d(alt) between */
+                                                        /* table points  */
+         if( max_slope < slope)
+            max_slope = slope;
+         for( j = 0; j < 5; j++)    /* check 0,  1/4,  1/2,  3/4,  1 */
+            {
+            const double x = (double)i + (double)j * .25;
+            double err, val;
+            int err_code;
+
+            if( j == 4 && i < n - 1)   /* only the last interval's end */
+               continue;
+            if( j == 0 || j == 4)      /* the end intervals are extrapolated */
+               val = prof->table[i + j / 4];
+            else if( j == 2)
+               val = mid[i];
+            else
+               val = quarters[i * 2 + j / 3] = profile_integrated_refraction(
+                        prof, x / (double)n, DEFAULT_INTEGRATION_TOLERANCE);
+            err = fabs( val - cubic_spline_interpolate_within_table(
+                                 prof->table, n + 1, x, &err_code));
+            if( !(err <= interp_err))
+               interp_err = err;
+            }
+         }
+      if( max_slope >= 1.)       /* reverse refraction isn't unique */
+         prof->max_error = HUGE_VAL;
+      else
+         prof->max_error = (interp_err + 2. * integ_err) / (1. - max_slope);
+      if( prof->max_error <= max_error || n * 2 > MAX_PROFILE_INTERVALS)
+         break;
+      for( i = n; i >= 0; i--)       /* interleave midpoints into table */
+         {
+         prof->table[i * 2] = prof->table[i];
+         if( i < n)
+            prof->table[i * 2 + 1] = mid[i];
+         }
+      n *= 2;
+      for( i = 0; i < n; i++)       /* old quarter points are new midpoints */
+         mid[i] = quarters[i];
+      }
+   prof->n_intervals = n;
+   if( !(prof->max_error <= max_error))
+      {
+      free( prof);
+      prof = NULL;
+      }
+   return( prof);
+}
+
+double DLL_FUNC profile_refraction( const void *profile,
+                                    const double observed_alt)
+{
+   const REFRACTION_PROFILE *prof = (const REFRACTION_PROFILE *)profile;
+   int err_code;
+
+   if( observed_alt < 0. || observed_alt > PI / 2.)
+      return( integrated_refraction( prof->latitude, observed_alt,
+                  prof->wavelength_microns, prof->height_in_meters,
+                  prof->rel_humid_pct, prof->temp_kelvins, prof->pressure_mb));
+   return( cubic_spline_interpolate_within_table( prof->table,
+               prof->n_intervals + 1,
+               sqrt( observed_alt * 2. / PI) * (double)prof->n_intervals,
+               &err_code));
+}
+
+/* As with reverse_integrated_refraction( ),  'refracted_alt' is the
+unrefracted altitude,  and we return the refraction R such that an
+object at that altitude is observed at refracted_alt + R.  We solve
+x - R(x) = refracted_alt for the observed altitude x by the secant
+method;  normally,  |dR/dx| is well below 1,  and that converges
+quickly.  Iterates are kept within the table,  so if the solution lies
+within it,  only the table is used.  If it doesn't (see above),  we fall
+back on reverse_integrated_refraction( ),  and '*used_integrator' (if
+non-NULL) is set to 1;  otherwise,  it's set to 0.   */
+
+static double clamp_to_profile( const double observed_alt)
+{
+   if( observed_alt < 0.)
+      return( 0.);
+   return( observed_alt > PI / 2. ? PI / 2. : observed_alt);
+}
+
+double DLL_FUNC reverse_profile_refraction( const void *profile,
+                     const double refracted_alt, int *used_integrator)
+{
+   const REFRACTION_PROFILE *prof = (const REFRACTION_PROFILE *)profile;
+   const double tolerance = 1e-10;
+   double x1, y1, x2, y2;
+   int n_iterations = 0;
+   const int outside_table = (refracted_alt < -prof->table[0]
+                              || refracted_alt > PI / 2.);
+
+   if( used_integrator)
+      *used_integrator = outside_table;
+   if( outside_table)
+      return( reverse_integrated_refraction( prof->latitude, refracted_alt,
+                  prof->wavelength_microns, prof->height_in_meters,
+                  prof->rel_humid_pct, prof->temp_kelvins, prof->pressure_mb));
+   x1 = clamp_to_profile( refracted_alt
+                  + profile_refraction( profile, clamp_to_profile( refracted_alt)));
+   y1 = refracted_alt - x1 + profile_refraction( profile, x1);
+   x2 = clamp_to_profile( x1 + y1);
+   y2 = refracted_alt - x2 + profile_refraction( profile, x2);
+   while( fabs( x2 - x1) > tolerance && y1 != y2 && n_iterations++ < 10)
+      {
+      const double x3 = clamp_to_profile( x2 - (x1 - x2) * y2 / (y1 - y2));
+
+      x1 = x2;
+      y1 = y2;
+      x2 = x3;
+      y2 = refracted_alt - x2 + profile_refraction( profile, x2);
+      }
+   return( x2 - refracted_alt);
+}
+
+double DLL_FUNC refraction_profile_error( const void *profile)
+{
+   return( ((const REFRACTION_PROFILE *)profile)->max_error);
+}
+
+void DLL_FUNC free_refraction_profile( void *profile)
+{
+   free( profile);
+}
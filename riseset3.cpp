@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #include "date.h"
 #include "afuncs.h"
 #include "riseset3.h"
+#include "brentmin.h"
 
 const static double pi =
      3.1415926535897932384626433832795028841971693993751058209749445923078;
@@ -180,4 +181,361 @@ double look_for_rise_set( const int planet_no,
    return( rval);
 }
 
+/* The above look_for_rise_set( ) computes the object's position from
+scratch at both ends of each hour and at each iteration,  so a day's
+rise and set times cost fifty or more evaluations of the lunar or VSOP
+theory.  But the object moves smoothly;  what makes the altitude change
+quickly is the earth's rotation,  which is cheap to compute.  So the
+following code computes positions at 'nodes' (every six hours for the
+moon,  every day for the sun),  once for the whole span of days of
+interest,  and interpolates between them.  Altitudes can then be had at
+any time for the cost of a sidereal time and a couple of rotations.
 
+   The search for events within a day then samples this smooth altitude
+hourly,  which brackets any crossing of the rise/set altitude,  and
+refines each bracket with a safeguarded secant (Illinois) method.  Two
+crossings within the same hour (an object just grazing the horizon)
+would be missed by the sign test;  so if three consecutive samples show
+an extremum that might reach the horizon,  Brent's method (brentmin.cpp)
+finds that extremum,  splitting the bracket if need be.    */
+
+#define MOON_NODE_STEP  .25
+#define SUN_NODE_STEP   1.
+
+int make_posn_table( POSN_TABLE *table, const int planet_no,
+                  const double jd_start, const double jd_end,
+                  const char *vsop_data)
+{
+   int i;
+
+   table->planet_no = planet_no;
+   table->step = (planet_no == 10 ? MOON_NODE_STEP : SUN_NODE_STEP);
+   table->jd0 = jd_start - table->step;
+   table->n_nodes = (int)ceil( (jd_end - jd_start) / table->step) + 4;
+   table->vects = (double *)malloc( table->n_nodes * 3 * sizeof( double));
+   if( !table->vects)
+      return( -1);
+   for( i = 0; i < table->n_nodes; i++)
+      {
+      PLANET_DATA pdata;
+
+      fill_planet_data( &pdata, planet_no, table->jd0 + (double)i * table->step,
+                        0., 0., vsop_data);
+      memcpy( table->vects + i * 3, pdata.equatorial_loc, 3 * sizeof( double));
+      }
+   return( 0);
+}
+
+void free_posn_table( POSN_TABLE *table)
+{
+   free( table->vects);
+   table->vects = NULL;
+}
+
+/* Four-point Lagrange interpolation between nodes.  The result is scaled
+back to a unit vector.  */
+
+static void interpolate_posn( const POSN_TABLE *table, const double jd,
+                              double *vect)
+{
+   const double x = (jd - table->jd0) / table->step;
+   int i = (int)floor( x) - 1, j;
+   double t, coeff[4], r;
+   const double *tptr;
+
+   if( i < 0)
+      i = 0;
+   if( i > table->n_nodes - 4)
+      i = table->n_nodes - 4;
+   t = x - (double)i;
+   coeff[0] = -(t - 1.) * (t - 2.) * (t - 3.) / 6.;
+   coeff[1] = t * (t - 2.) * (t - 3.) / 2.;
+   coeff[2] = -t * (t - 1.) * (t - 3.) / 2.;
+   coeff[3] = t * (t - 1.) * (t - 2.) / 6.;
+   tptr = table->vects + i * 3;
+   for( j = 0; j < 3; j++)
+      vect[j] = coeff[0] * tptr[j] + coeff[1] * tptr[j + 3]
+              + coeff[2] * tptr[j + 6] + coeff[3] * tptr[j + 9];
+   r = sqrt( vect[0] * vect[0] + vect[1] * vect[1] + vect[2] * vect[2]);
+   for( j = 0; j < 3; j++)
+      vect[j] /= r;
+}
+
+/* Returns the altitude,  in radians,  just as fill_planet_data( ) would
+compute it.  If 'hour_angle' is non-NULL,  it's set the same way as
+pdata->hour_angle.  */
+
+double posn_table_altitude( const POSN_TABLE *table, const double jd,
+                  const double observer_lat, const double observer_lon,
+                  double *hour_angle)
+{
+   double loc[3];
+
+   interpolate_posn( table, jd, loc);
+   rotate_vector( loc, -(green_sidereal_time( jd) + observer_lon), 2);
+   if( hour_angle)
+      *hour_angle = atan2( loc[1], loc[0]);
+   rotate_vector( loc, observer_lat - pi / 2., 1);
+   return( asin( loc[2]));
+}
+
+#define EVENT_ALTITUDE     0
+#define EVENT_TRANSIT      1
+
+typedef struct
+{
+   const POSN_TABLE *table;
+   double observer_lat, observer_lon, altitude;
+   int event_type;
+} event_search_t;
+
+/* For rise/set searches,  the function whose zeroes we want is the
+altitude less the rise/set altitude.  For transits,  it's the 'y'
+component of the position after rotating for sidereal time,  i.e.,
+(cosine of declination) times sine of the hour angle;  'x' (returned
+in *aux) tells you if it's an upper or lower transit.  */
+
+static double event_func( const event_search_t *s, const double jd,
+                          double *aux)
+{
+   double rval;
+
+   if( s->event_type == EVENT_TRANSIT)
+      {
+      double loc[3];
+
+      interpolate_posn( s->table, jd, loc);
+      rotate_vector( loc, -(green_sidereal_time( jd) + s->observer_lon), 2);
+      if( aux)
+         *aux = loc[0];
+      rval = loc[1];
+      }
+   else
+      rval = posn_table_altitude( s->table, jd, s->observer_lat,
+                              s->observer_lon, NULL) - s->altitude;
+   return( rval);
+}
+
+#define EVENT_TOLERANCE 1e-7     /* days;  about .01 second */
+
+static double find_event_root( const event_search_t *s, double t0, double f0,
+                                                        double t1, double f1)
+{
+   double t = t0, prev_t = t1;
+   int side = 0, iter;
+
+   for( iter = 0; iter < 60 && fabs( t - prev_t) > EVENT_TOLERANCE; iter++)
+      {
+      double f;
+
+      prev_t = t;
+      t = (t0 * f1 - t1 * f0) / (f1 - f0);
+      f = event_func( s, t, NULL);
+      if( f == 0.)
+         break;
+      if( (f > 0.) == (f1 > 0.))
+         {
+         t1 = t;
+         f1 = f;
+         if( side == -1)
+            f0 /= 2.;
+         side = -1;
+         }
+      else
+         {
+         t0 = t;
+         f0 = f;
+         if( side == 1)
+            f1 /= 2.;
+         side = 1;
+         }
+      }
+   return( t);
+}
+
+/* Checks samples at t - dt, t, t + dt for an extremum between them that
+may cross zero,  even though all three samples have the same sign.  If
+one is found,  its time is returned,  with the function value there in
+*f_ext;  otherwise,  zero is returned.  */
+
+static double check_for_grazing( const event_search_t *s, const double t,
+            const double dt, const double *f, double *f_ext)
+{
+   const double a = (f[0] - 2. * f[1] + f[2]) / 2.;
+   const double b = (f[2] - f[0]) / 2.;
+   const double sign = (f[1] > 0. ? 1. : -1.);
+   brent_min_t brent;
+
+   if( (f[0] > 0.) != (f[1] > 0.) || (f[2] > 0.) != (f[1] > 0.))
+      return( 0.);
+   if( a * sign <= 0.)     /* curving away from zero */
+      return( 0.);
+   if( (f[1] - b * b / (4. * a)) * sign > 5e-3)
+      return( 0.);         /* parabola's extremum isn't near zero */
+   if( f[1] * sign > f[0] * sign || f[1] * sign > f[2] * sign)
+      return( 0.);         /* extremum isn't bracketed by the samples */
+            /* Brent minimizes,  so we minimize sign * f(t) */
+   brent_min_init( &brent, t - dt, f[0] * sign, t, f[1] * sign,
+                           t + dt, f[2] * sign);
+   brent.tolerance = EVENT_TOLERANCE * 10.;
+   brent.ytolerance = 0.;
+   while( brent.step_type && brent.n_iterations < 100)
+      {
+      const double new_t = brent_min_next( &brent);
+
+      if( brent.step_type)
+         {
+         *f_ext = event_func( s, new_t, NULL);
+         brent_min_add( &brent, *f_ext * sign);
+         if( *f_ext * sign < 0.)
+            return( new_t);      /* we've crossed zero;  done */
+         }
+      }
+   *f_ext = brent.y[0] * sign;
+   return( brent.x[0]);
+}
+
+#define N_EVENT_SAMPLES 24
+
+/* Searches [jd, jd + 1] for sign changes of event_func( ).  Times at
+which it goes from non-positive to positive are stored in times[0],  and
+positive to non-positive in times[1].  (If there are several,  the last
+one is kept,  as with the hourly search in tables.cpp.)  Returns the
+number of events found.  */
+
+static int search_for_events( const event_search_t *s, const double jd,
+                              double *times, double *aux)
+{
+   const double dt = 1. / (double)N_EVENT_SAMPLES;
+   double f[N_EVENT_SAMPLES + 1];
+   int i, n_found = 0;
+
+   times[0] = times[1] = -1.;
+   for( i = 0; i <= N_EVENT_SAMPLES; i++)
+      f[i] = event_func( s, jd + (double)i * dt, NULL);
+   for( i = 0; i < N_EVENT_SAMPLES; i++)
+      {
+      double t0 = jd + (double)i * dt, t1 = t0 + dt;
+      double f0 = f[i], f1 = f[i + 1];
+
+      if( i < N_EVENT_SAMPLES - 1 && (f0 > 0.) == (f1 > 0.))
+         {           /* look for grazing of zero around the sample */
+         double f_ext;     /* at t1,  i.e.,  between t0 and t1 + dt */
+         const double t_ext = check_for_grazing( s, t1, dt, f + i, &f_ext);
+
+         if( t_ext && (f_ext > 0.) != (f0 > 0.))
+            {
+            const double t_in = find_event_root( s, t0, f0, t_ext, f_ext);
+            const double t_out = find_event_root( s, t_ext, f_ext,
+                                                  t1 + dt, f[i + 2]);
+
+            times[f_ext > 0. ? 0 : 1] = t_in;
+            times[f_ext > 0. ? 1 : 0] = t_out;
+            n_found += 2;
+            i++;           /* we've covered the following hour,  too */
+            continue;
+            }
+         }
+      if( (f0 > 0.) != (f1 > 0.))
+         {
+         const int idx = (f1 > 0. ? 0 : 1);
+
+         times[idx] = find_event_root( s, t0, f0, t1, f1);
+         if( aux)
+            event_func( s, times[idx], aux + idx);
+         n_found++;
+         }
+      }
+   return( n_found);
+}
+
+/* Finds the times during the day starting at 'jd' at which the object
+(whose positions are in 'table') rises above,  or sets below,  the given
+altitude (radians).  Rise time goes in rise_set[0],  set time in
+rise_set[1];  either is -1 if no such event occurs.  */
+
+int find_altitude_crossings( const POSN_TABLE *table, double *rise_set,
+                  const double jd,
+                  const double observer_lat, const double observer_lon,
+                  const double altitude)
+{
+   event_search_t s;
+
+   s.table = table;
+   s.observer_lat = observer_lat;
+   s.observer_lon = observer_lon;
+   s.altitude = altitude;
+   s.event_type = EVENT_ALTITUDE;
+   return( search_for_events( &s, jd, rise_set, NULL));
+}
+
+/* As above,  using the same rise/set altitudes as look_for_rise_set( ). */
+
+int find_rise_set_times( const POSN_TABLE *table, double *rise_set,
+                  const double jd,
+                  const double observer_lat, const double observer_lon)
+{
+   const double riseset_alt = (table->planet_no == 10 ? .125 : -.83333)
+                                       * pi / 180.;
+
+   return( find_altitude_crossings( table, rise_set, jd,
+                           observer_lat, observer_lon, riseset_alt));
+}
+
+/* Finds the time of transit (if real_transit == 1) or 'anti-transit' (if
+real_transit == 0) during the day starting at 'jd',  or -1 if there is
+none (the moon skips one day a month).   */
+
+double find_transit_time( const POSN_TABLE *table, const double jd,
+                  const double observer_lon, const int real_transit)
+{
+   event_search_t s;
+   double times[2], aux[2];
+   int i;
+
+   s.table = table;
+   s.observer_lat = s.altitude = 0.;
+   s.observer_lon = observer_lon;
+   s.event_type = EVENT_TRANSIT;
+   aux[0] = aux[1] = 0.;
+   search_for_events( &s, jd, times, aux);
+   for( i = 0; i < 2; i++)
+      if( times[i] >= 0. && (aux[i] > 0.) == (real_transit != 0))
+         return( times[i]);
+   return( -1.);
+}
+
+/* Fills in SITE_ALMANACs for 'n_sites' sites at latitudes/longitudes
+lats[i], lons[i] (radians),  for the days starting at jds[i] (which will
+usually differ only by time zone).  The sun and moon positions come from
+the tables,  which must span all of those days;  so nothing but sidereal
+time and the observer's latitude differ from site to site,  and the
+sites can be processed in parallel ('make OPENMP=Y').  */
+
+int find_site_almanacs( const POSN_TABLE *sun, const POSN_TABLE *moon,
+                  const int n_sites, const double *lats, const double *lons,
+                  const double *jds, SITE_ALMANAC *almanacs)
+{
+   int i;
+
+#ifdef _OPENMP
+   #pragma omp parallel for schedule( dynamic, 16)
+#endif
+   for( i = 0; i < n_sites; i++)
+      {
+      SITE_ALMANAC *alm = almanacs + i;
+      const double deg = pi / 180.;
+
+      find_rise_set_times( sun, alm->sun_rise_set, jds[i], lats[i], lons[i]);
+      find_rise_set_times( moon, alm->moon_rise_set, jds[i], lats[i], lons[i]);
+      find_altitude_crossings( sun, alm->civil, jds[i], lats[i], lons[i],
+                                    -6. * deg);
+      find_altitude_crossings( sun, alm->nautical, jds[i], lats[i], lons[i],
+                                    -12. * deg);
+      find_altitude_crossings( sun, alm->astronomical, jds[i], lats[i],
+                                    lons[i], -18. * deg);
+      alm->sun_transit = find_transit_time( sun, jds[i], lons[i], 1);
+      alm->moon_transit = find_transit_time( moon, jds[i], lons[i], 1);
+      }
+   return( n_sites);
+}
@@ -32,3 +32,50 @@ double look_for_rise_set( const int planet_no,
                   const double observer_lat, const double observer_lon,
                   const char *vsop_data, int *is_setting);
 char *load_file_into_memory( const char *filename, size_t *filesize);
+
+/* A POSN_TABLE holds equatorial unit vectors (of date) for the sun or
+moon at evenly spaced times,  so that rise/set/transit searches can
+interpolate positions instead of re-running the theory.  See riseset3.cpp. */
+
+#define POSN_TABLE struct posn_table
+
+POSN_TABLE
+   {
+   int planet_no, n_nodes;
+   double jd0, step;             /* node 'i' is at time jd0 + i * step */
+   double *vects;
+   };
+
+int make_posn_table( POSN_TABLE *table, const int planet_no,
+                  const double jd_start, const double jd_end,
+                  const char *vsop_data);
+void free_posn_table( POSN_TABLE *table);
+double posn_table_altitude( const POSN_TABLE *table, const double jd,
+                  const double observer_lat, const double observer_lon,
+                  double *hour_angle);
+int find_altitude_crossings( const POSN_TABLE *table, double *rise_set,
+                  const double jd,
+                  const double observer_lat, const double observer_lon,
+                  const double altitude);
+int find_rise_set_times( const POSN_TABLE *table, double *rise_set,
+                  const double jd,
+                  const double observer_lat, const double observer_lon);
+double find_transit_time( const POSN_TABLE *table, const double jd,
+                  const double observer_lon, const int real_transit);
+
+/* Rise/set/transit/twilight times for one site and one day,  as found
+by find_site_almanacs( ).  Each pair is (rise, set) or (dawn, dusk);
+any time is -1 if the event doesn't happen that day.   */
+
+#define SITE_ALMANAC struct site_almanac
+
+SITE_ALMANAC
+   {
+   double sun_rise_set[2], moon_rise_set[2];
+   double civil[2], nautical[2], astronomical[2];
+   double sun_transit, moon_transit;
+   };
+
+int find_site_almanacs( const POSN_TABLE *sun, const POSN_TABLE *moon,
+                  const int n_sites, const double *lats, const double *lons,
+                  const double *jds, SITE_ALMANAC *almanacs);
@@ -610,6 +610,139 @@ static const ROCK rocks[N_ROCKS] = {
 #define DLL_FUNC
 #endif
 
+   /* The Laplacian pole of each rock is fixed,  so the (avect, bvect,    */
+   /* cvect) frame built from it need only be computed once.  At the same */
+   /* time,  we build an index from JPL ID to the rock in question.  JPL  */
+   /* IDs are planet * 100 + (satellite number),  with satellite numbers  */
+   /* below MAX_ROCK_SAT_NO,  which makes for a conveniently small table. */
+   /* Both are built by get_rock_tables( ) into a function-local static;  */
+   /* C++11 guarantees that's initialised exactly once,  even if several  */
+   /* threads make their first calls at the same time.                    */
+
+typedef struct
+{
+   double avect[3], bvect[3], cvect[3];
+} rock_frame_t;
+
+#define MAX_ROCK_SAT_NO 100
+#define N_ROCK_PLANETS    9
+
+typedef struct
+{
+   rock_frame_t frames[N_ROCKS];
+   signed char index[N_ROCK_PLANETS][MAX_ROCK_SAT_NO];
+} rock_tables_t;
+
+static void make_rock_frame( const ROCK *rptr, rock_frame_t *frame)
+{
+   const double tsin = sin( rptr->laplacian_pole_dec);
+   const double tcos = cos( rptr->laplacian_pole_dec);
+
+                     /* avect is at right angles to Laplacian pole, */
+                     /* but in plane of the J2000 equator:          */
+   frame->avect[0] = -sin( rptr->laplacian_pole_ra);
+   frame->avect[1] = cos( rptr->laplacian_pole_ra);
+   frame->avect[2] = 0.;
+
+                     /* bvect is at right angles to Laplacian pole  */
+                     /* _and_ to avect:                             */
+   frame->bvect[0] = -frame->avect[1] * tsin;
+   frame->bvect[1] = frame->avect[0] * tsin;
+   frame->bvect[2] = tcos;
+
+                     /* cvect is the Laplacian pole vector:  */
+   frame->cvect[0] = frame->avect[1] * tcos;
+   frame->cvect[1] = -frame->avect[0] * tcos;
+   frame->cvect[2] = tsin;
+}
+
+static rock_tables_t build_rock_tables( void)
+{
+   rock_tables_t rval;
+   int i, j;
+
+   for( i = 0; i < N_ROCK_PLANETS; i++)
+      for( j = 0; j < MAX_ROCK_SAT_NO; j++)
+         rval.index[i][j] = -1;
+   for( i = 0; i < N_ROCKS; i++)
+      {
+      make_rock_frame( rocks + i, rval.frames + i);
+      rval.index[rocks[i].jpl_id / 100][rocks[i].jpl_id % 100] = (signed char)i;
+      }
+   return( rval);
+}
+
+static const rock_tables_t *get_rock_tables( void)
+{
+   static const rock_tables_t tables = build_rock_tables( );
+
+   return( &tables);
+}
+
+static int find_rock( const rock_tables_t *tables, const int jpl_id)
+{
+   if( jpl_id < 100 || jpl_id >= N_ROCK_PLANETS * 100)
+      return( -1);
+   return( tables->index[jpl_id / 100][jpl_id % 100]);
+}
+
+static void rock_posn( const ROCK *rptr, const rock_frame_t *frame,
+                       const double jde, double *output_vect)
+{
+   const double seconds_per_day = 86400.;
+   const double dt_seconds = (jde - rptr->epoch_jd) * seconds_per_day;
+   const double mean_lon =
+              rptr->mean_lon0 + dt_seconds * rptr->mean_motion;
+   double h, k, p, q, tsin, tcos, r, e, omega, true_lon;
+   double a_fraction, b_fraction, c_fraction, dot_prod;
+   int i;
+
+                     /* Rotate the (h, k) vector to account for */
+                     /* a constant apsidal motion:              */
+   tsin = sin( dt_seconds * rptr->apsis_rate);
+   tcos = cos( dt_seconds * rptr->apsis_rate);
+   h = rptr->k * tsin + rptr->h * tcos;
+   k = rptr->k * tcos - rptr->h * tsin;
+
+                     /* I'm sure there's a better way to do this...  */
+                     /* all I do here is to compute the eccentricity */
+                     /* and omega,  a.k.a. longitude of perihelion,  */
+                     /* and do a first-order correction to get the   */
+                     /* 'actual' r and true longitude values.        */
+   e = sqrt( h * h + k * k);
+   omega = atan2( h, k);
+   true_lon = mean_lon + 2. * e * sin( mean_lon - omega)
+                    + 1.25 * e * e * sin( 2. * (mean_lon - omega));
+   r = rptr->a * (1. - e * e) / (1 + e * cos( true_lon - omega));
+
+                     /* Just as we rotated (h,k),  we gotta rotate */
+                     /* the (p,q) vector to account for precession */
+                     /* in the Laplacian plane:                    */
+
+   tsin = sin( dt_seconds * rptr->node_rate);
+   tcos = cos( dt_seconds * rptr->node_rate);
+   p = rptr->q * tsin + rptr->p * tcos;
+   q = rptr->q * tcos - rptr->p * tsin;
+
+                     /* Now we evaluate the position in components */
+                     /* along avect, bvect, cvect.  I derived the  */
+                     /* formulae from scratch... sorry I can't     */
+                     /* give references:                           */
+   tsin = sin( true_lon);
+   tcos = cos( true_lon);
+   dot_prod = 2. * (q * tsin - p * tcos) / (1. + p * p + q * q);
+   a_fraction = tcos + p * dot_prod;
+   b_fraction = tsin - q * dot_prod;
+   c_fraction = dot_prod;
+
+                     /* Now that we've got components on each axis, */
+                     /* the remainder is trivial: */
+   for( i = 0; i < 3; i++)
+      output_vect[i] = r * (a_fraction * frame->avect[i]
+                          + b_fraction * frame->bvect[i]
+                          + c_fraction * frame->cvect[i]);
+}
+
    /* Given a JDE and a JPL ID number (see list at the top of this file), */
    /* evaluate_rock( ) will compute the J2000 equatorial Cartesian        */
    /* position for that "rock" and will return 0.  Otherwise,  it returns */
@@ -624,86 +757,50 @@ extern "C" {
 int DLL_FUNC evaluate_rock( const double jde, const int jpl_id,
                                                   double *output_vect)
 {
-   int i;
-   const ROCK *rptr = rocks;
+   const rock_tables_t *tables = get_rock_tables( );
+   const int idx = find_rock( tables, jpl_id);
 
-   for( i = N_ROCKS; i; i--, rptr++)
-      if( rptr->jpl_id == jpl_id)
+   if( idx < 0)
+      return( -1);
+   rock_posn( rocks + idx, tables->frames + idx, jde, output_vect);
+   return( 0);
+}
+
+   /* evaluate_rocks( ) computes positions for all rocks orbiting the     */
+   /* given planet (4=Mars... 8=Neptune) at each of n_times JDEs.  The    */
+   /* output is n_times groups of three doubles per rock,  in the order   */
+   /* in which the rocks' JPL IDs are stored in 'jpl_ids' (which can be   */
+   /* NULL if you don't care;  otherwise,  it should have room for all    */
+   /* N_ROCKS).  The return value is the number of rocks for that planet, */
+   /* so call with n_times = 0 to find out how big 'output' must be.      */
+   /* Times are independent,  and are computed in parallel if OpenMP is   */
+   /* enabled.                                                            */
+
+int DLL_FUNC evaluate_rocks( const int planet_no, const int n_times,
+                     const double *jdes, double *output, int *jpl_ids)
+{
+   const rock_tables_t *tables = get_rock_tables( );
+   int idx[N_ROCKS], n_found = 0, i;
+
+   for( i = 0; i < N_ROCKS; i++)
+      if( rocks[i].jpl_id / 100 == planet_no)
          {
-         const double seconds_per_day = 86400.;
-         const double dt_seconds = (jde - rptr->epoch_jd) * seconds_per_day;
-         const double mean_lon =
-                    rptr->mean_lon0 + dt_seconds * rptr->mean_motion;
-         double avect[3], bvect[3], cvect[3];
-         double h, k, p, q, tsin, tcos, r, e, omega, true_lon;
-         double a_fraction, b_fraction, c_fraction, dot_prod;
-
-                        /* avect is at right angles to Laplacian pole, */
-                        /* but in plane of the J2000 equator:          */
-         avect[0] = -sin( rptr->laplacian_pole_ra);
-         avect[1] = cos( rptr->laplacian_pole_ra);
-         avect[2] = 0.;
-
-                        /* bvect is at right angles to Laplacian pole  */
-                        /* _and_ to avect:                             */
-         tsin = sin( rptr->laplacian_pole_dec);
-         tcos = cos( rptr->laplacian_pole_dec);
-         bvect[0] = -avect[1] * tsin;
-         bvect[1] = avect[0] * tsin;
-         bvect[2] = tcos;
-
-                        /* cvect is the Laplacian pole vector:  */
-         cvect[0] = avect[1] * tcos;
-         cvect[1] = -avect[0] * tcos;
-         cvect[2] = tsin;
-
-                           /* Rotate the (h, k) vector to account for */
-                           /* a constant apsidal motion:              */
-         tsin = sin( dt_seconds * rptr->apsis_rate);
-         tcos = cos( dt_seconds * rptr->apsis_rate);
-         h = rptr->k * tsin + rptr->h * tcos;
-         k = rptr->k * tcos - rptr->h * tsin;
-
-                           /* I'm sure there's a better way to do this...  */
-                           /* all I do here is to compute the eccentricity */
-                           /* and omega,  a.k.a. longitude of perihelion,  */
-                           /* and do a first-order correction to get the   */
-                           /* 'actual' r and true longitude values.        */
-         e = sqrt( h * h + k * k);
-         omega = atan2( h, k);
-         true_lon = mean_lon + 2. * e * sin( mean_lon - omega)
-                          + 1.25 * e * e * sin( 2. * (mean_lon - omega));
-         r = rptr->a * (1. - e * e) / (1 + e * cos( true_lon - omega));
-
-                           /* Just as we rotated (h,k),  we gotta rotate */
-                           /* the (p,q) vector to account for precession */
-                           /* in the Laplacian plane:                    */
-
-         tsin = sin( dt_seconds * rptr->node_rate);
-         tcos = cos( dt_seconds * rptr->node_rate);
-         p = rptr->q * tsin + rptr->p * tcos;
-         q = rptr->q * tcos - rptr->p * tsin;
-
-                           /* Now we evaluate the position in components */
-                           /* along avect, bvect, cvect.  I derived the  */
-                           /* formulae from scratch... sorry I can't     */
-                           /* give references:                           */
-         tsin = sin( true_lon);
-         tcos = cos( true_lon);
-         dot_prod = 2. * (q * tsin - p * tcos) / (1. + p * p + q * q);
-         a_fraction = tcos + p * dot_prod;
-         b_fraction = tsin - q * dot_prod;
-         c_fraction = dot_prod;
-
-                           /* Now that we've got components on each axis, */
-                           /* the remainder is trivial: */
-         for( i = 0; i < 3; i++)
-            output_vect[i] = r * (a_fraction * avect[i]
-                                + b_fraction * bvect[i]
-                                + c_fraction * cvect[i]);
-         return( 0);
+         if( jpl_ids)
+            jpl_ids[n_found] = rocks[i].jpl_id;
+         idx[n_found++] = i;
          }
-   return( -1);
+#ifdef _OPENMP
+   #pragma omp parallel for
+#endif
+   for( i = 0; i < n_times; i++)
+      {
+      int j;
+
+      for( j = 0; j < n_found; j++)
+         rock_posn( rocks + idx[j], tables->frames + idx[j], jdes[i],
+                           output + (i * n_found + j) * 3);
+      }
+   return( n_found);
 }
 
 #ifdef __cplusplus
@@ -203,10 +203,470 @@ int extract_sof_data( ELEMENTS *elem, const char *buff, const char *header)
    return( extract_sof_data_ex( elem, buff, header, NULL));
 }
 
+/* extract_sof_data_ex( ) walks through the header for every record,
+copying each field and deciding what to do with it based on the header
+text.  When reading an entire file (such as 'mpcorb.sof',  with over a
+million records),  it's faster to do that once :  compile_sof_header( )
+turns the header into a list of columns we care about (offset,  width,
+which element it sets,  and how to convert it),  and
+extract_sof_data_compiled( ) just runs through that list.  The results
+are exactly those of extract_sof_data_ex( ).
+
+   Numbers are decoded in place,  without copying,  using a variant of
+quick_strtod( ) in mpc_code.cpp :  all the digits go into one integer,
+which is then divided by a power of ten.  With up to 15 digits,  both
+numbers are exact,  so the division gives the correctly rounded result,
+just as atof( ) would.  A field with no digits at all (blank,  or a
+lone '-' or '.') has no value and is zero,  as it would be from atof( ),
+rather than -0.  Anything odder (more digits,  exponents,  other text)
+falls back to atof( ).     */
+
+#define SOF_FIELD_Q              0
+#define SOF_FIELD_ECC            1
+#define SOF_FIELD_INCL           2
+#define SOF_FIELD_ASC_NODE       3
+#define SOF_FIELD_ARG_PERIH      4
+#define SOF_FIELD_ABS_MAG        5
+#define SOF_FIELD_SLOPE_PARAM    6
+#define SOF_FIELD_CENTRAL_OBJ    7
+#define SOF_FIELD_TPERIH         8
+#define SOF_FIELD_TEPOCH         9
+#define SOF_FIELD_TWRITTEN      10
+#define SOF_FIELD_TFIRST        11
+#define SOF_FIELD_TLAST         12
+#define SOF_FIELD_RMS           13
+
+#define SOF_CONVERT_NUMBER       0
+#define SOF_CONVERT_DEGREES      1
+#define SOF_CONVERT_DATE         2
+#define SOF_CONVERT_INT          3
+
+#define MAX_SOF_COLUMNS         32
+
+typedef struct
+{
+   uint16_t offset, width;
+   char field, converter;
+} sof_column_t;
+
+typedef struct
+{
+   int n_columns;
+   sof_column_t columns[MAX_SOF_COLUMNS];
+} sof_plan_t;
+
+static int add_sof_column( sof_plan_t *plan, const size_t offset,
+               const size_t width, const int field, const int converter)
+{
+   sof_column_t *col = plan->columns + plan->n_columns;
+
+   if( plan->n_columns == MAX_SOF_COLUMNS)
+      return( -1);
+   col->offset = (uint16_t)offset;
+   col->width = (uint16_t)width;
+   col->field = (char)field;
+   col->converter = (char)converter;
+   plan->n_columns++;
+   return( 0);
+}
+
+/* Returns NULL if memory couldn't be allocated,  or if the header is one
+that extract_sof_data_ex( ) would reject (fields too short or too long). */
+
+void *compile_sof_header( const char *header)
+{
+   sof_plan_t *plan = (sof_plan_t *)calloc( 1, sizeof( sof_plan_t));
+   size_t offset = 0;
+   int err = 0;
+
+   if( !plan)
+      return( NULL);
+   while( !err && header[offset] >= ' ')
+      {
+      const char *hptr = header + offset;
+      size_t i = 0;
+      int field = -1, converter = SOF_CONVERT_NUMBER;
+
+      while( hptr[i] >= ' ' && hptr[i] != '|')
+         i++;
+      if( i < 2 || i >= 80)
+         err = -1;
+      else if( hptr[1] == ' ')
+         switch( hptr[0])
+            {
+            case 'q':
+               field = SOF_FIELD_Q;
+               break;
+            case 'e':
+               field = SOF_FIELD_ECC;
+               break;
+            case 'i':
+               field = SOF_FIELD_INCL;
+               converter = SOF_CONVERT_DEGREES;
+               break;
+            case 'O':
+               field = SOF_FIELD_ASC_NODE;
+               converter = SOF_CONVERT_DEGREES;
+               break;
+            case 'o':
+               field = SOF_FIELD_ARG_PERIH;
+               converter = SOF_CONVERT_DEGREES;
+               break;
+            case 'H':
+               field = SOF_FIELD_ABS_MAG;
+               break;
+            case 'G':
+               field = SOF_FIELD_SLOPE_PARAM;
+               break;
+            case 'C':
+               field = SOF_FIELD_CENTRAL_OBJ;
+               converter = SOF_CONVERT_INT;
+               break;
+            }
+      else switch( hptr[0])
+         {
+         case 'T':
+            converter = SOF_CONVERT_DATE;
+            switch( hptr[1])
+               {
+               case 'p':
+                  field = SOF_FIELD_TPERIH;
+                  break;
+               case 'e':
+                  field = SOF_FIELD_TEPOCH;
+                  break;
+               case 'w':
+                  field = SOF_FIELD_TWRITTEN;
+                  break;
+               case 'f':
+                  field = SOF_FIELD_TFIRST;
+                  break;
+               case 'l':
+                  field = SOF_FIELD_TLAST;
+                  break;
+               }
+            break;
+         case 'O':
+            field = SOF_FIELD_ASC_NODE;
+            converter = SOF_CONVERT_DEGREES;
+            break;
+         case 'o':
+            field = SOF_FIELD_ARG_PERIH;
+            converter = SOF_CONVERT_DEGREES;
+            break;
+         }
+      if( !err && field >= 0)
+         err = add_sof_column( plan, offset, i, field, converter);
+      if( !err && !memcmp( hptr, "rms", 3))
+         err = add_sof_column( plan, offset, i, SOF_FIELD_RMS,
+                                             SOF_CONVERT_NUMBER);
+      if( hptr[i] == '|')
+         i++;
+      offset += i;
+      }
+   if( err)
+      {
+      free( plan);
+      plan = NULL;
+      }
+   return( plan);
+}
+
+void free_compiled_sof_header( void *plan)
+{
+   free( plan);
+}
+
+/* astcheck identifies a particular 'mpcorb.sof' (and therefore which
+of its cached .chk day-data files are still valid) by a checksum of a
+few samples from the file.  mpc2sof needs the same checksum when
+writing a diff between two SOF files,  so it's computed here.  Note that
+(for historical reasons,  and so that existing .chk files remain valid)
+only one byte from each sample actually goes into the checksum.  The
+file is left positioned at its start.  */
+
+int32_t get_sof_file_checksum( FILE *ifile)
+{
+   int32_t rval = 0;
+   size_t i, j;
+   char buff[450];
+   int filelen;
+
+   fseek( ifile, 0L, SEEK_END);
+   filelen = (int)ftell( ifile);
+   for( i = 0; i < 4; i++)
+      {
+      const int32_t big_prime = 1234567891;
+
+      fseek( ifile, (long)( i * (filelen - sizeof( buff))) / 3L, SEEK_SET);
+      if( fread( buff, sizeof( buff), 1, ifile))
+         for( j = 0; j < sizeof( buff); j++)
+            rval = rval * big_prime + (int32_t)buff[i];
+      }
+   fseek( ifile, 0L, SEEK_SET);
+   return( rval);
+}
+
+/* The above only samples the file,  so two 'mpcorb.sof's differing in
+a few orbits can easily have the same checksum.  When that matters --
+astcheck deciding whether a .chk file was made from this very file,  or
+mpc2sof checking that a diff is being applied to (and produces) exactly
+the right file -- use this FNV-1a hash of the entire file instead.  The
+file is left positioned at its start.  */
+
+uint32_t get_sof_file_full_checksum( FILE *ifile)
+{
+   uint32_t rval = 2166136261u;
+   char buff[4096];
+   size_t i, n_read;
+
+   fseek( ifile, 0L, SEEK_SET);
+   while( (n_read = fread( buff, 1, sizeof( buff), ifile)) > 0)
+      for( i = 0; i < n_read; i++)
+         rval = (rval ^ (unsigned char)buff[i]) * 16777619u;
+   fseek( ifile, 0L, SEEK_SET);
+   return( rval);
+}
+
+static double slow_sof_atof( const char *buff, const size_t width)
+{
+   char tbuff[80];
+
+   memcpy( tbuff, buff, width);
+   tbuff[width] = '\0';
+   return( atof( tbuff));
+}
+
+static double sof_atof( const char *buff, const size_t width)
+{
+   static const double powers_of_ten[16] = { 1., 1e+1, 1e+2, 1e+3, 1e+4,
+            1e+5, 1e+6, 1e+7, 1e+8, 1e+9, 1e+10, 1e+11, 1e+12, 1e+13,
+            1e+14, 1e+15 };
+   const char *end = buff + width, *tptr = buff;
+   bool is_negative = false;
+   int64_t mantissa = 0;
+   int n_digits = 0, n_decimals = 0;
+   double rval;
+
+   while( tptr < end && *tptr == ' ')
+      tptr++;
+   if( tptr < end && (*tptr == '-' || *tptr == '+'))
+      is_negative = (*tptr++ == '-');
+   while( tptr < end && *tptr >= '0' && *tptr <= '9')
+      {
+      mantissa = mantissa * 10 + (*tptr++ - '0');
+      n_digits++;
+      }
+   if( tptr < end && *tptr == '.')
+      {
+      tptr++;
+      while( tptr < end && *tptr >= '0' && *tptr <= '9')
+         {
+         mantissa = mantissa * 10 + (*tptr++ - '0');
+         n_digits++;
+         n_decimals++;
+         }
+      }
+   if( n_digits > 15 || (tptr < end && *tptr != ' '))
+      return( slow_sof_atof( buff, width));
+   if( !n_digits)       /* blank,  or just a sign and/or decimal point; */
+      return( 0.);      /* no value,  not -0 */
+   rval = (double)mantissa / powers_of_ten[n_decimals];
+   return( is_negative ? -rval : rval);
+}
+
+static double sof_date_to_jd( const char *buff, const size_t width)
+{
+   int i;
+   long t = 0;
+   double rval;
+
+   for( i = 0; i < 8 && buff[i] >= '0' && buff[i] <= '9'; i++)
+      t = t * 10 + (long)( buff[i] - '0');
+   if( i < 8 || width < 8 || (width > 8 && buff[8] >= '0' && buff[8] <= '9'))
+      {                 /* not plain YYYYMMDD;  do it the slow way */
+      char tbuff[80];
+
+      memcpy( tbuff, buff, width);
+      tbuff[width] = '\0';
+      return( extract_yyyymmdd_to_jd( tbuff));
+      }
+   rval = (double)dmy_to_day( t % 100, (t / 100) % 100, t / 10000,
+                                    CALENDAR_GREGORIAN) - .5;
+   if( width > 8 && buff[8] == '.')
+      rval += sof_atof( buff + 8, width - 8);
+   return( rval);
+}
+
+int extract_sof_data_compiled( ELEMENTS *elem, const char *buff,
+                        const void *compiled_header, double *extra_info)
+{
+   const sof_plan_t *plan = (const sof_plan_t *)compiled_header;
+   int fields_found = 0, rval, i;
+
+   memset( elem, 0, sizeof( ELEMENTS));
+   elem->slope_param = 0.15;
+   elem->gm = SOLAR_GM;
+   if( extra_info)
+      for( i = 0; i < 4; i++)
+         extra_info[i] = 0.;
+   for( i = 0; i < plan->n_columns; i++)
+      {
+      const sof_column_t *col = plan->columns + i;
+      const char *tptr = buff + col->offset;
+      double value = 0.;
+
+      if( col->field >= SOF_FIELD_TWRITTEN && !extra_info)
+         continue;
+      switch( col->converter)
+         {
+         case SOF_CONVERT_NUMBER:
+            value = sof_atof( tptr, col->width);
+            break;
+         case SOF_CONVERT_DEGREES:
+            value = sof_atof( tptr, col->width) * PI / 180.;
+            break;
+         case SOF_CONVERT_DATE:
+            value = sof_date_to_jd( tptr, col->width);
+            break;
+         }
+      switch( col->field)
+         {
+         case SOF_FIELD_Q:
+            elem->q = value;
+            fields_found |= SOF_Q_FOUND;
+            break;
+         case SOF_FIELD_ECC:
+            elem->ecc = value;
+            fields_found |= SOF_ECC_FOUND;
+            break;
+         case SOF_FIELD_INCL:
+            elem->incl = value;
+            fields_found |= SOF_INCL_FOUND;
+            break;
+         case SOF_FIELD_ASC_NODE:
+            elem->asc_node = value;
+            fields_found |= SOF_ASC_NODE_FOUND;
+            break;
+         case SOF_FIELD_ARG_PERIH:
+            elem->arg_per = value;
+            fields_found |= SOF_ARG_PERIH_FOUND;
+            break;
+         case SOF_FIELD_ABS_MAG:
+            elem->abs_mag = value;
+            fields_found |= SOF_ABS_MAG_FOUND;
+            break;
+         case SOF_FIELD_SLOPE_PARAM:
+            elem->slope_param = value;
+            fields_found |= SOF_SLOPE_PARAM_FOUND;
+            break;
+         case SOF_FIELD_CENTRAL_OBJ:
+            {
+            char tbuff[80];
+
+            memcpy( tbuff, tptr, col->width);
+            tbuff[col->width] = '\0';
+            elem->central_obj = atoi( tbuff);
+            if( 3 == elem->central_obj)
+               elem->gm *= MASS_EARTH;
+            }
+            break;
+         case SOF_FIELD_TPERIH:
+            elem->perih_time = value;
+            fields_found |= SOF_TPERIH_FOUND;
+            break;
+         case SOF_FIELD_TEPOCH:
+            elem->epoch = value;
+            fields_found |= SOF_TEPOCH_FOUND;
+            break;
+         case SOF_FIELD_TWRITTEN:
+            extra_info[2] = value;
+            fields_found |= SOF_TWRITTEN_FOUND;
+            break;
+         case SOF_FIELD_TFIRST:
+            extra_info[0] = value;
+            fields_found |= SOF_TFIRST_FOUND;
+            break;
+         case SOF_FIELD_TLAST:
+            extra_info[1] = value;
+            fields_found |= SOF_TLAST_FOUND;
+            break;
+         case SOF_FIELD_RMS:
+            extra_info[3] = value;
+            break;
+         }
+      }
+   if( (fields_found & MIN_FIELDS_NEEDED) == MIN_FIELDS_NEEDED)
+      {
+      rval = 0;            /* success */
+      derive_quantities( elem, elem->gm);
+      }
+   else
+      {
+      printf( "Got '%x'\n", (unsigned)fields_found);
+      rval = -1;
+      }
+   return( rval);
+}
+
 #ifdef TEST_CODE
 
+#include <time.h>
+
 #define MAX_LEN 300
 
+/* Parses every record in the file with both extract_sof_data_ex( ) and
+extract_sof_data_compiled( ),  reporting parse rates and any records
+for which the results differ.  */
+
+static int benchmark( FILE *ifile, const char *header)
+{
+   void *plan = compile_sof_header( header);
+   char buff[MAX_LEN];
+   clock_t t0, old_time = 0, new_time = 0;
+   long n_records = 0, n_mismatches = 0;
+
+   if( !plan)
+      {
+      printf( "Header didn't compile\n");
+      return( -1);
+      }
+   while( fgets( buff, sizeof( buff), ifile))
+      {
+      ELEMENTS elem1, elem2;
+      double extra1[4], extra2[4];
+      int rval1, rval2;
+
+      t0 = clock( );
+      rval1 = extract_sof_data_ex( &elem1, buff, header, extra1);
+      old_time += clock( ) - t0;
+      t0 = clock( );
+      rval2 = extract_sof_data_compiled( &elem2, buff, plan, extra2);
+      new_time += clock( ) - t0;
+      if( rval1 != rval2 || memcmp( &elem1, &elem2, sizeof( ELEMENTS))
+                         || memcmp( extra1, extra2, sizeof( extra1)))
+         {
+         if( n_mismatches < 10)
+            printf( "Mismatch: %s", buff);
+         n_mismatches++;
+         }
+      n_records++;
+      }
+   free_compiled_sof_header( plan);
+   printf( "%ld records;  %ld mismatches\n", n_records, n_mismatches);
+   printf( "extract_sof_data_ex( ) :       %.3f s (%.0f records/s)\n",
+            (double)old_time / (double)CLOCKS_PER_SEC,
+            (double)n_records * (double)CLOCKS_PER_SEC / (double)old_time);
+   printf( "extract_sof_data_compiled( ) : %.3f s (%.0f records/s)\n",
+            (double)new_time / (double)CLOCKS_PER_SEC,
+            (double)n_records * (double)CLOCKS_PER_SEC / (double)new_time);
+   return( 0);
+}
+
+/* Run as 'sof (filename) (object name)' to see elements for that object,
+or as 'sof (filename) -b' to parse the whole file both the usual way and
+with a compiled header,  and compare speed and results.  */
+
 int main( const int argc, const char **argv)
 {
    FILE *ifile = fopen( argv[1], "rb");
@@ -221,6 +681,13 @@ int main( const int argc, const char **argv)
       printf( "Couldn't read header\n");
       return( -1);
       }
+   if( !strcmp( argv[2], "-b"))
+      {
+      const int rval = benchmark( ifile, header_line);
+
+      fclose( ifile);
+      return( rval);
+      }
    tptr = strchr( header_line, '|');
    assert( tptr);
    name_len = tptr - header_line;
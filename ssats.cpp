@@ -546,3 +546,83 @@ int DLL_FUNC calc_ssat_loc( const double t, double DLLPTR *ssat,
 #endif
    return( 0);
 }
+
+/* calc_ssat_loc_grid( ) computes the same J2000 ecliptic positions as
+calc_ssat_loc( ) for 'n_steps' evenly spaced times,  jd0,  jd0 + step,
+etc.,  for those satellites whose bits are set in 'sats_wanted' (bit 0 =
+Mimas... bit 8 = Phoebe).  Output is 27 doubles per time (three for each
+of the nine satellites;  zeroes for those not wanted).
+
+   The rotations from Saturn's equator to the B1950 ecliptic,  then to
+the B1950 equator,  the precession to J2000,  and the rotation to the
+J2000 ecliptic are the same at every time step.  So they're combined
+into two matrices (one for the inner four satellites,  one for the
+rest),  computed once.  Dourneau's elements are then the only part that
+depends on time.  Each time step is independent,  so the loop runs
+in parallel if OpenMP is enabled.   */
+
+static void ssat_output_matrix( double *matrix, const bool inner_sat)
+{
+   double precess_matrix[9];
+   int i;
+
+   setup_precession( precess_matrix, 1950., 2000);
+   for( i = 0; i < 3; i++)
+      {
+      double loc[3], ovect[3];
+
+      loc[0] = loc[1] = loc[2] = 0.;
+      loc[i] = 1.;
+      if( inner_sat)
+         {
+         rotate_vector( loc, INCL0, 0);
+         rotate_vector( loc, ASC_NODE0, 2);
+         }
+      rotate_vector( loc, OBLIQUITY_1950, 0);
+      precess_vector( precess_matrix, loc, ovect);
+      rotate_vector( ovect, -OBLIQUITY_2000, 0);
+      matrix[i] = ovect[0];         /* stored so that output = matrix * loc */
+      matrix[i + 3] = ovect[1];
+      matrix[i + 6] = ovect[2];
+      }
+}
+
+int DLL_FUNC calc_ssat_loc_grid( const double jd0, const double step,
+               const int n_steps, double DLLPTR *ssats, const int sats_wanted)
+{
+   double matrices[2][9];
+   int step_no;
+
+   ssat_output_matrix( matrices[0], false);
+   ssat_output_matrix( matrices[1], true);
+#ifdef _OPENMP
+   #pragma omp parallel for
+#endif
+   for( step_no = 0; step_no < n_steps; step_no++)
+      {
+      double *optr = ssats + step_no * 27;
+      int sat;
+
+      for( sat = 0; sat <= PHOEBE; sat++, optr += 3)
+         if( sats_wanted & (1 << sat))
+            {
+            const double *matrix = matrices[sat < RHEA ? 1 : 0];
+            SAT_ELEMS elems;
+            ELEMENTS orbit;
+            double loc[4];
+            int i;
+
+            elems.jd = jd0 + (double)step_no * step;
+            elems.sat_no = sat;
+            set_ssat_elems( &elems, &orbit);
+            setup_orbit_vectors( &orbit);
+            comet_posn_part_ii( &orbit, IGNORED_DOUBLE, loc, NULL);
+            for( i = 0; i < 3; i++)
+               optr[i] = matrix[i * 3] * loc[0] + matrix[i * 3 + 1] * loc[1]
+                                                + matrix[i * 3 + 2] * loc[2];
+            }
+         else
+            optr[0] = optr[1] = optr[2] = 0.;
+      }
+   return( sats_wanted);
+}
@@ -18,6 +18,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "watdefs.h"
 #include "lunar.h"
 #include "date.h"
@@ -26,20 +28,77 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #define JUPITER_R (71492. / AU_IN_KM)
 #define J2000     2451545.
 
+static double cpu_seconds( const clock_t t0)
+{
+   return( (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+}
+
+/* Computes positions for 'n_steps' times at ten-minute intervals,  first
+one time at a time,  then with the grid functions,  and shows how long
+each took and the largest difference between the two.   */
+
+static int benchmark_grids( const double jd0, const int n_steps)
+{
+   const double step = 10. / 1440.;
+   double *slow = (double *)calloc( n_steps * 27 * 2, sizeof( double));
+   double *fast = slow + n_steps * 27;
+   double max_diff = 0.;
+   clock_t t0;
+   int i, j;
+
+   if( !slow)
+      return( -1);
+   t0 = clock( );
+   for( i = 0; i < n_steps; i++)
+      calc_jsat_loc( jd0 + (double)i * step, slow + i * 15, 31, 0L);
+   printf( "%d Galilean positions computed singly : %.3f s\n", n_steps,
+                     cpu_seconds( t0));
+   t0 = clock( );
+   calc_jsat_loc_grid( jd0, step, n_steps, fast, 31);
+   printf( "%d Galilean positions on a grid : %.3f s\n", n_steps,
+                     cpu_seconds( t0));
+   for( i = 0; i < n_steps * 15; i++)
+      if( max_diff < fabs( slow[i] - fast[i]))
+         max_diff = fabs( slow[i] - fast[i]);
+   printf( "Max difference %g km\n\n", max_diff * JUPITER_R * AU_IN_KM);
+
+   max_diff = 0.;
+   t0 = clock( );
+   for( i = 0; i < n_steps; i++)
+      for( j = 0; j < 9; j++)
+         calc_ssat_loc( jd0 + (double)i * step, slow + i * 27 + j * 3, j, 0L);
+   printf( "%d Saturnian positions computed singly : %.3f s\n", n_steps,
+                     cpu_seconds( t0));
+   t0 = clock( );
+   calc_ssat_loc_grid( jd0, step, n_steps, fast, 0x1ff);
+   printf( "%d Saturnian positions on a grid : %.3f s\n", n_steps,
+                     cpu_seconds( t0));
+   for( i = 0; i < n_steps * 27; i++)
+      if( max_diff < fabs( slow[i] - fast[i]))
+         max_diff = fabs( slow[i] - fast[i]);
+   printf( "Max difference %g km\n", max_diff * AU_IN_KM);
+   free( slow);
+   return( 0);
+}
+
 int main( const int argc, const char **argv)
 {
    int i;
    double loc[12], jd, precess_matrix[9], t_years, obliquity;
    char buff[80];
 
-   if( argc != 2)
+   if( argc < 2)
       {
       printf( "'ssattest' takes a JD on the command line,  and outputs\n"
               "J2000 ecliptic Cartesian coordinates for the eight main\n"
-              "satellites of Saturn and the four Galileans.\n");
+              "satellites of Saturn and the four Galileans.\n\n"
+              "'ssattest (JD) -b (n)' times computing positions for n\n"
+              "(default 100000) times,  singly and with the grid functions.\n");
       return( -1);
       }
    jd = get_time_from_string( 0., argv[1], 0, NULL);
+   if( argc > 2 && !strcmp( argv[2], "-b"))
+      return( benchmark_grids( jd, (argc > 3 ? atoi( argv[3]) : 100000)));
    full_ctime( buff, jd, FULL_CTIME_YMD);
    t_years = (jd - J2000) / 365.25;
    obliquity = mean_obliquity( t_years / 100.);
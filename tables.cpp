@@ -28,10 +28,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 #include "date.h"
 #include "afuncs.h"
 #include "riseset3.h"
+#include "lun_tran.h"
 
 const static double pi =
      3.1415926535897932384626433832795028841971693993751058209749445923078;
 
+   /* get_rise_set_times( ) was the original way of finding rise/set times :
+step through the day an hour at a time,  computing the object's position
+from scratch each time.  It's now used only with the '-b' (benchmark)
+option,  to check that the faster find_rise_set_times( ) gets the same
+results.      */
+
 static void get_rise_set_times( double *rise_set, const int planet_no,
                   double jd,
                   const double observer_lat, const double observer_lon,
@@ -87,52 +94,297 @@ static int quadrant( double angle)
    return( (int)( angle * 2. / pi));
 }
 
+/* Batch mode :  rise/set/transit/twilight times for many sites on one
+day.  The sites are either a grid in latitude and longitude,  'step'
+degrees apart (times are then in UT),  or a list of US ZIP codes read
+from a file,  looked up with get_zip_code_data( ) (times are then local
+standard time).  Positions of the sun and moon are computed once for
+all sites;  see find_site_almanacs( ).   */
+
+static int site_tables( const int year, const int month, const int day,
+            const double step, const char *zip_filename,
+            const char *vsop_data)
+{
+   const long jd0 = dmy_to_day( day, month, year, 0);
+   int i, n_sites = 0, n_alloced = 1000;
+   double *lats, *lons, *jds, jd_min = 1e+10, jd_max = -1e+10;
+   SITE_ALMANAC *almanacs;
+   POSN_TABLE sun, moon;
+   clock_t t0;
+
+   if( step > 0.)
+      {
+      const int n_lat = (int)( 180. / step), n_lon = (int)( 360. / step);
+
+      n_alloced = n_lat * n_lon;
+      lats = (double *)malloc( (3 * n_alloced + 1) * sizeof( double));
+      if( !lats)
+         {
+         fprintf( stderr, "Couldn't allocate memory for %d sites\n", n_alloced);
+         return( -2);
+         }
+      for( i = 0; i < n_alloced; i++)
+         {
+         lats[i] = (-90. + ((double)( i / n_lon) + .5) * step) * pi / 180.;
+         lats[i + n_alloced] = (-180. + (double)( i % n_lon) * step) * pi / 180.;
+         lats[i + 2 * n_alloced] = (double)jd0 - .5;
+         }
+      n_sites = n_alloced;
+      }
+   else
+      {
+      FILE *ifile = fopen( zip_filename, "rb");
+      char buff[100];
+
+      if( !ifile)
+         {
+         fprintf( stderr, "Couldn't open '%s'\n", zip_filename);
+         return( -1);
+         }
+      lats = (double *)malloc( 3 * n_alloced * sizeof( double));
+      if( !lats)
+         {
+         fclose( ifile);
+         return( -2);
+         }
+      while( fgets( buff, sizeof( buff), ifile))
+         {
+         double lat, lon;
+         int time_zone, use_dst;
+
+         if( !get_zip_code_data( atoi( buff), &lat, &lon, &time_zone,
+                                       &use_dst, NULL))
+            {
+            if( n_sites == n_alloced)
+               {
+               double *tptr;
+
+               n_alloced *= 2;
+               tptr = (double *)malloc( 3 * n_alloced * sizeof( double));
+               if( !tptr)
+                  {
+                  fprintf( stderr, "Couldn't allocate memory for %d sites\n",
+                                    n_alloced);
+                  fclose( ifile);
+                  free( lats);
+                  return( -2);
+                  }
+               for( i = 0; i < 3; i++)
+                  memcpy( tptr + i * n_alloced, lats + i * n_sites,
+                                       n_sites * sizeof( double));
+               free( lats);
+               lats = tptr;
+               }
+            lats[n_sites] = lat * pi / 180.;
+            lats[n_sites + n_alloced] = lon * pi / 180.;
+            lats[n_sites + 2 * n_alloced] =
+                        (double)jd0 - .5 - (double)time_zone / 24.;
+            n_sites++;
+            }
+         else
+            fprintf( stderr, "ZIP code %05d not found\n", atoi( buff));
+         }
+      fclose( ifile);
+      }
+   if( !n_sites)
+      {
+      fprintf( stderr, "No sites to compute\n");
+      free( lats);
+      return( -1);
+      }
+   lons = lats + n_alloced;
+   jds = lats + 2 * n_alloced;
+   for( i = 0; i < n_sites; i++)
+      {
+      if( jd_min > jds[i])
+         jd_min = jds[i];
+      if( jd_max < jds[i])
+         jd_max = jds[i];
+      }
+   almanacs = (SITE_ALMANAC *)calloc( n_sites + 1, sizeof( SITE_ALMANAC));
+   if( !almanacs)
+      {
+      fprintf( stderr, "Couldn't allocate memory for %d sites\n", n_sites);
+      free( lats);
+      return( -2);
+      }
+   t0 = clock( );
+   if( make_posn_table( &sun, 3, jd_min, jd_max + 1., vsop_data))
+      {
+      fprintf( stderr, "Couldn't make position tables\n");
+      free( almanacs);
+      free( lats);
+      return( -3);
+      }
+   if( make_posn_table( &moon, 10, jd_min, jd_max + 1., vsop_data))
+      {
+      fprintf( stderr, "Couldn't make position tables\n");
+      free_posn_table( &sun);
+      free( almanacs);
+      free( lats);
+      return( -3);
+      }
+   find_site_almanacs( &sun, &moon, n_sites, lats, lons, jds, almanacs);
+   fprintf( stderr, "%d sites computed in %.3f seconds (CPU time)\n", n_sites,
+                  (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   printf( "  Lat     Lon     Sun       Moon      Civil     Naut      Astro"
+           "     Transits\n");
+   for( i = 0; i < n_sites; i++)
+      {
+      const SITE_ALMANAC *alm = almanacs + i;
+      const double times[12] = { alm->sun_rise_set[0], alm->sun_rise_set[1],
+                     alm->moon_rise_set[0], alm->moon_rise_set[1],
+                     alm->civil[0], alm->civil[1],
+                     alm->nautical[0], alm->nautical[1],
+                     alm->astronomical[0], alm->astronomical[1],
+                     alm->sun_transit, alm->moon_transit };
+      char buff[128], hh_mm[10];
+      size_t len;
+      int j;
+
+      len = snprintf( buff, sizeof( buff), "%+6.2f %+7.2f ",
+                  lats[i] * 180. / pi, lons[i] * 180. / pi);
+      for( j = 0; j < 12 && len < sizeof( buff); j++)
+         {
+         const double t = (times[j] < 0. ? -1. : times[j] - jds[i]);
+
+         format_hh_mm( hh_mm, t);
+         len += snprintf( buff + len, sizeof( buff) - len, "%s%s", hh_mm,
+                           (j == 11 ? "" : (j % 2 ? "  " : " ")));
+         }
+      printf( "%s\n", buff);
+      }
+   free_posn_table( &sun);
+   free_posn_table( &moon);
+   free( almanacs);
+   free( lats);
+   return( 0);
+}
+
 int main( int argc, char **argv)
 {
    char *vsop_data = load_file_into_memory( "vsop.bin", NULL);
-   int i, year = atoi( argv[1]);
+   int i, year, n_days;
    int month_start = 1, month_end = 12, month;
    const double observer_lon = -69.90 * pi / 180.;
    const double observer_lat = 44.01 * pi / 180.;
-
+   const int time_zone = -5;
+   bool benchmark = false, have_lons = false;
+   double grid_step = 0.;
+   const char *zip_filename = NULL;
+   POSN_TABLE tables[2];
+   double lunar_lon[2], solar_lon[2], max_diff = 0.;
+   long jd_start, jd_end;
+   clock_t t0, new_time = 0, old_time = 0;
+   int n_mismatches = 0;
+
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1])
+         {
+         if( argv[i][1] == 'b')
+            benchmark = true;
+         else if( argv[i][1] == 'g')
+            grid_step = (argv[i][2] ? atof( argv[i] + 2) : 1.);
+         else if( argv[i][1] == 'z')
+            zip_filename = argv[i] + 2;
+         else
+            fprintf( stderr, "Option '%s' not recognized\n", argv[i]);
+         memmove( argv + i, argv + i + 1, (argc - i - 1) * sizeof( char *));
+         argc--;
+         i--;
+         }
+   if( argc < 2)
+      {
+      fprintf( stderr, "'tables' needs a year (and optionally a month) as\n"
+               "command-line arguments.  Add '-b' to also compute the times\n"
+               "the older,  slower way,  and compare results and speed.\n\n"
+               "Give a year, month, and day,  plus either '-g(step)' or\n"
+               "'-z(filename)',  to get rise/set,  twilight,  and transit\n"
+               "times for that day for many sites :  either a grid of points\n"
+               "'step' degrees apart,  or the US ZIP codes listed in a file.\n");
+      return( -1);
+      }
+   year = atoi( argv[1]);
    if( !vsop_data)
       {
       printf( "VSOP.BIN wasn't loaded.\n");
       return( -1);
       }
 
+   if( argc > 3 && (grid_step > 0. || zip_filename))
+      {
+      i = site_tables( year, atoi( argv[2]), atoi( argv[3]), grid_step,
+                              zip_filename, vsop_data);
+      free( vsop_data);
+      return( i);
+      }
    if( argc > 2)        /* month specified,  rather than "entire year" */
       month_start = month_end = atoi( argv[2]);
 
+   jd_start = dmy_to_day( 1, month_start, year, 0);
+   if( month_end == 12)
+      jd_end = dmy_to_day( 1, 1, year + 1, 0);
+   else
+      jd_end = dmy_to_day( 1, month_end + 1, year, 0);
+   n_days = (int)( jd_end - jd_start);
+            /* Positions of the sun and moon over the entire span : */
+   t0 = clock( );
+   for( i = 0; i < 2; i++)
+      if( make_posn_table( tables + i, (i ? 10 : 3),
+                  (double)jd_start - .5 - (double)time_zone / 24.,
+                  (double)jd_end - .5 - (double)time_zone / 24., vsop_data))
+         {
+         fprintf( stderr, "Couldn't make position tables\n");
+         return( -1);
+         }
+   new_time = clock( ) - t0;
+
    printf( "       Sun          Moon\n");
    printf( "Day  Rise Set     Rise Set\n");
    for( month = month_start; month <= month_end; month++)
       {
-      long jd_start, jd_end;
-      const int time_zone = -5;
+      long month_jd_start, month_jd_end;
 
-      jd_start = dmy_to_day( 1, month, year, 0);
+      month_jd_start = dmy_to_day( 1, month, year, 0);
       if( month == 12)
-         jd_end = dmy_to_day( 1, 1, year + 1, 0);
+         month_jd_end = dmy_to_day( 1, 1, year + 1, 0);
       else
-         jd_end = dmy_to_day( 1, month + 1, year, 0);
+         month_jd_end = dmy_to_day( 1, month + 1, year, 0);
 
 
-      for( i = 0; i < (int)( jd_end - jd_start); i++)
+      for( i = 0; i < (int)( month_jd_end - month_jd_start); i++)
          {
          double rise_set[4];
-         double lunar_lon[2], solar_lon[2];
-         double jd = (double)( jd_start + i) - .5 - (double)time_zone / 24.;
+         double jd = (double)( month_jd_start + i) - .5
+                                    - (double)time_zone / 24.;
          char buff[80];
          int j, quad0, quad1;
 
          memset( buff, 0, 40);
          assert( i <= 30);
-         get_rise_set_times( rise_set, 3,  jd, observer_lat, observer_lon,
-                                                                vsop_data);
-         get_rise_set_times( rise_set + 2, 10, jd, observer_lat, observer_lon,
-                                                                vsop_data);
-         if( (jd_start + i) % 7 == 6)        /* Sunday */
+         t0 = clock( );
+         find_rise_set_times( tables, rise_set, jd, observer_lat,
+                                                    observer_lon);
+         find_rise_set_times( tables + 1, rise_set + 2, jd, observer_lat,
+                                                    observer_lon);
+         new_time += clock( ) - t0;
+         if( benchmark)
+            {
+            double old_rise_set[4];
+
+            t0 = clock( );
+            get_rise_set_times( old_rise_set, 3,  jd, observer_lat,
+                                          observer_lon, vsop_data);
+            get_rise_set_times( old_rise_set + 2, 10, jd, observer_lat,
+                                          observer_lon, vsop_data);
+            old_time += clock( ) - t0;
+            for( j = 0; j < 4; j++)
+               if( (old_rise_set[j] < 0.) != (rise_set[j] < 0.))
+                  n_mismatches++;
+               else if( fabs( old_rise_set[j] - rise_set[j]) > max_diff)
+                  max_diff = fabs( old_rise_set[j] - rise_set[j]);
+            }
+         if( (month_jd_start + i) % 7 == 6)        /* Sunday */
             strcpy( buff, "Su");
          else
             snprintf( buff, 3, "%2d", i + 1);
@@ -155,7 +407,9 @@ int main( int argc, char **argv)
                }
             }
 
-         for( j = 0; j < 2; j++)
+                  /* The longitudes at the end of one day are those at */
+                  /* the start of the next;  only compute them once.   */
+         for( j = (have_lons ? 1 : 0); j < 2; j++)
             {
             PLANET_DATA pdata;
 
@@ -184,6 +438,9 @@ int main( int argc, char **argv)
 
             strcpy( buff + 29, strings[quad0]);
             }
+         solar_lon[0] = solar_lon[1];
+         lunar_lon[0] = lunar_lon[1];
+         have_lons = true;
 
          for( j = 0; j < 39; j++)
             if( !buff[j])
@@ -191,6 +448,16 @@ int main( int argc, char **argv)
          printf( "%s\n", buff);
          }
       }
+   if( benchmark)
+      {
+      printf( "%d days: %.3f s with position tables,  %.3f s hourly\n",
+                  n_days, (double)new_time / (double)CLOCKS_PER_SEC,
+                  (double)old_time / (double)CLOCKS_PER_SEC);
+      printf( "Max difference %.3f seconds;  %d events found by only one method\n",
+                  max_diff * seconds_per_day, n_mismatches);
+      }
+   for( i = 0; i < 2; i++)
+      free_posn_table( tables + i);
    free( vsop_data);
    return( 0);
 }
@@ -19,16 +19,96 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <time.h>
 #include "watdefs.h"
 #include "afuncs.h"
 
 #define PI 3.1415926535897932384626433832795028841971693993751058209749445923
 
+/* Compares the refraction profile functions to integrated_refraction( )
+over a range of altitudes,  and times them.  For the reverse direction,
+the unrefracted altitude alt - R(alt) should give back R(alt) exactly.
+Run with '-r',  or '-r(arcsec)' to ask for an error bound other than
+the default one arcsecond.
+
+   The profile's error bound is relative to the more careful integration
+it's built from (see refract4.cpp).  integrated_refraction( ) has narrow
+spikes,  mostly near the horizon,  which the profile doesn't follow;  so
+the differences shown here can exceed the bound. */
+
+static int test_profile( const double wavelength_microns,
+            const double height_in_meters, const double rel_humid_pct,
+            const double temp_kelvin, const double pressure_mb,
+            const double max_error_arcsec)
+{
+   const double rad_to_arcsec = 180. * 3600. / PI;
+   const int n_steps = 3000;
+   clock_t t0 = clock( );
+   void *prof = init_refraction_profile( PI / 4., wavelength_microns,
+                  height_in_meters, rel_humid_pct, temp_kelvin, pressure_mb,
+                  max_error_arcsec / rad_to_arcsec);
+   double max_diff = 0., max_rdiff = 0., sum = 0.;
+   int i, used_integrator, n_fallbacks = 0;
+
+   if( !prof)
+      {
+      printf( "Couldn't set up a profile good to %.4f\"\n", max_error_arcsec);
+      return( -1);
+      }
+   printf( "Profile set up in %.3f ms;  error bound %.4f\"\n",
+               (double)( clock( ) - t0) * 1000. / (double)CLOCKS_PER_SEC,
+               refraction_profile_error( prof) * rad_to_arcsec);
+   for( i = 0; i <= n_steps; i++)
+      {
+      const double alt = (double)i * PI / (2. * (double)n_steps);
+      const double ref1 = integrated_refraction( PI / 4., alt,
+                  wavelength_microns, height_in_meters, rel_humid_pct,
+                  temp_kelvin, pressure_mb);
+      double diff = fabs( ref1 - profile_refraction( prof, alt));
+
+      if( max_diff < diff)
+         max_diff = diff;
+      diff = fabs( ref1 - reverse_profile_refraction( prof, alt - ref1, NULL));
+      if( max_rdiff < diff)
+         max_rdiff = diff;
+      }
+   printf( "Max difference %.4f\" forward,  %.4f\" reverse\n",
+               max_diff * rad_to_arcsec, max_rdiff * rad_to_arcsec);
+   t0 = clock( );
+   for( i = 0; i < 1000; i++)
+      sum += integrated_refraction( PI / 4., (double)i * PI / 2000.,
+                  wavelength_microns, height_in_meters, rel_humid_pct,
+                  temp_kelvin, pressure_mb);
+   printf( "integrated_refraction( ): %.3f microseconds/call\n",
+               (double)( clock( ) - t0) * 1000. / (double)CLOCKS_PER_SEC);
+   t0 = clock( );
+   for( i = 0; i < 1000000; i++)
+      sum += profile_refraction( prof, (double)( i % 1000) * PI / 2000.);
+   printf( "profile_refraction( ): %.3f microseconds/call\n",
+               (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   t0 = clock( );
+   for( i = 0; i < 1000000; i++)
+      {
+      sum += reverse_profile_refraction( prof, (double)( i % 1000) * PI / 2000.,
+                  &used_integrator);
+      n_fallbacks += used_integrator;
+      }
+   printf( "reverse_profile_refraction( ): %.3f microseconds/call\n",
+               (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   if( n_fallbacks)
+      printf( "(%d of 1000 altitudes fell back on the integrator)\n",
+               n_fallbacks / 1000);
+   free_refraction_profile( prof);
+   return( sum == 0.);
+}
+
 int main( const int argc, const char **argv)
 {
-   int i, diff_mode = 0;
+   int i, diff_mode = 0, profile_mode = 0;
    double pressure_mb = 1013.,  temp_kelvin = 293., relative_humidity = .2;
    double wavelength_microns = .574, height_in_meters = 100.;
+   double profile_error_arcsec = 1.;
 // extern double minimum_refractive_altitude;
 
    for( i = 1; i < argc; i++)
@@ -53,6 +133,11 @@ int main( const int argc, const char **argv)
             case 'd':
                diff_mode = 1;
                break;
+            case 'r':
+               profile_mode = 1;
+               if( argv[i][2])
+                  profile_error_arcsec = atof( argv[i] + 2);
+               break;
             default:
                if( i > 1 || atof( argv[1]) == 0.)
                   {
@@ -63,6 +148,9 @@ int main( const int argc, const char **argv)
                   printf( "   -h(fraction) Set relative humidity fraction (default = .2)\n");
                   printf( "   -l(wavelen)  Set wavelength in nanometers (default = 574)\n");
                   printf( "   -a(ht)       Set altitude in meters (default = 100)\n");
+                  printf( "   -d           Show differences from integrated refraction\n");
+                  printf( "   -r(arcsec)   Test and time refraction profiles (default\n"
+                          "                error bound = 1 arcsec)\n");
                   return( -1);
                   }
                break;
@@ -71,6 +159,10 @@ int main( const int argc, const char **argv)
                    pressure_mb, temp_kelvin - 273., relative_humidity * 100.);
    printf( "Wavelength %.1f nm; altitude %.1f meters\n",
                    wavelength_microns * 1000., height_in_meters);
+   if( profile_mode)
+      return( test_profile( wavelength_microns, height_in_meters,
+                  100. * relative_humidity, temp_kelvin, pressure_mb,
+                  profile_error_arcsec));
    for( i = (argc == 1 ? 0 : -1); i < 90; i++)
       if( i < 5 || i % 5 == 0)
          {
@@ -106,19 +106,21 @@ int main( int argc, char **argv)
    int nSat;                     // loop counter
    const char *sat_names[5] = {
          "Ariel", "Umbriel", "Titania", "Oberon", "Miranda" };
+   double all_rects[30];         // satellite coordinates
+
+   // Retrieve the coordinates of the satellites relative to the
+   // centre of Uranus. These are equatorial coordinates for the
+   // mean ecliptic and epoch of J2000.0.  Positions in AU,
+   // velocities in AU/second.  Printed out in km and km/s.
+
+   gust86_posns( jde, all_rects);
 
    // Process each satellite in turn.
 
    for (nSat=0; nSat<5; nSat++)
    {
-      double dRect[6];               // satellite coordinates
-
-      // Retrieve the coordinates of the satellite relative to the
-      // centre of Saturn. These are equatorial coordinates for the
-      // mean ecliptic and epoch of J2000.0.  Positions in AU,
-      // velocities in AU/second.  Printed out in km and km/s.
+      double *dRect = all_rects + nSat * 6;
 
-      gust86_posn( jde, nSat, dRect );
       if( test_differences)
          subtract_test_data( dRect, nSat, 0);
       printf( "%d %-8s: %14.6f %14.6f %14.6f\n", nSat, sat_names[nSat],
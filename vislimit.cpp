@@ -95,6 +95,7 @@ See the 'test program' below for example usage. */
 #endif
 
 #include <math.h>
+#include <stdlib.h>
 #include "vislimit.h"
 
 #define MAG_TO_BRIGHTNESS( X) (exp( -.4 * (X) * LOG_10))
@@ -197,33 +198,155 @@ int DLL_FUNC set_brightness_params( BRIGHTNESS_DATA *b)
 }
 
 
+   /* Everything in the sky brightness computation that depends only on
+the time and place,  not on the direction in the sky,  is gathered into
+a sky_consts_t.  compute_sky_brightness( ) builds one for each point,
+as before;  compute_sky_points( ) and compute_sky_grid( ) build one and
+use it for every point.  */
+
+typedef struct
+{
+   double base[5];            /* base sky brightness,  with solar cycle */
+   double moon[5];            /* lunar brightness,  before scattering */
+   double c3[5], c4[5];
+   double twilight_mag[5], twilight_loss[5];
+   double daylight[5];
+   double lunar_fadeout;      /* dims the moon as it goes below horizon */
+   const double *k;
+} sky_consts_t;
+
+static void set_sky_consts( sky_consts_t *c, const BRIGHTNESS_DATA *b,
+                                                const int mask)
+{
+   const double lunar_alt = PI / 2. - b->zenith_ang_moon;
+   const double lunar_fadeout_fudge = 100.;
+                    /* above is arbitrarily chosen to make the lunar */
+                    /* contribution fade as the moon goes below the horizon */
+   int i;
+
+   c->k = b->k;
+   c->lunar_fadeout = 1.;
+   if( lunar_alt < 0.)                   /* moon is below horizon */
+      c->lunar_fadeout = exp( lunar_fadeout_fudge * lunar_alt);
+   for( i = 0; i < 5; i++)
+      if( (mask >> i) & 1)
+         {
+         static const double bo[5] = {8.0e-14, 7.e-14, 1.e-13, 1.e-13, 3.e-13};
+               /* Base sky brightness in each band */
+         static const double cm[5] = {1.36, 0.91, 0.00, -0.76, -1.17 };
+               /* Correction to moon's magnitude */
+         static const double ms[5] = {-25.96, -26.09, -26.74, -27.26, -27.55 };
+               /* Solar magnitude? */
+         static const double mo[5] = {-10.93, -10.45, -11.05, -11.90, -12.70 };
+               /* Lunar magnitude? */
+
+         c->base[i] = bo[i] * b->year_term;
+         c->moon[i] = MAG_TO_BRIGHTNESS( b->lunar_mag + cm[i] - mo[i] + 43.27);
+         c->c3[i] = b->c3[i];
+         c->c4[i] = b->c4[i];
+         c->twilight_mag[i] = ms[i] - mo[i] + 32.5 -
+                           (90. - b->zenith_ang_sun * 180. / PI);
+         c->twilight_loss[i] = 1. - MAG_TO_BRIGHTNESS( b->k[i]);
+                  /* preceding line looks suspicious to me... line 2290 */
+         c->daylight[i] = MAG_TO_BRIGHTNESS( ms[i] - mo[i] + 43.27);
+                     /* line 2340 */
+         }
+}
+
+/* Computes brightnesses in the bands given by 'mask' for one point in
+the sky,  returning the air mass to that point.  */
+
+static double sky_point_brightness( const sky_consts_t *c, const int mask,
+            const double zenith_angle, const double dist_moon,
+            const double dist_sun, double *brightness)
+{
+   const double sin_zenith = sin( zenith_angle);
+   const double brightness_drop_2150 =
+                 .4 + .6 / sqrt( 1.0 - .96 * sin_zenith * sin_zenith);
+               /* Not sure what this is.. line 2150 in B Schaefer code */
+               /* Probably means there's a drop in brightness as one   */
+               /* moves away from the zenith toward the horizon?       */
+   const double fm = compute_f_factor( dist_moon);
+   const double fs = compute_f_factor( dist_sun);
+   const double air_mass = compute_air_mass( zenith_angle);
+   int i;
+
+   for( i = 0; i < 5; i++)
+      if( (mask >> i) & 1)
+         {
+         const double direct_loss = MAG_TO_BRIGHTNESS( c->k[i] * air_mass);
+         const double bn = c->base[i] * brightness_drop_2150 * direct_loss;
+         double twilight_brightness;
+         double brightness_daylight;
+         double brightness_moon = c->moon[i];
+
+         brightness_moon *= (1. - direct_loss);
+                  /* Maybe computing how much of the lunar light gets */
+                  /* scattered?   2240 */
+         brightness_moon *= (fm * c->c3[i] + 440000. * (1. - c->c3[i]));
+         brightness_moon *= c->lunar_fadeout;
+         twilight_brightness = c->twilight_mag[i]
+                           - zenith_angle / (2 * PI * c->k[i]);
+                  /* above is in magnitudes,  so gotta do this: */
+         twilight_brightness = MAG_TO_BRIGHTNESS( twilight_brightness);
+                  /* above is line 2280,  B Schaefer code */
+         twilight_brightness *= 100. / (dist_sun * 180. / PI);
+         twilight_brightness *= c->twilight_loss[i];
+         brightness_daylight = c->daylight[i];
+         brightness_daylight *= (1. - direct_loss);
+                     /* line 2350 */
+         brightness_daylight *= fs * c->c4[i] + 440000. * (1. - c->c4[i]);
+         brightness[i] = bn + brightness_moon +
+                     min( brightness_daylight, twilight_brightness);
+#ifdef TEST_STATEMENTS
+         printf( "Brightnesses (%d): base %lg  moon %lg   twil %lg   sun %lg\n", i, bn,
+                  brightness_moon, twilight_brightness, brightness_daylight);
+#endif
+         }
+   return( air_mass);
+}
+
    /* If all you want is the sky brightness,  all the data concerning */
    /* separate air masses for gas, aerosols,  and ozone and such is   */
    /* an unnecessary drain on computation.  So that's broken out as a */
    /* separate process in compute_extinction( ). */
 
-int DLL_FUNC compute_extinction( BRIGHTNESS_DATA *b)
+static void sky_point_extinction( const BRIGHTNESS_DATA *b, const int mask,
+               const double zenith_angle, double *air_masses,
+               double *extinction)
 {
-   const double cos_zenith_ang = cos( b->zenith_angle);
-   const double tval = sin( b->zenith_angle) / (1. + 20. / 6378.);
+   const double cos_zenith_ang = cos( zenith_angle);
+   const double tval = sin( zenith_angle) / (1. + 20. / 6378.);
    int i;
 
-   b->air_mass_gas =
+   air_masses[0] =         /* gas */
                1. / (cos_zenith_ang + .0286 * exp( -10.5 * cos_zenith_ang));
-   b->air_mass_aerosol =
+   air_masses[1] =         /* aerosol */
                1. / (cos_zenith_ang + .0123 * exp( -24.5 * cos_zenith_ang));
-   b->air_mass_ozone = 1. / sqrt( 1. - tval * tval);
+   air_masses[2] = 1. / sqrt( 1. - tval * tval);      /* ozone */
    for( i = 0; i < 5; i++)
-      if( (b->mask >> i) & 1)
-         b->extinction[i] = (b->kr[i] + b->kw[i]) * b->air_mass_gas +
-                             b->ka[i] * b->air_mass_aerosol +
-                             b->ko[i] * b->air_mass_ozone;
+      if( (mask >> i) & 1)
+         extinction[i] = (b->kr[i] + b->kw[i]) * air_masses[0] +
+                             b->ka[i] * air_masses[1] +
+                             b->ko[i] * air_masses[2];
+}
+
+int DLL_FUNC compute_extinction( BRIGHTNESS_DATA *b)
+{
+   double air_masses[3];
+
+   sky_point_extinction( b, b->mask, b->zenith_angle, air_masses,
+                                             b->extinction);
+   b->air_mass_gas = air_masses[0];
+   b->air_mass_aerosol = air_masses[1];
+   b->air_mass_ozone = air_masses[2];
    return( 0);
 }
 
-double DLL_FUNC compute_limiting_mag( BRIGHTNESS_DATA *b)
+static double limiting_mag( const double v_brightness,
+                            const double v_extinction)
 {
-   const double bl = b->brightness[2] / 1.11e-15;
+   const double bl = v_brightness / 1.11e-15;
    double c1, c2;
    double th, tval, rval;
 
@@ -239,85 +362,182 @@ double DLL_FUNC compute_limiting_mag( BRIGHTNESS_DATA *b)
       }
    tval = 1. + sqrt( c2 * bl);
    th = c1 * tval * tval;        /* brightness in foot-candles? */
-   rval = -16.57 + BRIGHTNESS_TO_MAG( th) - b->extinction[2];
+   rval = -16.57 + BRIGHTNESS_TO_MAG( th) - v_extinction;
    return( rval);
 }
 
+double DLL_FUNC compute_limiting_mag( BRIGHTNESS_DATA *b)
+{
+   return( limiting_mag( b->brightness[2], b->extinction[2]));
+}
+
 int DLL_FUNC compute_sky_brightness( BRIGHTNESS_DATA *b)
 {
-   const double sin_zenith = sin( b->zenith_angle);
-   const double brightness_drop_2150 =
-                 .4 + .6 / sqrt( 1.0 - .96 * sin_zenith * sin_zenith);
-               /* Not sure what this is.. line 2150 in B Schaefer code */
-               /* Probably means there's a drop in brightness as one   */
-               /* moves away from the zenith toward the horizon?       */
-   const double fm = compute_f_factor( b->dist_moon);
-   const double fs = compute_f_factor( b->dist_sun);
+   sky_consts_t c;
+
+   set_sky_consts( &c, b, b->mask);
+   b->air_mass = sky_point_brightness( &c, b->mask, b->zenith_angle,
+                        b->dist_moon, b->dist_sun, b->brightness);
+   return( 0);
+}
+
+/* Computes brightness (in the bands given by b->mask) for each of
+'n_points' directions.  If the V band is included,  extinction and
+limiting magnitude are computed as well.  'b' must have been run through
+set_brightness_params( ).  The points can be anything;  e.g.,  HEALPix
+pixel centers (the caller supplies zenith angle and angular distances
+from the sun and moon).  */
+
+int DLL_FUNC compute_sky_points( const BRIGHTNESS_DATA *b,
+                           const int n_points, SKY_POINT *points)
+{
+   sky_consts_t c;
    int i;
 
-   b->air_mass = compute_air_mass( b->zenith_angle);
-   for( i = 0; i < 5; i++)
-      if( (b->mask >> i) & 1)
+   set_sky_consts( &c, b, b->mask);
+#ifdef _OPENMP
+   #pragma omp parallel for
+#endif
+   for( i = 0; i < n_points; i++)
+      {
+      SKY_POINT *p = points + i;
+
+      sky_point_brightness( &c, b->mask, p->zenith_angle, p->dist_moon,
+                                 p->dist_sun, p->brightness);
+      if( b->mask & 4)
          {
-         static const double bo[5] = {8.0e-14, 7.e-14, 1.e-13, 1.e-13, 3.e-13};
-               /* Base sky brightness in each band */
-         static const double cm[5] = {1.36, 0.91, 0.00, -0.76, -1.17 };
-               /* Correction to moon's magnitude */
-         static const double ms[5] = {-25.96, -26.09, -26.74, -27.26, -27.55 };
-               /* Solar magnitude? */
-         static const double mo[5] = {-10.93, -10.45, -11.05, -11.90, -12.70 };
-               /* Lunar magnitude? */
-         const double lunar_alt = PI / 2. - b->zenith_ang_moon;
-         const double lunar_fadeout_fudge = 100.;
-                    /* above is arbitrarily chosen to make the lunar */
-                    /* contribution fade as the moon goes below the horizon */
-         const double direct_loss = MAG_TO_BRIGHTNESS( b->k[i] * b->air_mass);
-         const double bn =
-                 bo[i] * b->year_term * brightness_drop_2150 * direct_loss;
-         double twilight_brightness;
-         double brightness_daylight;
-         double brightness_moon =
-                   MAG_TO_BRIGHTNESS( b->lunar_mag + cm[i] - mo[i] + 43.27);
+         double air_masses[3];
 
-         brightness_moon *= (1. - direct_loss);
-                  /* Maybe computing how much of the lunar light gets */
-                  /* scattered?   2240 */
-         brightness_moon *= (fm * b->c3[i] + 440000. * (1. - b->c3[i]));
-         if( lunar_alt < 0.)                   /* moon is below horizon */
-            brightness_moon *= exp( lunar_fadeout_fudge * lunar_alt);
-         twilight_brightness = ms[i] - mo[i] + 32.5 -
-                           (90. - b->zenith_ang_sun * 180. / PI) -
-                           b->zenith_angle / (2 * PI * b->k[i]);
-                  /* above is in magnitudes,  so gotta do this: */
-         twilight_brightness = MAG_TO_BRIGHTNESS( twilight_brightness);
-                  /* above is line 2280,  B Schaefer code */
-         twilight_brightness *= 100. / (b->dist_sun * 180. / PI);
-         twilight_brightness *= 1. - MAG_TO_BRIGHTNESS( b->k[i]);
-                  /* preceding line looks suspicious to me... line 2290 */
-         brightness_daylight = MAG_TO_BRIGHTNESS( ms[i] - mo[i] + 43.27);
-                     /* line 2340 */
-         brightness_daylight *= (1. - direct_loss);
-                     /* line 2350 */
-         brightness_daylight *= fs * b->c4[i] + 440000. * (1. - b->c4[i]);
-         b->brightness[i] = bn + brightness_moon +
-                     min( brightness_daylight, twilight_brightness);
-#ifdef TEST_STATEMENTS
-         printf( "Brightnesses (%d): base %lg  moon %lg   twil %lg   sun %lg\n", i, bn,
-                  brightness_moon, twilight_brightness, brightness_daylight);
+         sky_point_extinction( b, b->mask, p->zenith_angle, air_masses,
+                                    p->extinction);
+         p->limiting_mag = limiting_mag( p->brightness[2], p->extinction[2]);
+         }
+      }
+   return( 0);
+}
+
+/* Computes brightness for an n_alt x n_az grid covering the sky above
+the horizon.  Row i is at altitude (i + .5) * 90 / n_alt degrees;  column
+j is at azimuth j * 360 / n_az degrees,  measured the same way as the
+sun and moon azimuths (radians) passed in.  Brightnesses for point (i, j)
+are stored at brightness[(i * n_az + j) * 5 + band],  for the bands in
+b->mask.  If limiting_mag is non-NULL,  limiting magnitudes are stored
+there (and the V band is computed,  whether in the mask or not).  */
+
+int DLL_FUNC compute_sky_grid( const BRIGHTNESS_DATA *b,
+            const double moon_azimuth, const double sun_azimuth,
+            const int n_alt, const int n_az,
+            double *brightness, double *limiting_mag_grid)
+{
+   const int mask = b->mask | (limiting_mag_grid ? 4 : 0);
+   const double cos_zm = cos( b->zenith_ang_moon);
+   const double sin_zm = sin( b->zenith_ang_moon);
+   const double cos_zs = cos( b->zenith_ang_sun);
+   const double sin_zs = sin( b->zenith_ang_sun);
+   double *cos_daz = (double *)malloc( 2 * n_az * sizeof( double));
+   sky_consts_t c;
+   int i;
+
+   if( !cos_daz)
+      return( -1);
+   for( i = 0; i < n_az; i++)
+      {
+      const double az = 2. * PI * (double)i / (double)n_az;
+
+      cos_daz[i] = cos( az - moon_azimuth);
+      cos_daz[i + n_az] = cos( az - sun_azimuth);
+      }
+   set_sky_consts( &c, b, mask);
+#ifdef _OPENMP
+   #pragma omp parallel for
 #endif
+   for( i = 0; i < n_alt; i++)
+      {
+      const double zenith_angle = PI / 2. - ((double)i + .5) * PI / 2.
+                                                / (double)n_alt;
+      const double cos_z = cos( zenith_angle), sin_z = sin( zenith_angle);
+      double extinction[5], air_masses[3];
+      int j;
+
+      if( limiting_mag_grid)
+         sky_point_extinction( b, 4, zenith_angle, air_masses, extinction);
+      for( j = 0; j < n_az; j++)
+         {
+         const double cos_dm = cos_z * cos_zm + sin_z * sin_zm * cos_daz[j];
+         const double cos_ds = cos_z * cos_zs
+                             + sin_z * sin_zs * cos_daz[j + n_az];
+         double *bptr = brightness + (i * n_az + j) * 5;
+
+         sky_point_brightness( &c, mask, zenith_angle,
+                  acos( cos_dm > 1. ? 1. : (cos_dm < -1. ? -1. : cos_dm)),
+                  acos( cos_ds > 1. ? 1. : (cos_ds < -1. ? -1. : cos_ds)),
+                  bptr);
+         if( limiting_mag_grid)
+            limiting_mag_grid[i * n_az + j] =
+                           limiting_mag( bptr[2], extinction[2]);
          }
+      }
+   free( cos_daz);
    return( 0);
 }
 
 #ifdef TEST_PROGRAM
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+
+/* Computes a 1-degree grid of the sky (moon at azimuth 0,  sun at 180)
+with compute_sky_grid( ),  then again a point at a time,  and reports
+times and the largest difference.  */
+
+static void grid_test( BRIGHTNESS_DATA *b)
+{
+   const int n_alt = 90, n_az = 360;
+   double *brightness = (double *)malloc( n_alt * n_az * 6 * sizeof( double));
+   double *lim_mag = brightness + n_alt * n_az * 5, max_diff = 0.;
+   clock_t t0 = clock( );
+   int i, j, k;
+
+   compute_sky_grid( b, 0., PI, n_alt, n_az, brightness, lim_mag);
+   printf( "Grid: %.3f s\n", (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   t0 = clock( );
+   for( i = 0; i < n_alt; i++)
+      for( j = 0; j < n_az; j++)
+         {
+         const double alt = ((double)i + .5) * PI / 2. / (double)n_alt;
+         const double az = 2. * PI * (double)j / (double)n_az;
+         const double cos_dm = sin( alt) * cos( b->zenith_ang_moon)
+               + cos( alt) * sin( b->zenith_ang_moon) * cos( az);
+         const double cos_ds = sin( alt) * cos( b->zenith_ang_sun)
+               - cos( alt) * sin( b->zenith_ang_sun) * cos( az);
+         double diff;
+
+         b->zenith_angle = PI / 2. - alt;
+         b->dist_moon = acos( cos_dm);
+         b->dist_sun = acos( cos_ds);
+         compute_sky_brightness( b);
+         compute_extinction( b);
+         for( k = 0; k < 5; k++)
+            {
+            diff = fabs( b->brightness[k] / brightness[(i * n_az + j) * 5 + k] - 1.);
+            if( max_diff < diff)
+               max_diff = diff;
+            }
+         diff = fabs( compute_limiting_mag( b) - lim_mag[i * n_az + j]);
+         if( max_diff < diff)
+            max_diff = diff;
+         }
+   printf( "Point by point: %.3f s;  max difference %g\n",
+               (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC, max_diff);
+   free( brightness);
+}
 
 int main( const int argc, const char **argv)
 {
    BRIGHTNESS_DATA b;
    int i;
    const char *band_name = "UBVRI";
+   bool show_grid = false;
 
    b.zenith_ang_moon = 40. * PI / 180.;
    b.zenith_ang_sun = 105. * PI / 180.;
@@ -359,6 +579,9 @@ int main( const int argc, const char **argv)
             case 't':
                b.temperature_in_c = atof( argv[i] + 2);
                break;
+            case 'g':
+               show_grid = true;
+               break;
             default:
                printf( "Option '%s' not recognized\n", argv[i]);
                break;
@@ -377,6 +600,8 @@ int main( const int argc, const char **argv)
                   brightness_in_mags_per_sq_arcsec, b.extinction[i]);
       }
    printf( "Limiting magnitude: %.5lf\n", compute_limiting_mag( &b));
+   if( show_grid)
+      grid_test( &b);
    return( 0);
 }
 #endif
@@ -51,6 +51,22 @@ BRIGHTNESS_DATA
    };
 #pragma pack( )
 
+/* For maps of the sky,  one sets up a BRIGHTNESS_DATA for the time and
+place and calls set_brightness_params( ) as usual.  The per-direction
+values above are then ignored;  instead,  each direction gets a
+SKY_POINT,  and compute_sky_points( ) or compute_sky_grid( ) fill in
+brightnesses in the bands given by b->mask (and,  if V is among them,
+extinction and limiting magnitude) for all of them at once.  */
+
+#define SKY_POINT struct sky_point
+
+SKY_POINT
+   {
+   double zenith_angle, dist_moon, dist_sun;    /* inputs */
+   double brightness[5], extinction[5];         /* outputs */
+   double limiting_mag;
+   };
+
 #ifdef _WIN32
 #define DLL_FUNC __stdcall
 #else
@@ -65,6 +81,12 @@ int DLL_FUNC set_brightness_params( BRIGHTNESS_DATA *b);
 int DLL_FUNC compute_sky_brightness( BRIGHTNESS_DATA *b);
 double DLL_FUNC compute_limiting_mag( BRIGHTNESS_DATA *b);
 int DLL_FUNC compute_extinction( BRIGHTNESS_DATA *b);
+int DLL_FUNC compute_sky_points( const BRIGHTNESS_DATA *b,
+                           const int n_points, SKY_POINT *points);
+int DLL_FUNC compute_sky_grid( const BRIGHTNESS_DATA *b,
+            const double moon_azimuth, const double sun_azimuth,
+            const int n_alt, const int n_az,
+            double *brightness, double *limiting_mag);
 
 #ifdef __cplusplus
 }